@@ -159,6 +159,25 @@ typedef enum {
 
 #define ASOCK_PEEK(a)   (a->flags & ASOCK_FLAG_PEEK)
 
+/*
+ * Most queued buffers handed to the kernel by a single sendmsg().
+ */
+#define ASOCK_MAX_SEND_IOVECS 64
+
+/*
+ * Largest TLS record payload. Small queued buffers are copied together up
+ * to this size so that each SSL_Write produces one full record instead of
+ * one record per buffer.
+ */
+#define ASOCK_SSL_RECORD_SIZE 16384
+
+#ifdef USE_SSL_DIRECT
+/* The sslDirect stubs write in the clear: the socket is never encrypted. */
+#define ASOCK_IS_ENCRYPTED(a) FALSE
+#else
+#define ASOCK_IS_ENCRYPTED(a) SSL_IsEncrypted((a)->sslSock)
+#endif
+
 /* Local types. */
 
 /*
@@ -216,6 +235,22 @@ typedef struct AsyncTCPSocket {
    SendBufList *sendBufList;
    SendBufList **sendBufTail;
    int sendPos;
+
+   /*
+    * Copy of the first sslPackLen unsent bytes of sendBufList, being written
+    * with SSL_Write. SSL_Write has to be retried with the same data, so the
+    * copy is kept until all of it is written.
+    */
+   uint8 *sslPackBuf;
+   int sslPackLen;
+   int sslPackPos;
+
+   /*
+    * An SSL_Write of the unsent part of the head of sendBufList did not
+    * complete. It has to be retried with the same buffer and length, so
+    * packing is not used until it completes.
+    */
+   Bool sslWritePending;
    Bool sendCb;
    Bool sendCbTimer;
    Bool sendCbRT;
@@ -4032,6 +4067,158 @@ AsyncTCPSocketPassFd(int socket,  // IN:
 }
 
 
+/*
+ *----------------------------------------------------------------------------
+ *
+ * AsyncTCPSocketAdvanceSendPos --
+ *
+ *      Account for 'sent' bytes written from the head of the send buffer
+ *      list, which may span several buffers, and fire the callbacks of the
+ *      buffers that are now fully sent.
+ *
+ * Results:
+ *      ASOCKERR_SUCCESS, or ASOCKERR_CLOSED if a callback closed the socket.
+ *
+ * Side effects:
+ *      Send callbacks.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static int
+AsyncTCPSocketAdvanceSendPos(AsyncTCPSocket *s,   // IN
+                             ssize_t sent)        // IN
+{
+   while (sent > 0) {
+      SendBufList *head = s->sendBufList;
+      int left = head->len - s->sendPos;
+      int result;
+
+      ASSERT(head->passFd == -1);
+
+      if (sent < left) {
+         s->sendPos += sent;
+         break;
+      }
+
+      sent -= left;
+      s->sendPos = head->len;
+      result = AsyncTCPSocketDispatchSentBuffer(s);
+      if (result != ASOCKERR_SUCCESS) {
+         return result;
+      }
+   }
+
+   return ASOCKERR_SUCCESS;
+}
+
+
+#ifndef _WIN32
+/*
+ *----------------------------------------------------------------------------
+ *
+ * AsyncTCPSocketSendGathered --
+ *
+ *      Write as many queued buffers as possible with a single sendmsg(),
+ *      stopping at the first file descriptor to pass.
+ *
+ * Results:
+ *      The number of bytes written, or -1 with the error in errno.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static ssize_t
+AsyncTCPSocketSendGathered(AsyncTCPSocket *s)  // IN
+{
+   struct iovec iov[ASOCK_MAX_SEND_IOVECS];
+   struct msghdr msghdr = {0};
+   SendBufList *cur;
+   int pos = s->sendPos;
+   size_t total = 0;
+   int n = 0;
+
+   for (cur = s->sendBufList;
+        cur != NULL && cur->passFd == -1 && n < ARRAYSIZE(iov);
+        cur = cur->next) {
+      size_t len = cur->len - pos;
+
+      /* Keep the result representable as an int-sized send count. */
+      if (n > 0 && total + len > MAX_INT32) {
+         break;
+      }
+      iov[n].iov_base = (uint8 *)cur->buf + pos;
+      iov[n].iov_len = len;
+      total += len;
+      n++;
+      pos = 0;
+   }
+
+   msghdr.msg_iov = iov;
+   msghdr.msg_iovlen = n;
+
+   return sendmsg(SSL_GetFd(s->sslSock), &msghdr, 0);
+}
+#endif
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * AsyncTCPSocketSendPacked --
+ *
+ *      Write queued buffers with SSL_Write, packing small ones together into
+ *      records of up to ASOCK_SSL_RECORD_SIZE bytes.
+ *
+ * Results:
+ *      The number of bytes written, or the SSL_Write error.
+ *
+ * Side effects:
+ *      Allocates or frees the packing buffer.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static ssize_t
+AsyncTCPSocketSendPacked(AsyncTCPSocket *s)  // IN
+{
+   ssize_t sent;
+
+   if (s->sslPackBuf == NULL) {
+      SendBufList *cur;
+      int pos = s->sendPos;
+      int len = 0;
+
+      s->sslPackBuf = Util_SafeMalloc(ASOCK_SSL_RECORD_SIZE);
+      for (cur = s->sendBufList;
+           cur != NULL && cur->passFd == -1 && len < ASOCK_SSL_RECORD_SIZE;
+           cur = cur->next) {
+         int chunk = MIN(cur->len - pos, ASOCK_SSL_RECORD_SIZE - len);
+
+         memcpy(s->sslPackBuf + len, (uint8 *)cur->buf + pos, chunk);
+         len += chunk;
+         pos = 0;
+      }
+      s->sslPackLen = len;
+      s->sslPackPos = 0;
+   }
+
+   sent = SSL_Write(s->sslSock, (char *)s->sslPackBuf + s->sslPackPos,
+                    s->sslPackLen - s->sslPackPos);
+   if (sent > 0 && (s->sslPackPos += sent) == s->sslPackLen) {
+      free(s->sslPackBuf);
+      s->sslPackBuf = NULL;
+      s->sslPackLen = 0;
+      s->sslPackPos = 0;
+   }
+
+   return sent;
+}
+
+
 /*
  *----------------------------------------------------------------------------
  *
@@ -4071,15 +4258,30 @@ AsyncTCPSocketWriteBuffers(AsyncTCPSocket *s)  // IN
    while (s->sendBufList && AsyncTCPSocketGetState(s) == AsyncSocketConnected) {
       SendBufList *head = s->sendBufList;
       int error = 0;
-      int sent = 0;
+      ssize_t sent = 0;
+      Bool direct = FALSE;
       int left = head->len - s->sendPos;
-      int sizeToSend = head->len;
+      Bool multi = head->passFd == -1 && head->next != NULL &&
+                   head->next->passFd == -1;
 
-      if (head->passFd == -1) {
+      /*
+       * Several plain buffers are queued: hand them all to the kernel at
+       * once, or pack the small ones into full records for SSL. An SSL_Write
+       * that has to be retried is always retried as it was issued.
+       */
+      if (s->sslPackBuf != NULL ||
+          (multi && left < ASOCK_SSL_RECORD_SIZE && ASOCK_IS_ENCRYPTED(s) &&
+           !s->sslWritePending)) {
+         sent = AsyncTCPSocketSendPacked(s);
+#ifndef _WIN32
+      } else if (multi && !ASOCK_IS_ENCRYPTED(s)) {
+         sent = AsyncTCPSocketSendGathered(s);
+#endif
+      } else if (head->passFd == -1) {
          sent = SSL_Write(s->sslSock,
                           (uint8 *) head->buf + s->sendPos, left);
+         direct = TRUE;
       } else {
-         sizeToSend = 1;
          sent = AsyncTCPSocketPassFd(s->fd, head->passFd);
       }
       /*
@@ -4087,15 +4289,20 @@ AsyncTCPSocketWriteBuffers(AsyncTCPSocket *s)  // IN
        * unless you can preserve the system error number
        */
       if (sent > 0) {
-         TCPSOCKLOG(3, s, "left\t%d\tsent\t%d\tremain\t%d\n",
+         TCPSOCKLOG(3, s, "left\t%d\tsent\t%"FMTSZ"d\tremain\t%"FMTSZ"d\n",
                     left, sent, left - sent);
          s->sendBufFull = FALSE;
          s->sslConnected = TRUE;
-         if ((s->sendPos += sent) == sizeToSend) {
+         s->sslWritePending = FALSE;
+         if (head->passFd != -1) {
+            /* The descriptor is passed along with a single byte. */
+            s->sendPos = 1;
             result = AsyncTCPSocketDispatchSentBuffer(s);
-            if (result != ASOCKERR_SUCCESS) {
-               goto exit;
-            }
+         } else {
+            result = AsyncTCPSocketAdvanceSendPos(s, sent);
+         }
+         if (result != ASOCKERR_SUCCESS) {
+            goto exit;
          }
       } else if (sent == 0) {
          TCPSOCKLG0(s, "socket write() should never return 0.\n");
@@ -4119,6 +4326,7 @@ AsyncTCPSocketWriteBuffers(AsyncTCPSocket *s)  // IN
           */
 
          s->sendBufFull = TRUE;
+         s->sslWritePending = direct && ASOCK_IS_ENCRYPTED(s);
          break;
       }
    }
@@ -5008,6 +5216,12 @@ AsyncTCPSocketCancelSendCb(AsyncTCPSocket *asock)  // IN:
     * handler invoked.
     */
 
+   free(asock->sslPackBuf);
+   asock->sslPackBuf = NULL;
+   asock->sslPackLen = 0;
+   asock->sslPackPos = 0;
+   asock->sslWritePending = FALSE;
+
    while (asock->sendBufList) {
       /*
        * Pop each remaining buffer and fire its completion callback.
@@ -6735,6 +6949,7 @@ AsyncTCPSocketGetOption(AsyncSocket *asyncSocket,     // IN/OUT
 static void
 AsyncTCPSocketDestroy(AsyncSocket *base)         // IN/OUT
 {
+   free(TCPSocket(base)->sslPackBuf);
    free(base);
 }
 
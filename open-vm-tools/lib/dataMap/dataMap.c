@@ -495,9 +495,10 @@ EncodeString(char **buf,         // IN/OUT
 /*
  *-----------------------------------------------------------------------------
  *
- * DecodeString --
+ * DecodeStringRef --
  *
- *      - low level helper function to decode a string from  a byte buffer
+ *      - low level helper function to locate a string in a byte buffer
+ *        without copying it. The string is not NUL terminated.
  *
  * Result:
  *      None
@@ -509,10 +510,10 @@ EncodeString(char **buf,         // IN/OUT
  */
 
 static ErrorCode
-DecodeString(char **buf,         // IN/OUT
-             int32 *left,        // IN/OUT
-             char **str,         // OUT
-             int32 *strLen)      // OUT
+DecodeStringRef(char **buf,         // IN/OUT
+                int32 *left,        // IN/OUT
+                const char **str,   // OUT
+                int32 *strLen)      // OUT
 {
    ErrorCode res;
 
@@ -530,14 +531,52 @@ DecodeString(char **buf,         // IN/OUT
       return DMERR_TRUNCATED_DATA;
    }
 
+   *str = *buf;
+   *buf += *strLen;
+   *left -= *strLen;
+
+   return res;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * DecodeString --
+ *
+ *      - low level helper function to decode a string from  a byte buffer
+ *        into a newly allocated copy.
+ *
+ * Result:
+ *      None
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static ErrorCode
+DecodeString(char **buf,         // IN/OUT
+             int32 *left,        // IN/OUT
+             char **str,         // OUT
+             int32 *strLen)      // OUT
+{
+   ErrorCode res;
+   const char *ref;
+
+   res = DecodeStringRef(buf, left, &ref, strLen);
+
+   if (res != DMERR_SUCCESS) {
+      return res;
+   }
+
    *str = (char *)malloc(*strLen);
    if (*str == NULL) {
       return DMERR_INSUFFICIENT_MEM;
    }
 
-   memcpy(*str, *buf, *strLen);
-   *buf += *strLen;
-   *left -= *strLen;
+   memcpy(*str, ref, *strLen);
 
    return res;
 }
@@ -1749,6 +1788,81 @@ DataMap_Copy(const DataMap *src,  // IN
 }
 
 
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * SerializedPayloadSize --
+ *
+ *      Compute the size of a serialized map, excluding the leading payload
+ *      length.
+ *
+ * Result:
+ *      0 on success
+ *      error code on failures.
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static ErrorCode
+SerializedPayloadSize(const DataMap *that,   // IN
+                      uint32 *payloadLen)    // OUT
+{
+   ClientData clientData;
+
+   memset(&clientData, 0, sizeof clientData);
+   HashMap_Iterate(that->map, HashMapCalcEntrySizeCb, FALSE, &clientData);
+
+   *payloadLen = clientData.buffLen;
+   return clientData.result;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * SerializeInto --
+ *
+ *      Serialize a map into a buffer of exactly payloadLen + 4 bytes, as
+ *      computed by SerializedPayloadSize.
+ *
+ * Result:
+ *      0 on success
+ *      error code on failures.
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static ErrorCode
+SerializeInto(const DataMap *that,   // IN
+              char *buf,             // OUT
+              uint32 payloadLen)     // IN
+{
+   ClientData clientData;
+
+   memset(&clientData, 0, sizeof clientData);
+   clientData.map = (DataMap *)that;
+   clientData.result = DMERR_SUCCESS;
+   clientData.buffer = buf;
+   clientData.buffLen = payloadLen;
+
+   /* Encode the payload size */
+   EncodeInt32(&(clientData.buffer), payloadLen);
+
+   HashMap_Iterate(that->map, HashMapSerializeEntryCb, FALSE, &clientData);
+
+   /* confidence check, make sure the buffer size is just used up. */
+   ASSERT(clientData.buffLen == 0);
+
+   return clientData.result;
+}
+
+
 /*
  *-----------------------------------------------------------------------------
  *
@@ -1775,7 +1889,8 @@ DataMap_Serialize(const DataMap *that,     // IN
                   char **buf,              // OUT
                   uint32 *bufLen)          // OUT
 {
-   ClientData clientData;
+   ErrorCode res;
+   uint32 payloadLen;
 
    if (that == NULL || buf == NULL || bufLen == NULL) {
       return DMERR_INVALID_ARGS;
@@ -1784,15 +1899,14 @@ DataMap_Serialize(const DataMap *that,     // IN
    ASSERT(that->cookie == magic_cookie);
 
    /* get the buffer size first */
-   memset(&clientData, 0, sizeof clientData);
-   HashMap_Iterate(that->map, HashMapCalcEntrySizeCb, FALSE, &clientData);
-   if (clientData.result != DMERR_SUCCESS) {
-      return clientData.result;
+   res = SerializedPayloadSize(that, &payloadLen);
+   if (res != DMERR_SUCCESS) {
+      return res;
    }
 
    /* 4 bytes is payload length */
-   *bufLen = clientData.buffLen + sizeof(uint32);
-   if (*bufLen < clientData.buffLen) {
+   *bufLen = payloadLen + sizeof(uint32);
+   if (*bufLen < payloadLen) {
       return DMERR_INTEGER_OVERFLOW;
    }
 
@@ -1803,24 +1917,69 @@ DataMap_Serialize(const DataMap *that,     // IN
    }
 
    /* now serialize the map into the buffer */
-   clientData.map = (DataMap *)that;
-   clientData.result = DMERR_SUCCESS;
-   clientData.buffer = *buf;
-
-   /* Encode the payload size */
-   EncodeInt32(&(clientData.buffer), clientData.buffLen);
-
-   HashMap_Iterate(that->map, HashMapSerializeEntryCb, FALSE, &clientData);
-
-   /* confidence check, make sure the buffer size is just used up. */
-   ASSERT(clientData.buffLen == 0);
+   res = SerializeInto(that, *buf, payloadLen);
 
-   if (clientData.result != DMERR_SUCCESS) {
+   if (res != DMERR_SUCCESS) {
       free(*buf);
       *buf = NULL;
       *bufLen = 0;
    }
-   return clientData.result;
+   return res;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * DataMap_SerializeToBuffer --
+ *
+ *      Serialize a map into a caller provided buffer, avoiding the
+ *      allocation done by DataMap_Serialize.
+ *     - 'bufSize': the size of 'buf'.
+ *     - 'bufLen': on success, the number of bytes written to 'buf'. If the
+ *       buffer is too small, the number of bytes needed.
+ *
+ * Result:
+ *     0 on success
+ *     DMERR_BUFFER_TOO_SMALL if the map does not fit.
+ *     error code on other failures.
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+ErrorCode
+DataMap_SerializeToBuffer(const DataMap *that,   // IN
+                          char *buf,             // OUT
+                          uint32 bufSize,        // IN
+                          uint32 *bufLen)        // OUT
+{
+   ErrorCode res;
+   uint32 payloadLen;
+
+   if (that == NULL || buf == NULL || bufLen == NULL) {
+      return DMERR_INVALID_ARGS;
+   }
+
+   ASSERT(that->cookie == magic_cookie);
+
+   res = SerializedPayloadSize(that, &payloadLen);
+   if (res != DMERR_SUCCESS) {
+      return res;
+   }
+
+   *bufLen = payloadLen + sizeof(uint32);
+   if (*bufLen < payloadLen) {
+      return DMERR_INTEGER_OVERFLOW;
+   }
+
+   if (*bufLen > bufSize) {
+      return DMERR_BUFFER_TOO_SMALL;
+   }
+
+   return SerializeInto(that, buf, payloadLen);
 }
 
 
@@ -1989,6 +2148,623 @@ out:
 }
 
 
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * ViewFields --
+ *
+ *      - low level helper function to get the field index of a view.
+ *
+ * Result:
+ *      The field array.
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static const DataMapViewField *
+ViewFields(const DataMapView *view)    // IN
+{
+   return view->extFields != NULL ? view->extFields : view->inlineFields;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * ViewLookup --
+ *
+ *      - low level helper function to find a field in a view. Data maps
+ *        exchanged over the wire hold a handful of fields, so a linear scan
+ *        beats hashing them.
+ *
+ * Result:
+ *      The field, or NULL if it does not exist.
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static const DataMapViewField *
+ViewLookup(const DataMapView *view,    // IN
+           DMKeyType fieldId)          // IN
+{
+   const DataMapViewField *fields = ViewFields(view);
+   int32 i;
+
+   for (i = 0; i < view->numFields; i++) {
+      if (fields[i].fieldId == fieldId) {
+         return &fields[i];
+      }
+   }
+   return NULL;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * ViewAddField --
+ *
+ *      - low level helper function to record a field in a view, moving the
+ *        index to the heap when the inline slots are used up.
+ *
+ * Result:
+ *      0 on success
+ *      error code otherwise
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static ErrorCode
+ViewAddField(DataMapView *view,    // IN/OUT
+             DMKeyType fieldId,    // IN
+             DMFieldType type,     // IN
+             int32 offset)         // IN
+{
+   DataMapViewField *fields;
+
+   if (ViewLookup(view, fieldId) != NULL) {
+      return DMERR_DUPLICATED_FIELD_IDS;
+   }
+
+   if (view->numFields == view->maxFields) {
+      int32 newMax = view->maxFields * 2;
+
+      fields = (DataMapViewField *)malloc(sizeof *fields * newMax);
+      if (fields == NULL) {
+         return DMERR_INSUFFICIENT_MEM;
+      }
+      memcpy(fields, ViewFields(view), sizeof *fields * view->numFields);
+      free(view->extFields);
+      view->extFields = fields;
+      view->maxFields = newMax;
+   }
+
+   fields = view->extFields != NULL ? view->extFields : view->inlineFields;
+   fields[view->numFields].fieldId = fieldId;
+   fields[view->numFields].type = type;
+   fields[view->numFields].offset = offset;
+   view->numFields++;
+
+   return DMERR_SUCCESS;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * ViewSkipValue --
+ *
+ *      - low level helper function to validate an encoded value and step
+ *        over it, applying the same checks as deserialization.
+ *
+ * Result:
+ *      0 on success
+ *      error code otherwise
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static ErrorCode
+ViewSkipValue(char **buf,          // IN/OUT
+              int32 *left,         // IN/OUT
+              DMFieldType type)    // IN
+{
+   ErrorCode res;
+   const char *str;
+   int32 len;
+   int32 i;
+
+   switch (type) {
+      case DMFIELDTYPE_INT64:
+      {
+         int64 val;
+         return DecodeInt64(buf, left, &val);
+      }
+      case DMFIELDTYPE_STRING:
+         return DecodeStringRef(buf, left, &str, &len);
+      case DMFIELDTYPE_INT64LIST:
+      {
+         res = DecodeInt32(buf, left, &len);
+         if (res != DMERR_SUCCESS) {
+            return res;
+         }
+         if (len < 0 || len > *left / sizeof(int64)) {
+            return DMERR_BAD_DATA;
+         }
+         *buf += len * sizeof(int64);
+         *left -= len * sizeof(int64);
+         return DMERR_SUCCESS;
+      }
+      case DMFIELDTYPE_STRINGLIST:
+      {
+         int32 listSize;
+         res = DecodeInt32(buf, left, &listSize);
+         if (res != DMERR_SUCCESS) {
+            return res;
+         }
+         if (listSize < 0 || listSize > *left / sizeof(int32)) {
+            return DMERR_BAD_DATA;
+         }
+         for (i = 0; i < listSize; i++) {
+            res = DecodeStringRef(buf, left, &str, &len);
+            if (res != DMERR_SUCCESS) {
+               return res;
+            }
+         }
+         return DMERR_SUCCESS;
+      }
+      default:
+         return DMERR_UNKNOWN_TYPE;
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * ViewLocate --
+ *
+ *      - low level helper function to find a field of the given type and
+ *        position a decoder at its value.
+ *
+ * Result:
+ *      0 on success
+ *      DMERR_NOT_FOUND or DMERR_TYPE_MISMATCH otherwise
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static ErrorCode
+ViewLocate(const DataMapView *view,    // IN
+           DMKeyType fieldId,          // IN
+           DMFieldType type,           // IN
+           char **buf,                 // OUT
+           int32 *left)                // OUT
+{
+   const DataMapViewField *field;
+
+   ASSERT(view->cookie == magic_cookie);
+
+   field = ViewLookup(view, fieldId);
+   if (field == NULL) {
+      return DMERR_NOT_FOUND;
+   }
+
+   if (field->type != type) {
+      return DMERR_TYPE_MISMATCH;
+   }
+
+   *buf = (char *)view->content + field->offset;
+   *left = view->contentLen - field->offset;
+   return DMERR_SUCCESS;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * DataMap_ViewInit --
+ *
+ *      Initialize a read-only view over a serialized data map. The buffer
+ *      is validated as thoroughly as DataMap_Deserialize does, but values
+ *      are neither copied nor decoded until they are read.
+ *      - 'bufIn': must stay valid and unmodified for the life of the view.
+ *      - 'view': on success, the caller needs to call DataMap_ViewDestroy.
+ *
+ * Result:
+ *      - 0 on success
+ *      - error code on failures.
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+ErrorCode
+DataMap_ViewInit(const char *bufIn,       // IN
+                 const int32 bufLen,      // IN
+                 DataMapView *view)       // OUT
+{
+   ErrorCode res;
+   int32 left = bufLen;   /* number of bytes undecoded */
+   int32 len;
+   char *buf = (char *)bufIn;
+
+   if (view == NULL || bufIn == NULL || bufLen < 0) {
+      return DMERR_INVALID_ARGS;
+   }
+
+   /* decode the encoded buffer length */
+   res = DecodeInt32(&buf, &left, &len);
+   if (res != DMERR_SUCCESS) {
+      return res;
+   }
+
+   if (len > bufLen - sizeof(int32)) {
+      return DMERR_TRUNCATED_DATA;
+   }
+
+   memset(view, 0, sizeof *view);
+   view->content = buf;
+   view->contentLen = len;
+   view->maxFields = DATAMAP_VIEW_INLINE_FIELDS;
+   view->cookie = magic_cookie;
+
+   left = len;
+   while (left > 0) {
+      DMKeyType fieldId;
+      int32 val;
+
+      res = DecodeInt32(&buf, &left, &val);     /* decode entry type */
+      if (res != DMERR_SUCCESS) {
+         goto out;
+      }
+
+      if (val >= DMFIELDTYPE_MAX) {
+         res = DMERR_UNKNOWN_TYPE;
+         goto out;
+      }
+
+      res = DecodeInt32(&buf, &left, &fieldId);   /* decode filedID */
+      if (res != DMERR_SUCCESS) {
+         goto out;
+      }
+
+      res = ViewAddField(view, fieldId, (DMFieldType)val,
+                         (int32)(buf - view->content));
+      if (res != DMERR_SUCCESS) {
+         goto out;
+      }
+
+      res = ViewSkipValue(&buf, &left, (DMFieldType)val);
+      if (res != DMERR_SUCCESS) {
+         goto out;
+      }
+   }
+
+   return DMERR_SUCCESS;
+
+out:
+   DataMap_ViewDestroy(view);
+   return res;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * DataMap_ViewDestroy --
+ *
+ *      Release the resources held by a view. The underlying buffer is not
+ *      touched.
+ *
+ * Result:
+ *      None
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+DataMap_ViewDestroy(DataMapView *view)    // IN/OUT
+{
+   if (view == NULL) {
+      return;
+   }
+
+   free(view->extFields);
+   memset(view, 0, sizeof *view);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * DataMap_ViewGetType --
+ *
+ *      Get the type of a field in a view.
+ *
+ * Result:
+ *      The field type, DMFIELDTYPE_EMPTY if the field does not exist.
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+DMFieldType
+DataMap_ViewGetType(const DataMapView *view,   // IN
+                    DMKeyType fieldId)         // IN
+{
+   const DataMapViewField *field;
+
+   ASSERT(view->cookie == magic_cookie);
+
+   field = ViewLookup(view, fieldId);
+   return field == NULL ? DMFIELDTYPE_EMPTY : field->type;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * DataMap_ViewGetInt64 --
+ *
+ *      Get an integer value from a view.
+ *
+ * Result:
+ *      0 on success
+ *      error code on failure.
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+ErrorCode
+DataMap_ViewGetInt64(const DataMapView *view,  // IN
+                     DMKeyType fieldId,        // IN
+                     int64 *value)             // OUT
+{
+   ErrorCode res;
+   char *buf;
+   int32 left;
+
+   if (view == NULL || value == NULL) {
+      return DMERR_INVALID_ARGS;
+   }
+
+   res = ViewLocate(view, fieldId, DMFIELDTYPE_INT64, &buf, &left);
+   if (res != DMERR_SUCCESS) {
+      return res;
+   }
+
+   return DecodeInt64(&buf, &left, value);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * DataMap_ViewGetString --
+ *
+ *      Get a string from a view.
+ *      - 'str': points into the view's buffer; the string is *NOT* NUL
+ *        terminated.
+ *
+ * Result:
+ *      0 on success
+ *      error code on failure.
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+ErrorCode
+DataMap_ViewGetString(const DataMapView *view, // IN
+                      DMKeyType fieldId,       // IN
+                      const char **str,        // OUT
+                      int32 *strLen)           // OUT
+{
+   ErrorCode res;
+   char *buf;
+   int32 left;
+
+   if (view == NULL || str == NULL || strLen == NULL) {
+      return DMERR_INVALID_ARGS;
+   }
+
+   res = ViewLocate(view, fieldId, DMFIELDTYPE_STRING, &buf, &left);
+   if (res != DMERR_SUCCESS) {
+      return res;
+   }
+
+   return DecodeStringRef(&buf, &left, str, strLen);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * DataMap_ViewGetListLength --
+ *
+ *      Get the number of items in an integer or string list of a view.
+ *
+ * Result:
+ *      0 on success
+ *      error code on failure.
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+ErrorCode
+DataMap_ViewGetListLength(const DataMapView *view,   // IN
+                          DMKeyType fieldId,         // IN
+                          int32 *listLen)            // OUT
+{
+   ErrorCode res;
+   char *buf;
+   int32 left;
+
+   if (view == NULL || listLen == NULL) {
+      return DMERR_INVALID_ARGS;
+   }
+
+   res = ViewLocate(view, fieldId, DMFIELDTYPE_INT64LIST, &buf, &left);
+   if (res == DMERR_TYPE_MISMATCH) {
+      res = ViewLocate(view, fieldId, DMFIELDTYPE_STRINGLIST, &buf, &left);
+   }
+   if (res != DMERR_SUCCESS) {
+      return res;
+   }
+
+   return DecodeInt32(&buf, &left, listLen);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * DataMap_ViewGetInt64ListItem --
+ *
+ *      Get one item of an integer list from a view.
+ *
+ * Result:
+ *      0 on success
+ *      DMERR_INVALID_ARGS if 'index' is out of range.
+ *      error code on other failures.
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+ErrorCode
+DataMap_ViewGetInt64ListItem(const DataMapView *view,   // IN
+                             DMKeyType fieldId,         // IN
+                             int32 index,               // IN
+                             int64 *value)              // OUT
+{
+   ErrorCode res;
+   char *buf;
+   int32 left;
+   int32 listLen;
+
+   if (view == NULL || value == NULL || index < 0) {
+      return DMERR_INVALID_ARGS;
+   }
+
+   res = ViewLocate(view, fieldId, DMFIELDTYPE_INT64LIST, &buf, &left);
+   if (res != DMERR_SUCCESS) {
+      return res;
+   }
+
+   res = DecodeInt32(&buf, &left, &listLen);
+   if (res != DMERR_SUCCESS) {
+      return res;
+   }
+
+   if (index >= listLen) {
+      return DMERR_INVALID_ARGS;
+   }
+
+   /* the items are fixed size, so jump straight to the one we want */
+   buf += index * sizeof(int64);
+   left -= index * sizeof(int64);
+
+   return DecodeInt64(&buf, &left, value);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * DataMap_ViewGetStringListItem --
+ *
+ *      Get one item of a string list from a view. Strings are variable
+ *      length, so this walks the list up to 'index'.
+ *      - 'str': points into the view's buffer; the string is *NOT* NUL
+ *        terminated.
+ *
+ * Result:
+ *      0 on success
+ *      DMERR_INVALID_ARGS if 'index' is out of range.
+ *      error code on other failures.
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+ErrorCode
+DataMap_ViewGetStringListItem(const DataMapView *view,  // IN
+                              DMKeyType fieldId,        // IN
+                              int32 index,              // IN
+                              const char **str,         // OUT
+                              int32 *strLen)            // OUT
+{
+   ErrorCode res;
+   char *buf;
+   int32 left;
+   int32 listSize;
+   int32 i;
+
+   if (view == NULL || str == NULL || strLen == NULL || index < 0) {
+      return DMERR_INVALID_ARGS;
+   }
+
+   res = ViewLocate(view, fieldId, DMFIELDTYPE_STRINGLIST, &buf, &left);
+   if (res != DMERR_SUCCESS) {
+      return res;
+   }
+
+   res = DecodeInt32(&buf, &left, &listSize);
+   if (res != DMERR_SUCCESS) {
+      return res;
+   }
+
+   if (index >= listSize) {
+      return DMERR_INVALID_ARGS;
+   }
+
+   for (i = 0; i <= index; i++) {
+      res = DecodeStringRef(&buf, &left, str, strLen);
+      if (res != DMERR_SUCCESS) {
+         break;
+      }
+   }
+
+   return res;
+}
+
+
 /*
  *-----------------------------------------------------------------------------
  *
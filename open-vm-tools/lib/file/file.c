@@ -902,7 +902,12 @@ File_IsFile(const char *pathName)  // IN:
  * File_CopyFromFdToFd --
  *
  *      Write all data between the current position in the 'src' file and the
- *      end of the 'src' file to the current position in the 'dst' file
+ *      end of the 'src' file to the current position in the 'dst' file.
+ *
+ *      On Linux, regular files are copied by the kernel where possible
+ *      (reflink, copy_file_range, sendfile) and holes in a sparse 'src' are
+ *      preserved when 'dst' is written past its end. Otherwise the data goes
+ *      through a large buffer.
  *
  * Results:
  *      TRUE   success
@@ -920,22 +925,46 @@ File_CopyFromFdToFd(FileIODescriptor src,  // IN:
 {
    Err_Number err;
    FileIOResult fretR;
+   unsigned char stackBuf[8 * 1024];
+   unsigned char *buf;
+   size_t bufSize;
+
+#if defined(__linux__)
+   err = FilePosixCopyFd(src.posix, dst.posix);
+   if (err != ENOTSUP) {
+      if (err != 0) {
+         Msg_Append(MSGID(File.CopyFromFdToFd.copy.failure)
+                    "Copy error: %s.\n\n", Err_Errno2String(err));
+
+         Err_SetErrno(err);
+
+         return FALSE;
+      }
+
+      return TRUE;
+   }
+#endif
+
+   buf = malloc(FILE_COPY_BUFFER_SIZE);
+   if (buf != NULL) {
+      bufSize = FILE_COPY_BUFFER_SIZE;
+   } else {
+      buf = stackBuf;
+      bufSize = sizeof stackBuf;
+   }
 
    do {
-      unsigned char buf[8 * 1024];
       size_t actual;
       FileIOResult fretW;
 
-      fretR = FileIO_Read(&src, buf, sizeof buf, &actual);
+      fretR = FileIO_Read(&src, buf, bufSize, &actual);
       if (!FileIO_IsSuccess(fretR) && (fretR != FILEIO_READ_ERROR_EOF)) {
          err = Err_Errno();
 
          Msg_Append(MSGID(File.CopyFromFdToFd.read.failure)
                                "Read error: %s.\n\n", FileIO_MsgError(fretR));
 
-         Err_SetErrno(err);
-
-         return FALSE;
+         goto error;
       }
 
       fretW = FileIO_Write(&dst, buf, actual, NULL);
@@ -945,13 +974,24 @@ File_CopyFromFdToFd(FileIODescriptor src,  // IN:
          Msg_Append(MSGID(File.CopyFromFdToFd.write.failure)
                               "Write error: %s.\n\n", FileIO_MsgError(fretW));
 
-         Err_SetErrno(err);
-
-         return FALSE;
+         goto error;
       }
    } while (fretR != FILEIO_READ_ERROR_EOF);
 
+   if (buf != stackBuf) {
+      free(buf);
+   }
+
    return TRUE;
+
+error:
+   if (buf != stackBuf) {
+      free(buf);
+   }
+
+   Err_SetErrno(err);
+
+   return FALSE;
 }
 
 
@@ -110,6 +110,8 @@ typedef struct FileData {
 
 #define FILE_MAX_WAIT_TIME_MS 2000  // maximum wait time in milliseconds
 
+#define FILE_COPY_BUFFER_SIZE (1024 * 1024)  // read/write copy buffer
+
 void FileIOResolveLockBits(int *access);
 
 #if defined(_WIN32)
@@ -166,6 +168,11 @@ FileMapErrorToErrno(const char *functionName,
 
 char *FilePosixGetBlockDevice(char const *path);
 
+#if defined(__linux__)
+int FilePosixCopyFd(int srcFd,
+                    int dstFd);
+#endif
+
 int FileAttributes(const char *pathName,
                    FileData *fileData);
 
@@ -55,6 +55,9 @@
 #include <dirent.h>
 #if defined(__linux__)
 #   include <pwd.h>
+#   include <sys/ioctl.h>
+#   include <sys/sendfile.h>
+#   include <sys/syscall.h>
 #endif
 #if defined(__APPLE__)
 #include <TargetConditionals.h>
@@ -3621,3 +3624,383 @@ File_GetMountPath(const char *pathName,  // IN:
 
    return NULL;
 }
+
+
+#if defined(__linux__)
+/*
+ * SEEK_DATA/SEEK_HOLE and FICLONE may be missing from older headers (and
+ * SEEK_DATA needs _GNU_SOURCE); the values are part of the kernel ABI.
+ */
+
+#if !defined(SEEK_DATA)
+#define SEEK_DATA 3
+#define SEEK_HOLE 4
+#endif
+
+#if !defined(FICLONE)
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+
+/* Largest request passed to copy_file_range(2) or sendfile(2) at once. */
+#define FILE_COPY_KERNEL_CHUNK (1024 * 1024 * 1024)
+
+/*
+ * How FilePosixCopyFd moved the data, from cheapest to most expensive. When
+ * a copy falls back part way through, the most expensive method used is
+ * logged.
+ */
+
+typedef enum {
+   FILE_COPY_METHOD_NONE,        // Nothing to copy
+   FILE_COPY_METHOD_CLONE,       // Blocks shared with the source (reflink)
+   FILE_COPY_METHOD_RANGE,       // copy_file_range(2)
+   FILE_COPY_METHOD_SENDFILE,    // sendfile(2)
+   FILE_COPY_METHOD_READ_WRITE,  // pread/pwrite through a user buffer
+} FileCopyMethod;
+
+static const char *const fileCopyMethodNames[] = {
+   "nothing",
+   "clone",
+   "copy_file_range",
+   "sendfile",
+   "read/write",
+};
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * FilePosixCopyUnsupported --
+ *
+ *      Decides whether a copy_file_range(2) or sendfile(2) failure means the
+ *      call can't be used for this pair of files (so the next method should
+ *      be tried) rather than that the copy failed.
+ *
+ * Results:
+ *      TRUE if the next method should be tried.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static Bool
+FilePosixCopyUnsupported(int err)  // IN: errno
+{
+   switch (err) {
+   case ENOSYS:
+   case EXDEV:
+   case EINVAL:
+   case EBADF:
+   case ENOTSUP:
+#if EOPNOTSUPP != ENOTSUP
+   case EOPNOTSUPP:
+#endif
+      return TRUE;
+   default:
+      return FALSE;
+   }
+}
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * FilePosixCopyExtent --
+ *
+ *      Copies 'length' bytes at '*srcOff' in 'srcFd' to '*dstOff' in 'dstFd',
+ *      or up to the end of 'srcFd' if that comes first, starting with
+ *      '*method' and falling back to cheaper-to-support methods as the
+ *      kernel refuses them.
+ *
+ *      copy_file_range(2) and sendfile(2) report end of file early on some
+ *      files (procfs, sysfs); only a read returning nothing is trusted as
+ *      the end of the source.
+ *
+ * Results:
+ *      0 on success, including when the source ends early (*srcOff then
+ *      shows where). An errno value on failure.
+ *
+ * Side effects:
+ *      *srcOff and *dstOff are advanced past the data copied. *method and
+ *      *buf may be updated for the next extent; *buf must be freed by the
+ *      caller. The position of 'dstFd' is modified.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static int
+FilePosixCopyExtent(int srcFd,               // IN:
+                    int dstFd,               // IN:
+                    off_t *srcOff,           // IN/OUT:
+                    off_t *dstOff,           // IN/OUT:
+                    off_t length,            // IN:
+                    FileCopyMethod *method,  // IN/OUT:
+                    char **buf)              // IN/OUT:
+{
+   while (length > 0) {
+      size_t want = MIN(length, FILE_COPY_KERNEL_CHUNK);
+      ssize_t done;
+
+      switch (*method) {
+      case FILE_COPY_METHOD_RANGE:
+#if defined(__NR_copy_file_range)
+         done = syscall(__NR_copy_file_range, srcFd, srcOff, dstFd, dstOff,
+                        want, 0);
+#else
+         done = -1;
+         errno = ENOSYS;
+#endif
+         if (done < 0 && FilePosixCopyUnsupported(errno)) {
+            *method = FILE_COPY_METHOD_SENDFILE;
+            continue;
+         }
+         break;
+
+      case FILE_COPY_METHOD_SENDFILE:
+         /* sendfile(2) writes at, and advances, the output file position. */
+         if (lseek(dstFd, *dstOff, SEEK_SET) == (off_t) -1) {
+            return errno;
+         }
+
+         done = sendfile(dstFd, srcFd, srcOff, want);
+         if (done < 0 && FilePosixCopyUnsupported(errno)) {
+            *method = FILE_COPY_METHOD_READ_WRITE;
+            continue;
+         }
+         if (done > 0) {
+            *dstOff += done;
+         }
+         break;
+
+      default:
+         ASSERT(*method == FILE_COPY_METHOD_READ_WRITE);
+
+         if (*buf == NULL) {
+            *buf = malloc(FILE_COPY_BUFFER_SIZE);
+            if (*buf == NULL) {
+               return ENOMEM;
+            }
+         }
+
+         done = pread(srcFd, *buf, MIN(want, FILE_COPY_BUFFER_SIZE), *srcOff);
+         if (done > 0) {
+            ssize_t written = 0;
+
+            while (written < done) {
+               ssize_t n = pwrite(dstFd, *buf + written, done - written,
+                                  *dstOff + written);
+
+               if (n < 0) {
+                  if (errno == EINTR) {
+                     continue;
+                  }
+
+                  return errno;
+               }
+               written += n;
+            }
+
+            *srcOff += done;
+            *dstOff += done;
+         }
+         break;
+      }
+
+      if (done < 0) {
+         if (errno == EINTR) {
+            continue;
+         }
+
+         return errno;
+      }
+
+      if (done == 0) {
+         if (*method != FILE_COPY_METHOD_READ_WRITE) {
+            *method = FILE_COPY_METHOD_READ_WRITE;
+            continue;
+         }
+
+         break;  // End of the source
+      }
+
+      length -= done;
+   }
+
+   return 0;
+}
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * FilePosixCopyFd --
+ *
+ *      Copies everything from the current position in 'srcFd' to its end to
+ *      the current position in 'dstFd' without moving the data through user
+ *      space where possible.
+ *
+ *      A copy of a whole file into an empty file is first tried as a clone
+ *      (FICLONE), sharing the blocks with the source. Otherwise data moves
+ *      with copy_file_range(2), which also clones or offloads the copy to
+ *      the server on file systems that support that, then sendfile(2), and
+ *      finally pread/pwrite through a large buffer, each method being
+ *      dropped as soon as the kernel refuses it.
+ *
+ *      When the destination is written past its end, holes in the source
+ *      (found with SEEK_DATA/SEEK_HOLE) are skipped so a sparse source
+ *      produces a sparse copy. The size reported by fstat only guides hole
+ *      detection: the copy continues until a read finds the end of the
+ *      source, so files that grow, or report a size of 0 (procfs), are
+ *      copied in full.
+ *
+ * Results:
+ *      0 on success.
+ *      ENOTSUP if either file isn't a regular file or the destination is
+ *      open for appending; nothing has been done and the caller should copy
+ *      by other means. Any other errno value on failure.
+ *
+ * Side effects:
+ *      On success, the positions of both files are at the end of the data
+ *      copied.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+int
+FilePosixCopyFd(int srcFd,  // IN:
+                int dstFd)  // IN:
+{
+   struct stat srcStat;
+   struct stat dstStat;
+   off_t srcStart;
+   off_t dstStart;
+   off_t srcOff;
+   off_t dstOff;
+   off_t pos;
+   Bool sparse;
+   int flags;
+   int err = 0;
+   char *buf = NULL;
+   FileCopyMethod next = FILE_COPY_METHOD_RANGE;
+   FileCopyMethod used = FILE_COPY_METHOD_NONE;
+
+   if (fstat(srcFd, &srcStat) == -1 || fstat(dstFd, &dstStat) == -1 ||
+       !S_ISREG(srcStat.st_mode) || !S_ISREG(dstStat.st_mode)) {
+      return ENOTSUP;
+   }
+
+   flags = fcntl(dstFd, F_GETFL);
+   if (flags == -1 || (flags & O_APPEND) != 0) {
+      return ENOTSUP;
+   }
+
+   srcStart = lseek(srcFd, 0, SEEK_CUR);
+   dstStart = lseek(dstFd, 0, SEEK_CUR);
+   if (srcStart == (off_t) -1 || dstStart == (off_t) -1) {
+      return ENOTSUP;
+   }
+
+   /*
+    * Past its end, the destination reads as zeros: holes need not be written.
+    */
+
+   sparse = dstStart >= dstStat.st_size;
+   pos = srcStart;
+
+   if (srcStart == 0 && dstStart == 0 && dstStat.st_size == 0 &&
+       srcStat.st_size > 0 && ioctl(dstFd, FICLONE, srcFd) == 0) {
+      used = FILE_COPY_METHOD_CLONE;
+      pos = srcStat.st_size;
+   }
+
+   /* The data and holes the source had when the copy started. */
+   while (pos < srcStat.st_size) {
+      off_t data = pos;
+      off_t hole = srcStat.st_size;
+
+      if (sparse) {
+         data = lseek(srcFd, pos, SEEK_DATA);
+         if (data == (off_t) -1) {
+            if (errno == ENXIO) {
+               pos = srcStat.st_size;  // Only a hole remains
+               break;
+            }
+
+            /* SEEK_DATA isn't supported; copy everything. */
+            sparse = FALSE;
+            data = pos;
+         } else {
+            hole = lseek(srcFd, data, SEEK_HOLE);
+            if (hole == (off_t) -1) {
+               hole = srcStat.st_size;
+            }
+         }
+      }
+
+      if (data >= srcStat.st_size) {
+         pos = srcStat.st_size;
+         break;
+      }
+
+      hole = MIN(hole, srcStat.st_size);
+
+      srcOff = data;
+      dstOff = dstStart + (data - srcStart);
+
+      err = FilePosixCopyExtent(srcFd, dstFd, &srcOff, &dstOff, hole - data,
+                                &next, &buf);
+      if (err != 0) {
+         goto exit;
+      }
+
+      if (srcOff > data) {
+         used = MAX(used, next);
+      }
+
+      if (srcOff < hole) {
+         pos = srcOff;  // The source shrank
+         break;
+      }
+
+      pos = hole;
+   }
+
+   /* Whatever was appended since, or everything if the size isn't known. */
+   srcOff = pos;
+   dstOff = dstStart + (pos - srcStart);
+
+   err = FilePosixCopyExtent(srcFd, dstFd, &srcOff, &dstOff, MAX_INT64,
+                             &next, &buf);
+   if (err != 0) {
+      goto exit;
+   }
+
+   if (srcOff > pos) {
+      used = MAX(used, next);
+   }
+
+   /* A trailing hole: extend the destination to the full length. */
+   if (sparse && dstOff > dstStat.st_size &&
+       (fstat(dstFd, &dstStat) == -1 ||
+        (dstStat.st_size < dstOff && ftruncate(dstFd, dstOff) == -1))) {
+      err = errno;
+      goto exit;
+   }
+
+   if (lseek(srcFd, srcOff, SEEK_SET) == (off_t) -1 ||
+       lseek(dstFd, dstOff, SEEK_SET) == (off_t) -1) {
+      err = errno;
+      goto exit;
+   }
+
+   LOG(1, LGPFX" %s: copied %"FMT64"d bytes with %s\n", __FUNCTION__,
+       (int64) (srcOff - srcStart), fileCopyMethodNames[used]);
+
+exit:
+   free(buf);
+
+   return err;
+}
+#endif
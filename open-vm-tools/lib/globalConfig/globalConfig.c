@@ -79,11 +79,6 @@
         "/vmware/configurations/vmtools/linux/tools.conf"
 #endif
 
-/**
- * Name of the local file populated with the global tools configuration.
- */
-#define GLOBALCONF_LOCAL_FILENAME "tools-global.conf"
-
 /**
  * Name of the local temp file populated with the global tools configuration.
  */
@@ -75,6 +75,13 @@ typedef GuestStoreLibError (*GuestStoreLibGetContent)(const char* contentPath,
                                                       GuestStore_Panic panic,
                                                       GuestStore_GetContentCallback getContentCb,
                                                       void* clientData);
+typedef GuestStoreLibError (*GuestStoreLibGetContentEx)(const char* contentPath,
+                                                        const char* outputPath,
+                                                        const GuestStoreCacheOptions *cacheOptions,
+                                                        GuestStore_Logger logger,
+                                                        GuestStore_Panic panic,
+                                                        GuestStore_GetContentCallback getContentCb,
+                                                        void* clientData);
 
 /*
  * Function pointer definitions for GuestStore client library exports.
@@ -84,6 +91,11 @@ static GuestStoreLibInit       GuestStoreLib_Init;
 static GuestStoreLibDeInit     GuestStoreLib_DeInit;
 static GuestStoreLibGetContent GuestStoreLib_GetContent;
 
+/*
+ * Only in newer GuestStore client libraries, NULL if not available.
+ */
+static GuestStoreLibGetContentEx GuestStoreLib_GetContentEx;
+
 /*
  * Macro to get the export function address from GuestStore client library.
  */
@@ -167,6 +179,19 @@ GuestStoreGetLibExportFunctions(void)
    GET_GUESTSTORELIB_FUNC_ADDR(GetContent);  // For GuestStore_GetContent
    GET_GUESTSTORELIB_FUNC_ADDR(DeInit);      // For GuestStore_DeInit
 
+#if defined(_WIN32)
+   GuestStoreLib_GetContentEx =
+      (GuestStoreLibGetContentEx) GetProcAddress(gsClientLibModule,
+                                                 "GuestStore_GetContentEx");
+#else
+   *(void **)(&GuestStoreLib_GetContentEx) =
+      dlsym(gsClientLibModule, "GuestStore_GetContentEx");
+#endif
+   if (GuestStoreLib_GetContentEx == NULL) {
+      g_debug("%s: GuestStore_GetContentEx is not available.\n",
+              __FUNCTION__);
+   }
+
    return TRUE;
 }
 
@@ -377,3 +402,49 @@ GuestStoreClient_GetContent(const char *contentPath,                     // IN:
                                    GuestStoreClientPanic,
                                    getContentCb, clientCbData);
 }
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * GuestStoreClient_GetContentEx --
+ *
+ *      Get content from GuestStore, using a local content cache if
+ *      cacheOptions is not NULL and the GuestStore client library supports
+ *      it.
+ *
+ * Results:
+ *      Error code from GuestStore client library or
+ *      general process error exit code.
+ *
+ * Side effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+GuestStoreClientError
+GuestStoreClient_GetContentEx(const char *contentPath,                     // IN: content file path
+                              const char *outputPath,                      // IN: output file path
+                              const GuestStoreCacheOptions *cacheOptions,  // IN: OPTIONAL cache options
+                              GuestStoreClient_GetContentCb getContentCb,  // IN: OPTIONAL callback
+                              void *clientCbData)                          // IN: OPTIONAL callback data
+{
+   g_debug("Entering %s.\n", __FUNCTION__);
+
+   if (!gsClientInit) {
+      return GSLIBERR_NOT_INITIALIZED;
+   }
+
+   if (cacheOptions == NULL || GuestStoreLib_GetContentEx == NULL) {
+      return GuestStoreLib_GetContent(contentPath, outputPath,
+                                      GuestStoreClientLogger,
+                                      GuestStoreClientPanic,
+                                      getContentCb, clientCbData);
+   }
+
+   return GuestStoreLib_GetContentEx(contentPath, outputPath, cacheOptions,
+                                     GuestStoreClientLogger,
+                                     GuestStoreClientPanic,
+                                     getContentCb, clientCbData);
+}
@@ -37,6 +37,7 @@
 #include <string.h>
 
 #include "hashMap.h"
+#include "hashFunc.h"
 #include "clamped.h"
 #include "util.h"
 #ifdef VMX86_SERVER
@@ -645,7 +646,7 @@ LookupKey(struct HashMap* map,          // IN
           uint32 *freeIndex)            // OUT
 {
    uint32 hash = ComputeHash(map, key);
-   uint32 index = hash % map->numEntries;
+   uint32 currentIndex = hash % map->numEntries;
    uint32 probe = 0;
 
    Bool done = FALSE, found = FALSE;
@@ -659,8 +660,6 @@ LookupKey(struct HashMap* map,          // IN
    *freeIndex = NO_FREE_INDEX;
 
    while (!done && probe < map->numEntries + 1) {
-      uint32 currentIndex = (index + probe) % map->numEntries;
-
       GetEntry(map, currentIndex, header, &tableKey, data);
       ASSERT(header);
 
@@ -699,6 +698,11 @@ LookupKey(struct HashMap* map,          // IN
          NOT_REACHED();
       }
       probe++;
+
+      /* Linear probing, without a division per step. */
+      if (++currentIndex == map->numEntries) {
+         currentIndex = 0;
+      }
    }
 
    ASSERT(found || *freeIndex != NO_FREE_INDEX || map->count == map->numEntries);
@@ -770,22 +774,12 @@ ComputeHash(struct HashMap *map,  // IN
             const void *key)      // IN
 {
    /*
-    * djb2, with n == 33. See http://www.cse.yorku.ca/~oz/hash.html.
-    *
-    * This hash function is largely borrowed from the emmet library in bora/lib
     * This hash table implementation does a hash compare before comparing the
     * keys so it's inappropriate for the hash function to take the modulo before
-    * returning.
+    * returning. The full hash is kept in each entry header, so keys are only
+    * compared when their hashes match.
     */
-   uint32 h = 5381;
-   const uint8 *keyByte;
-   size_t i = 0;
-
-   for (keyByte = key, i = 0; i < map->keySize; keyByte++, i++) {
-      h *= 33;
-      h += *keyByte;
-   }
-   return h;
+   return HashFunc_Bytes32(key, map->keySize);
 }
 
 
@@ -811,7 +805,17 @@ CompareKeys(struct HashMap *map,    // IN
             const void *key,        // IN
             const void *compare)    // IN
 {
-   return memcmp(key, compare, map->keySize) == 0;
+   /*
+    * Fixed size compares of the common key sizes are inlined by the compiler.
+    */
+   switch (map->keySize) {
+   case sizeof(uint32):
+      return memcmp(key, compare, sizeof(uint32)) == 0;
+   case sizeof(uint64):
+      return memcmp(key, compare, sizeof(uint64)) == 0;
+   default:
+      return memcmp(key, compare, map->keySize) == 0;
+   }
 }
 
 
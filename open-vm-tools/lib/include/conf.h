@@ -182,6 +182,17 @@
  */
 #define CONFNAME_CONTAINERINFO_ALLOWED_NAMESPACES "allowed-namespaces"
 
+/**
+ * Defines the configuration to keep the container information up to date
+ * by subscribing to the containerd events, in addition to polling.
+ *
+ * @note Tools daemon restart is required to apply this setting's change.
+ *
+ * @param boolean Set to TRUE to update the container information whenever
+ *                containers are started or stopped.
+ */
+#define CONFNAME_CONTAINERINFO_EVENT_DRIVEN "event-driven"
+
 /*
  * END containerInfo goodies.
  ******************************************************************************
@@ -797,4 +808,49 @@
  ******************************************************************************
  */
 
+/*
+ ******************************************************************************
+ * BEGIN lock statistics goodies.
+ */
+
+/**
+ * Defines the string used for the lock statistics config file group.
+ */
+#define CONFGROUPNAME_LOCKSTATS "lockstats"
+
+/**
+ * Defines the configuration to collect lock contention statistics or not.
+ * Takes effect when the config file is reloaded.
+ *
+ * @param boolean Set to TRUE to collect statistics.
+ */
+#define CONFNAME_LOCKSTATS_ENABLED "enabled"
+
+/**
+ * Defines the interval (in seconds) at which the most contended locks are
+ * logged. The statistics are also logged as part of the service state dump.
+ *
+ * @param int   Log interval. Set to 0 to log only with the state dump.
+ */
+#define CONFNAME_LOCKSTATS_INTERVAL "interval"
+
+/**
+ * Defines the number of locks logged.
+ *
+ * @param int   Number of most contended locks to log.
+ */
+#define CONFNAME_LOCKSTATS_TOP "top"
+
+/**
+ * Defines the configuration to track lock hold times or not.
+ *
+ * @param boolean Set to FALSE to only track waits for locks.
+ */
+#define CONFNAME_LOCKSTATS_HELD_TIMES "held-times"
+
+/*
+ * END lock statistics goodies.
+ ******************************************************************************
+ */
+
 #endif /* __CONF_H__ */
@@ -81,6 +81,30 @@ typedef struct {
    const char *fieldName;
 } FieldIdNameEntry;
 
+/*
+ * A read-only view of a serialized data map. Fields are located when the
+ * view is initialized and decoded from the buffer when they are read, so
+ * nothing is copied; the buffer must outlive the view. Maps with more than
+ * DATAMAP_VIEW_INLINE_FIELDS fields need one allocation for the index.
+ */
+#define DATAMAP_VIEW_INLINE_FIELDS 8
+
+typedef struct {
+   DMKeyType fieldId;
+   DMFieldType type;
+   int32 offset;      /* of the encoded value, from the start of content */
+} DataMapViewField;
+
+typedef struct {
+   const char *content;
+   int32 contentLen;
+   int32 numFields;
+   int32 maxFields;
+   DataMapViewField *extFields;   /* used instead of inlineFields if set */
+   DataMapViewField inlineFields[DATAMAP_VIEW_INLINE_FIELDS];
+   uint64 cookie;
+} DataMapView;
+
 /*
  * Initializer
  */
@@ -104,6 +128,11 @@ ErrorCode
 DataMap_DeserializeContent(const char *bufIn,     // IN
                            const int32 bufLen,    // IN
                            DataMap *that);        // OUT
+ErrorCode
+DataMap_SerializeToBuffer(const DataMap *that,   // IN
+                          char *buf,             // OUT
+                          uint32 bufSize,        // IN
+                          uint32 *bufLen);       // OUT
 /*
  * Setters
  */
@@ -162,6 +191,45 @@ DataMap_GetStringList(const DataMap *that,      // IN
                       char ***strList,          // OUT
                       int32 **strLens);         // OUT
 
+/*
+ * Views
+ */
+
+ErrorCode
+DataMap_ViewInit(const char *bufIn,       // IN
+                 const int32 bufLen,      // IN
+                 DataMapView *view);      // OUT
+void
+DataMap_ViewDestroy(DataMapView *view);   // IN/OUT
+
+DMFieldType
+DataMap_ViewGetType(const DataMapView *view,   // IN
+                    DMKeyType fieldId);        // IN
+ErrorCode
+DataMap_ViewGetInt64(const DataMapView *view,  // IN
+                     DMKeyType fieldId,        // IN
+                     int64 *value);            // OUT
+ErrorCode
+DataMap_ViewGetString(const DataMapView *view, // IN
+                      DMKeyType fieldId,       // IN
+                      const char **str,        // OUT
+                      int32 *strLen);          // OUT
+ErrorCode
+DataMap_ViewGetListLength(const DataMapView *view,   // IN
+                          DMKeyType fieldId,         // IN
+                          int32 *listLen);           // OUT
+ErrorCode
+DataMap_ViewGetInt64ListItem(const DataMapView *view,   // IN
+                             DMKeyType fieldId,         // IN
+                             int32 index,               // IN
+                             int64 *value);             // OUT
+ErrorCode
+DataMap_ViewGetStringListItem(const DataMapView *view,  // IN
+                              DMKeyType fieldId,        // IN
+                              int32 index,              // IN
+                              const char **str,         // OUT
+                              int32 *strLen);           // OUT
+
 ErrorCode
 DataMap_ToString(const DataMap *that,               // IN
                  FieldIdNameEntry *fieldIdList,     // IN
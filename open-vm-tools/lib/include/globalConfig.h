@@ -34,6 +34,12 @@
  * Interface of the module to fetch the tools.conf file from GuestStore.
  */
 
+/**
+ * Name of the local file populated with the global tools configuration. It
+ * lives in the GuestApp_GetConfPath() directory.
+ */
+#define GLOBALCONF_LOCAL_FILENAME "tools-global.conf"
+
 gboolean GlobalConfig_Start(ToolsAppCtx *ctx);
 
 gboolean GlobalConfig_LoadConfig(GKeyFile **config,
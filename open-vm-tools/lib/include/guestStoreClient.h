@@ -47,4 +47,11 @@ GuestStoreClient_GetContent(const char *contentPath,
                             GuestStoreClient_GetContentCb getContentCb,
                             void *clientCbData);
 
+GuestStoreClientError
+GuestStoreClient_GetContentEx(const char *contentPath,
+                              const char *outputPath,
+                              const GuestStoreCacheOptions *cacheOptions,
+                              GuestStoreClient_GetContentCb getContentCb,
+                              void *clientCbData);
+
 #endif /* _GUEST_STORE_CLIENT_H_ */
\ No newline at end of file
@@ -0,0 +1,222 @@
+/*********************************************************
+ * Copyright (c) 2025 Broadcom. All Rights Reserved.
+ * The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation version 2.1 and no later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the Lesser GNU General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA.
+ *
+ *********************************************************/
+
+/*
+ * hashFunc.h --
+ *
+ *      Fast non-cryptographic hash of a byte range, for hash tables.
+ *
+ *      The input is consumed 16 bytes at a time and each block is mixed
+ *      with a 64x64->128 bit multiply (in the style of wyhash). Hash values
+ *      are meant for in-memory use only: they depend on the host byte order
+ *      and may change between releases.
+ */
+
+#ifndef _HASHFUNC_H_
+#define _HASHFUNC_H_
+
+#define INCLUDE_ALLOW_MODULE
+#define INCLUDE_ALLOW_USERLEVEL
+#define INCLUDE_ALLOW_VMCORE
+#include "includeCheck.h"
+
+#include <string.h>
+
+#include "vm_basic_types.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define HASHFUNC_SECRET0   CONST64U(0xa0761d6478bd642f)
+#define HASHFUNC_SECRET1   CONST64U(0xe7037ed1a0b428db)
+#define HASHFUNC_SECRET2   CONST64U(0x8ebc6af09c88c6e3)
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * HashFuncMix --
+ *
+ *      Multiply two 64-bit values and fold the 128-bit product.
+ *
+ * Results:
+ *      The low and high halves of a * b, XORed.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static INLINE uint64
+HashFuncMix(uint64 a,  // IN:
+            uint64 b)  // IN:
+{
+#if defined(VM_HAS_INT128)
+   uint128 r = (uint128) a * b;
+
+   return (uint64) r ^ (uint64) (r >> 64);
+#else
+   uint64 ha = a >> 32;
+   uint64 la = (uint32) a;
+   uint64 hb = b >> 32;
+   uint64 lb = (uint32) b;
+   uint64 rh = ha * hb;
+   uint64 rm0 = ha * lb;
+   uint64 rm1 = hb * la;
+   uint64 rl = la * lb;
+   uint64 t = rl + (rm0 << 32);
+   uint64 carry = t < rl;
+   uint64 lo = t + (rm1 << 32);
+
+   carry += lo < t;
+
+   return lo ^ (rh + (rm0 >> 32) + (rm1 >> 32) + carry);
+#endif
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * HashFuncRead64 --
+ * HashFuncRead32 --
+ *
+ *      Unaligned loads.
+ *
+ * Results:
+ *      The value at p.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static INLINE uint64
+HashFuncRead64(const uint8 *p)  // IN:
+{
+   uint64 v;
+
+   memcpy(&v, p, sizeof v);
+   return v;
+}
+
+
+static INLINE uint64
+HashFuncRead32(const uint8 *p)  // IN:
+{
+   uint32 v;
+
+   memcpy(&v, p, sizeof v);
+   return v;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * HashFunc_BytesSeeded --
+ *
+ *      Hash a byte range, continuing from a previous hash value. Passing
+ *      the result of one call as the seed of the next hashes data that is
+ *      not contiguous in memory.
+ *
+ * Results:
+ *      A 64-bit hash value.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static INLINE uint64
+HashFunc_BytesSeeded(const void *key,  // IN:
+                     size_t len,       // IN:
+                     uint64 seed)      // IN:
+{
+   const uint8 *p = (const uint8 *) key;
+   size_t left = len;
+   uint64 a;
+   uint64 b;
+
+   seed ^= HashFuncMix(seed ^ HASHFUNC_SECRET0, HASHFUNC_SECRET1);
+
+   while (left > 16) {
+      seed = HashFuncMix(HashFuncRead64(p) ^ HASHFUNC_SECRET1,
+                         HashFuncRead64(p + 8) ^ seed);
+      p += 16;
+      left -= 16;
+   }
+
+   /* The last 1-16 bytes, with overlapping loads */
+   if (left >= 8) {
+      a = HashFuncRead64(p);
+      b = HashFuncRead64(p + left - 8);
+   } else if (left >= 4) {
+      a = HashFuncRead32(p);
+      b = HashFuncRead32(p + left - 4);
+   } else if (left > 0) {
+      a = ((uint64) p[0] << 16) | ((uint64) p[left >> 1] << 8) | p[left - 1];
+      b = 0;
+   } else {
+      a = 0;
+      b = 0;
+   }
+
+   a ^= HASHFUNC_SECRET1;
+   b ^= seed;
+
+   return HashFuncMix(HashFuncMix(a, b) ^ HASHFUNC_SECRET0,
+                      (uint64) len ^ HASHFUNC_SECRET2);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * HashFunc_Bytes32 --
+ *
+ *      Hash a byte range.
+ *
+ * Results:
+ *      A 32-bit hash value.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static INLINE uint32
+HashFunc_Bytes32(const void *key,  // IN:
+                 size_t len)       // IN:
+{
+   uint64 h = HashFunc_BytesSeeded(key, len, 0);
+
+   return (uint32) (h ^ (h >> 32));
+}
+
+#if defined(__cplusplus)
+}  // extern "C"
+#endif
+
+#endif // _HASHFUNC_H_
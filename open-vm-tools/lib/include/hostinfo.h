@@ -210,6 +210,7 @@ typedef struct {
 uint32 Hostinfo_NumCPUs(void);
 char *Hostinfo_GetCpuidStr(void);
 Bool Hostinfo_GetCpuid(HostinfoCpuIdInfo *info);
+Bool Hostinfo_HaveSSSE3(void);
 
 #if defined(_WIN32)
 typedef enum {
@@ -369,6 +369,31 @@ void MXUser_SetStatsFunc(void *context,
                                            const char *fmt,
                                            va_list ap));
 
+/*
+ * Lock statistics snapshot; see MXUser_GetTopContendedLocks. Times are in ns.
+ * Percentiles are approximate (histogram bin lower bounds).
+ */
+
+typedef struct MXUserLockStats {
+   char    name[64];
+   uint64  serialNumber;
+   uint64  numAttempts;     // Acquisition attempts
+   uint64  numContended;    // Contended acquisitions and failed try-acquires
+   uint64  contentionTime;  // Total time spent waiting
+   uint64  waitP50;
+   uint64  waitP99;
+   uint64  waitMax;
+   uint64  numHeld;         // 0 if held times are not being tracked
+   uint64  heldP50;
+   uint64  heldP99;
+   uint64  heldMax;
+} MXUserLockStats;
+
+void MXUser_SetStatsExport(Bool enable,
+                           Bool trackHeldTimes);
+uint32 MXUser_GetTopContendedLocks(MXUserLockStats *lockStats,
+                                   uint32 maxLocks);
+
 void MXUser_SetInPanic(void);
 Bool MXUser_InPanic(void);
 
@@ -121,6 +121,9 @@ extern "C++" {
    GDP_ERR_ITEM(GDP_ERROR_NO_SUBSCRIBERS,                 \
                 "no-subscribers",                         \
                 "No subscribers for data")                \
+   GDP_ERR_ITEM(GDP_ERROR_QUEUE_FULL,                     \
+                "queue-full",                             \
+                "Publish queue full")                     \
    GDP_ERR_ITEM(GDP_ERR_MAX,                              \
                 "last-error",                             \
                 "last-error")
@@ -135,6 +138,19 @@ typedef enum GdpError {
 #undef GDP_ERR_ITEM
 
 
+/**
+ * @brief Completion callback of a non-blocking publish.
+ *
+ * Called once per accepted ToolsPluginSvcGdp_PublishAsync call in the gdp
+ * task thread, it must not block nor call ToolsPluginSvcGdp_Publish.
+ *
+ * @param[in] gdpErr      GDP_ERROR_SUCCESS or other GdpError code
+ * @param[in] clientData  The clientData passed to publishAsync
+ */
+typedef void (*GdpPublishCallback)(GdpError gdpErr,
+                                   gpointer clientData);
+
+
 /**
  * @brief Type of the public interface of the gdp plugin service.
  *
@@ -150,6 +166,16 @@ typedef struct ToolsPluginSvcGdp {
                        guint32 dataLen,
                        gboolean cacheData,
                        gboolean requireSubs);
+   GdpError (*publishAsync)(gint64 createTime,
+                            const gchar *topic,
+                            const gchar *token,
+                            const gchar *category,
+                            const gchar *data,
+                            guint32 dataLen,
+                            gboolean cacheData,
+                            gboolean requireSubs,
+                            GdpPublishCallback callback,
+                            gpointer clientData);
 } ToolsPluginSvcGdp;
 
 
@@ -201,4 +227,61 @@ ToolsPluginSvcGdp_Publish(ToolsAppCtx *ctx,      // IN
    return GDP_ERROR_GENERAL;
 }
 
+
+/*
+ ******************************************************************************
+ * ToolsPluginSvcGdp_PublishAsync --                                     */ /**
+ *
+ * @brief Queues guest data for publishing to host side gdp daemon.
+ *
+ * This function is thread-safe and non-blocking. The data is copied into a
+ * bounded submission queue and sent by the gdp task thread as fast as the
+ * host rate limit allows, so a publisher can submit a batch of items without
+ * waiting for each round trip. Do not call the function in ToolsOnLoad nor
+ * in/after TOOLS_CORE_SIG_SHUTDOWN handler.
+ *
+ * @param[in]          ctx         The application context
+ * @param[in]          createTime  UTC timestamp, in number of micro-
+ *                                 seconds since January 1, 1970 UTC.
+ * @param[in]          topic       Topic
+ * @param[in,optional] token       Token, can be NULL
+ * @param[in,optional] category    Category, can be NULL that defaults to
+ *                                 "application"
+ * @param[in]          data        Buffer containing data to publish
+ * @param[in]          dataLen     Buffer length, up to GDP_USER_DATA_LEN
+ * @param[in]          cacheData   Cache the data if TRUE
+ * @param[in]          requireSubs Require subscriber(s) if TRUE
+ * @param[in,optional] callback    Called with the publish result, can be NULL
+ * @param[in,optional] clientData  Passed to callback
+ *
+ * @return GDP_ERROR_SUCCESS if the data is queued, callback will be called.
+ * @return GDP_ERROR_QUEUE_FULL if the submission queue is full.
+ * @return Other GdpError code otherwise, callback will not be called.
+ *
+ ******************************************************************************
+ */
+
+static inline GdpError
+ToolsPluginSvcGdp_PublishAsync(ToolsAppCtx *ctx,            // IN
+                               gint64 createTime,           // IN
+                               const gchar *topic,          // IN
+                               const gchar *token,          // IN, OPTIONAL
+                               const gchar *category,       // IN, OPTIONAL
+                               const gchar *data,           // IN
+                               guint32 dataLen,             // IN
+                               gboolean cacheData,          // IN
+                               gboolean requireSubs,        // IN
+                               GdpPublishCallback callback, // IN, OPTIONAL
+                               gpointer clientData)         // IN, OPTIONAL
+{
+   ToolsPluginSvcGdp *svcGdp = NULL;
+   g_object_get(ctx->serviceObj, TOOLS_PLUGIN_SVC_PROP_GDP, &svcGdp, NULL);
+   if (svcGdp != NULL && svcGdp->publishAsync != NULL) {
+      return svcGdp->publishAsync(createTime, topic, token, category,
+                                  data, dataLen, cacheData, requireSubs,
+                                  callback, clientData);
+   }
+   return GDP_ERROR_GENERAL;
+}
+
 #endif /* _VMWARE_TOOLS_GDP_H_ */
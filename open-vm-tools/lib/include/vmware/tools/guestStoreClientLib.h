@@ -136,6 +136,17 @@ typedef Bool (*GuestStore_GetContentCallback) (int64 contentSize,
                                                int64 contentBytesReceived,
                                                void *clientData);
 
+/*
+ * Caller provided options for the local content cache, see
+ * GuestStore_GetContentEx.
+ */
+typedef struct GuestStoreCacheOptions {
+   const char *cacheDir;  // Cache directory, created if it does not exist
+   int64 maxCacheSize;    // Cache directory size limit in bytes, 0: no limit
+   int32 maxAge;          // Seconds a cached content can be reused,
+                          // capped at one hour
+} GuestStoreCacheOptions;
+
 /*
  * GuestStore client library Init entry point function.
  */
@@ -154,6 +165,34 @@ GuestStore_GetContent(
    GuestStore_GetContentCallback getContentCb,  // IN, OPTIONAL
    void *clientData);                           // IN, OPTIONAL
 
+/*
+ * GuestStore client library GetContent entry point function with a local
+ * content cache.
+ *
+ * When cacheOptions is not NULL, a successfully downloaded content is kept
+ * in cacheOptions->cacheDir, keyed by contentPath. A later call for the same
+ * contentPath within cacheOptions->maxAge seconds still asks GuestStore for
+ * the content, but if the reported content size matches the cached copy the
+ * download is abandoned and the output file is copied from the cache.
+ * GuestStore reports no content version, so the content at a path is
+ * assumed not to change during that time; to bound the effect of a content
+ * replaced by one of the same size, cached contents are never reused after
+ * one hour, whatever cacheOptions->maxAge is.
+ * Oldest cached contents are evicted to keep the cache directory within
+ * cacheOptions->maxCacheSize bytes.
+ *
+ * The cache is not supported on Windows, cacheOptions is ignored there.
+ */
+GuestStoreLibError
+GuestStore_GetContentEx(
+   const char *contentPath,                     // IN
+   const char *outputPath,                      // IN
+   const GuestStoreCacheOptions *cacheOptions,  // IN, OPTIONAL
+   GuestStore_Logger logger,                    // IN, OPTIONAL
+   GuestStore_Panic panic,                      // IN, OPTIONAL
+   GuestStore_GetContentCallback getContentCb,  // IN, OPTIONAL
+   void *clientData);                           // IN, OPTIONAL
+
 /*
  * GuestStore client library DeInit entry point function.
  * Call of GuestStore_DeInit should match succeeded GuestStore_Init call.
@@ -142,6 +142,12 @@ ToolsCore_LogState(guint level,
 /**
  * Signal sent when the config file is reloaded.
  *
+ * While the signal is being emitted, ToolsAppCtx::configChanges holds the set
+ * of groups and keys that differ from the previous config. Handlers can use
+ * ToolsCore_ConfigGroupChanged() and ToolsCore_ConfigKeyChanged() to skip
+ * work when the settings they care about did not change. The signal is also
+ * sent when the file was rewritten without changes; the set is then empty.
+ *
  * @param[in]  src      The source object.
  * @param[in]  ctx      ToolsAppCtx *: The application context.
  * @param[in]  data     Client data.
@@ -285,6 +291,8 @@ ToolsCore_LogState(guint level,
  */
 typedef enum {
    TOOLS_CORE_API_V1    = 0x1,
+   /** ToolsAppCtx::configChanges is available. */
+   TOOLS_CORE_API_V2    = 0x2,
 } ToolsCoreAPI;
 
 
@@ -344,8 +352,63 @@ typedef struct ToolsAppCtx {
     * This allows a plugin to share data and services to others.
     */
    RegisterServiceProperty registerServiceProperty;
+
+   /**
+    * Groups and keys changed by the config reload being signalled, as
+    * returned by VMTools_DiffConfig(). Only set while TOOLS_CORE_SIG_CONF_RELOAD
+    * is being emitted, and only when the change set is known; NULL otherwise.
+    * Requires TOOLS_CORE_API_V2.
+    */
+   GHashTable       *configChanges;
 } ToolsAppCtx;
 
+
+/**
+ * Checks whether a config group changed in the reload being signalled. Only
+ * meaningful inside a TOOLS_CORE_SIG_CONF_RELOAD handler.
+ *
+ * @param[in]  ctx     The application context.
+ * @param[in]  group   Config group name.
+ *
+ * @return FALSE if the group is known to be unchanged, TRUE otherwise
+ *         (including when the change set is not available).
+ */
+static inline gboolean
+ToolsCore_ConfigGroupChanged(ToolsAppCtx *ctx,
+                             const gchar *group)
+{
+   if (!(ctx->version & TOOLS_CORE_API_V2) || ctx->configChanges == NULL) {
+      return TRUE;
+   }
+   return g_hash_table_lookup(ctx->configChanges, group) != NULL;
+}
+
+
+/**
+ * Checks whether a config key changed in the reload being signalled. Only
+ * meaningful inside a TOOLS_CORE_SIG_CONF_RELOAD handler.
+ *
+ * @param[in]  ctx     The application context.
+ * @param[in]  group   Config group name.
+ * @param[in]  key     Config key name.
+ *
+ * @return FALSE if the key is known to be unchanged, TRUE otherwise
+ *         (including when the change set is not available).
+ */
+static inline gboolean
+ToolsCore_ConfigKeyChanged(ToolsAppCtx *ctx,
+                           const gchar *group,
+                           const gchar *key)
+{
+   GHashTable *keys;
+
+   if (!(ctx->version & TOOLS_CORE_API_V2) || ctx->configChanges == NULL) {
+      return TRUE;
+   }
+   keys = g_hash_table_lookup(ctx->configChanges, group);
+   return keys != NULL && g_hash_table_lookup(keys, key) != NULL;
+}
+
 #if defined(G_PLATFORM_WIN32)
 /**
  * Initializes COM if it hasn't been initialized yet.
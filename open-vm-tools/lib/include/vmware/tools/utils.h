@@ -114,6 +114,10 @@ gboolean
 VMTools_CompareConfig(GKeyFile *config1,
                       GKeyFile *config2);
 
+GHashTable *
+VMTools_DiffConfig(GKeyFile *oldConfig,
+                   GKeyFile *newConfig);
+
 gboolean
 VMTools_WriteConfig(const gchar *path,
                     GKeyFile *config,
@@ -88,6 +88,11 @@ typedef struct WiperPartition {
    DWORD flags;
 #endif
 
+#if defined(__linux__)
+   /* The filesystem discards blocks as they are freed ("-o discard") */
+   Bool onlineDiscard;
+#endif
+
    DblLnkLst_Links link;
 } WiperPartition;
 
@@ -119,7 +124,28 @@ unsigned char *WiperSinglePartition_GetSpace(const WiperPartition *p,
 struct Wiper_State;
 typedef struct Wiper_State Wiper_State;
 
+/* How the free space of a partition is being reclaimed */
+typedef enum {
+   WIPER_METHOD_ZERO_FILL = 0,
+   WIPER_METHOD_PUNCH_HOLE,
+   WIPER_METHOD_TRIM,
+} WiperMethod;
+
+typedef struct WiperStats {
+   WiperMethod method;
+   uint64 bytes;        /* Bytes zeroed, discarded or trimmed */
+   uint64 usecs;        /* Time spent since Wiper_Start */
+} WiperStats;
+
 Wiper_State *Wiper_Start(const WiperPartition *p, unsigned int maxWiperFileSize);
+#if !defined(_WIN32)
+Wiper_State *Wiper_StartWithStats(const WiperPartition *p,
+                                  unsigned int maxWiperFileSize,
+                                  WiperStats *stats);
+void Wiper_SetZeroFill(Wiper_State *s, unsigned int streams,
+                       unsigned int maxMBps);
+#endif
+const char *Wiper_MethodName(WiperMethod method);
 
 unsigned char *Wiper_Next(Wiper_State **s, unsigned int *progress);
 unsigned char *Wiper_Cancel(Wiper_State **s);
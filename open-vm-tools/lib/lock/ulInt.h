@@ -49,6 +49,18 @@ typedef pthread_t MXUserThreadID;
 #define MXUSER_STAT_CLASS_ACQUISITION "a"
 #define MXUSER_STAT_CLASS_HELD        "h"
 
+/*
+ * Statistics support is compiled into stats builds and into Tools, where it
+ * is switched on at run time (see MXUser_SetStatsExport). A lock without
+ * statistics objects attached pays one pointer read per operation.
+ */
+
+#if defined(VMX86_STATS) || defined(VMX86_TOOLS)
+#define mxuser_stats 1
+#else
+#define mxuser_stats 0
+#endif
+
 /*
  * A portable recursive lock.
  */
@@ -462,6 +474,9 @@ typedef struct MXUserHeader {
    void       (*statsFunc)(struct MXUserHeader *);
    ListItem     item;
 
+   Atomic_Ptr  *acquireStatsMem;  // NULL if the object keeps no statistics
+   Atomic_Ptr  *heldStatsMem;     // NULL if the object keeps no statistics
+
    uint64       serialNumber;
    Bool         badHeader;
 } MXUserHeader;
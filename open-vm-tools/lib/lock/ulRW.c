@@ -355,6 +355,8 @@ MXUser_CreateRWLock(const char *userName,  // IN:
    lock->header.rank = rank;
    lock->header.serialNumber = MXUserAllocSerialNumber();
    lock->header.dumpFunc = MXUserDumpRWLock;
+   lock->header.acquireStatsMem = &lock->acquireStatsMem;
+   lock->header.heldStatsMem = &lock->heldStatsMem;
 
    /*
     * Always attempt to use native locks when they are available. If, for some
@@ -445,7 +447,7 @@ MXUser_DestroyRWLock(MXUserRWLock *lock)  // IN:
 
       MXUserRemoveFromList(&lock->header);
 
-      if (vmx86_stats) {
+      if (mxuser_stats) {
          MXUserDisableStats(&lock->acquireStatsMem, &lock->heldStatsMem);
       }
 
@@ -540,7 +542,7 @@ MXUserAcquisition(MXUserRWLock *lock,  // IN/OUT:
                                                                    "Write");
    }
 
-   if (vmx86_stats) {
+   if (mxuser_stats) {
       VmTimeType value;
       MXUserAcquireStats *acquireStats;
 
@@ -744,10 +746,15 @@ MXUser_ReleaseRWLock(MXUserRWLock *lock)  // IN/OUT:
 
    myContext = MXUserGetHolderContext(lock);
 
-   if (vmx86_stats) {
+   if (mxuser_stats) {
       MXUserHeldStats *heldStats = Atomic_ReadPtr(&lock->heldStatsMem);
 
-      if (UNLIKELY(heldStats != NULL)) {
+      /*
+       * No hold start was taken if the held statistics were attached while
+       * the lock was held; there is nothing to sample then.
+       */
+
+      if (UNLIKELY(heldStats != NULL) && myContext->holdStart != 0) {
          MXUserHisto *histo;
          VmTimeType duration = Hostinfo_SystemTimerNS() - myContext->holdStart;
 
@@ -773,6 +780,8 @@ MXUser_ReleaseRWLock(MXUserRWLock *lock)  // IN/OUT:
             MXRecLockRelease(&lock->recursiveLock);
          }
       }
+
+      myContext->holdStart = 0;
    }
 
    if (UNLIKELY(myContext->state == RW_UNLOCKED)) {
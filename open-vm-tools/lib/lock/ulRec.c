@@ -144,12 +144,12 @@ MXUser_EnableStatsRecLock(MXUserRecLock *lock,        // IN/OUT:
    ASSERT(lock != NULL);
    MXUserValidateHeader(&lock->header, MXUSER_TYPE_REC);
 
-   if (vmx86_stats) {
+   if (mxuser_stats) {
       MXUserEnableStats(trackAcquisitionTime ? &lock->acquireStatsMem : NULL,
                         trackHeldTime        ? &lock->heldStatsMem    : NULL);
    }
 
-   return vmx86_stats;
+   return mxuser_stats;
 }
 
 
@@ -176,11 +176,11 @@ MXUser_DisableStatsRecLock(MXUserRecLock *lock)  // IN/OUT:
    ASSERT(lock != NULL);
    MXUserValidateHeader(&lock->header, MXUSER_TYPE_REC);
 
-   if (vmx86_stats) {
+   if (mxuser_stats) {
       MXUserDisableStats(&lock->acquireStatsMem, &lock->heldStatsMem);
    }
 
-   return vmx86_stats;
+   return mxuser_stats;
 }
 
 
@@ -210,7 +210,7 @@ MXUser_SetContentionRatioFloorRecLock(MXUserRecLock *lock,  // IN/OUT:
    ASSERT(lock != NULL);
    MXUserValidateHeader(&lock->header, MXUSER_TYPE_REC);
 
-   if (vmx86_stats) {
+   if (mxuser_stats) {
       result = MXUserSetContentionRatioFloor(&lock->acquireStatsMem, ratio);
    } else {
       result = FALSE;
@@ -246,7 +246,7 @@ MXUser_SetContentionCountFloorRecLock(MXUserRecLock *lock,  // IN/OUT:
    ASSERT(lock != NULL);
    MXUserValidateHeader(&lock->header, MXUSER_TYPE_REC);
 
-   if (vmx86_stats) {
+   if (mxuser_stats) {
       result = MXUserSetContentionCountFloor(&lock->acquireStatsMem, count);
    } else {
       result = FALSE;
@@ -282,7 +282,7 @@ MXUser_SetContentionDurationFloorRecLock(MXUserRecLock *lock,  // IN/OUT:
    ASSERT(lock != NULL);
    MXUserValidateHeader(&lock->header, MXUSER_TYPE_REC);
 
-   if (vmx86_stats) {
+   if (mxuser_stats) {
       result = MXUserSetContentionDurationFloor(&lock->acquireStatsMem,
                                                 duration);
    } else {
@@ -378,6 +378,8 @@ MXUser_CreateRecLock(const char *userName,  // IN:
    lock->header.rank = rank;
    lock->header.serialNumber = MXUserAllocSerialNumber();
    lock->header.dumpFunc = MXUserDumpRecLock;
+   lock->header.acquireStatsMem = &lock->acquireStatsMem;
+   lock->header.heldStatsMem = &lock->heldStatsMem;
 
    statsMode = MXUserStatsMode();
 
@@ -447,7 +449,7 @@ MXUserCondDestroyRecLock(MXUserRecLock *lock)  // IN:
 
          MXUserRemoveFromList(&lock->header);
 
-         if (vmx86_stats) {
+         if (mxuser_stats) {
             MXUserDisableStats(&lock->acquireStatsMem, &lock->heldStatsMem);
          }
       }
@@ -500,7 +502,7 @@ MXUser_AcquireRecLock(MXUserRecLock *lock)  // IN/OUT:
       /* Rank checking is only done on the first acquisition */
       MXUserAcquisitionTracking(&lock->header, TRUE);
 
-      if (vmx86_stats) {
+      if (mxuser_stats) {
          VmTimeType value = 0;
          MXUserAcquireStats *acquireStats;
 
@@ -566,7 +568,7 @@ MXUser_ReleaseRecLock(MXUserRecLock *lock)  // IN/OUT:
       ASSERT(MXUserMX_UnlockRec);
       (*MXUserMX_UnlockRec)(lock->vmmLock);
    } else {
-      if (vmx86_stats) {
+      if (mxuser_stats) {
          MXUserHeldStats *heldStats = Atomic_ReadPtr(&lock->heldStatsMem);
 
          if (LIKELY(heldStats != NULL)) {
@@ -659,7 +661,7 @@ MXUser_TryAcquireRecLock(MXUserRecLock *lock)  // IN/OUT:
          MXUserAcquisitionTracking(&lock->header, FALSE);
       }
 
-      if (vmx86_stats) {
+      if (mxuser_stats) {
          MXUserAcquireStats *acquireStats;
 
          acquireStats = Atomic_ReadPtr(&lock->acquireStatsMem);
@@ -469,6 +469,7 @@ MXUser_CreateSemaphore(const char *userName,  // IN:
       sema->header.rank = rank;
       sema->header.serialNumber = MXUserAllocSerialNumber();
       sema->header.dumpFunc = MXUserDumpSemaphore;
+      sema->header.acquireStatsMem = &sema->acquireStatsMem;
 
       statsMode = MXUserStatsMode();
 
@@ -538,7 +539,7 @@ MXUser_DestroySemaphore(MXUserSemaphore *sema)  // IN/OUT:
 
       MXUserRemoveFromList(&sema->header);
 
-      if (vmx86_stats) {
+      if (mxuser_stats) {
          MXUserAcquireStats *acquireStats;
 
          acquireStats = Atomic_ReadPtr(&sema->acquireStatsMem);
@@ -589,7 +590,7 @@ MXUser_DownSemaphore(MXUserSemaphore *sema)  // IN/OUT:
 
    MXUserAcquisitionTracking(&sema->header, TRUE);  // rank checking
 
-   if (vmx86_stats) {
+   if (mxuser_stats) {
       VmTimeType start = 0;
       Bool tryDownSuccess = FALSE;
       MXUserAcquireStats *acquireStats;
@@ -676,7 +677,7 @@ MXUser_TimedDownSemaphoreNS(MXUserSemaphore *sema,  // IN/OUT:
 
    MXUserAcquisitionTracking(&sema->header, TRUE);  // rank checking
 
-   if (vmx86_stats) {
+   if (mxuser_stats) {
       VmTimeType start = 0;
       Bool tryDownSuccess = FALSE;
       MXUserAcquireStats *acquireStats;
@@ -801,7 +802,7 @@ MXUser_TryDownSemaphore(MXUserSemaphore *sema)  // IN/OUT:
                          __FUNCTION__, err);
    }
 
-   if (vmx86_stats) {
+   if (mxuser_stats) {
       MXUserAcquireStats *acquireStats;
 
       acquireStats = Atomic_ReadPtr(&sema->acquireStatsMem);
@@ -32,6 +32,7 @@
 #include "logFixed.h"
 
 #define BINS_PER_DECADE 100
+#define BIN_WIDTH_RATIO 1.0232929922807541  // 10^(1 / BINS_PER_DECADE)
 
 static double mxUserContentionRatioFloor = 0.0;   // always "off"
 static uint64 mxUserContentionCountFloor = 0;     // always "off"
@@ -55,6 +56,7 @@ struct MXUserHisto {
 };
 
 static Bool    mxUserTrackHeldTimes = FALSE;
+static Bool    mxUserStatsExport = FALSE;
 static char   *mxUserHistoLine = NULL;
 static uint32  mxUserMaxLineLength = 0;
 static void   *mxUserStatsContext = NULL;
@@ -936,7 +938,9 @@ MXUserForceHeldHisto(Atomic_Ptr *mem,  // IN/OUT:
 uint32
 MXUserStatsMode(void)
 {
-   if (vmx86_stats && (mxUserStatsFunc != NULL) && (mxUserMaxLineLength > 0)) {
+   if (mxuser_stats &&
+       (mxUserStatsExport ||
+        ((mxUserStatsFunc != NULL) && (mxUserMaxLineLength > 0)))) {
       return mxUserTrackHeldTimes ? 2 : 1;
    } else {
       return 0;
@@ -1264,6 +1268,13 @@ MXUserEnableStats(Atomic_Ptr *acquisitionMem,  // IN/OPT:
             free(acquireStats);
          }
       }
+
+      /* Percentiles are computed from the histograms */
+      if (mxUserStatsExport) {
+         MXUserForceAcquisitionHisto(acquisitionMem,
+                                     MXUSER_DEFAULT_HISTO_MIN_VALUE_NS,
+                                     MXUSER_DEFAULT_HISTO_DECADES);
+      }
    }
 
    if (heldMem != NULL) {
@@ -1275,6 +1286,9 @@ MXUserEnableStats(Atomic_Ptr *acquisitionMem,  // IN/OPT:
          heldStats = Util_SafeCalloc(1, sizeof *heldStats);
          MXUserBasicStatsSetUp(&heldStats->data, MXUSER_STAT_CLASS_HELD);
 
+         /* Bound the first sample should the lock be held right now */
+         heldStats->holdStart = Hostinfo_SystemTimerNS();
+
          before = Atomic_ReadIfEqualWritePtr(heldMem, NULL,
                                              (void *) heldStats);
 
@@ -1282,6 +1296,278 @@ MXUserEnableStats(Atomic_Ptr *acquisitionMem,  // IN/OPT:
             free(heldStats);
          }
       }
+
+      if (mxUserStatsExport) {
+         MXUserForceHeldHisto(heldMem, MXUSER_DEFAULT_HISTO_MIN_VALUE_NS,
+                              MXUSER_DEFAULT_HISTO_DECADES);
+      }
+   }
+}
+
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * MXUser_SetStatsExport --
+ *
+ *      Switch the collection of statistics for MXUser_GetTopContendedLocks
+ *      on or off at run time. When switched on, statistics (including the
+ *      histograms from which percentiles are computed) are attached to all
+ *      existing locks and to all locks created afterwards.
+ *
+ *      Statistics objects cannot be safely detached from a lock that may be
+ *      in use, so switching off only stops attaching them to new locks;
+ *      existing locks keep collecting.
+ *
+ * Results:
+ *      None
+ *
+ * Side effects:
+ *      Memory is allocated.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+MXUser_SetStatsExport(Bool enable,          // IN:
+                      Bool trackHeldTimes)  // IN:
+{
+   MXRecLock *listLock = MXUserInternalSingleton(&mxLockMemPtr);
+
+   if (!mxuser_stats) {
+      return;
+   }
+
+   mxUserStatsExport = enable;
+
+   if (!enable) {
+      return;
+   }
+
+   mxUserTrackHeldTimes = trackHeldTimes;
+
+   if (listLock) {
+      ListItem *entry;
+
+      MXRecLockAcquire(listLock,
+                       NULL);  // non-stats
+
+      CIRC_LIST_SCAN(entry, mxUserLockList) {
+         MXUserHeader *header = CIRC_LIST_CONTAINER(entry, MXUserHeader, item);
+
+         if (header->acquireStatsMem != NULL) {
+            MXUserEnableStats(header->acquireStatsMem,
+                              trackHeldTimes ? header->heldStatsMem : NULL);
+         }
+      }
+
+      MXRecLockRelease(listLock);
    }
 }
 
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * MXUserHistoPercentile --
+ *
+ *      Estimate a percentile from a histogram. The histogram may be updated
+ *      concurrently so the result is approximate.
+ *
+ * Results:
+ *      The lower bound of the bin holding the percentile, in ns.
+ *      0 if there are no samples.
+ *
+ * Side effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static uint64
+MXUserHistoPercentile(const MXUserHisto *histo,  // IN:
+                      uint32 percent)            // IN: 1 - 100
+{
+   uint32 i;
+   uint32 j;
+   uint64 sum = 0;
+   uint64 target;
+   double value;
+
+   ASSERT(percent > 0 && percent <= 100);
+
+   if (histo == NULL || histo->totalSamples == 0) {
+      return 0;
+   }
+
+   target = (histo->totalSamples * percent + 99) / 100;
+
+   for (i = 0; i < histo->numBins - 1; i++) {
+      sum += histo->binData[i];
+
+      if (sum >= target) {
+         break;
+      }
+   }
+
+   /* Bin i covers minValue * 10^(i / BINS_PER_DECADE) and up */
+   value = (double) histo->minValue;
+
+   for (j = 0; j < i / BINS_PER_DECADE; j++) {
+      value *= 10.0;
+   }
+
+   for (j = 0; j < i % BINS_PER_DECADE; j++) {
+      value *= BIN_WIDTH_RATIO;
+   }
+
+   return (uint64) value;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * MXUserCompareLockStats --
+ *
+ *      qsort comparator; most contended first.
+ *
+ * Results:
+ *      As above.
+ *
+ * Side effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static int
+MXUserCompareLockStats(const void *left,   // IN:
+                       const void *right)  // IN:
+{
+   const MXUserLockStats *a = left;
+   const MXUserLockStats *b = right;
+
+   if (a->contentionTime != b->contentionTime) {
+      return (a->contentionTime < b->contentionTime) ? 1 : -1;
+   }
+
+   if (a->numContended != b->numContended) {
+      return (a->numContended < b->numContended) ? 1 : -1;
+   }
+
+   if (a->numAttempts != b->numAttempts) {
+      return (a->numAttempts < b->numAttempts) ? 1 : -1;
+   }
+
+   return 0;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * MXUser_GetTopContendedLocks --
+ *
+ *      Take a snapshot of the statistics of the locks that have been
+ *      acquired since statistics were switched on (see
+ *      MXUser_SetStatsExport), ordered by the total time spent waiting for
+ *      them.
+ *
+ *      The snapshot is taken on active locks so the data is approximate.
+ *
+ * Results:
+ *      The number of entries filled in, at most maxLocks.
+ *
+ * Side effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+uint32
+MXUser_GetTopContendedLocks(MXUserLockStats *lockStats,  // OUT:
+                            uint32 maxLocks)             // IN:
+{
+   MXRecLock *listLock = MXUserInternalSingleton(&mxLockMemPtr);
+   MXUserLockStats *all = NULL;
+   ListItem *entry;
+   uint32 numLocks = 0;
+   uint32 numAll = 0;
+
+   ASSERT(lockStats != NULL || maxLocks == 0);
+
+   if (!mxuser_stats || maxLocks == 0 || listLock == NULL) {
+      return 0;
+   }
+
+   MXRecLockAcquire(listLock,
+                    NULL);  // non-stats
+
+   CIRC_LIST_SCAN(entry, mxUserLockList) {
+      numAll++;
+   }
+
+   if (numAll > 0) {
+      all = Util_SafeCalloc(numAll, sizeof *all);
+   }
+
+   CIRC_LIST_SCAN(entry, mxUserLockList) {
+      MXUserHeader *header = CIRC_LIST_CONTAINER(entry, MXUserHeader, item);
+      MXUserAcquireStats *acquireStats;
+      MXUserHeldStats *heldStats;
+      MXUserLockStats *out;
+
+      if (header->acquireStatsMem == NULL) {
+         continue;
+      }
+
+      acquireStats = Atomic_ReadPtr(header->acquireStatsMem);
+
+      if (acquireStats == NULL || acquireStats->data.numAttempts == 0) {
+         continue;
+      }
+
+      ASSERT(numLocks < numAll);
+      out = &all[numLocks++];
+
+      Str_Snprintf(out->name, sizeof out->name, "%s", header->name);
+      out->serialNumber = header->serialNumber;
+      out->numAttempts = acquireStats->data.numAttempts;
+      out->numContended = acquireStats->data.numSuccessesContended +
+                          (acquireStats->data.numAttempts -
+                           acquireStats->data.numSuccesses);
+      out->contentionTime = acquireStats->data.totalContentionTime;
+      out->waitP50 = MXUserHistoPercentile(Atomic_ReadPtr(&acquireStats->histo),
+                                           50);
+      out->waitP99 = MXUserHistoPercentile(Atomic_ReadPtr(&acquireStats->histo),
+                                           99);
+      out->waitMax = acquireStats->data.basicStats.maxTime;
+
+      heldStats = (header->heldStatsMem == NULL) ? NULL :
+                                           Atomic_ReadPtr(header->heldStatsMem);
+
+      if (heldStats != NULL && heldStats->data.numSamples > 0) {
+         out->numHeld = heldStats->data.numSamples;
+         out->heldP50 = MXUserHistoPercentile(Atomic_ReadPtr(&heldStats->histo),
+                                              50);
+         out->heldP99 = MXUserHistoPercentile(Atomic_ReadPtr(&heldStats->histo),
+                                              99);
+         out->heldMax = heldStats->data.maxTime;
+      }
+   }
+
+   MXRecLockRelease(listLock);
+
+   qsort(all, numLocks, sizeof *all, MXUserCompareLockStats);
+
+   numLocks = MIN(numLocks, maxLocks);
+   if (numLocks > 0) {
+      memcpy(lockStats, all, numLocks * sizeof *lockStats);
+   }
+
+   free(all);
+
+   return numLocks;
+}
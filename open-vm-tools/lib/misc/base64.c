@@ -111,6 +111,159 @@ static const signed char base64Reverse[256] = {
    ILLEGAL, ILLEGAL, ILLEGAL, ILLEGAL, ILLEGAL, ILLEGAL, ILLEGAL, ILLEGAL,   /* F0-F7 */
    ILLEGAL, ILLEGAL, ILLEGAL, ILLEGAL, ILLEGAL, ILLEGAL, ILLEGAL, ILLEGAL }; /* F8-FF */
 
+/*
+ * On x86-64 the bulk of the input is encoded and decoded 16 bytes at a time
+ * with SSSE3 when the CPU has it, using the pshufb-based translation from
+ * Wojciech Mula's and Daniel Lemire's base64 work. The scalar loops remain
+ * the reference implementation and handle the tail of the input, padding,
+ * whitespace and anything else the vector code refuses.
+ */
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define BASE64_SSSE3
+#endif
+
+#ifdef BASE64_SSSE3
+#include <tmmintrin.h>
+#include "hostinfo.h"
+
+#define BASE64_SSSE3_ATTR __attribute__((target("ssse3")))
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * Base64EncodeSSSE3 --
+ *
+ *      Encodes 12 bytes at a time while at least 16 bytes of input remain
+ *      (each step loads 16). dst must have room for the output.
+ *
+ * Results:
+ *      The number of input bytes consumed, a multiple of 3.
+ *
+ * Side effects:
+ *      Writes 4/3 as many characters to dst.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static BASE64_SSSE3_ATTR size_t
+Base64EncodeSSSE3(uint8 const *src,  // IN:
+                  size_t srcSize,    // IN:
+                  char *dst)         // OUT:
+{
+   const __m128i shuf = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4,
+                                      7, 6, 8, 7, 10, 9, 11, 10);
+   const __m128i shiftLut = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '+' - 62,
+                                          '/' - 63, 'A', 0, 0);
+   size_t done = 0;
+
+   while (srcSize - done >= 16) {
+      __m128i in = _mm_loadu_si128((const __m128i *)(src + done));
+      __m128i t0;
+      __m128i t1;
+      __m128i idx;
+      __m128i res;
+
+      /* Spread 3 bytes into each 32-bit lane, then pull out the sextets */
+      in = _mm_shuffle_epi8(in, shuf);
+      t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)),
+                           _mm_set1_epi32(0x04000040));
+      t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)),
+                           _mm_set1_epi32(0x01000010));
+      idx = _mm_or_si128(t0, t1);
+
+      /* Map each 6-bit value to the offset of its alphabet range */
+      res = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+      res = _mm_or_si128(res,
+                         _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), idx),
+                                       _mm_set1_epi8(13)));
+      res = _mm_add_epi8(_mm_shuffle_epi8(shiftLut, res), idx);
+
+      _mm_storeu_si128((__m128i *)dst, res);
+      dst += 16;
+      done += 12;
+   }
+
+   return done;
+}
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * Base64DecodeSSSE3 --
+ *
+ *      Decodes 16 characters at a time while the input holds nothing but
+ *      alphabet characters, at least 16 of them remain and out has room for
+ *      16 bytes (each step stores 16 and keeps 12).
+ *
+ * Results:
+ *      The number of characters consumed, a multiple of 16.
+ *
+ * Side effects:
+ *      Writes 3/4 as many bytes to out.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static BASE64_SSSE3_ATTR size_t
+Base64DecodeSSSE3(char const *in,   // IN:
+                  size_t inSize,    // IN:
+                  uint8 *out,       // OUT:
+                  size_t outSize)   // IN:
+{
+   const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                       0x11, 0x11, 0x11, 0x11, 0x13, 0x1a,
+                                       0x1b, 0x1b, 0x1b, 0x1a);
+   const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08,
+                                       0x04, 0x08, 0x10, 0x10, 0x10, 0x10,
+                                       0x10, 0x10, 0x10, 0x10);
+   const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                         0, 0, 0, 0, 0, 0, 0, 0);
+   const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9,
+                                      8, 14, 13, 12, -1, -1, -1, -1);
+   const __m128i nibble = _mm_set1_epi8(0x0f);
+   size_t done = 0;
+
+   while (inSize - done >= 16 && outSize >= 16) {
+      __m128i str = _mm_loadu_si128((const __m128i *)(in + done));
+      __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(str, 4), nibble);
+      __m128i loNibbles = _mm_and_si128(str, nibble);
+      __m128i lo = _mm_shuffle_epi8(lutLo, loNibbles);
+      __m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+      __m128i roll;
+
+      /* Any byte outside the alphabet has a class bit set in both tables */
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi),
+                                           _mm_setzero_si128())) != 0xffff) {
+         break;
+      }
+
+      roll = _mm_shuffle_epi8(lutRoll,
+                              _mm_add_epi8(_mm_cmpeq_epi8(str,
+                                                          _mm_set1_epi8('/')),
+                                           hiNibbles));
+      str = _mm_add_epi8(str, roll);
+
+      /* Merge the sextets into 24-bit groups and drop the spare bytes */
+      str = _mm_maddubs_epi16(str, _mm_set1_epi32(0x01400140));
+      str = _mm_madd_epi16(str, _mm_set1_epi32(0x00011000));
+      str = _mm_shuffle_epi8(str, pack);
+
+      _mm_storeu_si128((__m128i *)out, str);
+      out += 12;
+      outSize -= 12;
+      done += 16;
+   }
+
+   return done;
+}
+#endif
+
 /* (From RFC1521 and draft-ietf-dnssec-secext-03.txt)
    The following encoding technique is taken from RFC 1521 by Borenstein
    and Freed.  It is reproduced here in a slightly edited form for
@@ -213,6 +366,16 @@ Base64_Encode(uint8 const *src,  // IN:
       goto exit;
    }
 
+#ifdef BASE64_SSSE3
+   if (srcSize >= 16 && Hostinfo_HaveSSSE3()) {
+      size_t done = Base64EncodeSSSE3(src, srcSize, dst);
+
+      src += done;
+      srcSize -= done;
+      dst += done / 3 * 4;
+   }
+#endif
+
    while (LIKELY(srcSize > 2)) {
       dst[0] = Base64[src[0] >> 2];
       dst[1] = Base64[(src[0] & 0x03) << 4 | src[1] >> 4];
@@ -387,6 +550,9 @@ Base64_ChunkDecode(char const *in,      // IN:
    int n = 0;
    uintptr_t i = 0;
    size_t inputIndex = 0;
+#ifdef BASE64_SSSE3
+   Bool useSSSE3;
+#endif
 
    ASSERT(in);
    ASSERT(out || outSize == 0);
@@ -394,9 +560,36 @@ Base64_ChunkDecode(char const *in,      // IN:
    ASSERT((inSize == (size_t)-1) || (inSize % 4) == 0);
    *dataLength = 0;
 
+#ifdef BASE64_SSSE3
+   /*
+    * The vector code reads ahead, so it needs to know where the input ends.
+    * Stopping at the NUL is what the loop below would do anyway.
+    */
+   if (inSize == (size_t)-1) {
+      inSize = strlen(in);
+   }
+   useSSSE3 = inSize >= 16 && Hostinfo_HaveSSSE3();
+#endif
+
    i = 0;
    for (;inputIndex < inSize;) {
-      int p = base64Reverse[(unsigned char)in[inputIndex]];
+      int p;
+
+#ifdef BASE64_SSSE3
+      /* Only whole quanta can be handed to the vector code. */
+      if (useSSSE3 && n == 0 && outSize - i >= 16) {
+         size_t done = Base64DecodeSSSE3(in + inputIndex, inSize - inputIndex,
+                                         out + i, outSize - i);
+
+         inputIndex += done;
+         i += done / 4 * 3;
+         if (inputIndex >= inSize) {
+            break;
+         }
+      }
+#endif
+
+      p = base64Reverse[(unsigned char)in[inputIndex]];
 
       if (UNLIKELY(p < 0)) {
          switch (p) {
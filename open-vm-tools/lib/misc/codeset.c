@@ -939,6 +939,15 @@ CodeSet_GenericToGenericDb(const char *codeIn,  // IN
                                            flags, db);
    }
 
+   /*
+    * Unicode and Latin-1 conversions don't need ICU.
+    */
+
+   if (CodeSetOld_FastGenericToGenericDb(codeIn, bufIn, sizeIn, codeOut,
+                                         flags, db, &result)) {
+      return result;
+   }
+
    /*
     * Trivial case.
     */
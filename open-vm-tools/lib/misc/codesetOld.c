@@ -208,61 +208,11 @@ CodeSetOldUtf8ToUtf16leDb(const char *bufIn,   // IN:
                           size_t      sizeIn,  // IN:
                           DynBuf     *db)      // IN:
 {
-   const char *bufEnd = bufIn + sizeIn;
-   size_t currentSize;
-   size_t allocatedSize;
-   uint16 *buf;
-
-   currentSize = DynBuf_GetSize(db);
-   allocatedSize = DynBuf_GetAllocatedSize(db);
-   buf = (uint16 *)((char *)DynBuf_Get(db) + currentSize);
-   while (bufIn < bufEnd) {
-      size_t neededSize;
-      uint32 uniChar;
-      int n = CodeSet_GetUtf8(bufIn, bufEnd, &uniChar);
-
-      if (n <= 0) {
-         return FALSE;
-      }
-      bufIn += n;
-
-      /*
-       * Here we have UCS-4 character in uniChar, between 0 and 0x7FFFFFFF.
-       * Let's convert it to UTF-16.
-       */
-
-      /* Non-paired surrogates are illegal in UTF-16. */
-      if (uniChar >= 0xD800 && uniChar < 0xE000) {
-         return FALSE;
-      }
-      if (uniChar < 0x10000) {
-         neededSize = currentSize + sizeof *buf;
-      } else if (uniChar < 0x110000) {
-         neededSize = currentSize + 2 * sizeof *buf;
-      } else {
-         /* This character cannot be represented in UTF-16. */
-         return FALSE;
-      }
-      if (allocatedSize < neededSize) {
-         if (DynBuf_Enlarge(db, neededSize) == FALSE) {
-            return FALSE;
-         }
-         allocatedSize = DynBuf_GetAllocatedSize(db);
-         ASSERT(neededSize <= allocatedSize);
-         buf = (uint16 *)((char *)DynBuf_Get(db) + currentSize);
-      }
-      if (uniChar < 0x10000) {
-         *buf++ = uniChar;
-      } else {
-         *buf++ = 0xD800 + ((uniChar - 0x10000) >> 10);
-         *buf++ = 0xDC00 + ((uniChar - 0x10000) & 0x3FF);
-      }
-      currentSize = neededSize;
-   }
-   /* All went fine, update buffer size. */
-   DynBuf_SetSize(db, currentSize);
+   Bool ok;
 
-   return TRUE;
+   return CodeSetOld_FastGenericToGenericDb("UTF-8", bufIn, sizeIn,
+                                            "UTF-16LE", CSGTG_NORMAL, db,
+                                            &ok) && ok;
 }
 
 
@@ -875,6 +825,15 @@ CodeSetOld_GenericToGenericDb(char const *codeIn,   // IN:
    ASSERT(codeOut);
    ASSERT(db);
 
+   {
+      Bool ok;
+
+      if (CodeSetOld_FastGenericToGenericDb(codeIn, bufIn, sizeIn, codeOut,
+                                            flags, db, &ok)) {
+         return ok;
+      }
+   }
+
    // XXX make CodeSetOldIconvOpen happy
    if (flags != 0) {
       flags = CSGTG_TRANSLIT | CSGTG_IGNORE;
@@ -1367,121 +1326,11 @@ CodeSetOld_Utf16leToUtf8Db(char const *bufIn,  // IN
                            size_t sizeIn,      // IN
                            DynBuf *db)         // IN
 {
-   const uint16 *utf16In;
-   size_t numCodeUnits;
-   size_t codeUnitIndex;
-
-   if (sizeIn % sizeof *utf16In != 0) {
-      return FALSE;
-   }
-
-   utf16In = (const uint16 *)bufIn;
-   numCodeUnits = sizeIn / 2;
-
-   for (codeUnitIndex = 0; codeUnitIndex < numCodeUnits; codeUnitIndex++) {
-      uint32 codePoint;
-      uint8 *dbBytes;
-      size_t size;
-      size_t newSize;
-
-      if (utf16In[codeUnitIndex] < 0xD800 ||
-          utf16In[codeUnitIndex] > 0xDFFF) {
-         // Non-surrogate UTF-16 code units directly represent a code point.
-         codePoint = utf16In[codeUnitIndex];
-      } else {
-         static const uint32 SURROGATE_OFFSET =
-                                        (0xD800 << 10UL) + 0xDC00 - 0x10000;
-
-         uint16 surrogateLead = utf16In[codeUnitIndex];
-         uint16 surrogateTrail;
-
-         // We need one more code unit for the trailing surrogate.
-         codeUnitIndex++;
-         if (codeUnitIndex == numCodeUnits) {
-            return FALSE;
-         }
-
-         surrogateTrail = utf16In[codeUnitIndex];
-
-         // Ensure we have a lead surrogate followed by a trail surrogate.
-         if (surrogateLead > 0xDBFF ||
-             surrogateTrail < 0xDC00 ||
-             surrogateTrail > 0xDFFF) {
-            return FALSE;
-         }
-
-         /*
-          * To get a code point between 0x10000 and 0x10FFFF (2^16 to
-          * (2^21) - 1):
-          *
-          * 1) Ensure surrogateLead is in the range [0xD800, 0xDBFF]
-          *
-          * 2) Ensure surrogateTrail is in the range [0xDC00, 0xDFFF]
-          *
-          * 3) Mask off all but the low 10 bits of lead and shift that
-          *    left 10 bits: ((surrogateLead << 10) - (0xD800 << 10))
-          *    -> result [0, 0xFFC00]
-          *
-          * 4) Add to that the low 10 bits of trail: (surrogateTrail - 0xDC00)
-          *    -> result [0, 0xFFFFF]
-          *
-          * 5) Add to that 0x10000:
-          *    -> result [0x10000, 0x10FFFF]
-          */
-         codePoint = ((uint32)surrogateLead << 10UL) +
-                                    (uint32)surrogateTrail - SURROGATE_OFFSET;
-
-         ASSERT(codePoint >= 0x10000 && codePoint <= 0x10FFFF);
-      }
-
-      size = DynBuf_GetSize(db);
-      newSize = size + 4;
-
-      // We'll need at most 4 more bytes for this code point.
-      if ((newSize < size) ||  // Prevent integer overflow
-          (DynBuf_GetAllocatedSize(db) < newSize &&
-           DynBuf_Enlarge(db, newSize) == FALSE)) {
-         return FALSE;
-      }
-
-      dbBytes = (uint8 *)DynBuf_Get(db) + size;
-
-      // Convert the code point to UTF-8.
-      if (codePoint <= 0x007F) {
-         // U+0000 - U+007F: 1 byte of UTF-8.
-         dbBytes[0] = codePoint;
-         size += 1;
-      } else if (codePoint <= 0x07FF) {
-         // U+0080 - U+07FF: 2 bytes of UTF-8.
-         dbBytes[0] = 0xC0 | (codePoint >> 6);
-         dbBytes[1] = 0x80 | (codePoint & 0x3F);
-         size += 2;
-      } else if (codePoint <= 0xFFFF) {
-         // U+0800 - U+FFFF: 3 bytes of UTF-8.
-         dbBytes[0] = 0xE0 | (codePoint >> 12);
-         dbBytes[1] = 0x80 | ((codePoint >> 6) & 0x3F);
-         dbBytes[2] = 0x80 | (codePoint & 0x3F);
-         size += 3;
-      } else {
-         /*
-          * U+10000 - U+10FFFF: 4 bytes of UTF-8.
-          *
-          * See the surrogate pair handling block above for the math
-          * that ensures we're in the range [0x10000, 0x10FFFF] here.
-          */
-
-         ASSERT(codePoint <= 0x10FFFF);
-         dbBytes[0] = 0xF0 | (codePoint >> 18);
-         dbBytes[1] = 0x80 | ((codePoint >> 12) & 0x3F);
-         dbBytes[2] = 0x80 | ((codePoint >> 6) & 0x3F);
-         dbBytes[3] = 0x80 | (codePoint & 0x3F);
-         size += 4;
-      }
-
-      DynBuf_SetSize(db, size);
-   }
+   Bool ok;
 
-   return TRUE;
+   return CodeSetOld_FastGenericToGenericDb("UTF-16LE", bufIn, sizeIn,
+                                            "UTF-8", CSGTG_NORMAL, db,
+                                            &ok) && ok;
 }
 
 
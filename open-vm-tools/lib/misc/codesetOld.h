@@ -49,6 +49,15 @@ CodeSetOld_GenericToGenericDb(char const *codeIn,  // IN
                               unsigned int flags,  // IN
                               DynBuf *db);         // IN/OUT
 
+Bool
+CodeSetOld_FastGenericToGenericDb(const char *codeIn,  // IN
+                                  const char *bufIn,   // IN
+                                  size_t sizeIn,       // IN
+                                  const char *codeOut, // IN
+                                  unsigned int flags,  // IN
+                                  DynBuf *db,          // IN/OUT
+                                  Bool *ok);           // OUT
+
 Bool
 CodeSetOld_GenericToGeneric(const char *codeIn,  // IN
                             const char *bufIn,   // IN
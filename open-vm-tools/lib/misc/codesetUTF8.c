@@ -26,8 +26,13 @@
  */
 
 
+#include <string.h>
+
 #include "vmware.h"
 #include "codeset.h"
+#include "codesetOld.h"
+#include "dynbuf.h"
+#include "str.h"
 
 #define UTF8_ACCEPT 0
 #define UTF8_REJECT 1
@@ -61,6 +66,298 @@ CodeSetDecode(uint32 *state,  // IN:
 }
 
 
+/*
+ * Validation and the UTF-8/UTF-16LE/UTF-32LE/ISO-8859-1/US-ASCII conversions
+ * below skip runs of ASCII a block at a time. On x86-64, where SSE2 is part
+ * of the baseline, that is done 16 bytes at a time; elsewhere 8 bytes at a
+ * time in a general purpose register.
+ *
+ * Validation of non-ASCII text additionally uses an SSSE3 kernel when the CPU
+ * has it: the "lookup" algorithm from John Keiser's and Daniel Lemire's
+ * "Validating UTF-8 In Less Than One Instruction Per Byte", which classifies
+ * every byte together with the one before it using three 16-entry pshufb
+ * tables, and checks the expected continuation bytes of 3- and 4-byte
+ * sequences separately. The DFA above remains the reference implementation
+ * and handles the tail of the input.
+ */
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define CODESET_SSSE3
+#endif
+
+#ifdef CODESET_SSSE3
+#include <tmmintrin.h>
+#include "hostinfo.h"
+
+#define CODESET_SSSE3_ATTR __attribute__((target("ssse3")))
+
+/*
+ * Error classes of the lookup algorithm. Each table gives, for one nibble,
+ * the classes that nibble is compatible with; a pair of bytes is in error if
+ * all three lookups agree on some class.
+ */
+
+#define UTF8_TOO_SHORT   0x01  // Lead byte not followed by a continuation
+#define UTF8_TOO_LONG    0x02  // ASCII followed by a continuation
+#define UTF8_OVERLONG_3  0x04
+#define UTF8_TOO_LARGE   0x08  // Above U+10FFFF
+#define UTF8_SURROGATE   0x10
+#define UTF8_OVERLONG_2  0x20
+#define UTF8_TOO_LARGE_1000 0x40
+#define UTF8_OVERLONG_4  0x40
+#define UTF8_TWO_CONTS   0x80  // Continuation after a continuation
+#define UTF8_CARRY       (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+static const uint8 utf8Byte1High[16] = {
+   /* 0xxx: ASCII */
+   UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+   UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+   /* 10xx: continuation */
+   UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+   /* 1100, 1101: 2-byte lead */
+   UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+   UTF8_TOO_SHORT,
+   /* 1110: 3-byte lead */
+   UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+   /* 1111: 4-byte lead */
+   UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+};
+
+static const uint8 utf8Byte1Low[16] = {
+   UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+   UTF8_CARRY | UTF8_OVERLONG_2,
+   UTF8_CARRY,
+   UTF8_CARRY,
+   UTF8_CARRY | UTF8_TOO_LARGE,
+   UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+   UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+   UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+   UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+   UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+   UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+   UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+   UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+   UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+   UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+   UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+};
+
+static const uint8 utf8Byte2High[16] = {
+   /* 0xxx: ASCII */
+   UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+   UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+   /* 1000 */
+   UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 |
+      UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+   /* 1001 */
+   UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 |
+      UTF8_TOO_LARGE,
+   /* 101x */
+   UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE |
+      UTF8_TOO_LARGE,
+   UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE |
+      UTF8_TOO_LARGE,
+   /* 11xx: lead byte */
+   UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+};
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * CodeSetValidateUTF8SSSE3 --
+ *
+ *      Validates UTF-8 16 bytes at a time while at least 16 bytes remain.
+ *      A sequence that is cut off by the end of the last block is not
+ *      checked; *consumed is set to its first byte so that the caller can
+ *      resume there.
+ *
+ * Results:
+ *      FALSE if an invalid sequence was found, TRUE otherwise.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static CODESET_SSSE3_ATTR Bool
+CodeSetValidateUTF8SSSE3(const uint8 *buf,   // IN:
+                         size_t size,        // IN:
+                         size_t *consumed)   // OUT:
+{
+   const __m128i byte1High = _mm_loadu_si128((const __m128i *) utf8Byte1High);
+   const __m128i byte1Low = _mm_loadu_si128((const __m128i *) utf8Byte1Low);
+   const __m128i byte2High = _mm_loadu_si128((const __m128i *) utf8Byte2High);
+   const __m128i nibble = _mm_set1_epi8(0x0F);
+   const __m128i third = _mm_set1_epi8(0xE0 - 0x80);
+   const __m128i fourth = _mm_set1_epi8(0xF0 - 0x80);
+   const __m128i high = _mm_set1_epi8((char) 0x80);
+   __m128i prev = _mm_setzero_si128();
+   __m128i error = _mm_setzero_si128();
+   size_t i;
+   size_t n;
+
+   for (i = 0; size - i >= 16; i += 16) {
+      __m128i in = _mm_loadu_si128((const __m128i *)(buf + i));
+      __m128i prev1;
+      __m128i prev2;
+      __m128i prev3;
+      __m128i special;
+      __m128i must23;
+
+      /* An ASCII block following another one needs no checks. */
+      if (_mm_movemask_epi8(_mm_or_si128(in, prev)) == 0) {
+         prev = in;
+         continue;
+      }
+
+      prev1 = _mm_alignr_epi8(in, prev, 15);
+      prev2 = _mm_alignr_epi8(in, prev, 14);
+      prev3 = _mm_alignr_epi8(in, prev, 13);
+      special = _mm_and_si128(
+         _mm_and_si128(
+            _mm_shuffle_epi8(byte1High,
+                             _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+            _mm_shuffle_epi8(byte1Low, _mm_and_si128(prev1, nibble))),
+         _mm_shuffle_epi8(byte2High,
+                          _mm_and_si128(_mm_srli_epi16(in, 4), nibble)));
+
+      /*
+       * The bytes two after a 3- or 4-byte lead, and three after a 4-byte
+       * lead, must be continuations, which is flagged as UTF8_TWO_CONTS
+       * above; anywhere else UTF8_TWO_CONTS is an error.
+       */
+      must23 = _mm_or_si128(_mm_subs_epu8(prev2, third),
+                            _mm_subs_epu8(prev3, fourth));
+      error = _mm_or_si128(error,
+                           _mm_xor_si128(_mm_and_si128(must23, high),
+                                         special));
+      prev = in;
+   }
+
+   if (_mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) !=
+       0xFFFF) {
+      return FALSE;
+   }
+
+   /* Back up to the start of a sequence cut off at i, if any. */
+   *consumed = i;
+   for (n = 1; n <= 3 && n <= i; n++) {
+      uint8 c = buf[i - n];
+
+      if (c < 0x80) {
+         break;
+      }
+      if (c >= 0xC0) {
+         if ((c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : 2) > n) {
+            *consumed = i - n;
+         }
+         break;
+      }
+   }
+
+   return TRUE;
+}
+#endif // CODESET_SSSE3
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * CodeSetAsciiPrefix --
+ *
+ *      Finds the end of the run of ASCII characters at the start of buf.
+ *
+ * Results:
+ *      The number of leading bytes below 0x80.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static INLINE size_t
+CodeSetAsciiPrefix(const uint8 *buf,  // IN:
+                   size_t size)       // IN:
+{
+   size_t i = 0;
+
+#ifdef CODESET_SSSE3
+   while (size - i >= 16) {
+      int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(buf + i)));
+
+      if (mask != 0) {
+         return i + __builtin_ctz(mask);
+      }
+      i += 16;
+   }
+#endif
+
+   while (size - i >= 8) {
+      uint64 word;
+
+      memcpy(&word, buf + i, sizeof word);
+      if ((word & CONST64U(0x8080808080808080)) != 0) {
+         break;
+      }
+      i += 8;
+   }
+
+   while (i < size && buf[i] < 0x80) {
+      i++;
+   }
+
+   return i;
+}
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * CodeSetValidateUTF8 --
+ *
+ *      Checks whether buf holds a sequence of complete, well-formed UTF-8
+ *      characters. NUL bytes are allowed.
+ *
+ * Results:
+ *      TRUE if buf is valid UTF-8, FALSE otherwise.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static Bool
+CodeSetValidateUTF8(const uint8 *buf,  // IN:
+                    size_t size)       // IN:
+{
+   uint32 state = UTF8_ACCEPT;
+   size_t i = 0;
+
+#ifdef CODESET_SSSE3
+   if (size >= 16 && Hostinfo_HaveSSSE3() &&
+       !CodeSetValidateUTF8SSSE3(buf, size, &i)) {
+      return FALSE;
+   }
+#endif
+
+   while (i < size) {
+      if (state == UTF8_ACCEPT && buf[i] < 0x80) {
+         i += CodeSetAsciiPrefix(buf + i, size - i);
+         continue;
+      }
+      if (CodeSetDecode(&state, buf[i++]) == UTF8_REJECT) {
+         return FALSE;
+      }
+   }
+
+   return state == UTF8_ACCEPT;
+}
+
+
 /*
  *----------------------------------------------------------------------------
  *
@@ -81,13 +378,7 @@ CodeSetDecode(uint32 *state,  // IN:
 Bool
 CodeSet_IsStringValidUTF8(const char *bufIn)  // IN:
 {
-   uint32 state = UTF8_ACCEPT;
-
-   while (*bufIn != '\0') {
-      CodeSetDecode(&state, (unsigned char) *bufIn++);
-   }
-
-   return state == UTF8_ACCEPT;
+   return CodeSetValidateUTF8((const uint8 *) bufIn, strlen(bufIn));
 }
 
 
@@ -112,14 +403,7 @@ Bool
 CodeSet_IsValidUTF8(const char *bufIn,  // IN:
                     size_t sizeIn)      // IN:
 {
-   size_t i;
-   uint32 state = UTF8_ACCEPT;
-
-   for (i = 0; i < sizeIn; i++) {
-      CodeSetDecode(&state, (unsigned char) *bufIn++);
-   }
-
-   return state == UTF8_ACCEPT;
+   return CodeSetValidateUTF8((const uint8 *) bufIn, sizeIn);
 }
 
 
@@ -143,22 +427,569 @@ CodeSet_IsValidUTF8(const char *bufIn,  // IN:
 Bool
 CodeSet_IsValidUTF8String(const char *bufIn,  // IN:
                           size_t sizeIn)      // IN:
+{
+   if (memchr(bufIn, '\0', sizeIn) != NULL) {
+      return FALSE;
+   }
+
+   /* The data might end in the middle of a UTF-8 code point. */
+   return CodeSetValidateUTF8((const uint8 *) bufIn, sizeIn);
+}
+
+
+/*
+ * Encodings that CodeSetOld_FastGenericToGenericDb() converts without ICU or
+ * iconv, and the names it recognizes for them (including what nl_langinfo()
+ * reports for the C locale).
+ */
+
+typedef enum {
+   CODESET_FAST_NONE,
+   CODESET_FAST_UTF8,
+   CODESET_FAST_UTF16LE,
+   CODESET_FAST_UTF32LE,
+   CODESET_FAST_LATIN1,
+   CODESET_FAST_ASCII,
+} CodeSetFastEncoding;
+
+static const struct {
+   const char *name;
+   CodeSetFastEncoding encoding;
+} codeSetFastNames[] = {
+   { "UTF-8",          CODESET_FAST_UTF8 },
+   { "UTF8",           CODESET_FAST_UTF8 },
+   { "UTF-16LE",       CODESET_FAST_UTF16LE },
+   { "UTF16LE",        CODESET_FAST_UTF16LE },
+   { "UTF-32LE",       CODESET_FAST_UTF32LE },
+   { "UTF32LE",        CODESET_FAST_UTF32LE },
+   { "ISO-8859-1",     CODESET_FAST_LATIN1 },
+   { "ISO8859-1",      CODESET_FAST_LATIN1 },
+   { "ISO_8859-1",     CODESET_FAST_LATIN1 },
+   { "latin1",         CODESET_FAST_LATIN1 },
+   { "US-ASCII",       CODESET_FAST_ASCII },
+   { "ASCII",          CODESET_FAST_ASCII },
+   { "ANSI_X3.4-1968", CODESET_FAST_ASCII },
+};
+
+/* Size in bytes of a code unit, indexed by CodeSetFastEncoding. */
+static const uint8 codeSetFastUnit[] = { 0, 1, 2, 4, 1, 1 };
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * CodeSetFastLookup --
+ *
+ *      Maps an encoding name to one of the encodings converted here.
+ *
+ * Results:
+ *      The encoding, or CODESET_FAST_NONE.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static CodeSetFastEncoding
+CodeSetFastLookup(const char *name)  // IN:
 {
    size_t i;
-   uint32 state = UTF8_ACCEPT;
 
-   for (i = 0; i < sizeIn; i++) {
-      unsigned char c = (unsigned char) *bufIn++;
+   for (i = 0; i < ARRAYSIZE(codeSetFastNames); i++) {
+      if (Str_Strcasecmp(name, codeSetFastNames[i].name) == 0) {
+         return codeSetFastNames[i].encoding;
+      }
+   }
+
+   return CODESET_FAST_NONE;
+}
 
-      if (UNLIKELY(c == '\0')) {
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * CodeSetFastMaxOut --
+ *
+ *      Bounds the output of a conversion.
+ *
+ * Results:
+ *      The largest number of bytes one input code unit can turn into.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static size_t
+CodeSetFastMaxOut(CodeSetFastEncoding encIn,   // IN:
+                  CodeSetFastEncoding encOut)  // IN:
+{
+   switch (encOut) {
+   case CODESET_FAST_UTF8:
+      return encIn == CODESET_FAST_UTF32LE ? 4 :
+             encIn == CODESET_FAST_UTF16LE ? 3 :
+             encIn == CODESET_FAST_LATIN1 ? 2 : 1;
+   case CODESET_FAST_UTF16LE:
+      /* A 4-byte UTF-8 sequence becomes a surrogate pair. */
+      return encIn == CODESET_FAST_UTF32LE ? 4 : 2;
+   case CODESET_FAST_UTF32LE:
+      return 4;
+   default:
+      return 1;
+   }
+}
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * CodeSetFastDecode --
+ *
+ *      Decodes the character at p. UTF-8 must use the shortest form, and no
+ *      encoding may contain surrogate code points (paired surrogates in
+ *      UTF-16 excepted) or values above U+10FFFF. p must be at a code unit
+ *      boundary, with at least one code unit before end.
+ *
+ * Results:
+ *      The number of bytes consumed, 0 if the input is invalid.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static INLINE int
+CodeSetFastDecode(CodeSetFastEncoding enc,  // IN:
+                  const uint8 *p,           // IN:
+                  const uint8 *end,         // IN:
+                  uint32 *uchar)            // OUT:
+{
+   uint32 c = p[0];
+
+   switch (enc) {
+   case CODESET_FAST_UTF8:
+      if (c < 0x80) {
+         *uchar = c;
+         return 1;
+      }
+      if (c < 0xC2 || c > 0xF4) {
+         return 0;
+      }
+      if (c < 0xE0) {
+         if (end - p < 2 || (p[1] & 0xC0) != 0x80) {
+            return 0;
+         }
+         *uchar = ((c & 0x1F) << 6) | (p[1] & 0x3F);
+         return 2;
+      }
+      if (c < 0xF0) {
+         if (end - p < 3 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80) {
+            return 0;
+         }
+         c = ((c & 0x0F) << 12) | ((p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+         if (c < 0x800 || (c >= 0xD800 && c <= 0xDFFF)) {
+            return 0;
+         }
+         *uchar = c;
+         return 3;
+      }
+      if (end - p < 4 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80 ||
+          (p[3] & 0xC0) != 0x80) {
+         return 0;
+      }
+      c = ((c & 0x07) << 18) | ((p[1] & 0x3F) << 12) |
+          ((p[2] & 0x3F) << 6) | (p[3] & 0x3F);
+      if (c < 0x10000 || c > 0x10FFFF) {
+         return 0;
+      }
+      *uchar = c;
+      return 4;
+
+   case CODESET_FAST_UTF16LE:
+      c |= (uint32) p[1] << 8;
+      if (c < 0xD800 || c > 0xDFFF) {
+         *uchar = c;
+         return 2;
+      }
+      if (c > 0xDBFF || end - p < 4) {
+         return 0;
+      } else {
+         uint32 trail = p[2] | ((uint32) p[3] << 8);
+
+         if (trail < 0xDC00 || trail > 0xDFFF) {
+            return 0;
+         }
+         *uchar = 0x10000 + ((c - 0xD800) << 10) + (trail - 0xDC00);
+         return 4;
+      }
+
+   case CODESET_FAST_UTF32LE:
+      c |= ((uint32) p[1] << 8) | ((uint32) p[2] << 16) | ((uint32) p[3] << 24);
+      if (c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) {
+         return 0;
+      }
+      *uchar = c;
+      return 4;
+
+   case CODESET_FAST_LATIN1:
+      *uchar = c;
+      return 1;
+
+   case CODESET_FAST_ASCII:
+      if (c >= 0x80) {
+         return 0;
+      }
+      *uchar = c;
+      return 1;
+
+   default:
+      NOT_REACHED();
+   }
+}
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * CodeSetFastEncode --
+ *
+ *      Encodes a Unicode scalar value.
+ *
+ * Results:
+ *      The number of bytes written to p, 0 if the character cannot be
+ *      represented in the encoding.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static INLINE int
+CodeSetFastEncode(CodeSetFastEncoding enc,  // IN:
+                  uint32 c,                 // IN:
+                  uint8 *p)                 // OUT:
+{
+   switch (enc) {
+   case CODESET_FAST_UTF8:
+      if (c < 0x80) {
+         p[0] = c;
+         return 1;
+      }
+      if (c < 0x800) {
+         p[0] = 0xC0 | (c >> 6);
+         p[1] = 0x80 | (c & 0x3F);
+         return 2;
+      }
+      if (c < 0x10000) {
+         p[0] = 0xE0 | (c >> 12);
+         p[1] = 0x80 | ((c >> 6) & 0x3F);
+         p[2] = 0x80 | (c & 0x3F);
+         return 3;
+      }
+      p[0] = 0xF0 | (c >> 18);
+      p[1] = 0x80 | ((c >> 12) & 0x3F);
+      p[2] = 0x80 | ((c >> 6) & 0x3F);
+      p[3] = 0x80 | (c & 0x3F);
+      return 4;
+
+   case CODESET_FAST_UTF16LE:
+      if (c < 0x10000) {
+         p[0] = c;
+         p[1] = c >> 8;
+         return 2;
+      } else {
+         uint32 lead = 0xD800 + ((c - 0x10000) >> 10);
+         uint32 trail = 0xDC00 + ((c - 0x10000) & 0x3FF);
+
+         p[0] = lead;
+         p[1] = lead >> 8;
+         p[2] = trail;
+         p[3] = trail >> 8;
+         return 4;
+      }
+
+   case CODESET_FAST_UTF32LE:
+      p[0] = c;
+      p[1] = c >> 8;
+      p[2] = c >> 16;
+      p[3] = 0;
+      return 4;
+
+   case CODESET_FAST_LATIN1:
+      if (c > 0xFF) {
+         return 0;
+      }
+      p[0] = c;
+      return 1;
+
+   case CODESET_FAST_ASCII:
+      if (c >= 0x80) {
+         return 0;
+      }
+      p[0] = c;
+      return 1;
+
+   default:
+      NOT_REACHED();
+   }
+}
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * CodeSetFastWidenAscii --
+ *
+ *      Copies ASCII characters to an encoding with unitOut-byte code units.
+ *
+ * Results:
+ *      The end of the output.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static INLINE uint8 *
+CodeSetFastWidenAscii(const uint8 *in,  // IN:
+                      size_t n,         // IN:
+                      size_t unitOut,   // IN:
+                      uint8 *out)       // OUT:
+{
+   size_t i = 0;
+
+   if (unitOut == 1) {
+      memcpy(out, in, n);
+      return out + n;
+   }
+
+   if (unitOut == 2) {
+#ifdef CODESET_SSSE3
+      const __m128i zero = _mm_setzero_si128();
+
+      for (; n - i >= 16; i += 16) {
+         __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+
+         _mm_storeu_si128((__m128i *)(out + 2 * i),
+                          _mm_unpacklo_epi8(v, zero));
+         _mm_storeu_si128((__m128i *)(out + 2 * i + 16),
+                          _mm_unpackhi_epi8(v, zero));
+      }
+#endif
+      for (; i < n; i++) {
+         out[2 * i] = in[i];
+         out[2 * i + 1] = 0;
+      }
+      return out + 2 * n;
+   }
+
+   for (; i < n; i++) {
+      out[4 * i] = in[i];
+      out[4 * i + 1] = 0;
+      out[4 * i + 2] = 0;
+      out[4 * i + 3] = 0;
+   }
+   return out + 4 * n;
+}
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * CodeSetFastNarrowAscii16 --
+ *
+ *      Copies the run of ASCII characters at the start of UTF-16LE input to
+ *      a single byte encoding.
+ *
+ * Results:
+ *      The number of characters copied.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static INLINE size_t
+CodeSetFastNarrowAscii16(const uint8 *in,  // IN:
+                         size_t units,     // IN:
+                         uint8 *out)       // OUT:
+{
+   size_t i = 0;
+
+#ifdef CODESET_SSSE3
+   const __m128i nonAscii = _mm_set1_epi16((short) 0xFF80);
+   const __m128i zero = _mm_setzero_si128();
+
+   for (; units - i >= 8; i += 8) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(in + 2 * i));
+
+      if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, nonAscii),
+                                            zero)) != 0xFFFF) {
+         break;
+      }
+      _mm_storel_epi64((__m128i *)(out + i), _mm_packus_epi16(v, v));
+   }
+#endif
+
+   for (; i < units && in[2 * i] < 0x80 && in[2 * i + 1] == 0; i++) {
+      out[i] = in[2 * i];
+   }
+
+   return i;
+}
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * CodeSetFastTranscode --
+ *
+ *      Converts between two of the encodings handled here, appending the
+ *      result to db. The whole input must be valid and representable in
+ *      the output encoding.
+ *
+ * Results:
+ *      TRUE on success, FALSE on invalid input or if memory runs out.
+ *
+ * Side effects:
+ *      On failure, db may have grown, but its size is unchanged.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static Bool
+CodeSetFastTranscode(CodeSetFastEncoding encIn,   // IN:
+                     const uint8 *in,             // IN:
+                     size_t sizeIn,               // IN:
+                     CodeSetFastEncoding encOut,  // IN:
+                     DynBuf *db)                  // IN/OUT:
+{
+   size_t unitIn = codeSetFastUnit[encIn];
+   size_t unitOut = codeSetFastUnit[encOut];
+   size_t maxOut = CodeSetFastMaxOut(encIn, encOut);
+   size_t size = DynBuf_GetSize(db);
+   const uint8 *end = in + sizeIn;
+   size_t needed;
+   uint8 *start;
+   uint8 *out;
+
+   if (sizeIn % unitIn != 0) {
+      return FALSE;
+   }
+   if (sizeIn == 0) {
+      return TRUE;
+   }
+
+   if (encIn == CODESET_FAST_UTF8 && encOut == CODESET_FAST_UTF8) {
+      return CodeSetValidateUTF8(in, sizeIn) && DynBuf_Append(db, in, sizeIn);
+   }
+
+   if (sizeIn / unitIn > (SIZE_MAX - size) / maxOut) {
+      return FALSE;
+   }
+   needed = size + sizeIn / unitIn * maxOut;
+   if (DynBuf_GetAllocatedSize(db) < needed && !DynBuf_Enlarge(db, needed)) {
+      return FALSE;
+   }
+
+   start = (uint8 *) DynBuf_Get(db) + size;
+   out = start;
+
+   while (in < end) {
+      uint32 c;
+      int n;
+
+      if (unitIn == 1 && *in < 0x80) {
+         size_t run = CodeSetAsciiPrefix(in, end - in);
+
+         out = CodeSetFastWidenAscii(in, run, unitOut, out);
+         in += run;
+         continue;
+      }
+
+      if (encIn == CODESET_FAST_UTF16LE && unitOut == 1 &&
+          in[0] < 0x80 && in[1] == 0) {
+         size_t run = CodeSetFastNarrowAscii16(in, (end - in) / 2, out);
+
+         in += 2 * run;
+         out += run;
+         continue;
+      }
+
+      n = CodeSetFastDecode(encIn, in, end, &c);
+      if (n == 0) {
          return FALSE;
       }
+      in += n;
 
-      CodeSetDecode(&state, c);
+      n = CodeSetFastEncode(encOut, c, out);
+      if (n == 0) {
+         return FALSE;
+      }
+      out += n;
    }
 
-   /* If everything went well we should have proper UTF8, the data
-    * might instead have ended in the middle of a UTF8 codepoint.
-    */
-   return state == UTF8_ACCEPT;
+   ASSERT(out - start <= needed - size);
+   DynBuf_SetSize(db, size + (out - start));
+
+   return TRUE;
+}
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * CodeSetOld_FastGenericToGenericDb --
+ *
+ *      Converts between UTF-8, UTF-16LE, UTF-32LE, ISO-8859-1 and US-ASCII
+ *      without going through ICU or iconv. Only strict conversions
+ *      (CSGTG_NORMAL) are handled: the input must be valid and every
+ *      character must be representable in the output encoding, as with
+ *      CodeSet_GenericToGenericDb().
+ *
+ * Results:
+ *      FALSE if the conversion isn't one handled here; the caller should
+ *      fall back to ICU or iconv. Otherwise TRUE, with the result of the
+ *      conversion in *ok and the output appended to db.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+Bool
+CodeSetOld_FastGenericToGenericDb(const char *codeIn,  // IN:
+                                  const char *bufIn,   // IN:
+                                  size_t sizeIn,       // IN:
+                                  const char *codeOut, // IN:
+                                  unsigned int flags,  // IN:
+                                  DynBuf *db,          // IN/OUT:
+                                  Bool *ok)            // OUT:
+{
+   CodeSetFastEncoding encIn;
+   CodeSetFastEncoding encOut;
+
+   if (flags != CSGTG_NORMAL) {
+      return FALSE;
+   }
+
+   encIn = CodeSetFastLookup(codeIn);
+   if (encIn == CODESET_FAST_NONE) {
+      return FALSE;
+   }
+   encOut = CodeSetFastLookup(codeOut);
+   if (encOut == CODESET_FAST_NONE) {
+      return FALSE;
+   }
+
+   *ok = CodeSetFastTranscode(encIn, (const uint8 *) bufIn, sizeIn, encOut,
+                              db);
+   return TRUE;
 }
@@ -37,9 +37,7 @@
 #include "util.h"
 #include "str.h"
 #include "vm_atomic.h"
-
-
-#define HASH_ROTATE     5
+#include "hashFunc.h"
 
 
 /*
@@ -71,6 +69,7 @@ typedef struct HashTableEntry {
    HashTableLink     next;
    const void       *keyStr;
    Atomic_Ptr        clientData;
+   uint32            hash;        // Unfolded key hash; checked before keys
 } HashTableEntry;
 
 /*
@@ -104,10 +103,11 @@ HashTableEntry *HashTableLookupOrInsert(HashTable *ht,
  *
  * HashTableComputeHash --
  *
- *      Compute hash value based on key type and hash size.
+ *      Compute the hash value of a key, based on key type. String keys are
+ *      hashed a word at a time; see hashFunc.h.
  *
  * Results:
- *      The hash value.
+ *      The hash value, not yet reduced to a bucket index.
  *
  * Side effects:
  *      None.
@@ -119,27 +119,32 @@ static uint32
 HashTableComputeHash(const HashTable *ht,  // IN: hash table
                      const void *s)        // IN: string to hash
 {
-   uint32 h = 0;
+   uint32 h;
 
    switch (ht->keyType) {
-   case HASH_STRING_KEY: {
-         int c;
-         unsigned char *keyPtr = (unsigned char *) s;
-
-         while ((c = *keyPtr++)) {
-            h ^= c;
-            h = h << HASH_ROTATE | h >> (32 - HASH_ROTATE);
-         }
-      }
+   case HASH_STRING_KEY:
+      h = HashFunc_Bytes32(s, strlen(s));
       break;
    case HASH_ISTRING_KEY: {
-         int c;
-         unsigned char *keyPtr = (unsigned char *) s;
-
-         while ((c = tolower(*keyPtr++))) {
-            h ^= c;
-            h = h << HASH_ROTATE | h >> (32 - HASH_ROTATE);
-         }
+         /*
+          * Hash the lower-cased key in chunks. Chaining the chunk hashes
+          * through the seed gives the same result for keys that only
+          * differ in case.
+          */
+         const unsigned char *keyPtr = (const unsigned char *) s;
+         unsigned char chunk[64];
+         uint64 h64 = 0;
+         size_t n;
+
+         do {
+            for (n = 0; n < sizeof chunk && keyPtr[n] != '\0'; n++) {
+               chunk[n] = tolower(keyPtr[n]);
+            }
+            h64 = HashFunc_BytesSeeded(chunk, n, h64);
+            keyPtr += n;
+         } while (n == sizeof chunk);
+
+         h = (uint32) (h64 ^ (h64 >> 32));
       }
       break;
    case HASH_INT_KEY:
@@ -162,12 +167,34 @@ HashTableComputeHash(const HashTable *ht,  // IN: hash table
       NOT_REACHED();
    }
 
-   {
-      int numBits = ht->numBits;
-      uint32 mask = MASK(numBits);
+   return h;
+}
 
-      for (; h > mask; h = (h & mask) ^ (h >> numBits)) {
-      }
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * HashTableBucket --
+ *
+ *      Reduce a hash value to a bucket index.
+ *
+ * Results:
+ *      The bucket index.
+ *
+ * Side effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static INLINE uint32
+HashTableBucket(const HashTable *ht,  // IN: hash table
+                uint32 h)             // IN: hash value
+{
+   int numBits = ht->numBits;
+   uint32 mask = MASK(numBits);
+
+   for (; h > mask; h = (h & mask) ^ (h >> numBits)) {
    }
 
    ASSERT(h < ht->numEntries);
@@ -437,10 +464,11 @@ HashTableLookup(const HashTable *ht,  // IN:
 {
    HashTableEntry *entry;
 
-   for (entry = ENTRY(ht->buckets[hash]);
+   for (entry = ENTRY(ht->buckets[HashTableBucket(ht, hash)]);
         entry != NULL;
         entry = ENTRY(entry->next)) {
-      if (HashTableEqualKeys(ht, entry->keyStr, keyStr)) {
+      if (entry->hash == hash &&
+          HashTableEqualKeys(ht, entry->keyStr, keyStr)) {
          return entry;
       }
    }
@@ -543,10 +571,11 @@ HashTable_LookupAndDelete(HashTable *ht,       // IN/OUT: the hash table
 
    ASSERT(!ht->atomic);
 
-   for (linkp = &ht->buckets[hash];
+   for (linkp = &ht->buckets[HashTableBucket(ht, hash)];
         (entry = ENTRY(*linkp)) != NULL;
         linkp = &entry->next) {
-      if (HashTableEqualKeys(ht, entry->keyStr, keyStr)) {
+      if (entry->hash == hash &&
+          HashTableEqualKeys(ht, entry->keyStr, keyStr)) {
          SETENTRY(*linkp, ENTRY(entry->next));
          ht->numElements--;
          if (ht->copyKey) {
@@ -758,12 +787,13 @@ HashTableLookupOrInsert(HashTable *ht,       // IN/OUT:
                         void *clientData)    // IN/OPT:
 {
    uint32 hash = HashTableComputeHash(ht, keyStr);
+   uint32 bucket = HashTableBucket(ht, hash);
    HashTableEntry *entry = NULL;
    HashTableEntry *oldEntry = NULL;
    HashTableEntry *head;
 
 again:
-   head = ENTRY(ht->buckets[hash]);
+   head = ENTRY(ht->buckets[bucket]);
 
    oldEntry = HashTableLookup(ht, keyStr, hash);
    if (oldEntry != NULL) {
@@ -785,14 +815,15 @@ again:
          entry->keyStr = keyStr;
       }
       Atomic_WritePtr(&entry->clientData, clientData);
+      entry->hash = hash;
    }
    SETENTRY(entry->next, head);
    if (ht->atomic) {
-      if (!SETENTRYATOMIC(ht->buckets[hash], head, entry)) {
+      if (!SETENTRYATOMIC(ht->buckets[bucket], head, entry)) {
          goto again;
       }
    } else {
-      SETENTRY(ht->buckets[hash], entry);
+      SETENTRY(ht->buckets[bucket], entry);
    }
 
    ht->numElements++;
@@ -226,6 +226,44 @@ Hostinfo_GetCpuid(HostinfoCpuIdInfo *info) // OUT
 }
 
 
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * Hostinfo_HaveSSSE3 --
+ *
+ *       Check whether the CPU supports SSSE3. The result is computed once;
+ *       racing initializers compute the same value, so this is cheap
+ *       enough to call on every pass through a vectorized routine.
+ *
+ * Results:
+ *       TRUE if the CPU supports SSSE3, FALSE otherwise.
+ *
+ * Side effect:
+ *       None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+Bool
+Hostinfo_HaveSSSE3(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+   static volatile int haveSSSE3 = -1;
+
+   if (UNLIKELY(haveSSSE3 < 0)) {
+      CPUIDRegs regs;
+
+      __GET_CPUID(1, &regs);
+      haveSSSE3 = CPUID_ISSET(1, ECX, SSSE3, regs.ecx);
+   }
+
+   return haveSSSE3;
+#else // defined(__i386__) || defined(__x86_64__)
+   return FALSE;
+#endif // defined(__i386__) || defined(__x86_64__)
+}
+
+
 /*
  *-----------------------------------------------------------------------------
  *
@@ -0,0 +1,1278 @@
+/*********************************************************
+ * Copyright (c) 2025 Broadcom. All Rights Reserved.
+ * The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation version 2.1 and no later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the Lesser GNU General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA.
+ *
+ *********************************************************/
+
+/*
+ * pollEpoll.c -- a Linux poll implementation built on epoll and timerfd,
+ * driven by the GLib main loop through a single GSource.
+ *
+ * pollGtk creates a GIOChannel and a GSource for every device callback and
+ * every timer, and destroys them again when the callback fires or is
+ * removed. AsyncSocket removes and re-adds its receive callback after every
+ * read, so that is a lot of churn. Here, a file descriptor is added to the
+ * epoll set once and its device entry is kept when its callbacks go; adding
+ * or removing one of its callbacks costs at most one epoll_ctl(), and a
+ * non-periodic callback that fires costs none, since it is registered with
+ * EPOLLONESHOT. Timers are kept in a heap whose earliest deadline is
+ * programmed into a timerfd that is also in the epoll set. GLib only ever
+ * polls the epoll descriptor.
+ *
+ * As with pollGtk, any thread may add or remove callbacks; they all fire on
+ * the thread running the default main context.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+#include <glib.h>
+
+#include "pollImpl.h"
+#include "mutexRankLib.h"
+#include "err.h"
+
+#define LOGLEVEL_MODULE poll
+#include "loglevel_user.h"
+
+
+/* Maximum number of epoll events handled per dispatch. */
+#define POLL_EPOLL_MAX_EVENTS 64
+
+
+/*
+ * A registered callback. 'flags' is zero when the slot is unused.
+ */
+typedef struct PollEpollCb {
+   int            flags;
+   PollerFunction cb;
+   void          *clientData;
+   PollClassSet   classSet;
+   MXUserRecLock *cbLock;
+} PollEpollCb;
+
+/*
+ * A file descriptor with its read and write callbacks.
+ */
+typedef struct PollEpollDevice {
+   int         fd;
+   PollEpollCb read;
+   PollEpollCb write;
+   uint32      events;       /* What the fd is registered for in epoll;
+                                just EPOLLONESHOT once it is disarmed */
+   Bool        inEpoll;
+   Bool        alwaysReady;  /* epoll does not take this fd (regular file) */
+} PollEpollDevice;
+
+/*
+ * A POLL_REALTIME or POLL_MAIN_LOOP callback.
+ */
+typedef struct PollEpollTimer {
+   PollEpollCb   cb;
+   PollEventType type;
+   gint64        delay;      /* Microseconds */
+   gint64        deadline;   /* Monotonic time, microseconds */
+   guint         heapIndex;
+} PollEpollTimer;
+
+typedef struct PollEpollSource {
+   GSource source;
+   GPollFD pollFd;
+} PollEpollSource;
+
+/*
+ * The global Poll state.
+ */
+typedef struct Poll {
+   MXUserExclLock *lock;
+
+   int             epollFd;
+   int             timerFd;
+   gint64          timerArmed;      /* Deadline set in timerFd, 0 if none */
+
+   GHashTable     *deviceTable;     /* fd -> PollEpollDevice */
+   guint           numAlwaysReady;
+   GPtrArray      *timers;          /* Binary min-heap on deadline */
+
+   GSource        *source;
+} Poll;
+
+static Poll *pollState;
+static gsize inited = 0;
+
+#define ASSERT_POLL_LOCKED()                                    \
+   ASSERT(!pollState || !pollState->lock ||                     \
+          MXUser_IsCurThreadHoldingExclLock(pollState->lock))
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * PollEpollLock --
+ * PollEpollUnlock --
+ *
+ *      Locking of the internal poll state.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static INLINE void
+PollEpollLock(void)
+{
+   MXUser_AcquireExclLock(pollState->lock);
+}
+
+
+static INLINE void
+PollEpollUnlock(void)
+{
+   MXUser_ReleaseExclLock(pollState->lock);
+}
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * PollEpollCbMatches --
+ *
+ *      Test whether a registered callback is the one being removed.
+ *
+ * Results:
+ *      TRUE if it matches.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static INLINE Bool
+PollEpollCbMatches(const PollEpollCb *cb,         // IN
+                   PollClassSet classSet,         // IN
+                   int flags,                     // IN
+                   PollerFunction f,              // IN
+                   void *clientData,              // IN
+                   Bool matchAnyClientData)       // IN
+{
+   return cb->flags == flags && cb->cb == f &&
+          PollClassSet_Equals(cb->classSet, classSet) &&
+          (matchAnyClientData || cb->clientData == clientData);
+}
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * PollEpollHeapSet --
+ * PollEpollHeapSiftUp --
+ * PollEpollHeapSiftDown --
+ *
+ *      Binary min-heap of timers, ordered by deadline. Each timer knows its
+ *      index so that it can be removed or rescheduled in O(log n).
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Reorders pollState->timers.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+#define PollEpollHeapAt(i) \
+   ((PollEpollTimer *)g_ptr_array_index(pollState->timers, (i)))
+
+static INLINE void
+PollEpollHeapSet(guint i,              // IN
+                 PollEpollTimer *t)    // IN
+{
+   pollState->timers->pdata[i] = t;
+   t->heapIndex = i;
+}
+
+
+static void
+PollEpollHeapSiftUp(guint i)  // IN
+{
+   PollEpollTimer *t = PollEpollHeapAt(i);
+
+   while (i > 0) {
+      guint parent = (i - 1) / 2;
+      PollEpollTimer *p = PollEpollHeapAt(parent);
+
+      if (p->deadline <= t->deadline) {
+         break;
+      }
+      PollEpollHeapSet(i, p);
+      i = parent;
+   }
+   PollEpollHeapSet(i, t);
+}
+
+
+static void
+PollEpollHeapSiftDown(guint i)  // IN
+{
+   guint len = pollState->timers->len;
+   PollEpollTimer *t = PollEpollHeapAt(i);
+
+   for (;;) {
+      guint child = 2 * i + 1;
+
+      if (child >= len) {
+         break;
+      }
+      if (child + 1 < len &&
+          PollEpollHeapAt(child + 1)->deadline < PollEpollHeapAt(child)->deadline) {
+         child++;
+      }
+      if (t->deadline <= PollEpollHeapAt(child)->deadline) {
+         break;
+      }
+      PollEpollHeapSet(i, PollEpollHeapAt(child));
+      i = child;
+   }
+   PollEpollHeapSet(i, t);
+}
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * PollEpollTimerInsert --
+ * PollEpollTimerRemove --
+ * PollEpollTimerReschedule --
+ *
+ *      Add a timer to, remove it from, or move it within the heap after its
+ *      deadline changed.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      The timerfd is not updated; see PollEpollArmTimer.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static void
+PollEpollTimerInsert(PollEpollTimer *t)  // IN
+{
+   ASSERT_POLL_LOCKED();
+
+   g_ptr_array_add(pollState->timers, t);
+   PollEpollHeapSiftUp(pollState->timers->len - 1);
+}
+
+
+static void
+PollEpollTimerRemove(PollEpollTimer *t)  // IN
+{
+   GPtrArray *heap = pollState->timers;
+   PollEpollTimer *last;
+   guint i = t->heapIndex;
+
+   ASSERT_POLL_LOCKED();
+   ASSERT(PollEpollHeapAt(i) == t);
+
+   last = g_ptr_array_remove_index(heap, heap->len - 1);
+   if (last != t) {
+      PollEpollHeapSet(i, last);
+      PollEpollHeapSiftUp(i);
+      PollEpollHeapSiftDown(last->heapIndex);
+   }
+}
+
+
+static void
+PollEpollTimerReschedule(PollEpollTimer *t,   // IN
+                         gint64 deadline)     // IN
+{
+   ASSERT_POLL_LOCKED();
+
+   t->deadline = deadline;
+   PollEpollHeapSiftUp(t->heapIndex);
+   PollEpollHeapSiftDown(t->heapIndex);
+}
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * PollEpollArmTimer --
+ *
+ *      Program the timerfd with the earliest timer deadline, or disarm it
+ *      if there are no timers.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static void
+PollEpollArmTimer(void)
+{
+   Poll *poll = pollState;
+   struct itimerspec its;
+   gint64 deadline = 0;
+
+   ASSERT_POLL_LOCKED();
+
+   if (poll->timers->len > 0) {
+      /* A deadline of 0 would disarm the timer; it is in the past anyway. */
+      deadline = MAX(PollEpollHeapAt(0)->deadline, 1);
+   }
+   if (deadline == poll->timerArmed) {
+      return;
+   }
+
+   memset(&its, 0, sizeof its);
+   its.it_value.tv_sec = deadline / G_USEC_PER_SEC;
+   its.it_value.tv_nsec = (deadline % G_USEC_PER_SEC) * 1000;
+
+   /*
+    * g_get_monotonic_time() is CLOCK_MONOTONIC on Linux, so deadlines can
+    * be used as absolute times. A deadline in the past fires immediately.
+    */
+   if (timerfd_settime(poll->timerFd, TFD_TIMER_ABSTIME, &its, NULL) == -1) {
+      LOG(0, "POLL: timerfd_settime failed: %s\n", Err_ErrString());
+      poll->timerArmed = 0;
+   } else {
+      poll->timerArmed = deadline;
+   }
+}
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * PollEpollDeviceCtl --
+ *
+ *      Make the epoll registration of a device match its callbacks.
+ *
+ *      A device that still has a callback may stay registered for more
+ *      events than it wants; they are dropped by the dispatcher once one
+ *      arrives that nobody wants ('prune' TRUE).
+ *
+ *      Unless one of its callbacks is periodic, a device is registered with
+ *      EPOLLONESHOT, so the kernel disarms it when it reports an event and
+ *      a registration left behind by a file descriptor that was closed in
+ *      the callback stays quiet. A device without callbacks is kept, and
+ *      its registration disarmed (interest 0, EPOLLONESHOT) rather than
+ *      deleted, so that adding a callback again is a single EPOLL_CTL_MOD.
+ *      Callers must remove their callbacks before they close the file
+ *      descriptor: once it is closed, epoll_ctl() no longer reaches the
+ *      registration, which lives on as long as the underlying file is open
+ *      elsewhere (a dup, a forked child).
+ *
+ * Results:
+ *      FALSE if epoll refused the file descriptor.
+ *
+ * Side effects:
+ *      May free 'dev' if it has no callbacks and cannot be polled.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static Bool
+PollEpollDeviceCtl(PollEpollDevice *dev,   // IN
+                   Bool refresh,           // IN: the registration may be stale
+                   Bool prune)             // IN: drop unwanted events
+{
+   Poll *poll = pollState;
+   struct epoll_event ev;
+   uint32 wanted = 0;
+   int op;
+   int ret;
+
+   ASSERT_POLL_LOCKED();
+
+   if (dev->alwaysReady) {
+      if (dev->read.flags == 0 && dev->write.flags == 0) {
+         /* Not in epoll, and it would keep the poll source ready. */
+         poll->numAlwaysReady--;
+         g_hash_table_remove(poll->deviceTable, GINT_TO_POINTER(dev->fd));
+      }
+      return TRUE;
+   }
+
+   if (dev->read.flags & POLL_FLAG_READ) {
+      wanted |= EPOLLIN | EPOLLPRI;
+   }
+   if (dev->write.flags & POLL_FLAG_WRITE) {
+      wanted |= EPOLLOUT;
+   }
+   if (((dev->read.flags | dev->write.flags) & POLL_FLAG_PERIODIC) == 0) {
+      wanted |= EPOLLONESHOT;
+   }
+
+   if (dev->inEpoll && !refresh) {
+      if (wanted == dev->events) {
+         return TRUE;
+      }
+      if (!prune && ((wanted ^ dev->events) & EPOLLONESHOT) == 0 &&
+          (wanted & ~dev->events) == 0) {
+         return TRUE;
+      }
+   }
+
+   if (!dev->inEpoll && wanted == EPOLLONESHOT) {
+      /* Nothing to disarm. */
+      return TRUE;
+   }
+
+   memset(&ev, 0, sizeof ev);
+   ev.events = wanted;
+   ev.data.fd = dev->fd;
+
+   op = dev->inEpoll ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+   ret = epoll_ctl(poll->epollFd, op, dev->fd, &ev);
+   if (ret == -1 && op == EPOLL_CTL_MOD && errno == ENOENT &&
+       wanted != EPOLLONESHOT) {
+      /* The fd was closed, and maybe reused, since it was registered. */
+      op = EPOLL_CTL_ADD;
+      ret = epoll_ctl(poll->epollFd, op, dev->fd, &ev);
+   } else if (ret == -1 && op == EPOLL_CTL_ADD && errno == EEXIST) {
+      op = EPOLL_CTL_MOD;
+      ret = epoll_ctl(poll->epollFd, op, dev->fd, &ev);
+   }
+
+   if (ret == -1) {
+      if (wanted == EPOLLONESHOT) {
+         /* Disarming a device whose fd has been closed. */
+         LOG(2, "POLL: fd %d is gone from epoll: %s\n", dev->fd,
+             Err_ErrString());
+         dev->inEpoll = FALSE;
+         dev->events = 0;
+         return TRUE;
+      }
+      if (errno == EPERM) {
+         /*
+          * Regular files and directories cannot be polled; poll() reports
+          * them as always ready, so do the same.
+          */
+         LOG(2, "POLL: fd %d is not pollable, treating it as ready\n",
+             dev->fd);
+         dev->inEpoll = FALSE;
+         dev->alwaysReady = TRUE;
+         poll->numAlwaysReady++;
+         return TRUE;
+      }
+      LOG(0, "POLL: epoll_ctl(%d) on fd %d failed: %s\n", op, dev->fd,
+          Err_ErrString());
+      dev->inEpoll = FALSE;
+      dev->events = 0;
+      return FALSE;
+   }
+
+   dev->inEpoll = TRUE;
+   dev->events = wanted;
+   return TRUE;
+}
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * PollEpollFireDevice --
+ *
+ *      Fire the read and then the write callback of a device, as far as
+ *      'revents' says they are ready. Non-periodic callbacks are removed
+ *      before they fire, so that they can register themselves again.
+ *
+ *      A callback whose lock cannot be taken does not fire; the event is
+ *      level-triggered and will be reported again once the dispatcher has
+ *      re-armed the device.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Depends on the callbacks.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static void
+PollEpollFireDevice(int fd,           // IN
+                    uint32 revents)   // IN
+{
+   Poll *poll = pollState;
+   int pass;
+
+   for (pass = 0; pass < 2; pass++) {
+      PollEpollDevice *dev;
+      PollEpollCb *slot;
+      PollEpollCb cb;
+      uint32 mask;
+
+      PollEpollLock();
+
+      dev = g_hash_table_lookup(poll->deviceTable, GINT_TO_POINTER(fd));
+      if (dev == NULL) {
+         PollEpollUnlock();
+         return;
+      }
+
+      if (pass == 0) {
+         if (dev->inEpoll && (dev->events & EPOLLONESHOT) != 0 &&
+             !dev->alwaysReady) {
+            /* The kernel disarmed the registration when it reported it. */
+            dev->events = EPOLLONESHOT;
+         }
+         slot = &dev->read;
+         mask = EPOLLIN | EPOLLPRI | EPOLLERR | EPOLLHUP;
+      } else {
+         slot = &dev->write;
+         mask = EPOLLOUT | EPOLLERR | EPOLLHUP;
+      }
+
+      if (slot->flags == 0 || (revents & mask) == 0) {
+         PollEpollUnlock();
+         continue;
+      }
+
+      cb = *slot;
+      if (cb.cbLock != NULL && !MXUser_TryAcquireRecLock(cb.cbLock)) {
+         LOG(3, "POLL: fd %d %s callback did not fire\n", fd,
+             pass == 0 ? "read" : "write");
+         PollEpollUnlock();
+         continue;
+      }
+
+      if ((cb.flags & POLL_FLAG_PERIODIC) == 0) {
+         /*
+          * The device is registered with EPOLLONESHOT, so nothing is left
+          * armed in epoll if the callback closes the fd.
+          */
+         memset(slot, 0, sizeof *slot);
+      }
+
+      PollEpollUnlock();
+
+      LOG(4, "POLL: firing fd %d %s callback %p\n", fd,
+          pass == 0 ? "read" : "write", cb.cb);
+      cb.cb(cb.clientData);
+
+      if (cb.cbLock != NULL) {
+         MXUser_ReleaseRecLock(cb.cbLock);
+      }
+   }
+}
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * PollEpollFireTimers --
+ *
+ *      Fire the timers that were due at 'now'. Non-periodic timers are
+ *      removed before they fire; periodic ones are rescheduled.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Depends on the callbacks.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static void
+PollEpollFireTimers(gint64 now)  // IN
+{
+   Poll *poll = pollState;
+
+   for (;;) {
+      PollEpollTimer *t;
+      PollEpollCb cb;
+
+      PollEpollLock();
+
+      if (poll->timers->len == 0 || PollEpollHeapAt(0)->deadline > now) {
+         PollEpollUnlock();
+         break;
+      }
+
+      t = PollEpollHeapAt(0);
+      cb = t->cb;
+
+      if (cb.cbLock != NULL && !MXUser_TryAcquireRecLock(cb.cbLock)) {
+         /* Retry on the next pass through the main loop. */
+         LOG(3, "POLL: timer %p did not fire\n", t);
+         PollEpollTimerReschedule(t, now + 1);
+         PollEpollUnlock();
+         continue;
+      }
+
+      if (cb.flags & POLL_FLAG_PERIODIC) {
+         /* Not before the next pass, even with no delay. */
+         PollEpollTimerReschedule(t, now + MAX(t->delay, 1));
+      } else {
+         PollEpollTimerRemove(t);
+         g_free(t);
+      }
+
+      PollEpollUnlock();
+
+      LOG(4, "POLL: firing timer callback %p\n", cb.cb);
+      cb.cb(cb.clientData);
+
+      if (cb.cbLock != NULL) {
+         MXUser_ReleaseRecLock(cb.cbLock);
+      }
+   }
+}
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * PollEpollDispatch --
+ *
+ *      Fire everything that is ready: devices reported by epoll, devices
+ *      that cannot be polled, and due timers. Then bring the epoll
+ *      registrations of the devices that fired and the timerfd up to date.
+ *
+ * Results:
+ *      None.
+ *
+ * Side effects:
+ *      Depends on the callbacks.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static void
+PollEpollDispatch(void)
+{
+   Poll *poll = pollState;
+   struct epoll_event events[POLL_EPOLL_MAX_EVENTS];
+   GArray *ready = g_array_new(FALSE, FALSE, sizeof(int));
+   int numEvents;
+   int i;
+
+   numEvents = epoll_wait(poll->epollFd, events, ARRAYSIZE(events), 0);
+   if (numEvents == -1) {
+      if (errno != EINTR) {
+         LOG(0, "POLL: epoll_wait failed: %s\n", Err_ErrString());
+      }
+      numEvents = 0;
+   }
+
+   for (i = 0; i < numEvents; i++) {
+      int fd = events[i].data.fd;
+
+      if (fd == poll->timerFd) {
+         uint64 expirations;
+
+         /* Non-blocking; only there to clear the readable state. */
+         if (read(poll->timerFd, &expirations, sizeof expirations) == -1 &&
+             errno != EAGAIN) {
+            LOG(0, "POLL: timerfd read failed: %s\n", Err_ErrString());
+         }
+         continue;
+      }
+
+      g_array_append_val(ready, fd);
+      PollEpollFireDevice(fd, events[i].events);
+   }
+
+   /*
+    * Devices that cannot be polled are always ready. The list is copied
+    * since the callbacks may change the table.
+    */
+   PollEpollLock();
+   if (poll->numAlwaysReady > 0) {
+      GHashTableIter iter;
+      gpointer value;
+      GArray *always = g_array_new(FALSE, FALSE, sizeof(int));
+
+      g_hash_table_iter_init(&iter, poll->deviceTable);
+      while (g_hash_table_iter_next(&iter, NULL, &value)) {
+         PollEpollDevice *dev = value;
+
+         if (dev->alwaysReady) {
+            g_array_append_val(always, dev->fd);
+         }
+      }
+      PollEpollUnlock();
+
+      for (i = 0; i < always->len; i++) {
+         PollEpollFireDevice(g_array_index(always, int, i),
+                             EPOLLIN | EPOLLOUT);
+      }
+      g_array_free(always, TRUE);
+   } else {
+      PollEpollUnlock();
+   }
+
+   PollEpollFireTimers(g_get_monotonic_time());
+
+   /*
+    * Callbacks have had their chance to re-register. Stop listening for
+    * whatever the devices that fired no longer want, and re-arm the
+    * one-shot registrations of those that still have a callback.
+    */
+   PollEpollLock();
+   for (i = 0; i < ready->len; i++) {
+      PollEpollDevice *dev =
+         g_hash_table_lookup(poll->deviceTable,
+                             GINT_TO_POINTER(g_array_index(ready, int, i)));
+
+      if (dev != NULL) {
+         PollEpollDeviceCtl(dev, FALSE, TRUE);
+      }
+   }
+   PollEpollArmTimer();
+   PollEpollUnlock();
+
+   g_array_free(ready, TRUE);
+}
+
+
+/*
+ *----------------------------------------------------------------------------
+ *
+ * PollEpollSourcePrepare --
+ * PollEpollSourceCheck --
+ * PollEpollSourceDispatch --
+ *
+ *      GSource functions of the source that runs this implementation from
+ *      the GLib main loop. The only file descriptor GLib polls is the epoll
+ *      descriptor; the timerfd inside it takes care of timeouts.
+ *
+ * Results:
+ *      See GSourceFuncs.
+ *
+ * Side effects:
+ *      Dispatch fires poll callbacks.
+ *
+ *----------------------------------------------------------------------------
+ */
+
+static gboolean
+PollEpollSourcePrepare(GSource *source,  // IN
+                       gint *timeout)    // OUT
+{
+   gboolean ready;
+
+   *timeout = -1;
+
+   PollEpollLock();
+   ready = pollState->numAlwaysReady > 0;
+   PollEpollUnlock();
+
+   return ready;
+}
+
+
+static gboolean
+PollEpollSourceCheck(GSource *source)  // IN
+{
+   PollEpollSource *src = (PollEpollSource *)source;
+
+   return (src->pollFd.revents & G_IO_IN) != 0 ||
+          PollEpollSourcePrepare(source, &(gint){0});
+}
+
+
+static gboolean
+PollEpollSourceDispatch(GSource *source,      // IN
+                        GSourceFunc callback, // IN: unused
+                        gpointer data)        // IN: unused
+{
+   PollEpollDispatch();
+   return TRUE;
+}
+
+
+static GSourceFuncs pollEpollSourceFuncs = {
+   PollEpollSourcePrepare,
+   PollEpollSourceCheck,
+   PollEpollSourceDispatch,
+   NULL,
+};
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PollEpollInit --
+ *
+ *      Module initialization. The epoll and timer descriptors have already
+ *      been created by Poll_InitEpoll.
+ *
+ * Results:
+ *       None
+ *
+ * Side effects:
+ *       Attaches the poll source to the default main context.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+PollEpollInit(void)
+{
+   Poll *poll = pollState;
+   PollEpollSource *src;
+
+   ASSERT(poll != NULL);
+
+   poll->lock = MXUser_CreateExclLock("pollEpollLock", RANK_pollDefaultLock);
+   poll->deviceTable = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                             NULL, g_free);
+   poll->timers = g_ptr_array_new();
+
+   poll->source = g_source_new(&pollEpollSourceFuncs, sizeof *src);
+   src = (PollEpollSource *)poll->source;
+   src->pollFd.fd = poll->epollFd;
+   src->pollFd.events = G_IO_IN | G_IO_ERR | G_IO_HUP;
+   g_source_add_poll(poll->source, &src->pollFd);
+   g_source_attach(poll->source, NULL);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PollEpollExit --
+ *
+ *      Module exit.
+ *
+ * Results:
+ *       None
+ *
+ * Side effects:
+ *       Discards the module-wide state and clears pollState.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+PollEpollExit(void)
+{
+   Poll *poll = pollState;
+   guint i;
+
+   ASSERT(poll != NULL);
+
+   g_source_destroy(poll->source);
+   g_source_unref(poll->source);
+
+   PollEpollLock();
+   g_hash_table_destroy(poll->deviceTable);
+   for (i = 0; i < poll->timers->len; i++) {
+      g_free(PollEpollHeapAt(i));
+   }
+   g_ptr_array_free(poll->timers, TRUE);
+   PollEpollUnlock();
+
+   MXUser_DestroyExclLock(poll->lock);
+   close(poll->timerFd);
+   close(poll->epollFd);
+
+   g_free(poll);
+   pollState = NULL;
+   inited = 0;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PollEpollLoopTimeout --
+ *
+ *       The poll loop. Like pollGtk, this implementation is pumped by the
+ *       GLib main loop, so this routine should never be called.
+ *
+ * Result:
+ *       Void.
+ *
+ * Side effects:
+ *
+ *----------------------------------------------------------------------
+ */
+
+static void
+PollEpollLoopTimeout(Bool loop,          // IN: loop forever if TRUE, else do one pass.
+                     Bool *exit,         // IN: NULL or set to TRUE to end loop.
+                     PollClass class,    // IN: class of events (POLL_CLASS_*)
+                     int timeout)        // IN: maximum time to sleep
+{
+   NOT_IMPLEMENTED();
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PollEpollCallback --
+ *
+ *      For the POLL_REALTIME or POLL_DEVICE queues, entries can be
+ *      inserted for good, to fire on a periodic basis (by setting the
+ *      POLL_FLAG_PERIODIC flag).
+ *
+ *      Otherwise, the callback fires only once.
+ *
+ *      For periodic POLL_REALTIME callbacks, "info" is the time in
+ *      microseconds between execution of the callback.  For
+ *      POLL_DEVICE callbacks, info is a file descriptor.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static VMwareStatus
+PollEpollCallback(PollClassSet classSet,   // IN
+                  int flags,               // IN
+                  PollerFunction f,        // IN
+                  void *clientData,        // IN
+                  PollEventType type,      // IN
+                  PollDevHandle info,      // IN
+                  MXUserRecLock *lock)     // IN
+{
+   Poll *poll = pollState;
+   VMwareStatus result = VMWARE_STATUS_SUCCESS;
+   PollEpollCb cb;
+
+   ASSERT(poll != NULL);
+   ASSERT(f);
+
+   /*
+    * Every callback must be in POLL_CLASS_MAIN (plus possibly others)
+    */
+   ASSERT(PollClassSet_IsMember(classSet, POLL_CLASS_MAIN) != 0);
+   ASSERT(type >= 0 && type < POLL_NUM_QUEUES);
+
+   cb.flags = flags;
+   cb.cb = f;
+   cb.clientData = clientData;
+   cb.classSet = classSet;
+   cb.cbLock = lock;
+
+   PollEpollLock();
+
+   switch (type) {
+   case POLL_MAIN_LOOP:
+      ASSERT(info == 0);
+      /* Fall-through */
+   case POLL_REALTIME:
+      {
+         PollEpollTimer *t = g_new0(PollEpollTimer, 1);
+
+         ASSERT(info >= 0);
+
+         t->cb = cb;
+         t->type = type;
+         t->delay = info;
+         t->deadline = g_get_monotonic_time() + info;
+         PollEpollTimerInsert(t);
+         PollEpollArmTimer();
+         LOG(2, "POLL: timer %p (cb %p, data %p, flags %x, type %x) added\n",
+             t, f, clientData, flags, type);
+      }
+      break;
+
+   case POLL_DEVICE:
+      {
+         PollEpollDevice *dev;
+         PollEpollCb *slot;
+         Bool wasIdle;
+
+         dev = g_hash_table_lookup(poll->deviceTable, GINT_TO_POINTER(info));
+         if (dev == NULL) {
+            dev = g_new0(PollEpollDevice, 1);
+            dev->fd = info;
+            g_hash_table_insert(poll->deviceTable, GINT_TO_POINTER(info),
+                                dev);
+         }
+
+         slot = (flags & POLL_FLAG_WRITE) ? &dev->write : &dev->read;
+         ASSERT(slot->flags == 0);
+
+         /*
+          * Without any callback, the fd may have been closed and its number
+          * reused since it was registered, so the registration has to be
+          * renewed.
+          */
+         wasIdle = dev->read.flags == 0 && dev->write.flags == 0;
+         *slot = cb;
+
+         if (!PollEpollDeviceCtl(dev, wasIdle, FALSE)) {
+            memset(slot, 0, sizeof *slot);
+            PollEpollDeviceCtl(dev, FALSE, TRUE);
+            result = VMWARE_STATUS_ERROR;
+         } else {
+            LOG(2, "POLL: fd %d (cb %p, data %p, flags %x) added\n",
+                (int)info, f, clientData, flags);
+         }
+      }
+      break;
+
+   case POLL_VIRTUALREALTIME:
+   case POLL_VTIME:
+   default:
+      NOT_IMPLEMENTED();
+   }
+
+   PollEpollUnlock();
+
+   return result;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PollEpollCallbackRemoveInt --
+ *
+ *      Remove a callback.
+ *
+ * Results:
+ *      TRUE if entry found and removed, FALSE otherwise
+ *
+ * Side effects:
+ *      A device left without callbacks stays known, with its epoll
+ *      registration disarmed; see PollEpollDeviceCtl.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Bool
+PollEpollCallbackRemoveInt(PollClassSet classSet,           // IN
+                           int flags,                       // IN
+                           PollerFunction f,                // IN
+                           void *clientData,                // IN
+                           Bool matchAnyClientData,         // IN
+                           PollEventType type,              // IN
+                           void **foundClientData)          // OUT
+{
+   Poll *poll = pollState;
+   Bool found = FALSE;
+
+   ASSERT(poll);
+   ASSERT(!clientData || !matchAnyClientData);
+   ASSERT(type >= 0 && type < POLL_NUM_QUEUES);
+   ASSERT(foundClientData);
+
+   PollEpollLock();
+
+   switch (type) {
+   case POLL_REALTIME:
+   case POLL_MAIN_LOOP:
+      {
+         guint i;
+
+         for (i = 0; i < poll->timers->len; i++) {
+            PollEpollTimer *t = PollEpollHeapAt(i);
+
+            if (t->type == type &&
+                PollEpollCbMatches(&t->cb, classSet, flags, f, clientData,
+                                   matchAnyClientData)) {
+               *foundClientData = t->cb.clientData;
+               PollEpollTimerRemove(t);
+               g_free(t);
+               found = TRUE;
+               break;
+            }
+         }
+      }
+      break;
+
+   case POLL_DEVICE:
+      {
+         GHashTableIter iter;
+         gpointer value;
+
+         g_hash_table_iter_init(&iter, poll->deviceTable);
+         while (g_hash_table_iter_next(&iter, NULL, &value)) {
+            PollEpollDevice *dev = value;
+            PollEpollCb *slot = (flags & POLL_FLAG_WRITE) ? &dev->write :
+                                                            &dev->read;
+
+            if (slot->flags != 0 &&
+                PollEpollCbMatches(slot, classSet, flags, f, clientData,
+                                   matchAnyClientData)) {
+               *foundClientData = slot->clientData;
+               memset(slot, 0, sizeof *slot);
+               if (dev->read.flags == 0 && dev->write.flags == 0) {
+                  /* The caller still has the fd open: disarm it now. */
+                  PollEpollDeviceCtl(dev, FALSE, TRUE);
+               }
+               found = TRUE;
+               break;
+            }
+         }
+      }
+      break;
+
+   case POLL_VIRTUALREALTIME:
+   case POLL_VTIME:
+   default:
+      NOT_IMPLEMENTED();
+   }
+
+   if (!found) {
+      LOG(1, "POLL: no matching entry for cb %p, data %p, flags %x, type %x\n",
+          f, clientData, flags, type);
+   }
+
+   PollEpollUnlock();
+   return found;
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PollEpollCallbackRemove --
+ *
+ *      Remove a callback.
+ *
+ * Results:
+ *      TRUE if entry found and removed, FALSE otherwise
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Bool
+PollEpollCallbackRemove(PollClassSet classSet,   // IN
+                        int flags,               // IN
+                        PollerFunction f,        // IN
+                        void *clientData,        // IN
+                        PollEventType type)      // IN
+{
+   void *foundClientData;
+
+   return PollEpollCallbackRemoveInt(classSet, flags, f, clientData, FALSE,
+                                     type, &foundClientData);
+}
+
+
+/*
+ *----------------------------------------------------------------------
+ *
+ * PollEpollCallbackRemoveOneByCB --
+ *
+ *      Remove a callback.
+ *
+ * Results:
+ *      TRUE if entry found and removed (*clientData updated), FALSE otherwise
+ *
+ * Side effects:
+ *      None.
+ *
+ *----------------------------------------------------------------------
+ */
+
+static Bool
+PollEpollCallbackRemoveOneByCB(PollClassSet classSet,   // IN
+                               int flags,               // IN
+                               PollerFunction f,        // IN
+                               PollEventType type,      // IN
+                               void **clientData)       // OUT
+{
+   return PollEpollCallbackRemoveInt(classSet, flags, f, NULL, TRUE, type,
+                                     clientData);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * Poll_InitEpoll --
+ *
+ *      Public init function for this Poll implementation. Poll loop will be
+ *      up and running after this is called.
+ *
+ *      Falls back to the pollGtk implementation if the epoll or timer
+ *      descriptors cannot be created.
+ *
+ * Results:
+ *      None
+ *
+ * Side effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+Poll_InitEpoll(void)
+{
+   static const PollImpl epollImpl =
+   {
+      PollEpollInit,
+      PollEpollExit,
+      PollEpollLoopTimeout,
+      PollEpollCallback,
+      PollEpollCallbackRemove,
+      PollEpollCallbackRemoveOneByCB,
+      PollLockingAlwaysEnabled,
+   };
+
+   if (g_once_init_enter(&inited)) {
+      gsize didInit = 1;
+      int epollFd = epoll_create1(EPOLL_CLOEXEC);
+      int timerFd = timerfd_create(CLOCK_MONOTONIC,
+                                   TFD_NONBLOCK | TFD_CLOEXEC);
+      struct epoll_event ev;
+
+      memset(&ev, 0, sizeof ev);
+      ev.events = EPOLLIN;
+      ev.data.fd = timerFd;
+
+      if (epollFd == -1 || timerFd == -1 ||
+          epoll_ctl(epollFd, EPOLL_CTL_ADD, timerFd, &ev) == -1) {
+         Log("POLL: epoll unavailable (%s), using GLib sources.\n",
+             Err_ErrString());
+         if (timerFd != -1) {
+            close(timerFd);
+         }
+         if (epollFd != -1) {
+            close(epollFd);
+         }
+         g_once_init_leave(&inited, didInit);
+         Poll_InitGtk();
+         return;
+      }
+
+      ASSERT(pollState == NULL);
+      pollState = g_new0(Poll, 1);
+      pollState->epollFd = epollFd;
+      pollState->timerFd = timerFd;
+
+      Poll_InitWithImpl(&epollImpl);
+      g_once_init_leave(&inited, didInit);
+   }
+}
@@ -492,21 +492,21 @@ Socket_DecodePacket(const char *recvBuf,       // IN
                     int32 *payloadLen)         // OUT
 {
    ErrorCode res;
-   DataMap map;
-   char *buf;
+   DataMapView map;
+   const char *buf;
    int32 len;
 
    *payload = NULL;
    *payloadLen = 0;
 
-   /* decoding the packet */
-   res = DataMap_Deserialize(recvBuf, fullPktLen, &map);
+   /* decoding the packet, the payload is copied out once below */
+   res = DataMap_ViewInit(recvBuf, fullPktLen, &map);
    if (res != DMERR_SUCCESS) {
       Debug(LGPFX "Error in dataMap decoding, error=%d\n", res);
       return FALSE;
    }
 
-   res = DataMap_GetString(&map, GUESTRPCPKT_FIELD_PAYLOAD, &buf, &len);
+   res = DataMap_ViewGetString(&map, GUESTRPCPKT_FIELD_PAYLOAD, &buf, &len);
    if (res == DMERR_SUCCESS) {
       char *tmpPtr = malloc(len + 1);
       if (tmpPtr == NULL) {
@@ -524,11 +524,11 @@ Socket_DecodePacket(const char *recvBuf,       // IN
       goto error;
    }
 
-   DataMap_Destroy(&map);
+   DataMap_ViewDestroy(&map);
    return TRUE;
 
 error:
-   DataMap_Destroy(&map);
+   DataMap_ViewDestroy(&map);
    return FALSE;
 }
 
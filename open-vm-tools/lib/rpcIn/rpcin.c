@@ -428,7 +428,11 @@ RpcIn_Construct(GMainContext *mainCtx,    // IN
    RpcIn *result;
 
 #if defined(VMTOOLS_USE_VSOCKET)
+#if defined(__linux__)
+   Poll_InitEpoll();
+#else
    Poll_InitGtk();
+#endif
 #endif
 
    ASSERT(mainCtx != NULL);
@@ -850,22 +854,22 @@ RpcInDecodePacket(ConnInfo *conn,       // IN
                   int32 *payloadLen)    // OUT
 {
    ErrorCode res;
-   DataMap map;
+   DataMapView map;
    int fd = AsyncSocket_GetFd(conn->asock);
    int fullPacketLen = conn->packetLen + sizeof conn->packetLen;
-   char *buf;
+   const char *buf;
    int32 len;
 
 
-   /* decoding the packet */
-   res = DataMap_Deserialize(conn->recvBuf, fullPacketLen, &map);
+   /* decoding the packet, the payload is copied out once below */
+   res = DataMap_ViewInit(conn->recvBuf, fullPacketLen, &map);
    if (res != DMERR_SUCCESS) {
       Debug("RpcIn: Error in dataMap decoding for conn %d, error=%d\n",
             fd, res);
       return FALSE;
    }
 
-   res = DataMap_GetString(&map, GUESTRPCPKT_FIELD_PAYLOAD, &buf, &len);
+   res = DataMap_ViewGetString(&map, GUESTRPCPKT_FIELD_PAYLOAD, &buf, &len);
    if (res == DMERR_SUCCESS) {
       char *tmpPtr = (char *)malloc(len + 1);
       if (tmpPtr == NULL) {
@@ -883,11 +887,11 @@ RpcInDecodePacket(ConnInfo *conn,       // IN
       goto exit;
    }
 
-   DataMap_Destroy(&map);
+   DataMap_ViewDestroy(&map);
    return TRUE;
 
 exit:
-   DataMap_Destroy(&map);
+   DataMap_ViewDestroy(&map);
    return FALSE;
 }
 
@@ -58,6 +58,9 @@ WiperSinglePartition_Allocate(void)
       p->fsName = NULL;
       p->comment = NULL;
       p->attemptUnmaps = TRUE;
+#if defined(__linux__)
+      p->onlineDiscard = FALSE;
+#endif
       DblLnkLst_Init(&p->link);
    }
 
@@ -125,3 +128,33 @@ WiperPartition_Close(WiperPartition_List *pl)      // IN/OUT
    }
 }
 
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * Wiper_MethodName --
+ *
+ *      Describes a wipe method, for logging and user output.
+ *
+ * Results:
+ *      A static string.
+ *
+ * Side Effects:
+ *      None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+const char *
+Wiper_MethodName(WiperMethod method)      // IN
+{
+   switch (method) {
+   case WIPER_METHOD_TRIM:
+      return "trim";
+   case WIPER_METHOD_PUNCH_HOLE:
+      return "discard";
+   case WIPER_METHOD_ZERO_FILL:
+   default:
+      return "zero-fill";
+   }
+}
@@ -27,11 +27,20 @@
 #error This file should not be compiled on this platform.
 #endif
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+# define _GNU_SOURCE    /* for fallocate() */
+#endif
+
+#include <errno.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <sys/stat.h>
 #if defined(__linux__) || defined(sun)
 # if defined(__linux__)
+#  include <fcntl.h>
+#  include <sys/ioctl.h>
 #  include <sys/sysmacros.h>
+#  include <linux/fs.h>
 # endif
 # include <sys/vfs.h>
 #elif defined(__FreeBSD__) || defined(__APPLE__)
@@ -54,20 +63,45 @@
 #include "mntinfo.h"
 #include "posix.h"
 #include "util.h"
+#include "hostinfo.h"
+
 
+/*
+ * Number of bytes to write per write system call when zero-filling.
+
+   The bigger it is, the less calls we do and the faster we are. It is a
+   multiple of any sector or page size so that the writes can bypass the
+   page cache.
+ */
+#define WIPER_FILL_BLOCK_SIZE (1 << 20) /* 1 MB */
+#define WIPER_FILL_ALIGNMENT 4096
 
-/* Number of bytes per disk sector */
-#define WIPER_SECTOR_SIZE 512
+/*
+ * Zero-fill writer threads. Several streams keep more requests in flight on
+ * the virtual disk than a single synchronous writer.
+ */
+#define WIPER_DEFAULT_FILL_STREAMS 4
+#define WIPER_MAX_FILL_STREAMS 16
 
-/* Number of disk sectors to write per write system call.
+/* How long Wiper_Next() waits for the writers before reporting progress */
+#define WIPER_FILL_POLL_USECS 200000 /* 1/5 second */
 
-   The bigger it is, the less calls we do and the faster we are.
+/* Free space left alone so that the partition never fills up completely */
+#define WIPER_FREE_MARGIN (((uint64)5) << 20) /* 5 MB */
 
-   This value has been empirically determined to give maximum performance.
+/* Largest wiper file; most filesystems can handle this much */
+#define WIPER_MAX_FILE_SIZE (((uint64)2) << 30) /* 2 GB */
 
---hpreg
-*/
-#define WIPER_SECTOR_STEP 128
+#if defined(__linux__)
+/*
+ * Amount of the filesystem to trim, and of free space to preallocate when
+ * relying on online discard, per call to Wiper_Next(). Both are metadata
+ * operations, so the steps can be much larger than a zero-fill step while
+ * keeping each call short.
+ */
+#define WIPER_TRIM_STEP (((uint64)1) << 30)        /* 1 GB */
+#define WIPER_DISCARD_STEP (((uint64)256) << 20)   /* 256 MB */
+#endif
 
 /* Number of device numbers to store for device-mapper */
 #define WIPER_MAX_DM_NUMBERS 8
@@ -81,8 +115,10 @@
 
 /* Types */
 typedef enum {
+   WIPER_PHASE_TRIM,
    WIPER_PHASE_CREATE,
    WIPER_PHASE_FILL,
+   WIPER_PHASE_ZERO,
 } WiperPhase;
 
 typedef struct File {
@@ -102,10 +138,37 @@ typedef struct WiperState {
    File *f;
    /* Serial number of the next wiper file to create */
    unsigned int nr;
-   /*  Buffer to write in each sector of a wiper file */
-   unsigned char buf[WIPER_SECTOR_STEP * WIPER_SECTOR_SIZE];
+   /* Protects f, nr, stats and the zero-fill state below */
+   pthread_mutex_t lock;
+
+   /*
+    * Zero-fill writers. 'buf' is the aligned block of zeroes they all write
+    * from; 'stop' is read without the lock. 'budget' is how much the
+    * writers may still write before they must look at the free space again
+    * and 'pending' how much they are writing right now.
+    */
+   unsigned char *buf;
+   pthread_t threads[WIPER_MAX_FILL_STREAMS];
+   unsigned int numThreads;
+   unsigned int numStreams;
+   unsigned int maxMBps;
+   VmTimeType throttleNext;
+   uint64 budget;
+   uint64 pending;
+   Bool buffered;
+   Bool full;
+   const char *fillError;
+   volatile Bool stop;
+
    /* Effective user id */
    uid_t euid;
+   /* Next filesystem offset to trim */
+   uint64 trimOffset;
+   /* When the wipe started */
+   VmTimeType startTime;
+   /* Method and throughput, in the caller's structure if it provided one */
+   WiperStats ownStats;
+   WiperStats *stats;
 } WiperState;
 
 #ifdef sun
@@ -158,6 +221,8 @@ static Bool WiperIsDiskDevice(MNTINFO *mnt, struct stat *s);
 static void WiperPartitionFilter(WiperPartition *item, MNTINFO *mnt, Bool shrinkableOnly);
 static unsigned char *WiperGetSpace(WiperState *state, uint64 *free, uint64 *total);
 static void WiperClean(WiperState *state);
+static void WiperFinish(WiperState **state);
+static void WiperStopFill(WiperState *state);
 
 
 #if defined(__linux__)
@@ -455,6 +520,10 @@ WiperPartitionFilter(WiperPartition *item,         // IN/OUT
       }
    }
 
+#if defined(__linux__)
+   item->onlineDiscard = hasmntopt(mnt, "discard") != NULL;
+#endif
+
    if (item->type == PARTITION_UNSUPPORTED) {
       ASSERT(comment);
       item->comment = Util_SafeStrdup(comment);
@@ -767,6 +836,41 @@ Wiper_IsWipeSupported(const WiperPartition *part)
 Wiper_State *
 Wiper_Start(const WiperPartition *p,             // IN
             unsigned int maxWiperFileSize)       // IN : unused
+{
+   return Wiper_StartWithStats(p, maxWiperFileSize, NULL);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * Wiper_StartWithStats --
+ *
+ *      Same as Wiper_Start, but keeps 'stats' up to date with the method used
+ *      to reclaim free space and the amount reclaimed so far. 'stats' must
+ *      outlive the wiper state; it holds the final numbers once Wiper_Next
+ *      reports 100% or Wiper_Cancel returns.
+ *
+ *      Where the partition allows unmaps, the free space is trimmed with
+ *      FITRIM, which discards it on the virtual disk without any writes. If
+ *      the filesystem or disk does not support that but the filesystem
+ *      discards blocks as it frees them, the free space is allocated with
+ *      fallocate() and released again. Otherwise it is filled with zeroes.
+ *
+ * Results:
+ *      A Wiper_State on success
+ *      NULL on failure
+ *
+ * Side Effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+Wiper_State *
+Wiper_StartWithStats(const WiperPartition *p,        // IN
+                     unsigned int maxWiperFileSize,  // IN : unused
+                     WiperStats *stats)              // OUT: optional
 {
    WiperState *state;
 
@@ -780,13 +884,70 @@ Wiper_Start(const WiperPartition *p,             // IN
    state->p = p;
    state->f = NULL;
    state->nr = 0;
-   memset(state->buf, 0, WIPER_SECTOR_STEP * WIPER_SECTOR_SIZE);
+   pthread_mutex_init(&state->lock, NULL);
+   state->buf = NULL;
+   state->numThreads = 0;
+   state->numStreams = WIPER_DEFAULT_FILL_STREAMS;
+   state->maxMBps = 0;
+   state->throttleNext = 0;
+   state->buffered = FALSE;
+   state->full = FALSE;
+   state->fillError = NULL;
+   state->stop = FALSE;
    state->euid = geteuid();
+   state->trimOffset = 0;
+   state->startTime = Hostinfo_SystemTimerUS();
+   state->stats = stats != NULL ? stats : &state->ownStats;
+   state->stats->method = WIPER_METHOD_ZERO_FILL;
+   state->stats->bytes = 0;
+   state->stats->usecs = 0;
+
+#if defined(__linux__)
+   if (p->attemptUnmaps) {
+      state->phase = WIPER_PHASE_TRIM;
+      state->stats->method = WIPER_METHOD_TRIM;
+   }
+#endif
 
    return (void *)state;
 }
 
 
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * Wiper_SetZeroFill --
+ *
+ *      Tunes the zero-fill used when free space cannot be discarded: the
+ *      number of files written to in parallel (0 for the default), and a cap
+ *      on their combined write rate in MB/s (0 for none). Must be called
+ *      before the first call to Wiper_Next.
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+Wiper_SetZeroFill(Wiper_State *s,          // IN/OUT
+                  unsigned int streams,    // IN
+                  unsigned int maxMBps)    // IN
+{
+   WiperState *state = (WiperState *)s;
+
+   ASSERT(state);
+   ASSERT(state->numThreads == 0);
+
+   state->numStreams = streams == 0 ? WIPER_DEFAULT_FILL_STREAMS :
+                                      MIN(streams, WIPER_MAX_FILL_STREAMS);
+   state->maxMBps = maxMBps;
+}
+
+
 /*
  *-----------------------------------------------------------------------------
  *
@@ -835,19 +996,570 @@ WiperClean(WiperState *state)      // IN/OUT
 {
    ASSERT(state);
 
+   WiperStopFill(state);
+   state->stats->usecs = Hostinfo_SystemTimerUS() - state->startTime;
+
    while (state->f != NULL) {
       File *next;
 
+#if defined(__linux__)
+      /*
+       * Release the preallocated blocks explicitly, so that they are
+       * discarded now even if something else still has the file open.
+       */
+      if (state->stats->method == WIPER_METHOD_PUNCH_HOLE &&
+          state->f->size > 0 &&
+          fallocate(state->f->fd.posix,
+                    FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                    0, state->f->size) == -1) {
+         Log("Unable to punch a hole in %s: %s\n",
+             state->f->name, strerror(errno));
+      }
+#endif
       FileIO_Close(&state->f->fd);
       next = state->f->next;
       free(state->f);
       state->f = next;
    }
 
+   free(state->buf);
+   pthread_mutex_destroy(&state->lock);
    free(state);
 }
 
 
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * WiperFinish --
+ *
+ *      Log how the partition was wiped and destroy the wiper state.
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      *state is freed and set to NULL.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+WiperFinish(WiperState **state)      // IN/OUT
+{
+   const WiperPartition *p = (*state)->p;
+   WiperStats stats;
+
+   /* The statistics may live in the state itself, so copy them first. */
+   (*state)->stats->usecs = Hostinfo_SystemTimerUS() - (*state)->startTime;
+   stats = *(*state)->stats;
+
+   WiperClean(*state);
+   *state = NULL;
+
+   Log("Wiped %s using %s: %"FMT64"u bytes in %"FMT64"u ms.\n",
+       p->mountPoint, Wiper_MethodName(stats.method), stats.bytes,
+       stats.usecs / 1000);
+}
+
+
+#if defined(__linux__)
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * WiperTrimNext --
+ *
+ *      Trim the next WIPER_TRIM_STEP bytes of the partition with FITRIM.
+ *
+ *      If the first trim fails, the filesystem, the disk or the caller's
+ *      privileges do not allow it: switch to the next best method.
+ *
+ * Results:
+ *      "" on success, with 'progress' updated.
+ *      The description of the error on failure.
+ *
+ * Side Effects:
+ *      The wiper state is updated
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static unsigned char *
+WiperTrimNext(WiperState *state,       // IN/OUT
+              uint64 total,            // IN
+              unsigned int *progress)  // OUT
+{
+   struct fstrim_range range;
+   int fd;
+   int ret;
+   int err;
+
+   fd = Posix_Open((const char *)state->p->mountPoint, O_RDONLY | O_DIRECTORY);
+   if (fd == -1) {
+      return "Unable to open the mount point";
+   }
+
+   range.start = state->trimOffset;
+   range.minlen = 0;
+   if (range.start + WIPER_TRIM_STEP >= total) {
+      /*
+       * statfs() does not count the filesystem's own metadata, so the
+       * filesystem may extend past 'total'. Cover everything up to its end.
+       */
+      range.len = ~(uint64)0;
+   } else {
+      range.len = WIPER_TRIM_STEP;
+   }
+
+   ret = ioctl(fd, FITRIM, &range);
+   err = errno;
+   close(fd);
+
+   if (ret == -1) {
+      if (state->trimOffset == 0) {
+         Log("Unable to trim %s: %s\n", state->p->mountPoint, strerror(err));
+         state->phase = WIPER_PHASE_CREATE;
+         state->stats->method = state->p->onlineDiscard ?
+                                WIPER_METHOD_PUNCH_HOLE :
+                                WIPER_METHOD_ZERO_FILL;
+         *progress = 0;
+         return "";
+      }
+      return "Unable to trim the partition";
+   }
+
+   /* On return, range.len holds the number of bytes actually trimmed. */
+   state->stats->bytes += range.len;
+
+   if (state->trimOffset + WIPER_TRIM_STEP >= total) {
+      *progress = 100;
+   } else {
+      state->trimOffset += WIPER_TRIM_STEP;
+      *progress = 99 * state->trimOffset / total;
+   }
+   return "";
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * WiperDiscardNext --
+ *
+ *      Allocate up to WIPER_DISCARD_STEP bytes of free space to the current
+ *      wiper file without writing to it. The blocks are discarded when they
+ *      are released by WiperClean.
+ *
+ * Results:
+ *      0 on success; the phase is set to WIPER_PHASE_CREATE if the file is
+ *         as large as it should get.
+ *      1 if the partition is full.
+ *      -1 on error, with errno set.
+ *
+ * Side Effects:
+ *      The wiper state is updated
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static int
+WiperDiscardNext(WiperState *state,    // IN/OUT
+                 uint64 free)          // IN
+{
+   File *f = state->f;
+   uint64 len = MIN(WIPER_DISCARD_STEP, free - WIPER_FREE_MARGIN);
+
+   if (f->size + len >= WIPER_MAX_FILE_SIZE) {
+      len = WIPER_MAX_FILE_SIZE - f->size;
+   }
+   if (len == 0) {
+      state->phase = WIPER_PHASE_CREATE;
+      return 0;
+   }
+
+   if (fallocate(f->fd.posix, 0, f->size, len) == -1) {
+      if (errno == ENOSPC || errno == EDQUOT) {
+         return 1;
+      }
+      if (errno == EFBIG) {
+         state->phase = WIPER_PHASE_CREATE;
+         return 0;
+      }
+      return -1;
+   }
+
+   f->size += len;
+   state->stats->bytes += len;
+   return 0;
+}
+#endif
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * WiperCreateFile --
+ *
+ *      Create a new wiper file and add it to the state's list of files.
+ *
+ *      We name it just under the mount point so that we are sure that the
+ *      file is on the right partition.
+ *
+ * Results:
+ *      The new file on success.
+ *      NULL on failure, with 'error' set.
+ *
+ * Side Effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static File *
+WiperCreateFile(WiperState *state,    // IN/OUT
+                int access,           // IN: extra FileIO access flags
+                const char **error)   // OUT
+{
+   File *new;
+
+   new = (File *)malloc(sizeof *new);
+   if (new == NULL) {
+      *error = "Not enough memory";
+      return NULL;
+   }
+
+   for (;;) {
+      FileIOResult fret;
+      unsigned int nr;
+
+      FileIO_Invalidate(&new->fd);
+
+      pthread_mutex_lock(&state->lock);
+      nr = state->nr++;
+      pthread_mutex_unlock(&state->lock);
+
+      if (Str_Snprintf(new->name, NATIVE_MAX_PATH, "%s/wiper%d",
+                       state->p->mountPoint, nr) == -1) {
+         Log("NATIVE_MAX_PATH is too small\n");
+         ASSERT(0);
+      }
+
+      fret = FileIO_Open(&new->fd,
+                         new->name,
+                         FILEIO_OPEN_ACCESS_WRITE
+                         | FILEIO_OPEN_DELETE_ASAP
+                         | access,
+                         FILEIO_OPEN_CREATE_SAFE);
+      if (FileIO_IsSuccess(fret)) {
+         break;
+      }
+
+      if (fret != FILEIO_OPEN_ERROR_EXIST) {
+         free(new);
+         *error = "error.create";
+         return NULL;
+      }
+   }
+   new->size = 0;
+
+   pthread_mutex_lock(&state->lock);
+   new->next = state->f;
+   state->f = new;
+   pthread_mutex_unlock(&state->lock);
+
+   return new;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * WiperThrottle --
+ *
+ *      Wait until the zero-fill writers may write another 'len' bytes
+ *      without exceeding their combined rate limit.
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      May sleep.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+WiperThrottle(WiperState *state,   // IN/OUT
+              uint64 len)          // IN
+{
+   VmTimeType now;
+   VmTimeType due;
+
+   if (state->maxMBps == 0) {
+      return;
+   }
+
+   now = Hostinfo_SystemTimerUS();
+
+   pthread_mutex_lock(&state->lock);
+   due = MAX(state->throttleNext, now);
+   state->throttleNext = due + len * 1000000 /
+                               ((uint64)state->maxMBps << 20);
+   pthread_mutex_unlock(&state->lock);
+
+   if (due > now) {
+      Util_Usleep(due - now);
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * WiperReserve --
+ *
+ *      Reserve room for one more zero-fill block, keeping WIPER_FREE_MARGIN
+ *      of the partition free. When the writers' budget runs out, it is
+ *      refilled from the free space left, minus what is still being written.
+ *
+ * Results:
+ *      TRUE if the block may be written, FALSE if the partition is full.
+ *
+ * Side Effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+WiperReserve(WiperState *state)   // IN/OUT
+{
+   Bool ok = FALSE;
+
+   pthread_mutex_lock(&state->lock);
+   if (state->budget < WIPER_FILL_BLOCK_SIZE) {
+      uint64 free;
+      uint64 total;
+
+      state->budget = 0;
+      if (*WiperGetSpace(state, &free, &total) == '\0' &&
+          free > WIPER_FREE_MARGIN + state->pending) {
+         state->budget = free - WIPER_FREE_MARGIN - state->pending;
+      }
+   }
+   if (state->budget >= WIPER_FILL_BLOCK_SIZE) {
+      state->budget -= WIPER_FILL_BLOCK_SIZE;
+      state->pending += WIPER_FILL_BLOCK_SIZE;
+      ok = TRUE;
+   }
+   pthread_mutex_unlock(&state->lock);
+
+   return ok;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * WiperFillThread --
+ *
+ *      Zero-fill writer: fill wiper files one after the other until only
+ *      WIPER_FREE_MARGIN of the partition is left, an error occurs or the
+ *      wipe is stopped.
+ *
+ * Results:
+ *      NULL
+ *
+ * Side Effects:
+ *      Sets state->full or state->fillError when it stops on its own.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void *
+WiperFillThread(void *data)   // IN
+{
+   WiperState *state = data;
+   File *f = NULL;
+   const char *error = NULL;
+   Bool full = FALSE;
+   Bool buffered = FALSE;
+
+   while (!state->stop) {
+      FileIOResult fret;
+
+      if (f == NULL ||
+          f->size + WIPER_FILL_BLOCK_SIZE > WIPER_MAX_FILE_SIZE) {
+         /* The file is going to be larger than what most filesystems
+            can support. Create a new file */
+         pthread_mutex_lock(&state->lock);
+         buffered = state->buffered;
+         pthread_mutex_unlock(&state->lock);
+
+         f = WiperCreateFile(state,
+                             buffered ? 0 : FILEIO_OPEN_UNBUFFERED,
+                             &error);
+         if (f == NULL && !buffered) {
+            /* The filesystem may not support O_DIRECT. */
+            buffered = TRUE;
+            f = WiperCreateFile(state, 0, &error);
+         }
+         if (f == NULL) {
+            break;
+         }
+      }
+
+      if (!WiperReserve(state)) {
+         full = TRUE;
+         break;
+      }
+
+      WiperThrottle(state, WIPER_FILL_BLOCK_SIZE);
+
+      fret = FileIO_Write(&f->fd, state->buf, WIPER_FILL_BLOCK_SIZE, NULL);
+
+      pthread_mutex_lock(&state->lock);
+      state->pending -= WIPER_FILL_BLOCK_SIZE;
+      if (FileIO_IsSuccess(fret)) {
+         state->stats->bytes += WIPER_FILL_BLOCK_SIZE;
+      }
+      pthread_mutex_unlock(&state->lock);
+
+      /*
+       * We distiguish errors from FilieIO_Write.
+       */
+      if (!FileIO_IsSuccess(fret)) {
+         /* The file is too big even though its size is less than 2GB */
+         if (fret == FILEIO_WRITE_ERROR_FBIG) {
+            f = NULL;
+            continue;
+         }
+
+         /*
+          * The disk is full (there may be other process is consuming space),
+          * or the user runs out of his disk quota.
+          */
+         if (fret == FILEIO_WRITE_ERROR_NOSPC) {
+            full = TRUE;
+            break;
+         }
+
+         /*
+          * Unbuffered writes may be refused even though the open worked.
+          * Switch all writers to buffered I/O and start a new file.
+          */
+         if (!buffered && f->size == 0) {
+            Log("Unbuffered write to %s failed, using buffered I/O.\n",
+                f->name);
+            pthread_mutex_lock(&state->lock);
+            state->buffered = TRUE;
+            pthread_mutex_unlock(&state->lock);
+            f = NULL;
+            continue;
+         }
+
+         /* Otherwise, it is a real error */
+         error = fret == FILEIO_WRITE_ERROR_DQUOT ?
+                 "User's disk quota exceeded" :
+                 "Unable to write to a wiper file";
+         break;
+      }
+
+      f->size += WIPER_FILL_BLOCK_SIZE;
+   }
+
+   pthread_mutex_lock(&state->lock);
+   if (full) {
+      state->full = TRUE;
+   } else if (error != NULL && state->fillError == NULL) {
+      state->fillError = error;
+   }
+   pthread_mutex_unlock(&state->lock);
+
+   return NULL;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * WiperStartFill --
+ *
+ *      Start the zero-fill writer threads.
+ *
+ * Results:
+ *      "" on success.
+ *      The description of the error on failure.
+ *
+ * Side Effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static unsigned char *
+WiperStartFill(WiperState *state)   // IN/OUT
+{
+   unsigned int i;
+
+   ASSERT(state->numThreads == 0);
+
+   if (posix_memalign((void **)&state->buf, WIPER_FILL_ALIGNMENT,
+                      WIPER_FILL_BLOCK_SIZE) != 0) {
+      state->buf = NULL;
+      return "Not enough memory";
+   }
+   memset(state->buf, 0, WIPER_FILL_BLOCK_SIZE);
+
+   state->throttleNext = Hostinfo_SystemTimerUS();
+   state->budget = 0;
+   state->pending = 0;
+
+   for (i = 0; i < state->numStreams; i++) {
+      if (pthread_create(&state->threads[i], NULL, WiperFillThread,
+                         state) != 0) {
+         break;
+      }
+      state->numThreads++;
+   }
+
+   if (state->numThreads == 0) {
+      return "Unable to start the wiper";
+   }
+
+   Log("Zero-filling %s with %u writers, %s%u MB/s.\n",
+       state->p->mountPoint, state->numThreads,
+       state->maxMBps == 0 ? "no limit on " : "at most ", state->maxMBps);
+   return "";
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * WiperStopFill --
+ *
+ *      Stop the zero-fill writer threads, if any, and wait for them.
+ *
+ * Results:
+ *      None
+ *
+ * Side Effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+WiperStopFill(WiperState *state)   // IN/OUT
+{
+   state->stop = TRUE;
+   while (state->numThreads > 0) {
+      pthread_join(state->threads[--state->numThreads], NULL);
+   }
+}
+
+
 /*
  *-----------------------------------------------------------------------------
  *
@@ -891,12 +1603,24 @@ Wiper_Next(Wiper_State **s,         // IN/OUT
       return error;
    }
 
+#if defined(__linux__)
+   if ((*state)->phase == WIPER_PHASE_TRIM) {
+      error = WiperTrimNext(*state, total, progress);
+      if (*error != '\0') {
+         WiperClean(*state);
+         *state = NULL;
+      } else if (*progress == 100) {
+         WiperFinish(state);
+      }
+      return error;
+   }
+#endif
+
    /* Disk space is an important system resource. Don't fill the partition
       completely */
-   if (free <= (((uint64)5) << 20) /* 5 MB */) {
+   if (free <= WIPER_FREE_MARGIN) {
       /* We are done */
-      WiperClean(*state);
-      *state = NULL;
+      WiperFinish(state);
       *progress = 100;
       return "";
    }
@@ -904,105 +1628,98 @@ Wiper_Next(Wiper_State **s,         // IN/OUT
    /* We are not done */
    switch ((*state)->phase) {
    case WIPER_PHASE_CREATE:
+      if ((*state)->stats->method == WIPER_METHOD_ZERO_FILL) {
+         error = WiperStartFill(*state);
+         if (*error != '\0') {
+            WiperClean(*state);
+            *state = NULL;
+            return error;
+         }
+         (*state)->phase = WIPER_PHASE_ZERO;
+         break;
+      }
+
       {
-         File *new;
+         const char *createError;
 
-         new = (File *)malloc(sizeof *new);
-         if (new == NULL) {
+         if (WiperCreateFile(*state, 0, &createError) == NULL) {
             WiperClean(*state);
             *state = NULL;
-            return "Not enough memory";
+            return (unsigned char *)createError;
          }
+      }
+      (*state)->phase = WIPER_PHASE_FILL;
+      break;
 
-         /*
-          * Create a new file
-          */
-
-         /* We name it just under the mount point so that we are sure that
-            the file is on the right partition. */
-         for (;;) {
-            FileIOResult fret;
-            FileIO_Invalidate(&new->fd);
+#if defined(__linux__)
+   case WIPER_PHASE_FILL:
+      {
+         int ret = WiperDiscardNext(*state, free);
 
-            if (Str_Snprintf(new->name, NATIVE_MAX_PATH, "%s/wiper%d",
-                             (*state)->p->mountPoint, (*state)->nr++) == -1) {
-               Log("NATIVE_MAX_PATH is too small\n");
-               ASSERT(0);
-            }
+         if (ret == 1) {
+            /* The partition is full */
+            WiperFinish(state);
+            *progress = 100;
+            return "";
+         }
 
-            fret = FileIO_Open(&new->fd,
-                               new->name,
-                               FILEIO_OPEN_ACCESS_WRITE
-                               | FILEIO_OPEN_DELETE_ASAP,
-                               FILEIO_OPEN_CREATE_SAFE);
-            if (FileIO_IsSuccess(fret)) {
-               break;
-            }
+         if (ret == 0) {
+            break;
+         }
 
-            if (fret != FILEIO_OPEN_ERROR_EXIST) {
-               WiperClean(*state);
-               *state = NULL;
-               return "error.create";
-            }
+         if ((*state)->f->size != 0 || (*state)->f->next != NULL) {
+            WiperClean(*state);
+            *state = NULL;
+            return "Unable to allocate space for a wiper file";
          }
-         new->size = 0;
 
-         new->next = (*state)->f;
-         (*state)->f = new;
+         /* fallocate() is not supported here: fall back to zero-fill. */
+         Log("Unable to preallocate %s: %s\n", (*state)->f->name,
+             strerror(errno));
+         (*state)->stats->method = WIPER_METHOD_ZERO_FILL;
+         (*state)->phase = WIPER_PHASE_CREATE;
       }
-      (*state)->phase = WIPER_PHASE_FILL;
       break;
+#endif
 
-   case WIPER_PHASE_FILL:
+   case WIPER_PHASE_ZERO:
       {
-         unsigned int i;
-
-         /* Do several write system calls per call to Wiper_Next() */
-         for (i = 0; i < (2 << 20) /* 2 MB */
-                         / (WIPER_SECTOR_STEP * WIPER_SECTOR_SIZE); i++) {
-            FileIOResult fret;
-
-            if ((*state)->f->size + WIPER_SECTOR_STEP * WIPER_SECTOR_SIZE >=
-                (((uint64)2) << 30) /* 2 GB */) {
-               /* The file is going to be larger than what most filesystems
-                  can support. Create a new file */
-               (*state)->phase = WIPER_PHASE_CREATE;
-               break;
-            }
+         const char *fillError;
+         Bool full;
 
-            fret = FileIO_Write(&(*state)->f->fd, (*state)->buf,
-                                WIPER_SECTOR_STEP * WIPER_SECTOR_SIZE, NULL);
-
-            /*
-             * We distiguish errors from FilieIO_Write.
-             */
-            if (!FileIO_IsSuccess(fret)) {
-               /* The file is too big even though its size is less than 2GB */
-               if (fret == FILEIO_WRITE_ERROR_FBIG) {
-                  (*state)->phase = WIPER_PHASE_CREATE;
-
-                  break;
-               }
-
-               /*
-                * The disk is full (there may be other process is consuming space),
-                * or the user runs out of his disk quota.
-                */
-               if (fret == FILEIO_WRITE_ERROR_NOSPC) {
-                  WiperClean(*state);
-                  *state = NULL;
-                  *progress = 100;
-                  return "";
-               }
-
-               /* Otherwise, it is a real error */
-               WiperClean(*state);
-               *state = NULL;
-               return fret==FILEIO_WRITE_ERROR_DQUOT ? "User's disk quota exceeded" :
-                                                       "Unable to write to a wiper file";
-            }
+         /*
+          * The writers do the work; just give them time, so that we still
+          * return to the caller about 5 times a second.
+          */
+         Util_Usleep(WIPER_FILL_POLL_USECS);
+
+         pthread_mutex_lock(&(*state)->lock);
+         fillError = (*state)->fillError;
+         full = (*state)->full;
+         pthread_mutex_unlock(&(*state)->lock);
+
+         if (fillError != NULL) {
+            WiperClean(*state);
+            *state = NULL;
+            return (unsigned char *)fillError;
+         }
 
-            (*state)->f->size += WIPER_SECTOR_STEP * WIPER_SECTOR_SIZE;
+         if (full) {
+            WiperFinish(state);
+            *progress = 100;
+            return "";
+         }
+
+         error = WiperGetSpace(*state, &free, &total);
+         if (*error != '\0') {
+            WiperClean(*state);
+            *state = NULL;
+            return error;
+         }
+         if (free <= WIPER_FREE_MARGIN) {
+            WiperFinish(state);
+            *progress = 100;
+            return "";
          }
       }
       break;
@@ -0,0 +1,643 @@
+/*********************************************************
+ * Copyright (c) 2025 Broadcom. All Rights Reserved.
+ * The term "Broadcom" refers to Broadcom Inc. and/or its subsidiaries.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation version 2.1 and no later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the Lesser GNU General Public
+ * License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA.
+ *
+ *********************************************************/
+
+/**
+ * @file guestStoreClientCache.c
+ *
+ * Local content cache of GuestStore client library.
+ *
+ * Each cached content is a file in the caller provided cache directory,
+ * named by the SHA-1 hex digest of its content path. The file modification
+ * time is the time the content was downloaded.
+ *
+ * GuestStore does not provide content versions, modification times or
+ * digests; its response header only carries the content size. The cache
+ * therefore treats the content at a given path as immutable for the life
+ * of a cache entry: the request is still sent to GuestStore, and if the
+ * content size in the response header matches a cached content younger
+ * than the maximum age, the response body is not downloaded. A content
+ * replaced in place by one of the same size is only picked up once the
+ * cache entry expires, so the maximum age is capped at
+ * CACHE_ENTRY_MAX_AGE whatever the caller asks for.
+ *
+ * Since a cached content is trusted on its name and size alone, the cache
+ * directory must belong to the effective user and must not be writable by
+ * anyone else, and only regular files owned by the effective user are used
+ * as cache entries.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+#include "guestStoreClientLibInt.h"
+#include "sha1.h"
+
+/*
+ * Cache entry file name length: SHA-1 hex digest.
+ */
+#define CACHE_ENTRY_NAME_LEN  (2 * SHA1_HASH_LEN)
+
+/*
+ * Upper bound on the lifetime of a cache entry in seconds, see the file
+ * comment above.
+ */
+#define CACHE_ENTRY_MAX_AGE   (60 * 60)
+
+
+#ifndef _WIN32
+
+/*
+ * Cache entry details collected for eviction.
+ */
+typedef struct {
+   char *path;
+   int64 size;
+   time_t mtime;
+} CacheEntryInfo;
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * GuestStoreCacheIsOwnFile --
+ *
+ *      Check if a cache entry is a regular file (not a symlink) owned by the
+ *      effective user.
+ *
+ * Results:
+ *      TRUE if it is, FALSE otherwise.
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+GuestStoreCacheIsOwnFile(const struct stat *st)  // IN
+{
+   return S_ISREG(st->st_mode) && st->st_uid == geteuid();
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * GuestStoreCacheIsEntryName --
+ *
+ *      Check if a file name in the cache directory is a cache entry name.
+ *
+ * Results:
+ *      TRUE if it is, FALSE otherwise.
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+GuestStoreCacheIsEntryName(const char *name)  // IN
+{
+   int i;
+
+   for (i = 0; i < CACHE_ENTRY_NAME_LEN; i++) {
+      if (!((name[i] >= '0' && name[i] <= '9') ||
+            (name[i] >= 'a' && name[i] <= 'f'))) {
+         return FALSE;
+      }
+   }
+
+   return name[CACHE_ENTRY_NAME_LEN] == '\0';
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * GuestStoreCacheCompareEntries --
+ *
+ *      qsort comparator ordering cache entries from oldest to newest.
+ *
+ * Results:
+ *      <0, 0 or >0.
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static int
+GuestStoreCacheCompareEntries(const void *a,  // IN
+                              const void *b)  // IN
+{
+   const CacheEntryInfo *entryA = (const CacheEntryInfo *)a;
+   const CacheEntryInfo *entryB = (const CacheEntryInfo *)b;
+
+   if (entryA->mtime != entryB->mtime) {
+      return entryA->mtime < entryB->mtime ? -1 : 1;
+   }
+
+   return strcmp(entryA->path, entryB->path);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * GuestStoreCacheEvict --
+ *
+ *      Remove the oldest cache entries until the cache directory is within
+ *      the configured size limit. The cache entry of the current call is
+ *      kept.
+ *
+ * Results:
+ *      None
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+GuestStoreCacheEvict(CallCtx *ctx)  // IN
+{
+   DIR *dir;
+   struct dirent *dirEntry;
+   CacheEntryInfo *entries = NULL;
+   int numEntries = 0;
+   int maxEntries = 0;
+   int64 totalSize = 0;
+   int i;
+
+   if (ctx->cacheOptions->maxCacheSize <= 0) {
+      return;
+   }
+
+   dir = Posix_OpenDir(ctx->cacheOptions->cacheDir);
+   if (dir == NULL) {
+      LOG_WARN(ctx, "Posix_OpenDir failed: cacheDir='%s', error=%d.",
+               ctx->cacheOptions->cacheDir, errno);
+      return;
+   }
+
+   while ((dirEntry = readdir(dir)) != NULL) {
+      struct stat st;
+      char *path;
+
+      if (!GuestStoreCacheIsEntryName(dirEntry->d_name)) {
+         continue;
+      }
+
+      path = Str_SafeAsprintf(NULL, "%s/%s", ctx->cacheOptions->cacheDir,
+                              dirEntry->d_name);
+      if (Posix_Lstat(path, &st) != 0 || !GuestStoreCacheIsOwnFile(&st)) {
+         free(path);
+         continue;
+      }
+
+      if (numEntries == maxEntries) {
+         maxEntries = maxEntries == 0 ? 16 : 2 * maxEntries;
+         entries = Util_SafeRealloc(entries, maxEntries * sizeof *entries);
+      }
+
+      entries[numEntries].path = path;
+      entries[numEntries].size = st.st_size;
+      entries[numEntries].mtime = st.st_mtime;
+      numEntries++;
+      totalSize += st.st_size;
+   }
+
+   closedir(dir);
+
+   if (totalSize > ctx->cacheOptions->maxCacheSize) {
+      qsort(entries, numEntries, sizeof *entries,
+            GuestStoreCacheCompareEntries);
+
+      for (i = 0;
+           i < numEntries && totalSize > ctx->cacheOptions->maxCacheSize;
+           i++) {
+         if (strcmp(entries[i].path, ctx->cachePath) == 0) {
+            continue;
+         }
+
+         if (Posix_Unlink(entries[i].path) == 0) {
+            LOG_DEBUG(ctx, "Evicted cache entry '%s'.", entries[i].path);
+            totalSize -= entries[i].size;
+         } else if (errno != ENOENT) {
+            LOG_WARN(ctx, "Posix_Unlink failed: cachePath='%s', error=%d.",
+                     entries[i].path, errno);
+         }
+      }
+   }
+
+   for (i = 0; i < numEntries; i++) {
+      free(entries[i].path);
+   }
+   free(entries);
+}
+
+#endif
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * GuestStoreCacheInit --
+ *
+ *      Set up the cache entry path of the requested content if the caller
+ *      provided cache options, creating the cache directory if needed.
+ *
+ *      An existing cache directory is only used if it is a directory (not a
+ *      symlink) owned by the effective user and not writable by group or
+ *      others: anyone who can write to it could plant cache entries.
+ *
+ *      Cache errors are not fatal, the content is downloaded without the
+ *      cache instead.
+ *
+ * Results:
+ *      None
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+GuestStoreCacheInit(CallCtx *ctx)  // IN / OUT
+{
+#ifdef _WIN32
+   if (ctx->cacheOptions != NULL) {
+      LOG_WARN(ctx, "Content cache is not supported.");
+   }
+#else
+   const GuestStoreCacheOptions *options = ctx->cacheOptions;
+   struct stat st;
+   SHA1_CTX sha1Ctx;
+   unsigned char digest[SHA1_HASH_LEN];
+   char name[CACHE_ENTRY_NAME_LEN + 1];
+   int i;
+
+   ASSERT(ctx->cachePath == NULL);
+
+   if (options == NULL) {
+      return;
+   }
+
+   if (options->cacheDir == NULL || *options->cacheDir == '\0' ||
+       options->maxAge < 0 || options->maxCacheSize < 0) {
+      LOG_WARN(ctx, "Invalid cache options, not using the cache.");
+      return;
+   }
+
+   if (Posix_Mkdir(options->cacheDir, 0700) != 0 && errno != EEXIST) {
+      LOG_WARN(ctx, "Posix_Mkdir failed: cacheDir='%s', error=%d.",
+               options->cacheDir, errno);
+      return;
+   }
+
+   if (Posix_Lstat(options->cacheDir, &st) != 0) {
+      LOG_WARN(ctx, "Posix_Lstat failed: cacheDir='%s', error=%d.",
+               options->cacheDir, errno);
+      return;
+   }
+
+   if (!S_ISDIR(st.st_mode) || st.st_uid != geteuid() ||
+       (st.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+      LOG_WARN(ctx, "Cache directory '%s' is not a directory owned by uid %d "
+               "and writable only by it, not using the cache.",
+               options->cacheDir, (int)geteuid());
+      return;
+   }
+
+   SHA1Init(&sha1Ctx);
+   SHA1Update(&sha1Ctx, (const unsigned char *)ctx->contentPath,
+              strlen(ctx->contentPath));
+   SHA1Final(digest, &sha1Ctx);
+
+   for (i = 0; i < SHA1_HASH_LEN; i++) {
+      Str_Sprintf(name + 2 * i, sizeof name - 2 * i, "%02x", digest[i]);
+   }
+
+   ctx->cachePath = Str_SafeAsprintf(NULL, "%s/%s", options->cacheDir, name);
+   LOG_DEBUG(ctx, "Cache entry for '%s' is '%s'.",
+             ctx->contentPath, ctx->cachePath);
+#endif
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * GuestStoreCacheValidate --
+ *
+ *      Check if the cache entry of the requested content can be used, once
+ *      the content size has been received from GuestStore.
+ *
+ * Results:
+ *      TRUE if the cache entry is a regular file owned by the effective
+ *      user, younger than the maximum age (capped at CACHE_ENTRY_MAX_AGE)
+ *      and has the same size as the content, FALSE otherwise.
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+Bool
+GuestStoreCacheValidate(CallCtx *ctx)  // IN
+{
+#ifdef _WIN32
+   return FALSE;
+#else
+   struct stat st;
+   time_t now;
+   int32 maxAge;
+
+   if (ctx->cachePath == NULL) {
+      return FALSE;
+   }
+
+   if (Posix_Lstat(ctx->cachePath, &st) != 0) {
+      if (errno != ENOENT) {
+         LOG_WARN(ctx, "Posix_Lstat failed: cachePath='%s', error=%d.",
+                  ctx->cachePath, errno);
+      }
+      return FALSE;
+   }
+
+   if (!GuestStoreCacheIsOwnFile(&st)) {
+      LOG_WARN(ctx, "Cache entry '%s' is not a regular file owned by uid %d, "
+               "ignoring it.", ctx->cachePath, (int)geteuid());
+      return FALSE;
+   }
+
+   now = time(NULL);
+   maxAge = MIN(ctx->cacheOptions->maxAge, CACHE_ENTRY_MAX_AGE);
+
+   if (st.st_size != ctx->contentSize ||
+       st.st_mtime > now ||
+       now - st.st_mtime > maxAge) {
+      LOG_DEBUG(ctx, "Cache entry '%s' is stale.", ctx->cachePath);
+      return FALSE;
+   }
+
+   LOG_INFO(ctx, "Using cache entry '%s' for '%s'.",
+            ctx->cachePath, ctx->contentPath);
+   return TRUE;
+#endif
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * GuestStoreCacheCopyToOutput --
+ *
+ *      Create the output file from the validated cache entry.
+ *
+ * Results:
+ *      GSLIBERR_SUCCESS or an error code of GSLIBERR_*.
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+GuestStoreLibError
+GuestStoreCacheCopyToOutput(CallCtx *ctx)  // IN / OUT
+{
+   GuestStoreLibError retVal;
+   FILE *input;
+
+   ASSERT(ctx->cachePath != NULL);
+   ASSERT(ctx->cacheHit);
+
+   input = Posix_Fopen(ctx->cachePath, "rb");
+   if (input == NULL) {
+      LOG_ERR(ctx, "Posix_Fopen failed: cachePath='%s', error=%d.",
+              ctx->cachePath, errno);
+      return GSLIBERR_GENERIC;
+   }
+
+   retVal = GuestStoreCreateOutputFile(ctx);
+   if (retVal != GSLIBERR_SUCCESS) {
+      goto exit;
+   }
+
+   while (ctx->contentBytesReceived < ctx->contentSize) {
+      size_t bytesRead = fread(ctx->buf, sizeof(char), ctx->bufSize, input);
+
+      if (bytesRead == 0) {
+         LOG_ERR(ctx, "fread failed: cachePath='%s', error=%d.",
+                 ctx->cachePath, errno);
+         retVal = GSLIBERR_GENERIC;
+         break;
+      }
+
+      ctx->contentBytesReceived += bytesRead;
+      if (ctx->contentBytesReceived > ctx->contentSize) {
+         LOG_ERR(ctx, "Cache entry '%s' changed while reading.",
+                 ctx->cachePath);
+         retVal = GSLIBERR_GENERIC;
+         break;
+      }
+
+      if (fwrite(ctx->buf, sizeof(char), bytesRead, ctx->output) != bytesRead) {
+         LOG_ERR(ctx, "fwrite failed: error=%d.", errno);
+         retVal = GSLIBERR_WRITE_OUTPUT_FILE;
+         break;
+      }
+
+      if (!REPORT_PROGRESS(ctx)) {
+         LOG_ERR(ctx, "Request cancelled.");
+         retVal = GSLIBERR_CANCELLED;
+         break;
+      }
+   }
+
+exit:
+   fclose(input);
+   return retVal;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * GuestStoreCacheBeginStore --
+ *
+ *      Create a temporary cache entry to save the content being downloaded.
+ *
+ * Results:
+ *      None
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+GuestStoreCacheBeginStore(CallCtx *ctx)  // IN / OUT
+{
+#ifndef _WIN32
+   int fd;
+
+   if (ctx->cachePath == NULL) {
+      return;
+   }
+
+   ASSERT(ctx->cacheOutput == NULL);
+
+   if (ctx->cacheOptions->maxCacheSize > 0 &&
+       ctx->contentSize > ctx->cacheOptions->maxCacheSize) {
+      LOG_DEBUG(ctx, "Content is larger than the cache size limit.");
+      return;
+   }
+
+   ctx->cacheTmpPath = Str_SafeAsprintf(NULL, "%s.XXXXXX", ctx->cachePath);
+   fd = mkstemp(ctx->cacheTmpPath);
+   if (fd < 0) {
+      LOG_WARN(ctx, "mkstemp failed: cachePath='%s', error=%d.",
+               ctx->cacheTmpPath, errno);
+      goto error;
+   }
+
+   ctx->cacheOutput = fdopen(fd, "wb");
+   if (ctx->cacheOutput == NULL) {
+      LOG_WARN(ctx, "fdopen failed: cachePath='%s', error=%d.",
+               ctx->cacheTmpPath, errno);
+      close(fd);
+      Posix_Unlink(ctx->cacheTmpPath);
+      goto error;
+   }
+
+   return;
+
+error:
+   free(ctx->cacheTmpPath);
+   ctx->cacheTmpPath = NULL;
+#endif
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * GuestStoreCacheWrite --
+ *
+ *      Save downloaded content bytes to the temporary cache entry.
+ *
+ *      On error, the temporary cache entry is discarded and the download
+ *      continues without the cache.
+ *
+ * Results:
+ *      None
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+GuestStoreCacheWrite(CallCtx *ctx,     // IN / OUT
+                     const char *buf,  // IN
+                     int len)          // IN
+{
+   if (ctx->cacheOutput == NULL) {
+      return;
+   }
+
+   if (fwrite(buf, sizeof(char), len, ctx->cacheOutput) != len) {
+      LOG_WARN(ctx, "fwrite failed: cachePath='%s', error=%d.",
+               ctx->cacheTmpPath, errno);
+      GuestStoreCacheEndStore(ctx, FALSE);
+   }
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * GuestStoreCacheEndStore --
+ *
+ *      Finish the temporary cache entry. If the content has been fully
+ *      downloaded, the temporary cache entry replaces the cache entry and
+ *      the cache directory is trimmed to its size limit. Otherwise, the
+ *      temporary cache entry is removed.
+ *
+ * Results:
+ *      None
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+void
+GuestStoreCacheEndStore(CallCtx *ctx,  // IN / OUT
+                        Bool commit)   // IN
+{
+#ifndef _WIN32
+   if (ctx->cacheOutput == NULL) {
+      return;
+   }
+
+   if (fclose(ctx->cacheOutput) != 0) {
+      LOG_WARN(ctx, "fclose failed: cachePath='%s', error=%d.",
+               ctx->cacheTmpPath, errno);
+      commit = FALSE;
+   }
+   ctx->cacheOutput = NULL;
+
+   if (commit && ctx->contentBytesReceived == ctx->contentSize) {
+      if (Posix_Rename(ctx->cacheTmpPath, ctx->cachePath) == 0) {
+         LOG_DEBUG(ctx, "Saved cache entry '%s'.", ctx->cachePath);
+         GuestStoreCacheEvict(ctx);
+      } else {
+         LOG_WARN(ctx, "Posix_Rename failed: cachePath='%s', error=%d.",
+                  ctx->cachePath, errno);
+         Posix_Unlink(ctx->cacheTmpPath);
+      }
+   } else {
+      Posix_Unlink(ctx->cacheTmpPath);
+   }
+
+   free(ctx->cacheTmpPath);
+   ctx->cacheTmpPath = NULL;
+#endif
+}
@@ -346,6 +346,46 @@ GuestStoreLog(CallCtx *ctx,                 // IN
 }
 
 
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * GuestStoreCloseSocket --
+ *
+ *      Close the socket connecting to vmtoolsd GuestStore plugin.
+ *
+ * Results:
+ *      None
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+GuestStoreCloseSocket(CallCtx *ctx)  // IN / OUT
+{
+   int res;
+
+   if (ctx->sd == INVALID_SOCKET) {
+      return;
+   }
+
+#ifdef _WIN32
+   res = closesocket(ctx->sd);
+#else
+   res = close(ctx->sd);
+#endif
+
+   if (res == SOCKET_ERROR) {
+      LOG_ERR(ctx, "close failed on socket %d: error=%d.",
+              ctx->sd, SocketGetLastError());
+   }
+
+   ctx->sd = INVALID_SOCKET;
+}
+
+
 /*
  *-----------------------------------------------------------------------------
  *
@@ -388,20 +428,11 @@ GuestStoreFreeCtxResources(CallCtx *ctx)  // IN / OUT
       }
    }
 
-   if (ctx->sd != INVALID_SOCKET) {
-#ifdef _WIN32
-      res = closesocket(ctx->sd);
-#else
-      res = close(ctx->sd);
-#endif
+   GuestStoreCloseSocket(ctx);
 
-      if (res == SOCKET_ERROR) {
-         LOG_ERR(ctx, "close failed on socket %d: error=%d.",
-                 ctx->sd, SocketGetLastError());
-      }
-
-      ctx->sd = INVALID_SOCKET;
-   }
+   GuestStoreCacheEndStore(ctx, FALSE);
+   free(ctx->cachePath);
+   ctx->cachePath = NULL;
 
    free(ctx->buf);
    ctx->buf = NULL;
@@ -426,7 +457,7 @@ GuestStoreFreeCtxResources(CallCtx *ctx)  // IN / OUT
  *-----------------------------------------------------------------------------
  */
 
-static GuestStoreLibError
+GuestStoreLibError
 GuestStoreCreateOutputFile(CallCtx *ctx)  // IN / OUT
 {
    FILE *output = Posix_Fopen(ctx->outputPath, "wb");
@@ -794,6 +825,14 @@ GuestStoreRecvHTTPResponseHeader(CallCtx *ctx)  // IN
       return GSLIBERR_SERVER;
    }
 
+   /*
+    * A valid cached copy makes the response body unnecessary.
+    */
+   if (GuestStoreCacheValidate(ctx)) {
+      ctx->cacheHit = TRUE;
+      return GSLIBERR_SUCCESS;
+   }
+
    /*
     * We've got content to save, create the output file now.
     */
@@ -802,6 +841,8 @@ GuestStoreRecvHTTPResponseHeader(CallCtx *ctx)  // IN
       return retVal;
    }
 
+   GuestStoreCacheBeginStore(ctx);
+
    /*
     * Save content bytes that follow HTTP response header.
     */
@@ -821,6 +862,8 @@ GuestStoreRecvHTTPResponseHeader(CallCtx *ctx)  // IN
          return GSLIBERR_WRITE_OUTPUT_FILE;
       }
 
+      GuestStoreCacheWrite(ctx, content, contentLen);
+
       if (!REPORT_PROGRESS(ctx)) {
          LOG_ERR(ctx, "Request cancelled.");
          return GSLIBERR_CANCELLED;
@@ -874,6 +917,8 @@ GuestStoreRecvHTTPResponseBody(CallCtx *ctx)  // IN
          break;
       }
 
+      GuestStoreCacheWrite(ctx, ctx->buf, bytesReceived);
+
       if (!REPORT_PROGRESS(ctx)) {
          LOG_ERR(ctx, "Request cancelled.");
          retVal = GSLIBERR_CANCELLED;
@@ -909,6 +954,38 @@ GuestStore_GetContent(
    GuestStore_Panic panic,                      // IN, OPTIONAL
    GuestStore_GetContentCallback getContentCb,  // IN, OPTIONAL
    void *clientData)                            // IN, OPTIONAL
+{
+   return GuestStore_GetContentEx(contentPath, outputPath, NULL,
+                                  logger, panic, getContentCb, clientData);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * GuestStore_GetContentEx --
+ *
+ *      GuestStore client library GetContent entry point function with
+ *      a local content cache.
+ *
+ * Results:
+ *      GSLIBERR_SUCCESS or an error code of GSLIBERR_*.
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+GuestStoreLibError
+GuestStore_GetContentEx(
+   const char *contentPath,                     // IN
+   const char *outputPath,                      // IN
+   const GuestStoreCacheOptions *cacheOptions,  // IN, OPTIONAL
+   GuestStore_Logger logger,                    // IN, OPTIONAL
+   GuestStore_Panic panic,                      // IN, OPTIONAL
+   GuestStore_GetContentCallback getContentCb,  // IN, OPTIONAL
+   void *clientData)                            // IN, OPTIONAL
 {
    GuestStoreLibError retVal;
    CallCtx ctx = { 0 };
@@ -926,6 +1003,7 @@ GuestStore_GetContent(
    ctx.panic = panic;
    ctx.getContentCb = getContentCb;
    ctx.clientData = clientData;
+   ctx.cacheOptions = cacheOptions;
    ctx.sd = INVALID_SOCKET;
 
    if (contentPath == NULL || *contentPath != '/' ||
@@ -960,6 +1038,8 @@ GuestStore_GetContent(
    }
 #endif
 
+   GuestStoreCacheInit(&ctx);
+
    retVal = GuestStoreConnect(&ctx);
    if (retVal != GSLIBERR_SUCCESS) {
       goto exit;
@@ -978,7 +1058,16 @@ GuestStore_GetContent(
       goto exit;
    }
 
-   retVal = GuestStoreRecvHTTPResponseBody(&ctx);
+   if (ctx.cacheHit) {
+      /*
+       * Closing the connection makes the plugin stop the VMX transfer.
+       */
+      GuestStoreCloseSocket(&ctx);
+      retVal = GuestStoreCacheCopyToOutput(&ctx);
+   } else {
+      retVal = GuestStoreRecvHTTPResponseBody(&ctx);
+      GuestStoreCacheEndStore(&ctx, retVal == GSLIBERR_SUCCESS);
+   }
 
 exit:
 
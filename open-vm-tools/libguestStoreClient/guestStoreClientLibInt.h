@@ -87,6 +87,11 @@ typedef struct _CallCtx {
    int64 contentBytesReceived;  // Received content bytes
    int bufSize;  // Content download buffer size
    char *buf;  // Content download buffer
+   const GuestStoreCacheOptions *cacheOptions;  // Caller provided options
+   char *cachePath;  // Cache entry path, NULL if the cache is not used
+   char *cacheTmpPath;  // Temporary cache entry path being written
+   FILE *cacheOutput;  // Temporary cache entry file stream
+   Bool cacheHit;  // Output file is to be copied from the cache entry
    Err_Number errNum;  // Preserve the last error
 #ifdef _WIN32
    int winErrNum;
@@ -191,6 +196,30 @@ GuestStoreLog(CallCtx *ctx,                 // IN
 GuestStoreLibError
 GuestStoreConnect(CallCtx *ctx);  // IN / OUT
 
+GuestStoreLibError
+GuestStoreCreateOutputFile(CallCtx *ctx);  // IN / OUT
+
+void
+GuestStoreCacheInit(CallCtx *ctx);  // IN / OUT
+
+Bool
+GuestStoreCacheValidate(CallCtx *ctx);  // IN
+
+GuestStoreLibError
+GuestStoreCacheCopyToOutput(CallCtx *ctx);  // IN / OUT
+
+void
+GuestStoreCacheBeginStore(CallCtx *ctx);  // IN / OUT
+
+void
+GuestStoreCacheWrite(CallCtx *ctx,     // IN / OUT
+                     const char *buf,  // IN
+                     int len);         // IN
+
+void
+GuestStoreCacheEndStore(CallCtx *ctx,  // IN / OUT
+                        Bool commit);  // IN
+
 #ifdef __cplusplus
 }
 #endif
@@ -407,6 +407,127 @@ exit:
 }
 
 
+/**
+ * Records a changed key (or, if key is NULL, just the group) in a change set
+ * built by VMTools_DiffConfig().
+ *
+ * @param[in]  changes  Change set.
+ * @param[in]  group    Group name.
+ * @param[in]  key      Key name, may be NULL.
+ */
+
+static void
+VMToolsConfigMarkChanged(GHashTable *changes,
+                         const gchar *group,
+                         const gchar *key)
+{
+   GHashTable *keys = g_hash_table_lookup(changes, group);
+
+   if (keys == NULL) {
+      keys = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+      g_hash_table_insert(changes, g_strdup(group), keys);
+   }
+
+   if (key != NULL && g_hash_table_lookup(keys, key) == NULL) {
+      gchar *name = g_strdup(key);
+
+      g_hash_table_insert(keys, name, name);
+   }
+}
+
+
+/**
+ * Adds to the change set every key of every group in config1 that is either
+ * missing from config2 or has a different value there. Groups that only exist
+ * in config1 are recorded even if they have no keys.
+ *
+ * @param[in]  config1  Config dictionary to walk.
+ * @param[in]  config2  Config dictionary to compare against (may be NULL).
+ * @param[in]  changes  Change set.
+ */
+
+static void
+VMToolsConfigDiffOneWay(GKeyFile *config1,
+                        GKeyFile *config2,
+                        GHashTable *changes)
+{
+   gsize numGroups = 0;
+   gchar **groupNames = g_key_file_get_groups(config1, &numGroups);
+   gsize i;
+
+   for (i = 0; i < numGroups; ++i) {
+      const gchar *group = groupNames[i];
+      gchar **keyNames;
+      gsize numKeys = 0;
+      gsize j;
+
+      if (config2 == NULL || !g_key_file_has_group(config2, group)) {
+         VMToolsConfigMarkChanged(changes, group, NULL);
+      }
+
+      keyNames = g_key_file_get_keys(config1, group, &numKeys, NULL);
+      for (j = 0; j < numKeys; ++j) {
+         const gchar *key = keyNames[j];
+         gchar *value1 = g_key_file_get_value(config1, group, key, NULL);
+         gchar *value2 = NULL;
+
+         if (config2 != NULL) {
+            value2 = g_key_file_get_value(config2, group, key, NULL);
+         }
+
+         if (value2 == NULL || g_strcmp0(value1, value2) != 0) {
+            g_debug("%s: (%s:%s) changed.\n", __FUNCTION__, group, key);
+            VMToolsConfigMarkChanged(changes, group, key);
+         }
+
+         g_free(value1);
+         g_free(value2);
+      }
+      g_strfreev(keyNames);
+   }
+
+   g_strfreev(groupNames);
+}
+
+
+/**
+ * Computes the set of groups and keys that differ between two configuration
+ * dictionaries. A key is part of the set if it was added, removed or had its
+ * value changed; a group is part of the set if any of its keys is, or if the
+ * group itself was added or removed.
+ *
+ * The result maps group names to a GHashTable whose keys are the changed key
+ * names (the value of each entry is the key name itself). Use
+ * g_hash_table_lookup() on both levels to test membership.
+ *
+ * @param[in]  oldConfig   Previous configuration dictionary (may be NULL).
+ * @param[in]  newConfig   New configuration dictionary (may be NULL).
+ *
+ * @return The change set, empty if both dictionaries are identical. Should be
+ *         freed with g_hash_table_unref().
+ */
+
+GHashTable *
+VMTools_DiffConfig(GKeyFile *oldConfig,
+                   GKeyFile *newConfig)
+{
+   GHashTable *changes = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                               g_free,
+                                               (GDestroyNotify) g_hash_table_unref);
+
+   if (oldConfig != NULL) {
+      VMToolsConfigDiffOneWay(oldConfig, newConfig, changes);
+   }
+   if (newConfig != NULL) {
+      VMToolsConfigDiffOneWay(newConfig, oldConfig, changes);
+   }
+
+   g_debug("%s: %u groups changed.\n", __FUNCTION__,
+           g_hash_table_size(changes));
+   return changes;
+}
+
+
 /**
  * Saves the given config data to the given path.
  *
@@ -87,6 +87,12 @@ VM_EMBED_VERSION(VMTOOLSD_VERSION_STRING);
  */
 #define APP_INFO_CONF_USE_WMI_DEFAULT_VALUE    FALSE
 
+/**
+ * Interval (in seconds) after which the application information is
+ * published even if it has not changed since the last update.
+ */
+#define APP_INFO_FORCE_REFRESH_INTERVAL (24 * 60 * 60)
+
 /**
  * Defines the current poll interval (in seconds).
  *
@@ -104,9 +110,90 @@ static gboolean gAppInfoEnabledInHost = TRUE;
  */
 static GSource *gAppInfoTimeoutSource = NULL;
 
+/**
+ * Checksum of the application list last published to the VMX and the
+ * monotonic time (in seconds) it was published at. Protected by
+ * gAppInfoDigestLock since the gather task runs in the thread pool.
+ */
+static gchar *gAppInfoLastDigest = NULL;
+static gint64 gAppInfoLastPublishTime = 0;
+G_LOCK_DEFINE_STATIC(gAppInfoDigestLock);
+
 static void TweakGatherLoop(ToolsAppCtx *ctx, gboolean force);
 
 
+/*
+ *****************************************************************************
+ * AppInfoResetDigest --
+ *
+ * Forgets the checksum of the last published application list, so that the
+ * next gather publishes unconditionally.
+ *
+ *****************************************************************************
+ */
+
+static void
+AppInfoResetDigest(void)
+{
+   G_LOCK(gAppInfoDigestLock);
+   g_free(gAppInfoLastDigest);
+   gAppInfoLastDigest = NULL;
+   G_UNLOCK(gAppInfoDigestLock);
+}
+
+
+/*
+ *****************************************************************************
+ * AppInfoCheckDigest --
+ *
+ * Checks whether the application list needs to be published. An unchanged
+ * list is republished once APP_INFO_FORCE_REFRESH_INTERVAL has elapsed.
+ *
+ * @param[in] digest    Checksum of the application list.
+ *
+ * @retval TRUE  The application list should be published.
+ * @retval FALSE The application list is unchanged.
+ *
+ *****************************************************************************
+ */
+
+static gboolean
+AppInfoCheckDigest(const gchar *digest)     // IN
+{
+   gboolean changed;
+   gint64 now = g_get_monotonic_time() / G_USEC_PER_SEC;
+
+   G_LOCK(gAppInfoDigestLock);
+   changed = g_strcmp0(gAppInfoLastDigest, digest) != 0 ||
+             now - gAppInfoLastPublishTime >= APP_INFO_FORCE_REFRESH_INTERVAL;
+   G_UNLOCK(gAppInfoDigestLock);
+
+   return changed;
+}
+
+
+/*
+ *****************************************************************************
+ * AppInfoSaveDigest --
+ *
+ * Records the checksum of the application list that was just published.
+ *
+ * @param[in] digest    Checksum of the application list.
+ *
+ *****************************************************************************
+ */
+
+static void
+AppInfoSaveDigest(const gchar *digest)      // IN
+{
+   G_LOCK(gAppInfoDigestLock);
+   g_free(gAppInfoLastDigest);
+   gAppInfoLastDigest = g_strdup(digest);
+   gAppInfoLastPublishTime = g_get_monotonic_time() / G_USEC_PER_SEC;
+   G_UNLOCK(gAppInfoDigestLock);
+}
+
+
 /*
  *****************************************************************************
  * SetGuestInfo --
@@ -230,6 +317,8 @@ AppInfo_GetAppList(GKeyFile *config)     // IN
  * AppInfoGatherTask --
  *
  * Collects all the desired application related information and updates VMX.
+ * The update is skipped if the list of applications has not changed since
+ * the last update.
  *
  * @param[in]  ctx     The application context.
  * @param[in]  data    Unused
@@ -253,6 +342,8 @@ AppInfoGatherTask(ToolsAppCtx *ctx,    // IN
    uint64 counter = (uint64) Atomic_ReadInc64(&updateCounter) + 1;
    GHashTable *appsAdded = NULL;
    gchar *key = NULL;
+   gchar *digest = NULL;
+   size_t headerLen;
 
    static char headerFmt[] = "{\n"
                      "\"" APP_INFO_KEY_VERSION        "\":\"%d\", \n"
@@ -288,6 +379,7 @@ AppInfoGatherTask(ToolsAppCtx *ctx,    // IN
    }
 
    DynBuf_Append(&dynBuffer, tmpBuf, len);
+   headerLen = DynBuf_GetSize(&dynBuffer);
 
    appList = AppInfo_SortAppList(AppInfo_GetAppList(ctx->config));
    if (removeDup) {
@@ -369,7 +461,22 @@ next_entry:
    }
 
    DynBuf_Append(&dynBuffer, jsonSuffix, sizeof jsonSuffix - 1);
-   SetGuestInfo(ctx, APP_INFO_GUESTVAR_KEY, DynBuf_GetString(&dynBuffer));
+
+   /*
+    * The header carries the update counter and publish time, which change
+    * every time. Only the application list decides whether to publish.
+    */
+   digest = g_compute_checksum_for_data(G_CHECKSUM_SHA256,
+                                        (const guchar *)
+                                           DynBuf_Get(&dynBuffer) + headerLen,
+                                        DynBuf_GetSize(&dynBuffer) - headerLen);
+   if (!AppInfoCheckDigest(digest)) {
+      g_debug("%s: Application list not changed, skipping the update.\n",
+              __FUNCTION__);
+   } else if (SetGuestInfo(ctx, APP_INFO_GUESTVAR_KEY,
+                           DynBuf_GetString(&dynBuffer))) {
+      AppInfoSaveDigest(digest);
+   }
 
 quit:
    free(escapedCmd);
@@ -380,6 +487,7 @@ quit:
    }
    g_free(key);
    g_free(tstamp);
+   g_free(digest);
    DynBuf_Destroy(&dynBuffer);
 }
 
@@ -463,6 +571,7 @@ TweakGatherLoopEx(ToolsAppCtx *ctx,       // IN
       g_info("%s: Poll loop for %s deactivated.\n",
              __FUNCTION__, CONFNAME_APPINFO_POLLINTERVAL);
       SetGuestInfo(ctx, APP_INFO_GUESTVAR_KEY, "");
+      AppInfoResetDigest();
    }
 
    gAppInfoPollInterval = pollInterval;
@@ -542,6 +651,10 @@ AppInfoServerConfReload(gpointer src,       // IN
                         ToolsAppCtx *ctx,   // IN
                         gpointer data)      // IN
 {
+   if (!ToolsCore_ConfigGroupChanged(ctx, CONFGROUPNAME_APPINFO)) {
+      return;
+   }
+
    g_info("%s: Reloading the tools configuration.\n", __FUNCTION__);
 
    TweakGatherLoop(ctx, FALSE);
@@ -572,6 +685,7 @@ AppInfoServerShutdown(gpointer src,          // IN
    }
 
    SetGuestInfo(ctx, APP_INFO_GUESTVAR_KEY, "");
+   AppInfoResetDigest();
 }
 
 
@@ -633,7 +747,8 @@ AppInfoServerSetOption(gpointer src,         // IN
  * AppInfoServerReset --
  *
  * Callback function that gets called whenever the RPC channel gets reset.
- * Disables the poll loop and sets a one time poll.
+ * Disables the poll loop and sets a one time poll. The next poll always
+ * publishes, since the VM may now be running on a different host.
  *
  * @param[in]  src      The source object.
  * @param[in]  ctx      Application context.
@@ -647,6 +762,8 @@ AppInfoServerReset(gpointer src,
                    ToolsAppCtx *ctx,
                    gpointer data)
 {
+   AppInfoResetDigest();
+
    /*
     * gAppInfoTimeoutSource is used to figure out if the poll loop is
     * enabled or not. If the poll loop is deactivated, then
@@ -302,6 +302,10 @@ ComponentMgrServerConfReload(gpointer src,     // IN
                              ToolsAppCtx *ctx, // IN
                              gpointer data)    // IN
 {
+   if (!ToolsCore_ConfigGroupChanged(ctx, COMPONENTMGR_CONF_GROUPNAME)) {
+      return;
+   }
+
    ComponentMgrPollLoop(ctx);
 }
 
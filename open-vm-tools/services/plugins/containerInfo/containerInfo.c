@@ -100,6 +100,18 @@ VM_EMBED_VERSION(VMTOOLSD_VERSION_STRING);
  */
 #define CONTAINERINFO_MAX_GUESTINFO_PACKET_SIZE (63 * 1024)
 
+/**
+ * Default value for CONFNAME_CONTAINERINFO_EVENT_DRIVEN setting in
+ * tools configuration file.
+ */
+#define CONTAINERINFO_DEFAULT_EVENT_DRIVEN FALSE
+
+/**
+ * Time (in seconds) to wait before subscribing to the containerd events
+ * again after the subscription failed.
+ */
+#define CONTAINERINFO_EVENTS_RETRY_INTERVAL 60
+
 /**
  * Defines current containerinfo poll interval (in seconds).
  *
@@ -125,6 +137,36 @@ static gboolean gAppInfoEnabledInHost = TRUE;
  */
 static Atomic_Bool gTaskSubmitted = { FALSE }; // Task has not been submitted.
 
+/**
+ * Whether the container information is also updated upon containerd events.
+ * Controlled by containerinfo.event-driven config file option, read once at
+ * load time.
+ */
+static gboolean gEventDriven = FALSE;
+
+/**
+ * State shared between the containerd events thread and the gather task.
+ * The config values are copied from the config file on the main thread,
+ * since the config may be replaced there when it is reloaded.
+ */
+static struct {
+   GMutex lock;
+   GCond cond;
+   gboolean stopped;
+   GHashTable *dirtyNamespaces; // Namespaces with events since last gather.
+   gchar *containerdSocketPath;
+   gchar **allowedNamespaces;
+} gEventState;
+
+/**
+ * In event-driven mode, the container list of every namespace from the
+ * last gather, so that only the namespaces with events are queried again.
+ * Also the checksum of the last published container information. Only
+ * accessed by the gather task.
+ */
+static GHashTable *gContainerCache = NULL;
+static gchar *gLastPublishedDigest = NULL;
+
 static void TweakGatherLoop(ToolsAppCtx *ctx, gboolean force);
 
 
@@ -138,10 +180,13 @@ static void TweakGatherLoop(ToolsAppCtx *ctx, gboolean force);
  * @param[in] key       Key sent to the VMX
  * @param[in] value     GuestInfo data sent to the VMX
  *
+ * @retval TRUE  RPCI succeeded.
+ * @retval FALSE RPCI failed.
+ *
  *****************************************************************************
  */
 
-static void
+static gboolean
 SetGuestInfo(ToolsAppCtx *ctx,                // IN
              const char *guestVariableName,   // IN
              const char *value)               // IN
@@ -149,6 +194,7 @@ SetGuestInfo(ToolsAppCtx *ctx,                // IN
    char *reply = NULL;
    gchar *msg;
    size_t replyLen;
+   gboolean status;
 
    ASSERT(guestVariableName != NULL);
    ASSERT(value != NULL);
@@ -157,11 +203,12 @@ SetGuestInfo(ToolsAppCtx *ctx,                // IN
                          guestVariableName,
                          value);
 
-   if (!RpcChannel_Send(ctx->rpc,
-                        msg,
-                        strlen(msg) + 1,
-                        &reply,
-                        &replyLen)) {
+   status = RpcChannel_Send(ctx->rpc,
+                            msg,
+                            strlen(msg) + 1,
+                            &reply,
+                            &replyLen);
+   if (!status) {
       g_warning("%s: Error sending RPC message: %s\n", __FUNCTION__,
                 VM_SAFE_STR(reply));
    } else {
@@ -171,7 +218,7 @@ SetGuestInfo(ToolsAppCtx *ctx,                // IN
 
    g_free(msg);
    vm_free(reply);
-   return;
+   return status;
 }
 
 
@@ -272,6 +319,60 @@ ContainerInfo_DestroyContainerList(GSList *containerList)
 }
 
 
+/*
+ *****************************************************************************
+ * ContainerInfoResolveImages --
+ *
+ * The image name may not be set for containers managed by docker. For such
+ * containers, fills in the image name using Docker APIs.
+ *
+ * @param[in]  ns                The name of the namespace
+ * @param[in]  containerList     The list of the running containers
+ * @param[in]  dockerSocketPath  The path to the unix socket used by docker.
+ *
+ *****************************************************************************
+ */
+
+static void
+ContainerInfoResolveImages(const char *ns,                 // IN
+                           GSList *containerList,          // IN/OUT
+                           const char *dockerSocketPath)   // IN
+{
+   GHashTable *dockerContainerTable = NULL;
+   GSList *info;
+
+   if (strcmp(ns, CONTAINERINFO_DOCKER_NAMESPACE_NAME) != 0) {
+      return;
+   }
+
+   for (info = containerList; info != NULL; info = info->next) {
+      ContainerInfo *node = (ContainerInfo *) info->data;
+
+      if (node->image == NULL || node->image[0] == '\0') {
+         const char *newImage;
+
+         if (dockerContainerTable == NULL) {
+            dockerContainerTable =
+               ContainerInfo_GetDockerContainers(dockerSocketPath);
+            if (dockerContainerTable == NULL) {
+               break;
+            }
+         }
+
+         newImage = g_hash_table_lookup(dockerContainerTable, node->id);
+         if (newImage != NULL) {
+            g_free(node->image);
+            node->image = g_strdup(newImage);
+         }
+      }
+   }
+
+   if (dockerContainerTable != NULL) {
+      g_hash_table_destroy(dockerContainerTable);
+   }
+}
+
+
 /*
  *****************************************************************************
  * ContainerInfoGetNsJson --
@@ -281,7 +382,6 @@ ContainerInfo_DestroyContainerList(GSList *containerList)
  *
  * @param[in]  ns                The name of the namespace
  * @param[in]  containerList     The list of the running containers
- * @param[in]  dockerSocketPath  The path to the unix socket used by docker.
  * @param[in]  removeDuplicates  Remove duplicate containers from the output.
  * @param[in]  maxSize           Maximum size of the JSON output
  * @param[out] resultJson        JSON string that is prepared.
@@ -294,7 +394,6 @@ ContainerInfo_DestroyContainerList(GSList *containerList)
 size_t
 ContainerInfoGetNsJson(const char *ns,                 // IN
                        GSList *containerList,          // IN
-                       const char *dockerSocketPath,   // IN
                        gboolean removeDuplicates,      // IN
                        unsigned int maxSize,           // IN
                        char **resultJson)              // OUT
@@ -306,7 +405,6 @@ ContainerInfoGetNsJson(const char *ns,                 // IN
    gboolean nodeAdded;
    DynBuf dynBuffer;
    size_t resultSize = 0;
-   GHashTable *dockerContainerTable = NULL;
    GHashTable *imagesAdded = NULL;
    gchar *escapedImageName = NULL;
 
@@ -317,15 +415,6 @@ ContainerInfoGetNsJson(const char *ns,                 // IN
 
    nodeAdded = FALSE;
 
-   /*
-    * The image name may not be set for containers managed by docker.
-    * To handle such cases, get the list of containers using Docker APIs.
-    */
-   if (strcmp(ns, CONTAINERINFO_DOCKER_NAMESPACE_NAME) == 0) {
-      dockerContainerTable =
-         ContainerInfo_GetDockerContainers(dockerSocketPath);
-   }
-
    if (removeDuplicates) {
       imagesAdded = g_hash_table_new_full(g_str_hash, g_str_equal,
                                           g_free, NULL);
@@ -344,26 +433,16 @@ ContainerInfoGetNsJson(const char *ns,                 // IN
       escapedImageName = NULL;
 
       if (node->image == NULL || node->image[0] == '\0') {
-         const char *newImage = NULL;
-
-         if (dockerContainerTable != NULL) {
-            newImage = g_hash_table_lookup(dockerContainerTable, node->id);
-         }
+         g_warning("%s: Skipping '%s' since image name couldn't "
+                   "be retrieved.\n", __FUNCTION__, node->id);
+         continue;
+      }
 
-         if (newImage != NULL) {
-            escapedImageName = g_strdup(newImage);
-         } else {
-            g_warning("%s: Skipping '%s' since image name couldn't "
-                      "be retrieved.\n", __FUNCTION__, node->id);
-            continue;
-         }
-      } else {
-         escapedImageName = CodeSet_JsonEscape(node->image);
-         if (NULL == escapedImageName) {
-            g_warning("%s: Failed to escape the image. Skipping '%s'\n",
-                      __FUNCTION__, node->id);
-            continue;
-         }
+      escapedImageName = CodeSet_JsonEscape(node->image);
+      if (NULL == escapedImageName) {
+         g_warning("%s: Failed to escape the image. Skipping '%s'\n",
+                   __FUNCTION__, node->id);
+         continue;
       }
 
       if (removeDuplicates) {
@@ -413,23 +492,74 @@ ContainerInfoGetNsJson(const char *ns,                 // IN
       g_hash_table_destroy(imagesAdded);
    }
 
-   if (dockerContainerTable != NULL) {
-      g_hash_table_destroy(dockerContainerTable);
-   }
-
    DynBuf_Destroy(&dynBuffer);
    return resultSize;
 }
 
 
+/*
+ *****************************************************************************
+ * ContainerInfoTakeDirtyNamespaces --
+ *
+ * Returns the set of namespaces which had containerd events since the last
+ * call, and starts a new one.
+ *
+ * @retval The set of namespaces. The caller must destroy it.
+ *
+ *****************************************************************************
+ */
+
+static GHashTable *
+ContainerInfoTakeDirtyNamespaces(void)
+{
+   GHashTable *dirtyNamespaces;
+
+   g_mutex_lock(&gEventState.lock);
+   dirtyNamespaces = gEventState.dirtyNamespaces;
+   gEventState.dirtyNamespaces = g_hash_table_new_full(g_str_hash,
+                                                       g_str_equal,
+                                                       g_free, NULL);
+   g_mutex_unlock(&gEventState.lock);
+
+   return dirtyNamespaces;
+}
+
+
+/*
+ *****************************************************************************
+ * ContainerInfoHasDirtyNamespaces --
+ *
+ * @retval TRUE if any namespace had containerd events since the last gather.
+ *
+ *****************************************************************************
+ */
+
+static gboolean
+ContainerInfoHasDirtyNamespaces(void)
+{
+   gboolean result;
+
+   g_mutex_lock(&gEventState.lock);
+   result = g_hash_table_size(gEventState.dirtyNamespaces) > 0;
+   g_mutex_unlock(&gEventState.lock);
+
+   return result;
+}
+
+
 /*
  *****************************************************************************
  * ContainerInfoGatherTask --
  *
  * Collects all the desired container related information.
  *
+ * In event-driven mode, a gather triggered by containerd events only queries
+ * the namespaces which had events, and publishes the information only if it
+ * changed. A gather triggered by the poll loop queries all the namespaces
+ * and always publishes.
+ *
  * @param[in]  ctx     The application context.
- * @param[in]  data    Unused
+ * @param[in]  data    TRUE if triggered by containerd events.
  *
  *****************************************************************************
  */
@@ -455,6 +585,9 @@ ContainerInfoGatherTask(ToolsAppCtx *ctx,   // IN
    char *dockerSocketPath = NULL;
    GHashTable *nsParsed;
    gboolean removeDuplicates;
+   gboolean eventTriggered = GPOINTER_TO_INT(data);
+   GHashTable *dirtyNamespaces = NULL;
+   size_t headerLen;
 
    static char headerFmt[] = "{"
                      "\"" CONTAINERINFO_KEY_VERSION  "\":\"%d\","
@@ -480,6 +613,20 @@ ContainerInfoGatherTask(ToolsAppCtx *ctx,   // IN
    ASSERT(len > 0);
 
    DynBuf_Append(&dynBuffer, tmpBuf, len);
+   headerLen = DynBuf_GetSize(&dynBuffer);
+
+   if (gEventDriven) {
+      dirtyNamespaces = ContainerInfoTakeDirtyNamespaces();
+
+      if (gContainerCache == NULL) {
+         gContainerCache =
+            g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                  (GDestroyNotify)
+                                     ContainerInfo_DestroyContainerList);
+      } else if (!eventTriggered) {
+         g_hash_table_remove_all(gContainerCache);
+      }
+   }
 
    if (!CheckContainerdRunning()) {
       g_info("%s: Could not find running containerd process on the system.\n",
@@ -558,6 +705,7 @@ ContainerInfoGatherTask(ToolsAppCtx *ctx,   // IN
       gchar *nsJsonString;
       size_t nsJsonSize;
       GSList *containerList;
+      gpointer cachedList;
 
       g_strstrip(nsList[i]);
       if (nsList[i][0] == '\0') {
@@ -581,17 +729,29 @@ ContainerInfoGatherTask(ToolsAppCtx *ctx,   // IN
          break;
       }
 
-      containerList =
-         ContainerInfo_GetContainerList(nsList[i], containerdSocketPath,
-                                        (unsigned int) limit);
+      if (gContainerCache != NULL &&
+          !g_hash_table_contains(dirtyNamespaces, nsList[i]) &&
+          g_hash_table_lookup_extended(gContainerCache, nsList[i],
+                                       NULL, &cachedList)) {
+         containerList = cachedList;
+      } else {
+         containerList =
+            ContainerInfo_GetContainerList(nsList[i], containerdSocketPath,
+                                           (unsigned int) limit);
+         ContainerInfoResolveImages(nsList[i], containerList,
+                                    dockerSocketPath);
+         if (gContainerCache != NULL) {
+            g_hash_table_insert(gContainerCache, g_strdup(nsList[i]),
+                                containerList);
+         }
+      }
       g_hash_table_add(nsParsed, nsList[i]);
       if (containerList == NULL) {
          continue;
       }
 
       nsJsonSize = ContainerInfoGetNsJson(nsList[i], containerList,
-                   dockerSocketPath, removeDuplicates, maxSizeRemaining,
-                   &nsJsonString);
+                   removeDuplicates, maxSizeRemaining, &nsJsonString);
       if (nsJsonSize > 0 && nsJsonSize <= maxSizeRemaining) {
          if (nsAdded) {
             DynBuf_Append(&dynBuffer, ",", 1);
@@ -600,7 +760,9 @@ ContainerInfoGatherTask(ToolsAppCtx *ctx,   // IN
          nsAdded = TRUE;
       }
       g_free(nsJsonString);
-      ContainerInfo_DestroyContainerList(containerList);
+      if (gContainerCache == NULL) {
+         ContainerInfo_DestroyContainerList(containerList);
+      }
    }
 
    g_hash_table_destroy(nsParsed);
@@ -620,18 +782,247 @@ exit:
        */
       SetGuestInfo(ctx, CONTAINERINFO_GUESTVAR_KEY, "");
    } else {
+      gchar *digest;
+
       DynBuf_Append(&dynBuffer, footer, sizeof(footer));
-      SetGuestInfo(ctx,
-                   CONTAINERINFO_GUESTVAR_KEY,
-                   DynBuf_GetString(&dynBuffer));
+
+      /*
+       * The header carries the update counter and publish time, which change
+       * every time. Only the container information decides whether an event
+       * triggered gather publishes.
+       */
+      digest = g_compute_checksum_for_data(G_CHECKSUM_SHA256,
+                                           (const guchar *)
+                                              DynBuf_Get(&dynBuffer) +
+                                              headerLen,
+                                           DynBuf_GetSize(&dynBuffer) -
+                                              headerLen);
+      if (eventTriggered && g_strcmp0(digest, gLastPublishedDigest) == 0) {
+         g_debug("%s: Container information not changed, skipping the "
+                 "update.\n", __FUNCTION__);
+         g_free(digest);
+      } else if (SetGuestInfo(ctx,
+                              CONTAINERINFO_GUESTVAR_KEY,
+                              DynBuf_GetString(&dynBuffer))) {
+         g_free(gLastPublishedDigest);
+         gLastPublishedDigest = digest;
+      } else {
+         g_free(digest);
+      }
    }
 
+   if (dirtyNamespaces != NULL) {
+      g_hash_table_destroy(dirtyNamespaces);
+   }
    DynBuf_Destroy(&dynBuffer);
    g_free(dockerSocketPath);
    g_free(containerdSocketPath);
    g_free(nsConfValue);
    g_free(timeStampString);
    Atomic_WriteBool(&gTaskSubmitted, FALSE);
+
+   /*
+    * Events that arrived while this task was running could not start a
+    * new one.
+    */
+   if (gEventDriven && ContainerInfoHasDirtyNamespaces() &&
+       !ToolsCorePool_SubmitTask(ctx, ContainerInfoGatherTask,
+                                 GINT_TO_POINTER(TRUE), NULL)) {
+      g_warning("%s: Failed to submit the task for capturing container "
+                "information\n", __FUNCTION__);
+   }
+}
+
+
+/*
+ *****************************************************************************
+ * ContainerInfoLoadEventConfig --
+ *
+ * Copies the containerd socket path and the allowed namespaces used by the
+ * containerd events thread from the config file. Must be called on the
+ * main thread.
+ *
+ * @param[in]  ctx     The application context.
+ *
+ *****************************************************************************
+ */
+
+static void
+ContainerInfoLoadEventConfig(ToolsAppCtx *ctx)   // IN
+{
+   gchar *socketPath;
+   gchar *nsConfValue;
+   gchar **nsList;
+   int i;
+
+   socketPath =
+      VMTools_ConfigGetString(ctx->config,
+                              CONFGROUPNAME_CONTAINERINFO,
+                              CONFNAME_CONTAINERINFO_CONTAINERDSOCKET,
+                              CONTAINERINFO_DEFAULT_CONTAINERDSOCKET);
+   g_strstrip(socketPath);
+
+   nsConfValue =
+      VMTools_ConfigGetString(ctx->config,
+                              CONFGROUPNAME_CONTAINERINFO,
+                              CONFNAME_CONTAINERINFO_ALLOWED_NAMESPACES,
+                              CONTAINERINFO_DEFAULT_ALLOWED_NAMESPACES);
+   nsList = g_strsplit(nsConfValue, ",", 0);
+   for (i = 0; nsList[i] != NULL; i++) {
+      g_strstrip(nsList[i]);
+   }
+   g_free(nsConfValue);
+
+   g_mutex_lock(&gEventState.lock);
+   g_free(gEventState.containerdSocketPath);
+   gEventState.containerdSocketPath = socketPath;
+   g_strfreev(gEventState.allowedNamespaces);
+   gEventState.allowedNamespaces = nsList;
+   g_mutex_unlock(&gEventState.lock);
+}
+
+
+/*
+ *****************************************************************************
+ * ContainerInfoIsNamespaceAllowed --
+ *
+ * Checks whether a namespace is in the list of namespaces to be queried.
+ *
+ * @param[in]  ns      The name of the namespace.
+ *
+ * @retval TRUE if the namespace is allowed.
+ *
+ *****************************************************************************
+ */
+
+static gboolean
+ContainerInfoIsNamespaceAllowed(const char *ns)     // IN
+{
+   gboolean result = FALSE;
+   int i;
+
+   g_mutex_lock(&gEventState.lock);
+   for (i = 0;
+        gEventState.allowedNamespaces != NULL &&
+        gEventState.allowedNamespaces[i] != NULL && !result;
+        i++) {
+      result = strcmp(gEventState.allowedNamespaces[i], ns) == 0;
+   }
+   g_mutex_unlock(&gEventState.lock);
+
+   return result;
+}
+
+
+/*
+ *****************************************************************************
+ * ContainerInfoOnEvent --
+ *
+ * Called for every containerd container or task event. Marks the namespace
+ * of the event as changed and submits a task to update the container
+ * information.
+ *
+ * @param[in]  ns          The namespace of the event.
+ * @param[in]  topic       The topic of the event.
+ * @param[in]  clientData  The application context.
+ *
+ *****************************************************************************
+ */
+
+static void
+ContainerInfoOnEvent(const char *ns,        // IN
+                     const char *topic,     // IN
+                     void *clientData)      // IN
+{
+   ToolsAppCtx *ctx = clientData;
+
+   if (Atomic_Read32(&gContainerInfoPollInterval) == 0 ||
+       !ContainerInfoIsNamespaceAllowed(ns)) {
+      return;
+   }
+
+   g_debug("%s: Event '%s' in namespace '%s'.\n", __FUNCTION__, topic, ns);
+
+   g_mutex_lock(&gEventState.lock);
+   g_hash_table_add(gEventState.dirtyNamespaces, g_strdup(ns));
+   g_mutex_unlock(&gEventState.lock);
+
+   if (!ToolsCorePool_SubmitTask(ctx, ContainerInfoGatherTask,
+                                 GINT_TO_POINTER(TRUE), NULL)) {
+      g_warning("%s: Failed to submit the task for capturing container "
+                "information\n", __FUNCTION__);
+   }
+}
+
+
+/*
+ *****************************************************************************
+ * ContainerInfoEventThread --
+ *
+ * Subscribes to the containerd events until the thread is interrupted.
+ * The subscription is retried every CONTAINERINFO_EVENTS_RETRY_INTERVAL
+ * seconds while containerd is not reachable.
+ *
+ * @param[in]  ctx     The application context.
+ * @param[in]  data    Unused.
+ *
+ *****************************************************************************
+ */
+
+static void
+ContainerInfoEventThread(ToolsAppCtx *ctx,   // IN
+                         gpointer data)      // IN
+{
+   g_mutex_lock(&gEventState.lock);
+
+   while (!gEventState.stopped) {
+      gchar *containerdSocketPath;
+      gint64 endTime;
+
+      containerdSocketPath = g_strdup(gEventState.containerdSocketPath);
+      g_mutex_unlock(&gEventState.lock);
+
+      ContainerInfo_WatchEvents(containerdSocketPath, ContainerInfoOnEvent,
+                                ctx);
+      g_free(containerdSocketPath);
+
+      endTime = g_get_monotonic_time() +
+                CONTAINERINFO_EVENTS_RETRY_INTERVAL * G_TIME_SPAN_SECOND;
+
+      g_mutex_lock(&gEventState.lock);
+      while (!gEventState.stopped &&
+             g_cond_wait_until(&gEventState.cond, &gEventState.lock,
+                               endTime)) {
+      }
+   }
+
+   g_mutex_unlock(&gEventState.lock);
+   g_debug("%s: Exiting the containerd events thread.\n", __FUNCTION__);
+}
+
+
+/*
+ *****************************************************************************
+ * ContainerInfoEventThreadInterrupt --
+ *
+ * Stops the containerd events thread.
+ *
+ * @param[in]  ctx     The application context.
+ * @param[in]  data    Unused.
+ *
+ *****************************************************************************
+ */
+
+static void
+ContainerInfoEventThreadInterrupt(ToolsAppCtx *ctx,   // IN
+                                  gpointer data)      // IN
+{
+   g_mutex_lock(&gEventState.lock);
+   gEventState.stopped = TRUE;
+   g_cond_signal(&gEventState.cond);
+   g_mutex_unlock(&gEventState.lock);
+
+   ContainerInfo_StopWatchingEvents();
 }
 
 
@@ -789,8 +1180,16 @@ ContainerInfoServerConfReload(gpointer src,       // IN
                               ToolsAppCtx *ctx,   // IN
                               gpointer data)      // IN
 {
+   if (!ToolsCore_ConfigGroupChanged(ctx, CONFGROUPNAME_CONTAINERINFO)) {
+      return;
+   }
+
    g_info("%s: Reloading the tools configuration.\n", __FUNCTION__);
 
+   if (gEventDriven) {
+      ContainerInfoLoadEventConfig(ctx);
+   }
+
    TweakGatherLoop(ctx, FALSE);
 }
 
@@ -819,6 +1218,25 @@ ContainerInfoServerShutdown(gpointer src,       // IN
    }
 
    SetGuestInfo(ctx, CONTAINERINFO_GUESTVAR_KEY, "");
+
+   if (gEventDriven) {
+      ContainerInfoEventThreadInterrupt(ctx, NULL);
+   }
+
+   /*
+    * Make sure no gather task is using the cached data while freeing it.
+    */
+   if (!Atomic_ReadIfEqualWriteBool(&gTaskSubmitted, FALSE, TRUE)) {
+      if (gContainerCache != NULL) {
+         g_hash_table_destroy(gContainerCache);
+         gContainerCache = NULL;
+      }
+      g_free(gLastPublishedDigest);
+      gLastPublishedDigest = NULL;
+   }
+
+   ContainerInfo_ReleaseGrpcChannel();
+   ContainerInfo_ReleaseDockerClient();
 }
 
 
@@ -1004,6 +1422,31 @@ ToolsOnLoad(ToolsAppCtx *ctx)   // IN
                                        sizeof *regs,
                                        ARRAYSIZE(regs));
 
+      /*
+       * Set up the containerd events subscription.
+       */
+      gEventDriven =
+         VMTools_ConfigGetBoolean(ctx->config,
+                                  CONFGROUPNAME_CONTAINERINFO,
+                                  CONFNAME_CONTAINERINFO_EVENT_DRIVEN,
+                                  CONTAINERINFO_DEFAULT_EVENT_DRIVEN);
+      if (gEventDriven) {
+         g_mutex_init(&gEventState.lock);
+         g_cond_init(&gEventState.cond);
+         gEventState.dirtyNamespaces = g_hash_table_new_full(g_str_hash,
+                                                             g_str_equal,
+                                                             g_free, NULL);
+         ContainerInfoLoadEventConfig(ctx);
+         if (!ToolsCorePool_StartThread(ctx, "ContainerInfoEvents",
+                                        ContainerInfoEventThread,
+                                        ContainerInfoEventThreadInterrupt,
+                                        NULL, NULL)) {
+            g_warning("%s: Failed to start the containerd events thread.\n",
+                      __FUNCTION__);
+            gEventDriven = FALSE;
+         }
+      }
+
       /*
        * Set up the containerInfo gather loop.
        */
@@ -40,15 +40,31 @@ typedef struct ContainerInfo {
    char *image;
 } ContainerInfo;
 
+/*
+ * Callback invoked for every containerd event of interest.
+ */
+typedef void (*ContainerInfoEventCb)(const char *ns,
+                                     const char *topic,
+                                     void *clientData);
+
 void ContainerInfo_DestroyContainerData(void *pointer);
 void ContainerInfo_DestroyContainerList(GSList *containerList);
 
 GHashTable *ContainerInfo_GetDockerContainers(const char *dockerSocketPath);
+void ContainerInfo_ReleaseDockerClient(void);
 
 GSList *ContainerInfo_GetContainerList(const char *ns,
                                        const char *containerdSocketPath,
                                        unsigned int maxContainers);
 
+void ContainerInfo_ReleaseGrpcChannel(void);
+
+gboolean ContainerInfo_WatchEvents(const char *containerdSocketPath,
+                                   ContainerInfoEventCb eventCb,
+                                   void *clientData);
+
+void ContainerInfo_StopWatchingEvents(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -22,6 +22,10 @@
  *    This file defines docker specific functions which are needed by
  *    containerInfo. Docker API is called using libcurl to find runnning
  *    docker containers and collect relevant info.
+ *
+ *    A single curl handle is kept across requests so that the connection
+ *    to the docker daemon is reused, and the list of containers is parsed
+ *    one container at a time while it is received.
  */
 
 #include <stdio.h>
@@ -38,6 +42,13 @@
 #define TOKENS_PER_ALLOC 500
 #define MAX_TOKENS 100000
 
+/*
+ * Maximum size of a single container object in the docker API response,
+ * and of an error response that is kept for logging.
+ */
+#define MAX_CONTAINER_JSON_SIZE (1024 * 1024)
+#define MAX_ERROR_RESPONSE_SIZE 1024
+
 /*
  * docker API versions are backwards compatible with older docker Engine
  * versions so this is the oldest API version that is documented by docker
@@ -45,10 +56,26 @@
  */
 #define DOCKER_API_VERSION "v1.18"
 
-typedef struct DockerBuffer {
-  char *response;
-  size_t size;
-} DockerBuffer;
+/*
+ * State of the incremental parser of a JSON array of containers. Only the
+ * container object currently being received is buffered.
+ */
+typedef struct DockerStreamParser {
+   char *httpStatus;             // HTTP status code of the response
+   int depth;                    // nesting level of the current character
+   gboolean inString;
+   gboolean escaped;
+   gboolean failed;
+   GString *object;              // current element of the top-level array
+   GString *errorResponse;       // start of a non-success response
+   GHashTable *containerTable;   // container id -> image name
+} DockerStreamParser;
+
+/*
+ * The curl handle is reused across requests. Protected by gDockerCurlLock.
+ */
+static CURL *gDockerCurl = NULL;
+G_LOCK_DEFINE_STATIC(gDockerCurlLock);
 
 
 /*
@@ -112,59 +139,6 @@ ContainerInfoJsonEqIsKey(const char *json,
 }
 
 
-/*
- ******************************************************************************
- * DockerWriteCB --
- *
- * @brief Sets callback for writing received data when using libcurl to access
- *        docker API. This function prototype is based on
- *        https://curl.se/libcurl/c/CURLOPT_WRITEFUNCTION.html
- *
- * @param[in] data       info received from API
- * @param[in] size       this value is always 1 (according to curl docs)
- * @param[in] nitems     size of data
- * @param[in] userdata   pointer to DockerBuffer
- *
- * @retval   number of bytes successfully written
- *
- ******************************************************************************
- */
-
-static size_t
-DockerWriteCB(void *data,                    // IN
-              size_t size,                   // IN
-              size_t nitems,                 // IN
-              void *userdata)                // IN
-{
-   size_t realsize = size * nitems;
-   DockerBuffer *mem = (DockerBuffer *) userdata;
-   char *realptr;
-   size_t newsize = mem->size + realsize + 1;
-
-   if (newsize < mem->size) {
-      g_warning("%s:%d: size overflow\n", __FUNCTION__, __LINE__);
-      g_free(mem->response);
-      mem->response = NULL;
-      return 0;
-   }
-
-   realptr = g_try_realloc(mem->response, newsize);
-   if (realptr == NULL) {
-      g_warning("%s:%d: out of memory\n", __FUNCTION__, __LINE__);
-      g_free(mem->response);
-      mem->response = NULL;
-      return 0;
-   }
-
-   mem->response = realptr;
-   memcpy(&mem->response[mem->size], data, realsize);
-   mem->size += realsize;
-   mem->response[mem->size] = '\0';
-
-   return realsize;
-}
-
-
 /*
  ******************************************************************************
  * DockerHeaderCB --
@@ -227,88 +201,15 @@ DockerHeaderCB(char *buffer,                     // IN
       return 0;
    }
 
+   /*
+    * Interim responses have their own status line.
+    */
+   g_free(*statusCode);
    *statusCode = g_strndup(statusStart, statusEnd - statusStart);
    return realSize;
 }
 
 
-/*
- ******************************************************************************
- * DockerCallAPI --
- *
- * @brief Uses libcurl to access docker API and loads response to jsonString.
- *
- * @param[in] url              url of docker API endpoint.
- *                              e.g. http://v1.18/containers/json
- * @param[in] unixSocket       unix socket to communicate with docker.
- * @param[in/out] jsonString   stores the response from docker API.
- *
- * @retval TRUE   successfully wrote valid response to jsonString
- * @retval FALSE  on failure
- *
- ******************************************************************************
- */
-
-static gboolean
-DockerCallAPI(const char *url,                     // IN
-              const char *unixSocket,              // IN
-              char **jsonString)                   // OUT
-{
-   DockerBuffer result = {0};
-   char *dockerStatus = NULL;
-   CURLcode ret;
-   char errBuf[CURL_ERROR_SIZE] = {'\0'};
-   gboolean retVal = FALSE;
-   CURL *curl = curl_easy_init();
-
-   if (curl == NULL) {
-      g_warning("%s:%d: curl failed to initialize\n",
-                __FUNCTION__, __LINE__);
-      return retVal;
-   }
-
-   curl_easy_setopt(curl, CURLOPT_UNIX_SOCKET_PATH, unixSocket);
-   curl_easy_setopt(curl, CURLOPT_URL, url);
-   curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, errBuf);
-   curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, DockerHeaderCB);
-   curl_easy_setopt(curl, CURLOPT_HEADERDATA, &dockerStatus);
-   curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, (void *) DockerWriteCB);
-   curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *) &result);
-
-   ret = curl_easy_perform(curl);
-
-   if (ret == CURLE_OK && result.size > 0) {
-      /*
-       * might receive CURLE_OK from libcurl but dockerStatus does not
-       * equal 200.  e.g. when page is not found by docker engine.
-       */
-      if (dockerStatus != NULL &&
-          strncmp(dockerStatus, HTTP_STATUS_SUCCESS,
-                  HTTP_STATUS_SUCCESS_LENGTH) == 0) {
-         *jsonString = result.response;
-         retVal = TRUE;
-      } else {
-         g_warning("%s:%d: error response from docker engine. response: %s",
-                   __FUNCTION__, __LINE__, result.response != NULL ?
-                   result.response : "No response from docker engine.");
-         g_free(result.response);
-      }
-   } else {
-      if (errBuf[0] != '\0') {
-         g_warning("%s:%d: %s\n", __FUNCTION__, __LINE__, errBuf);
-      } else {
-         g_warning("%s:%d: docker request unsuccessful. strerror: %s\n",
-                   __FUNCTION__, __LINE__, curl_easy_strerror(ret));
-      }
-      g_free(result.response);
-   }
-
-   g_free(dockerStatus);
-   curl_easy_cleanup(curl);
-   return retVal;
-}
-
-
 /*
  ******************************************************************************
  * ContainerInfoParseString --
@@ -363,51 +264,40 @@ ContainerInfoParseString(char *jsonString,            // IN
 
 
 /*
- *****************************************************************************
- * ContainerInfo_GetDockerContainers --
+ ******************************************************************************
+ * ContainerInfoParseContainer --
  *
- * @brief  Entry point for gathering running docker container info
+ * @brief  Extracts the id and image of a container from its JSON object
+ *         and adds them to the container table.
  *
+ * @param[in] json               JSON object of one container.
+ * @param[in/out] containerTable Table of container id to image name.
  *
- * @retval TRUE   successfully collected docker container info
- * @retval FALSE  on failure
+ * @retval TRUE   the object was parsed.
+ * @retval FALSE  the object is not valid JSON.
  *
- *****************************************************************************
+ ******************************************************************************
  */
 
-GHashTable *
-ContainerInfo_GetDockerContainers(const char *dockerSocketPath)          // IN
+static gboolean
+ContainerInfoParseContainer(char *json,                      // IN
+                            GHashTable *containerTable)      // IN/OUT
 {
    jsmntok_t *t = NULL;
    int i;
    int numTokens;
-   char *dockerContainerString = NULL;
-   char *endpt = g_strdup_printf("http://%s/containers/json?"
-                                 "filters={\"status\":[\"running\"]}",
-                                 DOCKER_API_VERSION);
-   GHashTable *containerTable = NULL;
+   char *id = NULL;
+   char *image = NULL;
 
-   if (!DockerCallAPI(endpt,
-                      dockerSocketPath,
-                      &dockerContainerString)) {
-       g_warning("%s: Failed to get the list of containers.", __FUNCTION__);
-       goto exit;
-   }
+   numTokens = ContainerInfoParseString(json, &t);
 
-   numTokens = ContainerInfoParseString(dockerContainerString, &t);
-
-   if (numTokens <= 0 || t[0].type != JSMN_ARRAY) {
-      g_warning("%s: invalid json response\n",
-                __FUNCTION__);
-      goto exit;
+   if (numTokens <= 0 || t[0].type != JSMN_OBJECT) {
+      g_free(t);
+      return FALSE;
    }
 
-   containerTable = g_hash_table_new_full(g_str_hash, g_str_equal,
-                                          g_free, g_free);
-
-   /* Example of "GET containers/json" response.
-    * Each item in the array is a running container.
-    * [{"Id":"370a480816ec5207c620fe628bd162925b85d150b3303601f76c3fe47ed863de",
+   /* Example of a container object in the "GET containers/json" response:
+    *  {"Id":"370a480816ec5207c620fe628bd162925b85d150b3303601f76c3fe47ed863de",
     *   "Names":["/fervent_goldwasser"],
     *   "Image":"redis",
     *   "ImageID":"sha256:de974760ddb2f32dbddb74b7bb8cff4c1eee06d43d36d11bbc",
@@ -419,85 +309,319 @@ ContainerInfo_GetDockerContainers(const char *dockerSocketPath)          // IN
     *   "Status":"Up 29 minutes",
     *   "HostConfig":{"NetworkMode":"default"},
     *   "NetworkSettings":{...},
-    *   "Mounts":[...]},
-    *  {"Id":"b3ba5ed8b84816c66a6b6fe5903565164ea953ecdddf190263d52ed6ad0f6088",
-    *   "Names":["/bold_solomon"],
-    *   "Image":"nginx",
-    *   "ImageID":"sha256:62d49f9bab67f7c70ac3395855bf01389eb3175b374e621f6f19",
-    *   "Command":"/docker-entrypoint.sh nginx -g 'daemon off;'",
-    *   "Created":1623742533,
-    *   "Ports":[{"PrivatePort":80,"Type":"tcp"}],
-    *   "Labels":{"maintainer":"NGINX Docker Maintainers"},
-    *   "State":"running",
-    *   "Status":"Up 29 minutes",
-    *   "HostConfig":{"NetworkMode":"default"},
-    *   "NetworkSettings":{...},
-    *   "Mounts":[]}]
+    *   "Mounts":[...]}
     */
-   i = 1;
-   while (i < numTokens) {
-      if (t[i].type == JSMN_OBJECT) {
-         char *id = NULL;
-         char *image = NULL;
-         int end = t[i].end;
-
-         i++;
-         while (i < numTokens - 1 && t[i + 1].start < end) {
-            if (t[i].type == JSMN_STRING &&
-                t[i + 1].type == JSMN_STRING) {
-               if (ContainerInfoJsonEqIsKey(dockerContainerString,
-                                            &t[i], "Id")) {
-                  if (id != NULL) {
-                     g_warning("%s:%d: found duplicate key for \"Id\". Json"
-                               "has improper format\n", __FUNCTION__, __LINE__);
-                     break;
-                  }
-
-                  id = g_strdup_printf("%.*s",
-                                       t[i + 1].end - t[i + 1].start,
-                                       dockerContainerString + t[i + 1].start);
-               } else if (ContainerInfoJsonEqIsKey(dockerContainerString,
-                                                   &t[i], "Image")) {
-                  if (image != NULL) {
-                     g_warning("%s:%d: found duplicate key for \"Image\". Json"
-                               "has improper format\n", __FUNCTION__, __LINE__);
-                     break;
-                  }
-
-                  image =
-                     g_strdup_printf("%.*s",
-                                     t[i + 1].end - t[i + 1].start,
-                                     dockerContainerString + t[i + 1].start);
-               }
+   for (i = 1; i < numTokens - 1; i++) {
+      if (t[i].type == JSMN_STRING &&
+          t[i + 1].type == JSMN_STRING) {
+         if (ContainerInfoJsonEqIsKey(json, &t[i], "Id")) {
+            if (id != NULL) {
+               g_warning("%s:%d: found duplicate key for \"Id\". Json"
+                         "has improper format\n", __FUNCTION__, __LINE__);
+               break;
             }
 
-            if (image != NULL && id != NULL) {
-               g_debug("%s: Found docker container id: %s and image: %s",
-                       __FUNCTION__, id, image);
-               g_hash_table_insert(containerTable, id, image);
-               id = NULL;
-               image = NULL;
+            id = g_strdup_printf("%.*s",
+                                 t[i + 1].end - t[i + 1].start,
+                                 json + t[i + 1].start);
+         } else if (ContainerInfoJsonEqIsKey(json, &t[i], "Image")) {
+            if (image != NULL) {
+               g_warning("%s:%d: found duplicate key for \"Image\". Json"
+                         "has improper format\n", __FUNCTION__, __LINE__);
                break;
             }
-            i++;
+
+            image = g_strdup_printf("%.*s",
+                                    t[i + 1].end - t[i + 1].start,
+                                    json + t[i + 1].start);
+         }
+      }
+
+      if (image != NULL && id != NULL) {
+         g_debug("%s: Found docker container id: %s and image: %s",
+                 __FUNCTION__, id, image);
+         g_hash_table_insert(containerTable, id, image);
+         id = NULL;
+         image = NULL;
+         break;
+      }
+   }
+
+   /*
+    * Check id and image in the case of (image && !id) and (!image && id)
+    */
+   g_free(id);
+   g_free(image);
+   g_free(t);
+   return TRUE;
+}
+
+
+/*
+ ******************************************************************************
+ * DockerContainersWriteCB --
+ *
+ * @brief Sets callback for writing received data when using libcurl to access
+ *        docker API. The data is expected to be a JSON array of container
+ *        objects. Every object is parsed as soon as it is completely
+ *        received, so only one object is held in memory at a time.
+ *        This function prototype is based on
+ *        https://curl.se/libcurl/c/CURLOPT_WRITEFUNCTION.html
+ *
+ * @param[in] data       info received from API
+ * @param[in] size       this value is always 1 (according to curl docs)
+ * @param[in] nitems     size of data
+ * @param[in] userdata   pointer to DockerStreamParser
+ *
+ * @retval   number of bytes successfully written
+ *
+ ******************************************************************************
+ */
+
+static size_t
+DockerContainersWriteCB(void *data,                    // IN
+                        size_t size,                   // IN
+                        size_t nitems,                 // IN
+                        void *userdata)                // IN
+{
+   size_t realsize = size * nitems;
+   DockerStreamParser *parser = (DockerStreamParser *) userdata;
+   const char *buf = data;
+   size_t i;
+
+   /*
+    * Keep the start of an error response for logging.
+    */
+   if (parser->httpStatus == NULL ||
+       strncmp(parser->httpStatus, HTTP_STATUS_SUCCESS,
+               HTTP_STATUS_SUCCESS_LENGTH) != 0) {
+      if (parser->errorResponse->len < MAX_ERROR_RESPONSE_SIZE) {
+         g_string_append_len(parser->errorResponse, buf,
+                             MIN(realsize, MAX_ERROR_RESPONSE_SIZE -
+                                           parser->errorResponse->len));
+      }
+      return realsize;
+   }
+
+   for (i = 0; i < realsize; i++) {
+      char c = buf[i];
+
+      if (parser->depth >= 2) {
+         g_string_append_c(parser->object, c);
+         if (parser->object->len > MAX_CONTAINER_JSON_SIZE) {
+            g_warning("%s:%d: container object exceeds %d bytes\n",
+                      __FUNCTION__, __LINE__, MAX_CONTAINER_JSON_SIZE);
+            parser->failed = TRUE;
+            return 0;
+         }
+      }
+
+      if (parser->inString) {
+         if (parser->escaped) {
+            parser->escaped = FALSE;
+         } else if (c == '\\') {
+            parser->escaped = TRUE;
+         } else if (c == '"') {
+            parser->inString = FALSE;
          }
+         continue;
+      }
 
-         /*
-          * Check id and image in the case of (image && !id) and (!image && id)
-          */
-         if (id != NULL) {
-            g_free(id);
+      switch (c) {
+      case '"':
+         parser->inString = TRUE;
+         break;
+      case '[':
+      case '{':
+         if (parser->depth == 0 && c != '[') {
+            g_warning("%s:%d: response is not a JSON array\n",
+                      __FUNCTION__, __LINE__);
+            parser->failed = TRUE;
+            return 0;
+         }
+         if (parser->depth == 1) {
+            g_string_assign(parser->object, "");
+            g_string_append_c(parser->object, c);
          }
-         if (image != NULL) {
-            g_free(image);
+         parser->depth++;
+         break;
+      case ']':
+      case '}':
+         if (parser->depth == 0) {
+            parser->failed = TRUE;
+            return 0;
          }
+         parser->depth--;
+         if (parser->depth == 1 && c == '}' &&
+             !ContainerInfoParseContainer(parser->object->str,
+                                          parser->containerTable)) {
+            g_warning("%s:%d: invalid container object in json response\n",
+                      __FUNCTION__, __LINE__);
+            parser->failed = TRUE;
+            return 0;
+         }
+         break;
+      default:
+         break;
       }
-      i++;
    }
 
-exit:
-   g_free(t);
+   return realsize;
+}
+
+
+/*
+ ******************************************************************************
+ * DockerCallAPI --
+ *
+ * @brief Uses libcurl to access docker API and feeds the response to the
+ *        streaming parser. The curl handle, and so the connection to the
+ *        docker daemon, is reused across calls.
+ *
+ * @param[in] url              url of docker API endpoint.
+ *                              e.g. http://v1.18/containers/json
+ * @param[in] unixSocket       unix socket to communicate with docker.
+ * @param[in/out] parser       parses the response from docker API.
+ *
+ * @retval TRUE   successfully parsed a valid response
+ * @retval FALSE  on failure
+ *
+ ******************************************************************************
+ */
+
+static gboolean
+DockerCallAPI(const char *url,                     // IN
+              const char *unixSocket,              // IN
+              DockerStreamParser *parser)          // IN/OUT
+{
+   CURLcode ret;
+   char errBuf[CURL_ERROR_SIZE] = {'\0'};
+   gboolean retVal = FALSE;
+   CURL *curl;
+
+   G_LOCK(gDockerCurlLock);
+
+   if (gDockerCurl == NULL) {
+      gDockerCurl = curl_easy_init();
+      if (gDockerCurl == NULL) {
+         g_warning("%s:%d: curl failed to initialize\n",
+                   __FUNCTION__, __LINE__);
+         G_UNLOCK(gDockerCurlLock);
+         return retVal;
+      }
+   }
+   curl = gDockerCurl;
+
+   curl_easy_setopt(curl, CURLOPT_UNIX_SOCKET_PATH, unixSocket);
+   curl_easy_setopt(curl, CURLOPT_URL, url);
+   curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, errBuf);
+   curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, DockerHeaderCB);
+   curl_easy_setopt(curl, CURLOPT_HEADERDATA, &parser->httpStatus);
+   curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION,
+                    (void *) DockerContainersWriteCB);
+   curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *) parser);
+
+   ret = curl_easy_perform(curl);
+
+   if (ret == CURLE_OK) {
+      /*
+       * might receive CURLE_OK from libcurl but dockerStatus does not
+       * equal 200.  e.g. when page is not found by docker engine.
+       */
+      if (parser->httpStatus == NULL ||
+          strncmp(parser->httpStatus, HTTP_STATUS_SUCCESS,
+                  HTTP_STATUS_SUCCESS_LENGTH) != 0) {
+         g_warning("%s:%d: error response from docker engine. response: %s",
+                   __FUNCTION__, __LINE__, parser->errorResponse->len > 0 ?
+                   parser->errorResponse->str :
+                   "No response from docker engine.");
+      } else if (parser->depth != 0 || parser->inString) {
+         g_warning("%s:%d: incomplete json response\n",
+                   __FUNCTION__, __LINE__);
+      } else {
+         retVal = TRUE;
+      }
+   } else if (!parser->failed) {
+      if (errBuf[0] != '\0') {
+         g_warning("%s:%d: %s\n", __FUNCTION__, __LINE__, errBuf);
+      } else {
+         g_warning("%s:%d: docker request unsuccessful. strerror: %s\n",
+                   __FUNCTION__, __LINE__, curl_easy_strerror(ret));
+      }
+   }
+
+   /*
+    * errBuf and parser are about to go out of scope.
+    */
+   curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, NULL);
+   curl_easy_setopt(curl, CURLOPT_HEADERDATA, NULL);
+   curl_easy_setopt(curl, CURLOPT_WRITEDATA, NULL);
+
+   G_UNLOCK(gDockerCurlLock);
+   return retVal;
+}
+
+
+/*
+ *****************************************************************************
+ * ContainerInfo_GetDockerContainers --
+ *
+ * @brief  Entry point for gathering running docker container info
+ *
+ * @param[in] dockerSocketPath   unix socket to communicate with docker.
+ *
+ * @retval the table of container id to image name of the running docker
+ *         containers. NULL on failure.
+ *
+ *****************************************************************************
+ */
+
+GHashTable *
+ContainerInfo_GetDockerContainers(const char *dockerSocketPath)          // IN
+{
+   DockerStreamParser parser = { 0 };
+   char *endpt = g_strdup_printf("http://%s/containers/json?"
+                                 "filters={\"status\":[\"running\"]}",
+                                 DOCKER_API_VERSION);
+
+   parser.object = g_string_new(NULL);
+   parser.errorResponse = g_string_new(NULL);
+   parser.containerTable = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                 g_free, g_free);
+
+   if (!DockerCallAPI(endpt,
+                      dockerSocketPath,
+                      &parser)) {
+       g_warning("%s: Failed to get the list of containers.", __FUNCTION__);
+       g_hash_table_destroy(parser.containerTable);
+       parser.containerTable = NULL;
+   }
+
+   g_string_free(parser.object, TRUE);
+   g_string_free(parser.errorResponse, TRUE);
+   g_free(parser.httpStatus);
    g_free(endpt);
-   g_free(dockerContainerString);
-   return containerTable;
+   return parser.containerTable;
+}
+
+
+/*
+ *****************************************************************************
+ * ContainerInfo_ReleaseDockerClient --
+ *
+ * @brief  Closes the connection to the docker daemon and frees the curl
+ *         handle.
+ *
+ *****************************************************************************
+ */
+
+void
+ContainerInfo_ReleaseDockerClient(void)
+{
+   G_LOCK(gDockerCurlLock);
+   if (gDockerCurl != NULL) {
+      curl_easy_cleanup(gDockerCurl);
+      gDockerCurl = NULL;
+   }
+   G_UNLOCK(gDockerCurlLock);
 }
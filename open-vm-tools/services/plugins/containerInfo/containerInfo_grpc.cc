@@ -22,28 +22,116 @@
  *    This file defines specific functions which are needed to query
  *    the containerd daemon and retrieve the list of running
  *    containers. A gRPC connection is created using the containerd unix
- *    socket and the specified namespace is queried for any running containers.
+ *    socket, kept across gathers, and the specified namespace is queried for
+ *    any running containers.
  */
 
 #include "containerInfoInt.h"
 #include "containers.grpc.pb.h"
+#include "events.grpc.pb.h"
 #include "tasks.grpc.pb.h"
 #include <grpc++/grpc++.h>
+#include <mutex>
 #include <stdio.h>
+#include <string>
+#include <unordered_set>
 
 using namespace containerd::services::containers::v1;
+using namespace containerd::services::events::v1;
 using namespace containerd::services::tasks::v1;
 using namespace containerd::v1::types;
 using namespace google::protobuf;
 
+/*
+ * The gRPC channel to containerd is kept across gathers and only recreated
+ * when the configured socket path changes. gRPC reconnects a channel on its
+ * own after the daemon restarts.
+ */
+static std::mutex gChannelLock;
+static std::shared_ptr<grpc::Channel> gChannel;
+static std::string gChannelSocket;
+
+/*
+ * Context of the active events subscription, so that it can be cancelled
+ * from another thread. Protected by gChannelLock.
+ */
+static grpc::ClientContext *gEventsContext = nullptr;
+static bool gEventsStopped = false;
+
+/*
+ * Topics of the events that change the set of running containers.
+ */
+static const char *gEventTopics[] = {
+   "/containers/create",
+   "/containers/delete",
+   "/tasks/start",
+   "/tasks/exit",
+   "/tasks/delete",
+};
+
+
+/*
+ ******************************************************************************
+ * ContainerInfoGetChannel --
+ *
+ * @brief   Returns the cached gRPC channel for the containerd unix socket,
+ *          creating it if needed.
+ *
+ * @param[in] containerdSocketPath     Path of the socket.
+ *
+ * @retval the gRPC channel. nullptr if the channel cannot be created.
+ *
+ ******************************************************************************
+ */
+
+static std::shared_ptr<grpc::Channel>
+ContainerInfoGetChannel(const char *containerdSocketPath) // IN
+{
+   std::lock_guard<std::mutex> lock(gChannelLock);
+
+   if (gChannel == nullptr || gChannelSocket != containerdSocketPath) {
+      gchar *unixSocket = g_strdup_printf("unix://%s", containerdSocketPath);
+
+      g_debug("%s: Creating gRPC channel for %s\n", __FUNCTION__, unixSocket);
+      gChannel = grpc::CreateChannel(unixSocket,
+                                     grpc::InsecureChannelCredentials());
+      gChannelSocket = (gChannel != nullptr) ? containerdSocketPath : "";
+      g_free(unixSocket);
+   }
+
+   return gChannel;
+}
+
+
+/*
+ ******************************************************************************
+ * ContainerInfo_ReleaseGrpcChannel --
+ *
+ * @brief   Drops the cached gRPC channel to containerd.
+ *
+ ******************************************************************************
+ */
+
+void
+ContainerInfo_ReleaseGrpcChannel(void)
+{
+   std::lock_guard<std::mutex> lock(gChannelLock);
+
+   gChannel.reset();
+   gChannelSocket.clear();
+}
+
 
 /*
  ******************************************************************************
  * ContainerInfo_GetContainerList --
  *
- * @brief   A gRPC connection is created with the containerd unix
- *          socket and specified namespace is inspected for
- *          running containers.
+ * @brief   The specified namespace is inspected for running containers
+ *          over a gRPC connection with the containerd unix socket.
+ *
+ *          Containers are listed with a single Containers List call and
+ *          matched against the tasks returned by a single Tasks List call,
+ *          so that only containers with a task are returned.
  *
  * @param[in] ns                       Namespace to be queried.
  * @param[in] containerdSocketPath     Path of the socket.
@@ -62,7 +150,7 @@ ContainerInfo_GetContainerList(const char *ns,                   // IN
                                unsigned int maxContainers)       // IN
 {
    GSList *containerList = NULL;
-   std::shared_ptr<grpc::ChannelInterface> channel;
+   std::shared_ptr<grpc::Channel> channel;
    std::unique_ptr<Containers::Stub> containerStub;
    std::unique_ptr<Tasks::Stub> taskStub;
    grpc::Status status;
@@ -71,21 +159,24 @@ ContainerInfo_GetContainerList(const char *ns,                   // IN
    const ListContainersRequest req;
    std::unique_ptr<ListContainersResponse> res;
    grpc::ClientContext containerContext;
+   const ListTasksRequest taskReq;
+   std::unique_ptr<ListTasksResponse> taskRes;
+   grpc::ClientContext taskContext;
+   std::unordered_set<std::string> taskIds;
    static const std::string namespaceKey = "containerd-namespace";
-   gchar *unixSocket = NULL;
+   gint64 startTime;
+   gint64 containersTime;
+   gint64 tasksTime;
 
    if (ns == NULL || containerdSocketPath == NULL) {
       g_warning("%s: Invalid arguments specified.\n", __FUNCTION__);
       goto exit;
    }
 
-   unixSocket = g_strdup_printf("unix://%s", containerdSocketPath);
-
    containerContext.AddMetadata(namespaceKey, ns);
+   taskContext.AddMetadata(namespaceKey, ns);
 
-   channel =
-      grpc::CreateChannel(unixSocket, grpc::InsecureChannelCredentials());
-
+   channel = ContainerInfoGetChannel(containerdSocketPath);
    if (channel == nullptr) {
       g_warning("%s: Failed to create gRPC channel\n", __FUNCTION__);
       goto exit;
@@ -103,9 +194,13 @@ ContainerInfo_GetContainerList(const char *ns,                   // IN
       goto exit;
    }
 
+   startTime = g_get_monotonic_time();
+
    res = std::make_unique<ListContainersResponse>();
    status = containerStub->List(&containerContext, req, res.get());
 
+   containersTime = g_get_monotonic_time();
+
    if (!status.ok()) {
       g_warning("%s: Failed to list containers. Error: %s\n", __FUNCTION__,
                 status.error_message().c_str());
@@ -115,34 +210,55 @@ ContainerInfo_GetContainerList(const char *ns,                   // IN
    g_debug("%s: Namespace: '%s', number of containers found: %d", __FUNCTION__,
            ns, res->containers_size());
 
-   for (i = 0, containersAdded = 0;
-        i < res->containers_size() && containersAdded < maxContainers; i++) {
-      Container curContainer = res->containers(i);
-      std::string id = curContainer.id();
-      std::string image = curContainer.image();
-      ContainerInfo *info;
-      GetRequest taskReq;
-      std::unique_ptr<GetResponse> taskRes;
-      grpc::Status taskStatus;
-      grpc::ClientContext taskContext;
+   if (res->containers_size() == 0) {
+      goto exit;
+   }
+
+   /*
+    * Get the tasks of all the containers in one call.
+    */
+   taskRes = std::make_unique<ListTasksResponse>();
+   status = taskStub->List(&taskContext, taskReq, taskRes.get());
+
+   tasksTime = g_get_monotonic_time();
 
-      taskContext.AddMetadata(namespaceKey, ns);
+   if (!status.ok()) {
+      g_warning("%s: Failed to list tasks. Error: %s\n", __FUNCTION__,
+                status.error_message().c_str());
+      goto exit;
+   }
+
+   g_debug("%s: Namespace: '%s', number of tasks found: %d, "
+           "list containers: %" G_GINT64_FORMAT " us, "
+           "list tasks: %" G_GINT64_FORMAT " us\n", __FUNCTION__,
+           ns, taskRes->tasks_size(), containersTime - startTime,
+           tasksTime - containersTime);
+
+   for (i = 0; i < taskRes->tasks_size(); i++) {
+      const Process &task = taskRes->tasks(i);
 
       /*
-       * Get pid for container using taskStub.
+       * The id of a container's init task is the container id.
        */
-      taskRes = std::make_unique<GetResponse>();
-      taskReq.set_container_id(id);
-      taskStatus = taskStub->Get(&taskContext, taskReq, taskRes.get());
-      if (!taskStatus.ok()) {
-         g_debug("%s: Task get service failed: %s. skipping container: %s\n",
-                 __FUNCTION__, taskStatus.error_message().c_str(), id.c_str());
+      taskIds.insert(task.container_id().empty() ? task.id() :
+                                                   task.container_id());
+   }
+
+   for (i = 0, containersAdded = 0;
+        i < res->containers_size() && containersAdded < maxContainers; i++) {
+      const Container &curContainer = res->containers(i);
+      const std::string &id = curContainer.id();
+      ContainerInfo *info;
+
+      if (taskIds.find(id) == taskIds.end()) {
+         g_debug("%s: No task found. skipping container: %s\n",
+                 __FUNCTION__, id.c_str());
          continue;
       }
 
       info = (ContainerInfo *)g_malloc(sizeof(*info));
       info->id = g_strdup(id.c_str());
-      info->image = g_strdup(image.c_str());
+      info->image = g_strdup(curContainer.image().c_str());
 
       g_debug("%s: Found container id: %s and image: %s\n", __FUNCTION__,
               info->id, info->image);
@@ -151,6 +267,120 @@ ContainerInfo_GetContainerList(const char *ns,                   // IN
    }
 
 exit:
-   g_free(unixSocket);
    return containerList;
 }
+
+
+/*
+ ******************************************************************************
+ * ContainerInfo_WatchEvents --
+ *
+ * @brief   Subscribes to the containerd events service and calls the
+ *          callback for every container or task event, until the
+ *          subscription fails or ContainerInfo_StopWatchingEvents is called.
+ *
+ * @param[in] containerdSocketPath     Path of the socket.
+ * @param[in] eventCb                  Callback invoked for every event.
+ * @param[in] clientData               Data passed to the callback.
+ *
+ * @retval TRUE  if the subscription was stopped.
+ * @retval FALSE if the subscription failed.
+ *
+ ******************************************************************************
+ */
+
+gboolean
+ContainerInfo_WatchEvents(const char *containerdSocketPath, // IN
+                          ContainerInfoEventCb eventCb,     // IN
+                          void *clientData)                 // IN
+{
+   std::shared_ptr<grpc::Channel> channel;
+   std::unique_ptr<Events::Stub> eventsStub;
+   std::unique_ptr<grpc::ClientReader<Envelope>> reader;
+   grpc::ClientContext context;
+   SubscribeRequest req;
+   Envelope envelope;
+   grpc::Status status;
+   gboolean stopped;
+   size_t i;
+
+   if (containerdSocketPath == NULL || eventCb == NULL) {
+      g_warning("%s: Invalid arguments specified.\n", __FUNCTION__);
+      return FALSE;
+   }
+
+   channel = ContainerInfoGetChannel(containerdSocketPath);
+   if (channel == nullptr) {
+      g_warning("%s: Failed to create gRPC channel\n", __FUNCTION__);
+      return FALSE;
+   }
+
+   eventsStub = Events::NewStub(channel);
+   if (eventsStub == nullptr) {
+      g_warning("%s: Failed to create eventsStub\n", __FUNCTION__);
+      return FALSE;
+   }
+
+   /*
+    * Filters are ORed by containerd.
+    */
+   for (i = 0; i < G_N_ELEMENTS(gEventTopics); i++) {
+      req.add_filters(std::string("topic==\"") + gEventTopics[i] + "\"");
+   }
+
+   {
+      std::lock_guard<std::mutex> lock(gChannelLock);
+
+      if (gEventsStopped) {
+         return TRUE;
+      }
+      gEventsContext = &context;
+   }
+
+   g_debug("%s: Subscribed to containerd events\n", __FUNCTION__);
+
+   reader = eventsStub->Subscribe(&context, req);
+   while (reader->Read(&envelope)) {
+      g_debug("%s: Received event '%s' in namespace '%s'\n", __FUNCTION__,
+              envelope.topic().c_str(), envelope.namespace_().c_str());
+      eventCb(envelope.namespace_().c_str(), envelope.topic().c_str(),
+              clientData);
+   }
+   status = reader->Finish();
+
+   {
+      std::lock_guard<std::mutex> lock(gChannelLock);
+
+      gEventsContext = nullptr;
+      stopped = gEventsStopped;
+   }
+
+   if (!stopped) {
+      g_info("%s: Events subscription ended. Error: %s\n", __FUNCTION__,
+             status.error_message().c_str());
+   }
+
+   return stopped;
+}
+
+
+/*
+ ******************************************************************************
+ * ContainerInfo_StopWatchingEvents --
+ *
+ * @brief   Cancels the active events subscription, and prevents any new
+ *          subscription from being made.
+ *
+ ******************************************************************************
+ */
+
+void
+ContainerInfo_StopWatchingEvents(void)
+{
+   std::lock_guard<std::mutex> lock(gChannelLock);
+
+   gEventsStopped = true;
+   if (gEventsContext != nullptr) {
+      gEventsContext->TryCancel();
+   }
+}
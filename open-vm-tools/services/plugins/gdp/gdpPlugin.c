@@ -308,6 +308,11 @@ VM_EMBED_VERSION(VMTOOLSD_VERSION_STRING);
 
 #define GDP_TOKENS_PER_ALLOC 50
 
+/*
+ * Publish submission queue item count limit
+ */
+#define GDP_PUBLISH_QUEUE_LIMIT 64
+
 
 /*
  * Gdp protocol 'error-id' response attribute table.
@@ -375,26 +380,46 @@ typedef struct PluginState {
 static PluginState gPluginState;
 
 
-typedef struct PublishState {
-   GMutex mutex; /* To sync incoming publish calls */
-
-   /*
-    * Data passed from the active incoming publish thread to
-    * the gdp task thread.
-    */
+typedef struct PublishItem {
    gint64 createTime; /* Real wall-clock time,
                        * in microseconds since January 1, 1970 UTC. */
-   const gchar *topic;
-   const gchar *token;
-   const gchar *category;
-   const gchar *data;
+   gchar *topic;
+   gchar *token;
+   gchar *category;
+   gchar *data;
    guint32 dataLen;
    gboolean cacheData;
    gboolean requireSubs; /* Subscriber presence required by publisher */
 
+   Bool blocking;        /* TRUE : Submitted by GdpPublish, the result is
+                          *        passed through gPublishState
+                          * FALSE: Submitted by GdpPublishAsync */
+   GdpPublishCallback callback; /* Async completion callback, can be NULL */
+   gpointer clientData;         /* Async completion callback data */
+} PublishItem;
+
+typedef struct PublishState {
+   GMutex mutex; /* To sync incoming blocking publish calls */
+
+   /*
+    * Protects the submission queue, and plugin start from incoming
+    * publish threads.
+    */
+   GMutex queueMutex;
+
+   /*
+    * Data passed from the incoming publish threads to the gdp task thread.
+    * Items are pushed at head and popped from tail.
+    */
+   GQueue queue;        /* Container for PublishItem */
+   guint32 queueLimit;  /* Async item count limit */
+   guint32 asyncCount;  /* Async items in queue */
+   Bool queueClosed;    /* TRUE : The gdp task thread has exited,
+                         *        no more items are accepted */
+
    /*
     * The publish event object:
-    * The active incoming publish thread signals this event object
+    * The incoming publish threads signal this event object
     * to notify the gdp task thread to publish new data.
     */
    GdpEvent eventPublish;
@@ -402,11 +427,11 @@ typedef struct PublishState {
    /*
     * The get-result event object:
     * The gdp task thread signals this event object to notify
-    * the active incoming publish thread to get publish result.
+    * the active incoming blocking publish thread to get publish result.
     */
    GdpEvent eventGetResult;
 
-   GdpError gdpErr; /* The publish result */
+   GdpError gdpErr; /* The blocking publish result */
 
 } PublishState;
 
@@ -454,29 +479,61 @@ typedef struct HistoryRequest {
    gint64 endCacheTime;      /* End cacheTime */
    guint64 id;               /* Subscription ID */
    GPtrArray *topicPrefixes; /* Topic prefixes */
+   guint64 endSeq;           /* First history cache record sequence number
+                              * after the request is received */
+   guint8 *topicMatch;       /* Indexed by history cache topic ID, non-zero
+                              * if the topic matches topicPrefixes.
+                              * NULL if the request has no topicPrefixes */
+   guint32 topicMatchLen;    /* topicMatch array length */
 } HistoryRequest;
 
-typedef struct HistoryCacheItem {
-   gint64 createTime; /* Guest data - begin */
-   gchar *topic;
-   gchar *token;
-   gchar *category;
-   gchar *data;
-   guint32 dataLen;   /* Guest data - end */
+/*
+ * History cache record header, followed by token, category and data.
+ * Records are laid out back to back in the history cache ring buffer,
+ * a record never wraps around the buffer end.
+ */
+typedef struct HistoryCacheRecord {
+   guint64 seq;          /* Record sequence number */
+   gint64 createTime;    /* Guest data - begin */
+   guint32 topicId;      /* Index into HistoryCache.topics */
+   guint32 tokenSize;    /* Including NUL, 0 for NULL token */
+   guint32 categorySize; /* Including NUL, 0 for NULL category */
+   guint32 dataLen;      /* Guest data - end */
    gboolean requireSubs; /* Publisher requires subscriber to publish Guest Data.
                           * Requires a V2 (and up) protocol compatible host;
                           * ignored otherwise */
-   gint64 cacheTime;  /* Monotonic time point when item is cached */
-   guint32 itemSize;  /* Item size in bytes */
-} HistoryCacheItem;
+   guint32 recordSize;   /* Record size in bytes, header included */
+   gint64 cacheTime;     /* Monotonic time point when record is cached */
+} HistoryCacheRecord;
+
+#define GDP_CACHE_RECORD_ALIGN ((guint32) sizeof(gint64))
+
+typedef struct HistoryCacheTopic {
+   gchar *topic;      /* Topic */
+   guint32 refCount;  /* Number of records with the topic */
+} HistoryCacheTopic;
 
 typedef struct HistoryCache {
-   GQueue queue;       /* Container for HistoryCacheItem */
+   guint8 *buf;        /* Ring buffer of HistoryCacheRecord,
+                        * sizeLimit bytes, allocated on first push */
    guint32 sizeLimit;  /* Cache buffer size limit */
    guint32 countLimit; /* Cache item count limit */
-   guint32 size;       /* Current cache buffer size */
-   GList *currentLink; /* Pointer to the history cache queue link
-                        * currently being published */
+   guint32 size;       /* Current cache buffer size used by records */
+   guint32 count;      /* Current record count */
+   guint32 head;       /* Offset of the earliest record */
+   guint32 tail;       /* Offset to append the next record */
+   guint32 wrap;       /* End offset of the records at the buffer end while
+                        * the ring is wrapped, sizeLimit otherwise */
+   guint64 headSeq;    /* Sequence number of the earliest record */
+   guint64 nextSeq;    /* Sequence number of the next record */
+   guint64 currentSeq; /* Sequence number of the record currently being
+                        * published, valid if currentValid is TRUE */
+   guint32 currentOffset; /* Offset of the currentSeq record */
+   Bool currentValid;
+
+   GPtrArray *topics;      /* Topic ID to HistoryCacheTopic, NULL if the
+                            * ID is free */
+   GHashTable *topicIndex; /* Topic to topic ID + 1 */
 } HistoryCache;
 
 typedef struct TaskContext {
@@ -500,9 +557,10 @@ typedef struct TaskContext {
    GdpTaskState state;
 
    /*
-    * Publish event object signalled while mode is GDP_TASK_MODE_HISTORY.
+    * The publish item being published while mode is GDP_TASK_MODE_PUBLISH.
+    * Queued publish items have priority over pending history requests.
     */
-   Bool publishPending;
+   PublishItem *item;
    /*
     * History request can be received at any time,
     * non-empty requests queue means history request pending.
@@ -578,18 +636,27 @@ GdpGetHistoryCacheCountLimit();
 static inline Bool
 GdpTaskIsHistoryCacheEnabled(TaskContext *taskCtx); // IN
 
+static inline HistoryCacheRecord *
+GdpHistoryCacheRecordAt(const HistoryCache *cache, // IN
+                        guint32 offset);           // IN
+
+static guint32
+GdpHistoryCacheNextOffset(const HistoryCache *cache, // IN
+                          guint32 offset);           // IN
+
 static void
-GdpHistoryCacheItemFree(HistoryCacheItem *item); // IN
+GdpTaskClearHistoryCache(TaskContext *taskCtx); // IN/OUT
 
 static void
-GdpHistoryCacheItemFreeGFunc(gpointer item_data,  // IN
-                             gpointer user_data); // IN
+GdpTaskDeleteHistoryCacheOldest(TaskContext *taskCtx); // IN/OUT
 
-static inline void
-GdpTaskClearHistoryCacheQueue(TaskContext *taskCtx); // IN/OUT
+static guint32
+GdpTaskHistoryCacheGetTopicId(TaskContext *taskCtx, // IN/OUT
+                              const gchar *topic);  // IN
 
 static void
-GdpTaskDeleteHistoryCacheTail(TaskContext *taskCtx); // IN/OUT
+GdpTaskHistoryCacheReleaseTopicId(TaskContext *taskCtx, // IN/OUT
+                                  guint32 id);          // IN
 
 static void
 GdpTaskHistoryCachePushItem(TaskContext *taskCtx,  // IN/OUT
@@ -628,6 +695,13 @@ static Bool
 GdpMatchTopicPrefixes(const gchar *topic,              // IN
                       const GPtrArray *topicPrefixes); // IN
 
+static inline Bool
+GdpHistoryRequestMatchRecord(const HistoryRequest *request,     // IN
+                             const HistoryCacheRecord *record); // IN
+
+static void
+GdpTaskAdvanceHistoryCachePointer(TaskContext *taskCtx); // IN/OUT
+
 static gchar *
 GdpTaskUpdateHistoryCachePointerAndGetSubscribers(
    TaskContext *taskCtx); // IN/OUT
@@ -635,6 +709,10 @@ GdpTaskUpdateHistoryCachePointerAndGetSubscribers(
 static void
 GdpTaskPublishHistory(TaskContext *taskCtx); // IN/OUT
 
+static void
+GdpTaskResizeHistoryCache(TaskContext *taskCtx, // IN/OUT
+                          guint32 sizeLimit);   // IN
+
 static void
 GdpTaskProcessConfigChange(TaskContext *taskCtx); // IN/OUT
 
@@ -659,6 +737,10 @@ GdpJsonIsHistoryRequest(const char *json,         // IN
                         int count,                // IN
                         HistoryRequest *request); // OUT
 
+static void
+GdpTaskIndexHistoryRequestTopics(TaskContext *taskCtx,     // IN
+                                 HistoryRequest *request); // IN/OUT
+
 static void
 GdpTaskProcessHistoryRequest(TaskContext *taskCtx,     // IN/OUT
                              HistoryRequest *request); // IN/OUT
@@ -666,6 +748,19 @@ GdpTaskProcessHistoryRequest(TaskContext *taskCtx,     // IN/OUT
 static void
 GdpTaskProcessNetwork(TaskContext *taskCtx); // IN/OUT
 
+static void
+GdpPublishItemFree(PublishItem *item); // IN
+
+static PublishItem *
+GdpPublishQueuePop(void);
+
+static void
+GdpTaskCompletePublish(TaskContext *taskCtx, // IN/OUT
+                       GdpError gdpErr);     // IN
+
+static void
+GdpTaskFailPublishQueue(TaskContext *taskCtx); // IN/OUT
+
 static void
 GdpTaskProcessPublish(TaskContext *taskCtx); // IN/OUT
 
@@ -1280,6 +1375,7 @@ GdpHistoryRequestFree(HistoryRequest *request) // IN
       g_ptr_array_free(request->topicPrefixes, TRUE);
    }
 
+   g_free(request->topicMatch);
    free(request);
 }
 
@@ -1403,95 +1499,226 @@ GdpTaskIsHistoryCacheEnabled(TaskContext *taskCtx) // IN
 
 /*
  *****************************************************************************
- * GdpHistoryCacheItemFree --
+ * GdpHistoryCacheRecordAt --
  *
- * Frees history cache item resources.
+ * Gets the history cache record at a ring buffer offset.
  *
- * @param[in] item  History cache item pointer
+ * @param[in] cache   The history cache
+ * @param[in] offset  Record offset
+ *
+ * @return The record pointer.
  *
  *****************************************************************************
  */
 
-static void
-GdpHistoryCacheItemFree(HistoryCacheItem *item) // IN
+static inline HistoryCacheRecord *
+GdpHistoryCacheRecordAt(const HistoryCache *cache, // IN
+                        guint32 offset)            // IN
 {
-   g_debug("%s: Entering ...\n", __FUNCTION__);
-   ASSERT(item != NULL);
-   free(item->topic);
-   free(item->token);
-   free(item->category);
-   free(item->data);
-   free(item);
+   ASSERT(cache->buf != NULL && offset < cache->sizeLimit);
+   return (HistoryCacheRecord *) (cache->buf + offset);
 }
 
 
 /*
  *****************************************************************************
- * GdpHistoryCacheItemFreeGFunc --
+ * GdpHistoryCacheNextOffset --
  *
- * GFunc called by GdpTaskClearHistoryCacheQueue.
+ * Gets the offset of the record following the record at offset.
+ * The caller must make sure the following record exists.
  *
- * @param[in] item_data  History cache item pointer
- * @param[in] user_data  Not used
+ * @param[in] cache   The history cache
+ * @param[in] offset  Record offset
+ *
+ * @return The following record offset.
  *
  *****************************************************************************
  */
 
-static void
-GdpHistoryCacheItemFreeGFunc(gpointer item_data, // IN
-                             gpointer user_data) // IN
+static guint32
+GdpHistoryCacheNextOffset(const HistoryCache *cache, // IN
+                          guint32 offset)            // IN
 {
-   GdpHistoryCacheItemFree((HistoryCacheItem *) item_data);
+   guint32 next = offset + GdpHistoryCacheRecordAt(cache, offset)->recordSize;
+
+   /*
+    * Records at the buffer end are followed by the record at offset 0.
+    */
+   return next == cache->wrap ? 0 : next;
 }
 
 
 /*
  *****************************************************************************
- * GdpTaskClearHistoryCacheQueue --
+ * GdpTaskHistoryCacheGetTopicId --
  *
- * Removes all the elements in history cache queue.
+ * Gets the topic ID for a new history cache record, adds the topic to the
+ * topic index if not present.
  *
  * @param[in,out] taskCtx  The task context
+ * @param[in]     topic    Topic
+ *
+ * @return The topic ID.
  *
  *****************************************************************************
  */
 
-static inline void
-GdpTaskClearHistoryCacheQueue(TaskContext *taskCtx) // IN/OUT
+static guint32
+GdpTaskHistoryCacheGetTopicId(TaskContext *taskCtx, // IN/OUT
+                              const gchar *topic)   // IN
 {
-   g_queue_foreach(&taskCtx->cache.queue, GdpHistoryCacheItemFreeGFunc, NULL);
-   g_queue_clear(&taskCtx->cache.queue);
+   HistoryCache *cache = &taskCtx->cache;
+   HistoryCacheTopic *entry;
+   gpointer value;
+   guint32 id;
+
+   if (g_hash_table_lookup_extended(cache->topicIndex, topic, NULL, &value)) {
+      id = GPOINTER_TO_UINT(value) - 1;
+      entry = (HistoryCacheTopic *) g_ptr_array_index(cache->topics, id);
+      entry->refCount++;
+      return id;
+   }
+
+   /*
+    * Reuses the lowest free ID, keeps history request topicMatch small.
+    */
+   for (id = 0; id < cache->topics->len; id++) {
+      if (g_ptr_array_index(cache->topics, id) == NULL) {
+         break;
+      }
+   }
+
+   entry = g_new(HistoryCacheTopic, 1);
+   entry->topic = g_strdup(topic);
+   entry->refCount = 1;
+
+   if (id == cache->topics->len) {
+      g_ptr_array_add(cache->topics, entry);
+   } else {
+      g_ptr_array_index(cache->topics, id) = entry;
+   }
 
+   g_hash_table_insert(cache->topicIndex, entry->topic,
+                       GUINT_TO_POINTER(id + 1));
+   return id;
 }
 
 
 /*
  *****************************************************************************
- * GdpTaskDeleteHistoryCacheTail --
+ * GdpTaskHistoryCacheReleaseTopicId --
  *
- * Deletes the tail of history cache queue and removes its reference.
+ * Releases the topic ID of a deleted history cache record, removes the
+ * topic from the topic index if no record refers to it.
  *
  * @param[in,out] taskCtx  The task context
+ * @param[in]     id       Topic ID
  *
  *****************************************************************************
  */
 
 static void
-GdpTaskDeleteHistoryCacheTail(TaskContext *taskCtx) // IN/OUT
+GdpTaskHistoryCacheReleaseTopicId(TaskContext *taskCtx, // IN/OUT
+                                  guint32 id)           // IN
 {
-   HistoryCacheItem *item;
+   HistoryCache *cache = &taskCtx->cache;
+   HistoryCacheTopic *entry;
+
+   ASSERT(id < cache->topics->len);
+   entry = (HistoryCacheTopic *) g_ptr_array_index(cache->topics, id);
+   ASSERT(entry != NULL && entry->refCount > 0);
+
+   if (--entry->refCount == 0) {
+      g_hash_table_remove(cache->topicIndex, entry->topic);
+      g_ptr_array_index(cache->topics, id) = NULL;
+      g_free(entry->topic);
+      g_free(entry);
+   }
+}
 
-   ASSERT(!g_queue_is_empty(&taskCtx->cache.queue));
 
-   if (taskCtx->cache.currentLink ==
-       g_queue_peek_tail_link(&taskCtx->cache.queue)) {
-      taskCtx->cache.currentLink = NULL;
+/*
+ *****************************************************************************
+ * GdpTaskClearHistoryCache --
+ *
+ * Removes all the records in history cache and frees the ring buffer.
+ *
+ * @param[in,out] taskCtx  The task context
+ *
+ *****************************************************************************
+ */
+
+static void
+GdpTaskClearHistoryCache(TaskContext *taskCtx) // IN/OUT
+{
+   HistoryCache *cache = &taskCtx->cache;
+   guint32 id;
+
+   for (id = 0; id < cache->topics->len; id++) {
+      HistoryCacheTopic *entry = g_ptr_array_index(cache->topics, id);
+      if (entry != NULL) {
+         g_free(entry->topic);
+         g_free(entry);
+      }
    }
+   g_ptr_array_set_size(cache->topics, 0);
+   g_hash_table_remove_all(cache->topicIndex);
+
+   g_free(cache->buf);
+   cache->buf = NULL;
+   cache->size = 0;
+   cache->count = 0;
+   cache->head = 0;
+   cache->tail = 0;
+   cache->wrap = cache->sizeLimit;
+   cache->headSeq = cache->nextSeq;
+   cache->currentValid = FALSE;
+}
 
-   item = (HistoryCacheItem *) g_queue_pop_tail(&taskCtx->cache.queue);
-   ASSERT(item != NULL);
-   taskCtx->cache.size -= item->itemSize;
-   GdpHistoryCacheItemFree(item);
+
+/*
+ *****************************************************************************
+ * GdpTaskDeleteHistoryCacheOldest --
+ *
+ * Deletes the earliest record in history cache and resets the history
+ * cache pointer if it refers to the record.
+ *
+ * @param[in,out] taskCtx  The task context
+ *
+ *****************************************************************************
+ */
+
+static void
+GdpTaskDeleteHistoryCacheOldest(TaskContext *taskCtx) // IN/OUT
+{
+   HistoryCache *cache = &taskCtx->cache;
+   HistoryCacheRecord *record;
+
+   ASSERT(cache->count > 0);
+
+   record = GdpHistoryCacheRecordAt(cache, cache->head);
+   ASSERT(record->seq == cache->headSeq);
+
+   if (cache->currentValid && cache->currentSeq == record->seq) {
+      cache->currentValid = FALSE;
+   }
+
+   GdpTaskHistoryCacheReleaseTopicId(taskCtx, record->topicId);
+   cache->size -= record->recordSize;
+   cache->count--;
+   cache->headSeq++;
+
+   if (cache->count == 0) {
+      cache->head = 0;
+      cache->tail = 0;
+      cache->wrap = cache->sizeLimit;
+   } else {
+      cache->head += record->recordSize;
+      if (cache->head == cache->wrap) {
+         cache->head = 0;
+         cache->wrap = cache->sizeLimit;
+      }
+   }
 }
 
 
@@ -1499,7 +1726,8 @@ GdpTaskDeleteHistoryCacheTail(TaskContext *taskCtx) // IN/OUT
  ******************************************************************************
  * GdpTaskHistoryCachePushItem --
  *
- * Pushes the published guest data item into history cache queue.
+ * Appends the published guest data item to history cache ring buffer as
+ * one record, deleting the earliest records to make room.
  *
  * @param[in,out]      taskCtx     The task context
  * @param[in]          createTime  UTC timestamp, in number of micro-
@@ -1525,42 +1753,96 @@ GdpTaskHistoryCachePushItem(TaskContext *taskCtx,  // IN/OUT
                             guint32 dataLen,       // IN
                             gboolean requireSubs)  // IN
 {
-   HistoryCacheItem *item;
+   HistoryCache *cache = &taskCtx->cache;
+   HistoryCacheRecord *record;
+   guint32 tokenSize = GDP_STR_SIZE(token);
+   guint32 categorySize = GDP_STR_SIZE(category);
+   guint32 recordSize;
+   guint32 offset;
+   gchar *payload;
 
    ASSERT(topic != NULL);
    ASSERT(data != NULL && dataLen > 0);
    ASSERT(GdpTaskIsHistoryCacheEnabled(taskCtx));
 
-   item = (HistoryCacheItem *) Util_SafeMalloc(sizeof(HistoryCacheItem));
-   item->createTime = createTime;
-   item->topic = Util_SafeStrdup(topic);
-   item->token = Util_SafeStrdup(token);
-   item->category = Util_SafeStrdup(category);
-   item->data = (gchar *) Util_SafeMalloc(dataLen);
-   Util_Memcpy(item->data, data, dataLen);
-   item->dataLen = dataLen;
-   item->requireSubs = requireSubs;
+   recordSize = ROUNDUP((guint32) sizeof *record + tokenSize + categorySize +
+                        dataLen, GDP_CACHE_RECORD_ALIGN);
+   if (recordSize > cache->sizeLimit) {
+      g_info("%s: History cache record size %u exceeds cache size %u.\n",
+             __FUNCTION__, recordSize, cache->sizeLimit);
+      return;
+   }
 
-   item->cacheTime = g_get_monotonic_time();
-   item->itemSize = ((guint32) sizeof(HistoryCacheItem))
-                    + GDP_STR_SIZE(item->topic)
-                    + GDP_STR_SIZE(item->token)
-                    + GDP_STR_SIZE(item->category)
-                    + item->dataLen;
+   if (cache->buf == NULL) {
+      cache->buf = g_malloc(cache->sizeLimit);
+      cache->wrap = cache->sizeLimit;
+   }
 
-   while (taskCtx->cache.size + item->itemSize >
-             taskCtx->cache.sizeLimit ||
-          g_queue_get_length(&taskCtx->cache.queue) >=
-             taskCtx->cache.countLimit) {
-      GdpTaskDeleteHistoryCacheTail(taskCtx);
+   while (cache->count >= cache->countLimit) {
+      GdpTaskDeleteHistoryCacheOldest(taskCtx);
    }
 
-   g_queue_push_head(&taskCtx->cache.queue, item);
-   taskCtx->cache.size += item->itemSize;
+   /*
+    * Records are in [head, tail) while the ring is not wrapped, and in
+    * [head, wrap) followed by [0, tail) while it is wrapped.
+    */
+   while (TRUE) {
+      if (cache->count == 0) {
+         offset = 0;
+         break;
+      }
+
+      if (cache->tail > cache->head) {
+         if (cache->sizeLimit - cache->tail >= recordSize) {
+            offset = cache->tail;
+            break;
+         }
+
+         if (cache->head >= recordSize) {
+            cache->wrap = cache->tail;
+            offset = 0;
+            break;
+         }
+      } else if (cache->head - cache->tail >= recordSize) {
+         offset = cache->tail;
+         break;
+      }
+
+      GdpTaskDeleteHistoryCacheOldest(taskCtx);
+   }
+
+   record = GdpHistoryCacheRecordAt(cache, offset);
+   record->seq = cache->nextSeq++;
+   record->createTime = createTime;
+   record->topicId = GdpTaskHistoryCacheGetTopicId(taskCtx, topic);
+   record->tokenSize = tokenSize;
+   record->categorySize = categorySize;
+   record->dataLen = dataLen;
+   record->requireSubs = requireSubs;
+   record->recordSize = recordSize;
+   record->cacheTime = g_get_monotonic_time();
+
+   payload = (gchar *) (record + 1);
+   if (tokenSize > 0) {
+      Util_Memcpy(payload, token, tokenSize);
+      payload += tokenSize;
+   }
+   if (categorySize > 0) {
+      Util_Memcpy(payload, category, categorySize);
+      payload += categorySize;
+   }
+   Util_Memcpy(payload, data, dataLen);
+
+   if (cache->count == 0) {
+      cache->head = 0;
+      cache->headSeq = record->seq;
+   }
+   cache->tail = offset + recordSize;
+   cache->size += recordSize;
+   cache->count++;
 
    g_debug("%s: Current history cache size in bytes: %u, item count: %u.\n",
-           __FUNCTION__, taskCtx->cache.size,
-           g_queue_get_length(&taskCtx->cache.queue));
+           __FUNCTION__, cache->size, cache->count);
 }
 
 
@@ -1656,9 +1938,10 @@ GdpTaskBuildPacket(TaskContext *taskCtx,     // IN/OUT
    if (data == NULL || dataLen == 0) {
       /*
        * ZeroData: Empty/no data is allowed only if requireSubs=true AND
-       *           gPublishState.cacheData=false.
+       *           cacheData=false.
        */
-      ASSERT(requireSubs && !gPublishState.cacheData); /* see: GdpPublish() */
+      ASSERT(requireSubs && taskCtx->item != NULL &&
+             !taskCtx->item->cacheData); /* see: GdpPublishSubmit() */
       base64Data[0] = '\0';  // ZeroData: set empty payload.
    } else if (!Base64_Encode(data, dataLen,
                              base64Data, sizeof base64Data, NULL)) {
@@ -1845,11 +2128,75 @@ GdpMatchTopicPrefixes(const gchar *topic,             // IN
 }
 
 
+/*
+ *****************************************************************************
+ * GdpHistoryRequestMatchRecord --
+ *
+ * Matches a history cache record topic against the request topic prefixes,
+ * using the request topic match index.
+ *
+ * @param[in] request  History request
+ * @param[in] record   History cache record
+ *
+ * @return TRUE if the request has no topic prefixes or the record topic
+ *         matches any prefix.
+ * @return FALSE otherwise.
+ *
+ *****************************************************************************
+ */
+
+static inline Bool
+GdpHistoryRequestMatchRecord(const HistoryRequest *request,     // IN
+                             const HistoryCacheRecord *record)  // IN
+{
+   if (request->topicMatch == NULL) {
+      return TRUE;
+   }
+
+   /*
+    * Topic IDs of records cached after the request was received may have
+    * been reused, and are not covered by the index.
+    */
+   return record->seq < request->endSeq &&
+          record->topicId < request->topicMatchLen &&
+          request->topicMatch[record->topicId] != 0;
+}
+
+
+/*
+ *****************************************************************************
+ * GdpTaskAdvanceHistoryCachePointer --
+ *
+ * Moves history cache pointer to the next record, invalidates it if there
+ * is no next record.
+ *
+ * @param[in,out] taskCtx  The task context
+ *
+ *****************************************************************************
+ */
+
+static void
+GdpTaskAdvanceHistoryCachePointer(TaskContext *taskCtx) // IN/OUT
+{
+   HistoryCache *cache = &taskCtx->cache;
+
+   ASSERT(cache->currentValid);
+
+   if (cache->currentSeq + 1 == cache->nextSeq) {
+      cache->currentValid = FALSE;
+   } else {
+      cache->currentOffset = GdpHistoryCacheNextOffset(cache,
+                                                       cache->currentOffset);
+      cache->currentSeq++;
+   }
+}
+
+
 /*
  *****************************************************************************
  * GdpTaskUpdateHistoryCachePointerAndGetSubscribers --
  *
- * Updates history cache pointer and gets subscribers of the pointed item.
+ * Updates history cache pointer and gets subscribers of the pointed record.
  *
  * @param[in,out] taskCtx  The task context
  *
@@ -1864,33 +2211,39 @@ static gchar *
 GdpTaskUpdateHistoryCachePointerAndGetSubscribers(
    TaskContext *taskCtx) // IN/OUT
 {
+   HistoryCache *cache = &taskCtx->cache;
    gchar *subscribers = NULL;
 
-   if (taskCtx->cache.currentLink == NULL) {
+   if (!cache->currentValid) {
+      if (cache->count == 0) {
+         return NULL;
+      }
+
       /*
-       * Starts with the earliest history cache link.
+       * Starts with the earliest history cache record.
        */
-      taskCtx->cache.currentLink = g_queue_peek_tail_link(
-                                      &taskCtx->cache.queue);
+      cache->currentSeq = cache->headSeq;
+      cache->currentOffset = cache->head;
+      cache->currentValid = TRUE;
    }
 
-   while (taskCtx->cache.currentLink != NULL &&
+   while (cache->currentValid &&
           !g_queue_is_empty(&taskCtx->requests)) {
-      HistoryCacheItem *item;
+      HistoryCacheRecord *record;
       GList *requestList;
 
-      item = (HistoryCacheItem *) taskCtx->cache.currentLink->data;
+      record = GdpHistoryCacheRecordAt(cache, cache->currentOffset);
+      ASSERT(record->seq == cache->currentSeq);
       requestList = g_queue_peek_tail_link(&taskCtx->requests);
       while (requestList != NULL) {
          HistoryRequest *request = (HistoryRequest *) requestList->data;
          Bool requestDone = FALSE;
 
-         if (item->cacheTime > request->endCacheTime) {
+         if (record->cacheTime > request->endCacheTime) {
             requestDone = TRUE;
-         } else if (request->beginCacheTime < item->cacheTime &&
-                    item->cacheTime <= request->endCacheTime) {
-            if (request->topicPrefixes == NULL ||
-                GdpMatchTopicPrefixes(item->topic, request->topicPrefixes)) {
+         } else if (request->beginCacheTime < record->cacheTime &&
+                    record->cacheTime <= request->endCacheTime) {
+            if (GdpHistoryRequestMatchRecord(request, record)) {
                if (subscribers == NULL) {
                   subscribers = g_strdup_printf("%" G_GUINT64_FORMAT,
                                                 request->id);
@@ -1903,10 +2256,10 @@ GdpTaskUpdateHistoryCachePointerAndGetSubscribers(
                }
             }
 
-            if (item->cacheTime == request->endCacheTime) {
+            if (record->cacheTime == request->endCacheTime) {
                requestDone = TRUE;
             } else {
-               request->beginCacheTime = item->cacheTime;
+               request->beginCacheTime = record->cacheTime;
             }
          }
 
@@ -1924,7 +2277,7 @@ GdpTaskUpdateHistoryCachePointerAndGetSubscribers(
          break;
       }
 
-      taskCtx->cache.currentLink = taskCtx->cache.currentLink->prev;
+      GdpTaskAdvanceHistoryCachePointer(taskCtx);
    }
 
    return subscribers;
@@ -1947,7 +2300,10 @@ GdpTaskPublishHistory(TaskContext *taskCtx) // IN/OUT
 {
    GdpError gdpErr;
    gchar *subscribers;
-   HistoryCacheItem *item;
+   HistoryCache *cache = &taskCtx->cache;
+   const HistoryCacheRecord *record;
+   const HistoryCacheTopic *entry;
+   const gchar *payload;
 
    g_debug("%s: Entering ...\n", __FUNCTION__);
 
@@ -1961,22 +2317,33 @@ GdpTaskPublishHistory(TaskContext *taskCtx) // IN/OUT
       goto cleanup;
    }
 
-   ASSERT(taskCtx->cache.currentLink != NULL);
-   item = (HistoryCacheItem *) taskCtx->cache.currentLink->data;
+   ASSERT(cache->currentValid);
+   record = GdpHistoryCacheRecordAt(cache, cache->currentOffset);
+   entry = g_ptr_array_index(cache->topics, record->topicId);
+   payload = (const gchar *) (record + 1);
+
    /*
-    * Updates history cache pointer.
+    * The packet is built straight from the record in the ring buffer,
+    * which stays in place until the next push.
     */
-   taskCtx->cache.currentLink = taskCtx->cache.currentLink->prev;
-
    gdpErr = GdpTaskBuildPacket(taskCtx,
-                               item->createTime,
-                               item->topic,
-                               item->token,
-                               item->category,
-                               item->data,
-                               item->dataLen,
-                               item->requireSubs,
+                               record->createTime,
+                               entry->topic,
+                               record->tokenSize > 0 ?
+                                  payload : NULL,
+                               record->categorySize > 0 ?
+                                  payload + record->tokenSize : NULL,
+                               payload + record->tokenSize +
+                                  record->categorySize,
+                               record->dataLen,
+                               record->requireSubs,
                                subscribers);
+
+   /*
+    * Updates history cache pointer.
+    */
+   GdpTaskAdvanceHistoryCachePointer(taskCtx);
+
    if (gdpErr != GDP_ERROR_SUCCESS) {
       /*
        * Theoretically speaking, too many subscribers could cause JSON packet
@@ -2010,11 +2377,67 @@ GdpTaskPublishHistory(TaskContext *taskCtx) // IN/OUT
    return;
 
 cleanup:
-   taskCtx->cache.currentLink = NULL;
+   cache->currentValid = FALSE;
    GdpTaskClearHistoryRequestQueue(taskCtx);
 }
 
 
+/*
+ *****************************************************************************
+ * GdpTaskResizeHistoryCache --
+ *
+ * Moves the history cache records into a ring buffer of the new size.
+ * The records must fit in the new size.
+ *
+ * @param[in,out] taskCtx    The task context
+ * @param[in]     sizeLimit  New cache buffer size limit
+ *
+ *****************************************************************************
+ */
+
+static void
+GdpTaskResizeHistoryCache(TaskContext *taskCtx, // IN/OUT
+                          guint32 sizeLimit)    // IN
+{
+   HistoryCache *cache = &taskCtx->cache;
+   guint8 *buf = NULL;
+   guint32 offset = cache->head;
+   guint32 newOffset = 0;
+   guint32 index;
+
+   ASSERT(cache->size <= sizeLimit);
+
+   if (cache->count > 0) {
+      buf = g_malloc(sizeLimit);
+
+      /*
+       * Lays out the records from offset 0, earliest first.
+       */
+      for (index = 0; index < cache->count; index++) {
+         HistoryCacheRecord *record = GdpHistoryCacheRecordAt(cache, offset);
+
+         if (cache->currentValid && cache->currentSeq == record->seq) {
+            cache->currentOffset = newOffset;
+         }
+
+         memcpy(buf + newOffset, record, record->recordSize);
+         newOffset += record->recordSize;
+
+         if (index + 1 < cache->count) {
+            offset = GdpHistoryCacheNextOffset(cache, offset);
+         }
+      }
+   }
+
+   g_free(cache->buf);
+   cache->buf = buf;
+   cache->sizeLimit = sizeLimit;
+   cache->head = 0;
+   cache->tail = newOffset;
+   cache->wrap = sizeLimit;
+}
+
+
 /*
  *****************************************************************************
  * GdpTaskProcessConfigChange --
@@ -2039,17 +2462,19 @@ GdpTaskProcessConfigChange(TaskContext *taskCtx) // IN/OUT
 
    g_debug("%s: Current history cache buffer size limit: %u, new value: %u.\n",
            __FUNCTION__, taskCtx->cache.sizeLimit, sizeLimit);
-   taskCtx->cache.sizeLimit = sizeLimit;
-
    g_debug("%s: Current history cache item count limit: %u, new value: %u.\n",
            __FUNCTION__, taskCtx->cache.countLimit, countLimit);
-   taskCtx->cache.countLimit = countLimit;
 
-   while (taskCtx->cache.size > taskCtx->cache.sizeLimit ||
-          g_queue_get_length(&taskCtx->cache.queue) >
-             taskCtx->cache.countLimit) {
-      GdpTaskDeleteHistoryCacheTail(taskCtx);
+   while (taskCtx->cache.size > sizeLimit ||
+          taskCtx->cache.count > countLimit) {
+      GdpTaskDeleteHistoryCacheOldest(taskCtx);
+   }
+
+   if (taskCtx->cache.sizeLimit != sizeLimit) {
+      GdpTaskResizeHistoryCache(taskCtx, sizeLimit);
    }
+
+   taskCtx->cache.countLimit = countLimit;
 }
 
 
@@ -2283,39 +2708,43 @@ GdpTaskProcessPublishResult(TaskContext *taskCtx,        // IN/OUT
    }
 
    if (taskCtx->mode == GDP_TASK_MODE_PUBLISH) {
+      PublishItem *item = taskCtx->item;
       Bool addToHistory = FALSE;
+      GdpError gdpErr;
+
+      ASSERT(item != NULL);
 
       if (result->statusOk) {
-         gPublishState.gdpErr = GDP_ERROR_SUCCESS;
+         gdpErr = GDP_ERROR_SUCCESS;
          addToHistory = TRUE;
       } else if (result->version >= GDP_PROTOCOL_VERSIONED_VERSION) {
          // V2 and up; use result->errorId
-         gPublishState.gdpErr = result->errorId;
+         gdpErr = result->errorId;
 
-         if (gPublishState.requireSubs &&
+         if (item->requireSubs &&
              result->errorId == GDP_ERROR_NO_SUBSCRIBERS) {
             // Add Data Message to history on no-subscriber error.
             addToHistory = TRUE;
          }
       } else {
          // Unversioned/original - default error response.
-         gPublishState.gdpErr = GDP_ERROR_INVALID_DATA;
+         gdpErr = GDP_ERROR_INVALID_DATA;
       }
 
       if (addToHistory &&
           GdpTaskIsHistoryCacheEnabled(taskCtx) &&
-          gPublishState.cacheData) {
+          item->cacheData) {
          GdpTaskHistoryCachePushItem(taskCtx,
-                                     gPublishState.createTime,
-                                     gPublishState.topic,
-                                     gPublishState.token,
-                                     gPublishState.category,
-                                     gPublishState.data,
-                                     gPublishState.dataLen,
-                                     gPublishState.requireSubs);
+                                     item->createTime,
+                                     item->topic,
+                                     item->token,
+                                     item->category,
+                                     item->data,
+                                     item->dataLen,
+                                     item->requireSubs);
       }
 
-      GdpSetEvent(gPublishState.eventGetResult);
+      GdpTaskCompletePublish(taskCtx, gdpErr);
    }
 
    GdpTaskDestroyPacket(taskCtx);
@@ -2412,6 +2841,49 @@ GdpJsonIsHistoryRequest(const char *json,        // IN
 }
 
 
+/*
+ *****************************************************************************
+ * GdpTaskIndexHistoryRequestTopics --
+ *
+ * Matches the topics currently in history cache against the request topic
+ * prefixes once, so that replaying the request checks a record topic ID
+ * instead of comparing strings.
+ *
+ * All the records in the request time range are cached at this point,
+ * so their topics are covered by the index.
+ *
+ * @param[in]     taskCtx  The task context
+ * @param[in,out] request  History request with topic prefixes
+ *
+ *****************************************************************************
+ */
+
+static void
+GdpTaskIndexHistoryRequestTopics(TaskContext *taskCtx,    // IN
+                                 HistoryRequest *request) // IN/OUT
+{
+   const HistoryCache *cache = &taskCtx->cache;
+   guint32 id;
+
+   ASSERT(request->topicPrefixes != NULL);
+
+   request->topicMatchLen = cache->topics->len;
+   request->topicMatch = g_malloc0(MAX(request->topicMatchLen, 1));
+
+   for (id = 0; id < cache->topics->len; id++) {
+      const HistoryCacheTopic *entry = g_ptr_array_index(cache->topics, id);
+
+      if (entry != NULL &&
+          GdpMatchTopicPrefixes(entry->topic, request->topicPrefixes)) {
+         request->topicMatch[id] = 1;
+      }
+   }
+
+   g_ptr_array_free(request->topicPrefixes, TRUE);
+   request->topicPrefixes = NULL;
+}
+
+
 /*
  *****************************************************************************
  * GdpTaskProcessHistoryRequest --
@@ -2453,6 +2925,13 @@ GdpTaskProcessHistoryRequest(TaskContext *taskCtx,    // IN/OUT
    requestCopy->id = request->id;
    requestCopy->topicPrefixes = request->topicPrefixes;
    request->topicPrefixes = NULL;
+   requestCopy->endSeq = taskCtx->cache.nextSeq;
+   requestCopy->topicMatch = NULL;
+   requestCopy->topicMatchLen = 0;
+
+   if (requestCopy->topicPrefixes != NULL) {
+      GdpTaskIndexHistoryRequestTopics(taskCtx, requestCopy);
+   }
 
    /*
     * Note: each request comes with a unique subscription ID.
@@ -2461,7 +2940,7 @@ GdpTaskProcessHistoryRequest(TaskContext *taskCtx,    // IN/OUT
    /*
     * Resets history cache pointer.
     */
-   taskCtx->cache.currentLink = NULL;
+   taskCtx->cache.currentValid = FALSE;
 
    return;
 
@@ -2574,6 +3053,128 @@ GdpTaskProcessNetwork(TaskContext *taskCtx) // IN/OUT
 }
 
 
+/*
+ *****************************************************************************
+ * GdpPublishItemFree --
+ *
+ * Frees publish item resources.
+ *
+ * @param[in] item  Publish item pointer
+ *
+ *****************************************************************************
+ */
+
+static void
+GdpPublishItemFree(PublishItem *item) // IN
+{
+   ASSERT(item != NULL);
+   g_free(item->topic);
+   g_free(item->token);
+   g_free(item->category);
+   g_free(item->data);
+   g_free(item);
+}
+
+
+/*
+ *****************************************************************************
+ * GdpPublishQueuePop --
+ *
+ * Pops the earliest item from the publish submission queue.
+ *
+ * @return The publish item, to be freed by caller.
+ * @return NULL if the queue is empty.
+ *
+ *****************************************************************************
+ */
+
+static PublishItem *
+GdpPublishQueuePop(void)
+{
+   PublishItem *item;
+
+   g_mutex_lock(&gPublishState.queueMutex);
+   item = (PublishItem *) g_queue_pop_tail(&gPublishState.queue);
+   if (item != NULL && !item->blocking) {
+      ASSERT(gPublishState.asyncCount > 0);
+      gPublishState.asyncCount--;
+   }
+   g_mutex_unlock(&gPublishState.queueMutex);
+
+   return item;
+}
+
+
+/*
+ *****************************************************************************
+ * GdpTaskCompletePublish --
+ *
+ * Passes the publish result to the submitter of the current publish item,
+ * then frees the item.
+ *
+ * @param[in,out] taskCtx  The task context
+ * @param[in]     gdpErr   The publish result
+ *
+ *****************************************************************************
+ */
+
+static void
+GdpTaskCompletePublish(TaskContext *taskCtx, // IN/OUT
+                       GdpError gdpErr)      // IN
+{
+   PublishItem *item = taskCtx->item;
+
+   ASSERT(item != NULL);
+   taskCtx->item = NULL;
+
+   if (item->blocking) {
+      gPublishState.gdpErr = gdpErr;
+      GdpSetEvent(gPublishState.eventGetResult);
+   } else if (item->callback != NULL) {
+      item->callback(gdpErr, item->clientData);
+   }
+
+   GdpPublishItemFree(item);
+}
+
+
+/*
+ *****************************************************************************
+ * GdpTaskFailPublishQueue --
+ *
+ * Fails the current and all the queued publish items with GDP_ERROR_STOP,
+ * and closes the publish submission queue.
+ *
+ * @param[in,out] taskCtx  The task context
+ *
+ *****************************************************************************
+ */
+
+static void
+GdpTaskFailPublishQueue(TaskContext *taskCtx) // IN/OUT
+{
+   GQueue queue;
+
+   if (taskCtx->item != NULL) {
+      GdpTaskCompletePublish(taskCtx, GDP_ERROR_STOP);
+   }
+
+   g_mutex_lock(&gPublishState.queueMutex);
+   gPublishState.queueClosed = TRUE;
+   queue = gPublishState.queue;
+   g_queue_init(&gPublishState.queue);
+   gPublishState.asyncCount = 0;
+   g_mutex_unlock(&gPublishState.queueMutex);
+
+   /*
+    * Callbacks are called without holding the queue lock.
+    */
+   while ((taskCtx->item = (PublishItem *) g_queue_pop_tail(&queue)) != NULL) {
+      GdpTaskCompletePublish(taskCtx, GDP_ERROR_STOP);
+   }
+}
+
+
 /*
  *****************************************************************************
  * GdpTaskProcessPublish --
@@ -2589,28 +3190,35 @@ static void
 GdpTaskProcessPublish(TaskContext *taskCtx) // IN/OUT
 {
    GdpError gdpErr;
+   PublishItem *item;
 
    g_debug("%s: Entering ...\n", __FUNCTION__);
 
-   ASSERT(taskCtx->mode != GDP_TASK_MODE_PUBLISH);
-
    if (taskCtx->mode != GDP_TASK_MODE_NONE) {
-      g_debug("%s: Set publish pending.\n", __FUNCTION__);
-      ASSERT(!taskCtx->publishPending);
-      taskCtx->publishPending = TRUE;
+      /*
+       * The queued item is picked up once the task is back to idle.
+       */
+      g_debug("%s: Publish pending.\n", __FUNCTION__);
       return;
    }
 
    ASSERT(taskCtx->state == GDP_TASK_STATE_IDLE);
+   ASSERT(taskCtx->item == NULL);
 
+   item = GdpPublishQueuePop();
+   if (item == NULL) {
+      return;
+   }
+
+   taskCtx->item = item;
    gdpErr = GdpTaskBuildPacket(taskCtx,
-                               gPublishState.createTime,
-                               gPublishState.topic,
-                               gPublishState.token,
-                               gPublishState.category,
-                               gPublishState.data,
-                               gPublishState.dataLen,
-                               gPublishState.requireSubs,
+                               item->createTime,
+                               item->topic,
+                               item->token,
+                               item->category,
+                               item->data,
+                               item->dataLen,
+                               item->requireSubs,
                                NULL);
    if (gdpErr != GDP_ERROR_SUCCESS) {
       goto fail;
@@ -2634,8 +3242,7 @@ GdpTaskProcessPublish(TaskContext *taskCtx) // IN/OUT
    return;
 
 fail:
-   gPublishState.gdpErr = gdpErr;
-   GdpSetEvent(gPublishState.eventGetResult);
+   GdpTaskCompletePublish(taskCtx, gdpErr);
 }
 
 
@@ -2689,8 +3296,7 @@ GdpTaskProcessTimeout(TaskContext *taskCtx) // IN/OUT
 
 fail:
    if (taskCtx->mode == GDP_TASK_MODE_PUBLISH) {
-      gPublishState.gdpErr = gdpErr;
-      GdpSetEvent(gPublishState.eventGetResult);
+      GdpTaskCompletePublish(taskCtx, gdpErr);
    }
 
    taskCtx->state = GDP_TASK_STATE_IDLE;
@@ -3012,13 +3618,23 @@ GdpTaskCtxInit(TaskContext *taskCtx) // OUT
 {
    taskCtx->mode = GDP_TASK_MODE_NONE;
    taskCtx->state = GDP_TASK_STATE_IDLE;
-   taskCtx->publishPending = FALSE;
+   taskCtx->item = NULL;
 
-   g_queue_init(&taskCtx->cache.queue);
+   taskCtx->cache.buf = NULL;
    taskCtx->cache.sizeLimit = GdpGetHistoryCacheSizeLimit();
    taskCtx->cache.countLimit = GdpGetHistoryCacheCountLimit();
    taskCtx->cache.size = 0;
-   taskCtx->cache.currentLink = NULL;
+   taskCtx->cache.count = 0;
+   taskCtx->cache.head = 0;
+   taskCtx->cache.tail = 0;
+   taskCtx->cache.wrap = taskCtx->cache.sizeLimit;
+   taskCtx->cache.headSeq = 0;
+   taskCtx->cache.nextSeq = 0;
+   taskCtx->cache.currentSeq = 0;
+   taskCtx->cache.currentOffset = 0;
+   taskCtx->cache.currentValid = FALSE;
+   taskCtx->cache.topics = g_ptr_array_new();
+   taskCtx->cache.topicIndex = g_hash_table_new(g_str_hash, g_str_equal);
 
    g_queue_init(&taskCtx->requests);
 
@@ -3045,7 +3661,9 @@ GdpTaskCtxInit(TaskContext *taskCtx) // OUT
 static void
 GdpTaskCtxDestroy(TaskContext *taskCtx) // IN/OUT
 {
-   GdpTaskClearHistoryCacheQueue(taskCtx);
+   GdpTaskClearHistoryCache(taskCtx);
+   g_ptr_array_free(taskCtx->cache.topics, TRUE);
+   g_hash_table_destroy(taskCtx->cache.topicIndex);
    GdpTaskClearHistoryRequestQueue(taskCtx);
    GdpTaskDestroyPacket(taskCtx);
 }
@@ -3087,10 +3705,9 @@ GdpThreadTask(ToolsAppCtx *ctx, // IN
          ASSERT(taskCtx.state == GDP_TASK_STATE_IDLE);
          ASSERT(taskCtx.timeoutAt == GDP_TIMEOUT_AT_INFINITE);
 
-         if (taskCtx.publishPending) { // Higher priority
-            taskCtx.publishPending = FALSE;
-            GdpTaskProcessPublish(&taskCtx);
-         } else if (!g_queue_is_empty(&taskCtx.requests)) {
+         GdpTaskProcessPublish(&taskCtx); // Higher priority
+         if (taskCtx.mode == GDP_TASK_MODE_NONE &&
+             !g_queue_is_empty(&taskCtx.requests)) {
             /*
              * History request pending.
              *
@@ -3116,11 +3733,11 @@ GdpThreadTask(ToolsAppCtx *ctx, // IN
       /*
        * timeout == GDP_WAIT_INFINITE means taskCtx.mode == GDP_TASK_MODE_NONE
        * and taskCtx.state == GDP_TASK_STATE_IDLE. There should be no pending
-       * publish event or history request in this case.
+       * history request in this case. A publish item queued after part 1
+       * comes with the publish event signalled.
        */
       ASSERT(timeout != GDP_WAIT_INFINITE ||
-             (!taskCtx.publishPending &&
-              g_queue_is_empty(&taskCtx.requests)));
+             g_queue_is_empty(&taskCtx.requests));
 
       gdpErr = GdpTaskWaitForEvents(timeout, &taskEvent);
       if (gdpErr != GDP_ERROR_SUCCESS) {
@@ -3130,11 +3747,9 @@ GdpThreadTask(ToolsAppCtx *ctx, // IN
       if (taskEvent == GDP_TASK_EVENT_STOP) {
          /*
           * In case the publish event comes at the same time,
-          * only the stop event is handled, so do not check
-          * (taskCtx.mode == GDP_TASK_MODE_PUBLISH) here.
+          * only the stop event is handled, the in-flight and
+          * queued publish items fail below.
           */
-         gPublishState.gdpErr = GDP_ERROR_STOP;
-         GdpSetEvent(gPublishState.eventGetResult);
          break;
       }
 
@@ -3142,6 +3757,7 @@ GdpThreadTask(ToolsAppCtx *ctx, // IN
 
    } while (!Atomic_ReadBool(&gPluginState.stopped));
 
+   GdpTaskFailPublishQueue(&taskCtx);
    GdpTaskCtxDestroy(&taskCtx);
 
    g_debug("%s: Exiting ...\n", __FUNCTION__);
@@ -3205,6 +3821,11 @@ GdpInit(ToolsAppCtx *ctx) // IN
 
    gPluginState.eventConfig = GDP_INVALID_EVENT;
 
+   g_queue_init(&gPublishState.queue);
+   gPublishState.queueLimit = GDP_PUBLISH_QUEUE_LIMIT;
+   gPublishState.asyncCount = 0;
+   gPublishState.queueClosed = FALSE;
+
    gPublishState.eventPublish = GDP_INVALID_EVENT;
 
    gPublishState.eventGetResult = GDP_INVALID_EVENT;
@@ -3384,9 +4005,10 @@ GdpDestroy(void)
 
 /*
  ******************************************************************************
- * GdpPublish --
+ * GdpPublishSubmit --
  *
- * Publishes guest data to host side gdp daemon.
+ * Validates guest data and queues it for the gdp task thread to publish,
+ * starts the gdp task thread on first call.
  *
  * @param[in]          createTime  UTC timestamp, in number of micro-
  *                                 seconds since January 1, 1970 UTC.
@@ -3398,26 +4020,31 @@ GdpDestroy(void)
  * @param[in]          dataLen     Buffer length
  * @param[in]          cacheData   Cache the data if TRUE
  * @param[in]          requireSubs Require subscribers if TRUE
+ * @param[in]          blocking    TRUE if called by GdpPublish
+ * @param[in,optional] callback    Async completion callback
+ * @param[in,optional] clientData  Async completion callback data
  *
- * @return GDP_ERROR_SUCCESS on success.
+ * @return GDP_ERROR_SUCCESS if the data is queued.
  * @return Other GdpError code otherwise.
  *
  ******************************************************************************
  */
 
 static GdpError
-GdpPublish(gint64 createTime,     // IN
-           const gchar *topic,    // IN
-           const gchar *token,    // IN, OPTIONAL
-           const gchar *category, // IN, OPTIONAL
-           const gchar *data,     // IN
-           guint32 dataLen,       // IN
-           gboolean cacheData,    // IN
-           gboolean requireSubs)  // IN
+GdpPublishSubmit(gint64 createTime,           // IN
+                 const gchar *topic,          // IN
+                 const gchar *token,          // IN, OPTIONAL
+                 const gchar *category,       // IN, OPTIONAL
+                 const gchar *data,           // IN
+                 guint32 dataLen,             // IN
+                 gboolean cacheData,          // IN
+                 gboolean requireSubs,        // IN
+                 Bool blocking,               // IN
+                 GdpPublishCallback callback, // IN, OPTIONAL
+                 gpointer clientData)         // IN, OPTIONAL
 {
    GdpError gdpErr;
-
-   g_debug("%s: Entering ...\n", __FUNCTION__);
+   PublishItem *item;
 
    if (topic == NULL || *topic == '\0') {
       g_info("%s: Missing topic.\n", __FUNCTION__);
@@ -3432,6 +4059,8 @@ GdpPublish(gint64 createTime,     // IN
          g_info("%s: Topic '%s' has no data.\n", __FUNCTION__, topic);
          return GDP_ERROR_INVALID_DATA;
       }
+
+      dataLen = 0;
    }
 
    if (token != NULL && *token == '\0') {
@@ -3442,7 +4071,23 @@ GdpPublish(gint64 createTime,     // IN
       category = NULL;
    }
 
-   g_mutex_lock(&gPublishState.mutex);
+   item = g_new0(PublishItem, 1);
+   item->createTime = createTime;
+   item->topic = g_strdup(topic);
+   item->token = g_strdup(token);
+   item->category = g_strdup(category);
+   if (dataLen > 0) {
+      item->data = g_malloc(dataLen);
+      memcpy(item->data, data, dataLen);
+   }
+   item->dataLen = dataLen;
+   item->cacheData = cacheData;
+   item->requireSubs = requireSubs;
+   item->blocking = blocking;
+   item->callback = callback;
+   item->clientData = clientData;
+
+   g_mutex_lock(&gPublishState.queueMutex);
 
    if (Atomic_ReadBool(&gPluginState.stopping)) {
       /*
@@ -3470,16 +4115,88 @@ GdpPublish(gint64 createTime,     // IN
       goto exit;
    }
 
-   gPublishState.createTime = createTime;
-   gPublishState.topic = topic;
-   gPublishState.token = token;
-   gPublishState.category = category;
-   gPublishState.data = data;
-   gPublishState.dataLen = dataLen;
-   gPublishState.cacheData = cacheData;
-   gPublishState.requireSubs = requireSubs;
+   if (gPublishState.queueClosed) {
+      gdpErr = GDP_ERROR_STOP;
+      goto exit;
+   }
+
+   /*
+    * Blocking publish calls are serialized by gPublishState.mutex,
+    * the queue limit applies to async items only.
+    */
+   if (!blocking) {
+      if (gPublishState.asyncCount >= gPublishState.queueLimit) {
+         g_debug("%s: Publish queue full, topic '%s'.\n",
+                 __FUNCTION__, topic);
+         gdpErr = GDP_ERROR_QUEUE_FULL;
+         goto exit;
+      }
+
+      gPublishState.asyncCount++;
+   }
+
+   g_queue_push_head(&gPublishState.queue, item);
+   item = NULL;
+   gdpErr = GDP_ERROR_SUCCESS;
+
+exit:
+   g_mutex_unlock(&gPublishState.queueMutex);
+
+   if (item != NULL) {
+      GdpPublishItemFree(item);
+   } else {
+      GdpSetEvent(gPublishState.eventPublish);
+   }
+
+   return gdpErr;
+}
+
+
+/*
+ ******************************************************************************
+ * GdpPublish --
+ *
+ * Publishes guest data to host side gdp daemon.
+ *
+ * @param[in]          createTime  UTC timestamp, in number of micro-
+ *                                 seconds since January 1, 1970 UTC.
+ * @param[in]          topic       Topic
+ * @param[in,optional] token       Token, can be NULL
+ * @param[in,optional] category    Category, can be NULL that defaults to
+ *                                 "application"
+ * @param[in]          data        Buffer containing data to publish
+ * @param[in]          dataLen     Buffer length
+ * @param[in]          cacheData   Cache the data if TRUE
+ * @param[in]          requireSubs Require subscribers if TRUE
+ *
+ * @return GDP_ERROR_SUCCESS on success.
+ * @return Other GdpError code otherwise.
+ *
+ ******************************************************************************
+ */
+
+static GdpError
+GdpPublish(gint64 createTime,     // IN
+           const gchar *topic,    // IN
+           const gchar *token,    // IN, OPTIONAL
+           const gchar *category, // IN, OPTIONAL
+           const gchar *data,     // IN
+           guint32 dataLen,       // IN
+           gboolean cacheData,    // IN
+           gboolean requireSubs)  // IN
+{
+   GdpError gdpErr;
 
-   GdpSetEvent(gPublishState.eventPublish);
+   g_debug("%s: Entering ...\n", __FUNCTION__);
+
+   g_mutex_lock(&gPublishState.mutex);
+
+   gdpErr = GdpPublishSubmit(createTime, topic, token, category,
+                             data, dataLen, cacheData, requireSubs,
+                             TRUE, NULL, NULL);
+   if (gdpErr != GDP_ERROR_SUCCESS) {
+      goto exit;
+   }
 
    do {
       gdpErr = GdpWaitForEvent(gPublishState.eventGetResult,
@@ -3500,6 +4217,72 @@ exit:
 }
 
 
+/*
+ ******************************************************************************
+ * GdpPublishAsync --
+ *
+ * Queues guest data for publishing to host side gdp daemon without waiting
+ * for the result.
+ *
+ * The gdp task thread sends queued items back to back, paced by the host
+ * rate limit, and calls the completion callback with each result.
+ *
+ * @param[in]          createTime  UTC timestamp, in number of micro-
+ *                                 seconds since January 1, 1970 UTC.
+ * @param[in]          topic       Topic
+ * @param[in,optional] token       Token, can be NULL
+ * @param[in,optional] category    Category, can be NULL that defaults to
+ *                                 "application"
+ * @param[in]          data        Buffer containing data to publish
+ * @param[in]          dataLen     Buffer length
+ * @param[in]          cacheData   Cache the data if TRUE
+ * @param[in]          requireSubs Require subscribers if TRUE
+ * @param[in,optional] callback    Completion callback
+ * @param[in,optional] clientData  Completion callback data
+ *
+ * @return GDP_ERROR_SUCCESS if the data is queued.
+ * @return Other GdpError code otherwise.
+ *
+ ******************************************************************************
+ */
+
+static GdpError
+GdpPublishAsync(gint64 createTime,           // IN
+                const gchar *topic,          // IN
+                const gchar *token,          // IN, OPTIONAL
+                const gchar *category,       // IN, OPTIONAL
+                const gchar *data,           // IN
+                guint32 dataLen,             // IN
+                gboolean cacheData,          // IN
+                gboolean requireSubs,        // IN
+                GdpPublishCallback callback, // IN, OPTIONAL
+                gpointer clientData)         // IN, OPTIONAL
+{
+   GdpError gdpErr;
+
+   g_debug("%s: Entering ...\n", __FUNCTION__);
+
+   /*
+    * Reject oversized data up front, it would fail packet build anyway
+    * and only hold a queue slot meanwhile.
+    */
+   if (dataLen > GDP_USER_DATA_LEN) {
+      g_info("%s: Topic '%s' data length %u exceeds limit %u.\n",
+             __FUNCTION__, topic != NULL ? topic : "",
+             dataLen, GDP_USER_DATA_LEN);
+      return GDP_ERROR_DATA_SIZE;
+   }
+
+   gdpErr = GdpPublishSubmit(createTime, topic, token, category,
+                             data, dataLen, cacheData, requireSubs,
+                             FALSE, callback, clientData);
+
+   g_debug("%s: Exiting with gdp error: %s.\n",
+           __FUNCTION__, gdpErrMsgs[gdpErr]);
+   return gdpErr;
+}
+
+
 /*
  *-----------------------------------------------------------------------------
  * GdpConfReload --
@@ -3518,7 +4301,8 @@ GdpConfReload(gpointer src,     // IN
               ToolsAppCtx *ctx, // IN
               gpointer data)    // IN
 {
-   if (!Atomic_ReadBool(&gPluginState.started)) {
+   if (!Atomic_ReadBool(&gPluginState.started) ||
+       !ToolsCore_ConfigGroupChanged(ctx, CONFGROUPNAME_GDP)) {
       return;
    }
 
@@ -3627,7 +4411,7 @@ ToolsOnLoad(ToolsAppCtx *ctx) // IN
    GdpInit(ctx);
 
    {
-      static ToolsPluginSvcGdp svcGdp = { GdpPublish };
+      static ToolsPluginSvcGdp svcGdp = { GdpPublish, GdpPublishAsync };
       static ToolsPluginData regData = { "gdp", NULL, NULL, NULL };
 
       ToolsServiceProperty propGdp = { TOOLS_PLUGIN_SVC_PROP_GDP };
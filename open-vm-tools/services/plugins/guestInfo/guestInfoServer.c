@@ -2159,6 +2159,10 @@ GuestInfoServerConfReload(gpointer src,
                           ToolsAppCtx *ctx,
                           gpointer data)
 {
+   if (!ToolsCore_ConfigGroupChanged(ctx, CONFGROUPNAME_GUESTINFO)) {
+      return;
+   }
+
    TweakGatherLoops(ctx, TRUE);
 }
 
@@ -103,12 +103,19 @@ VM_EMBED_VERSION(VMTOOLSD_VERSION_STRING);
  */
 #define DEFAULT_MAX_CLIENT_CONNECTIONS  8
 
+/*
+ * Maximum concurrent VMX connections, i.e. client requests served in parallel
+ */
+#define DEFAULT_MAX_VMX_CONNECTIONS  4
+
 /*
  * Default timeout value in seconds for receiving from client connections
  */
 #define DEFAULT_CLIENT_RECV_TIMEOUT  3  // seconds
 
 
+struct _ServeSession;
+
 /*
  * Client connection details
  */
@@ -120,7 +127,7 @@ typedef struct _ClientConnInfo {
 
    Bool shutDown;  // Close connection in send callback.
 
-   Bool isCurrent;  // True for the current client connection
+   struct _ServeSession *session;  // Serving session, NULL while waiting
    char *requestPath;  // Requested GuestStore content path
    GSource *timeoutSource;  // Timeout source for receiving HTTP request
 } ClientConnInfo;
@@ -140,16 +147,34 @@ typedef struct _VmxConnInfo {
    int32 connTimeout;  // Connection inactivity timeout
    int64 bytesRemaining;  // Track remaining content size to transfer
    GSource *timeoutSource;  // Timeout source for connection inactivity
+
+   struct _ServeSession *session;  // Owning serving session
 } VmxConnInfo;
 
+/*
+ * Serving session details
+ *
+ * A session pairs the client connection being served with the VMX
+ * connection streaming its content. Sessions run independently of each
+ * other; once a client connection is finished, its session picks up the
+ * next client connection in the waiting list and reuses the VMX connection.
+ */
+typedef struct _ServeSession {
+   ClientConnInfo *clientConn;  // The client connection being served
+   VmxConnInfo    *vmxConn;     // The VMX connection providing service
+
+   Bool vmxConnectRequested;  // VMX connect request sent status
+   GSource *timeoutSource;  // Timeout source for VMX to guest connection
+} ServeSession;
+
 typedef struct {
    AsyncSocket *vmxListenSock;     // For vsocket connections from VMX
    AsyncSocket *clientListenSock;  // For connections from clients
 
    GList *clientConnWaitList;  // Client connections in waiting list
 
-   ClientConnInfo *clientConn;  // The current client connection being served
-   VmxConnInfo    *vmxConn;     // The VMX connection providing service
+   GList *sessions;  // Active serving sessions
+   int vmxConnLimit;  // VMX connection limit observed, 0 if not hit
 
    ToolsAppCtx *ctx;  // vmtoolsd application context
 
@@ -158,18 +183,13 @@ typedef struct {
 
    Bool guestStoreAccessEnabled;  // VMX GuestStore access enable status
 
-   Bool vmxConnectRequested;  // VMX connect request sent status
-   GSource *timeoutSource;  // Timeout source for VMX to guest connection
    Bool shutdown;  // vmtoolsd shutdown
 } PluginData;
 
 static PluginData pluginData = {0};
 
-#define currentClientConn  pluginData.clientConn
-#define theVmxConn         pluginData.vmxConn
-
-#define ReceivedHttpRequestFromCurrentClientConn()  \
-   (currentClientConn->requestPath != NULL)
+#define ReceivedHttpRequestFromClientConn(clientConn)  \
+   ((clientConn)->requestPath != NULL)
 
 /*
  * Macros to read values from config file
@@ -180,7 +200,6 @@ static PluginData pluginData = {0};
 #define GUESTSTORE_CONFIG_GET_INT(key, defVal)  \
    VMTools_ConfigGetInteger(pluginData.ctx->config, "guestStore", key, defVal)
 
-
 /*
  *-----------------------------------------------------------------------------
  *
@@ -269,21 +288,55 @@ IsAdminOnly(void)
    (pluginData.adminOnly = IsAdminOnly())
 
 
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * GetMaxVmxConnections --
+ *
+ *      Get the maximum number of VMX connections, i.e. serving sessions,
+ *      that may be active at the same time.
+ *
+ * Results:
+ *      Return the configured value, capped by the limit observed from VMX.
+ *
+ * Side-effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static int
+GetMaxVmxConnections(void)
+{
+   int maxVmxConnections;
+
+   maxVmxConnections = GUESTSTORE_CONFIG_GET_INT("maxVmxConnections",
+      DEFAULT_MAX_VMX_CONNECTIONS);
+   if (maxVmxConnections <= 0) {
+      g_warning("Invalid maxVmxConnections (%d); Using default (%d).\n",
+                maxVmxConnections, DEFAULT_MAX_VMX_CONNECTIONS);
+      maxVmxConnections = DEFAULT_MAX_VMX_CONNECTIONS;
+   }
+
+   if (pluginData.vmxConnLimit > 0 &&
+       pluginData.vmxConnLimit < maxVmxConnections) {
+      maxVmxConnections = pluginData.vmxConnLimit;
+   }
+
+   return maxVmxConnections;
+}
+
+
 static void
-StartServeNextClientConn(void);
+StartServeNextClientConn(ServeSession *session);  // IN
 
 static void
 CloseClientConn(ClientConnInfo *clientConn);  // IN
 
-#define CloseCurrentClientConn()           \
-   if (currentClientConn != NULL) {        \
-      CloseClientConn(currentClientConn);  \
-   }
-
-#define CloseCurrentClientConnIfReceivedHttpRequest()  \
-   if (currentClientConn != NULL &&                    \
-       currentClientConn->requestPath != NULL) {       \
-      CloseClientConn(currentClientConn);              \
+#define CloseSessionClientConn(session)        \
+   if ((session)->clientConn != NULL) {        \
+      CloseClientConn((session)->clientConn);  \
    }
 
 #define CloseClientConnsInWait()                                   \
@@ -294,112 +347,120 @@ CloseClientConn(ClientConnInfo *clientConn);  // IN
    }
 
 static void
-CloseVmxConn(void);
+CloseVmxConn(ServeSession *session);  // IN
 
 static void
-CloseActiveConnections(void);
+CloseActiveConnections(ServeSession *session);  // IN
+
+static Bool
+ReleaseSessionIfIdle(ServeSession *session);  // IN
 
 static void
-HandleCurrentClientConnError(void);
+HandleClientConnError(ServeSession *session);  // IN
 
 static void
-HandleVmxConnError(void);
+HandleVmxConnError(ServeSession *session);  // IN
+
+static void
+HandleVmxConnectFailure(ServeSession *session);  // IN
 
 static Bool
-RecvHttpRequestFromCurrentClientConn(void *buf,  // OUT
-                                     int len);   // IN
+RecvHttpRequestFromClientConn(ServeSession *session,  // IN
+                              void *buf,              // OUT
+                              int len);               // IN
 
 static Bool
-StartRecvHttpRequestFromCurrentClientConn(void);
+StartRecvHttpRequestFromClientConn(ServeSession *session);  // IN
 
 static inline void
-StopRecvFromCurrentClientConn(void);
+StopRecvFromClientConn(ClientConnInfo *clientConn);  // IN
 
 static Bool
-SendToCurrentClientConn(void *buf,  // IN
-                        int len);   // IN
+SendToClientConn(ServeSession *session,  // IN
+                 void *buf,              // IN
+                 int len);               // IN
 
 static Bool
-SendHttpResponseToCurrentClientConn(const char *headFmt,  // IN
-                                    int64 contentLen,     // IN
-                                    Bool shutdown);       // IN
-
-#define SendHttpResponseOKToCurrentClientConn(contentSize)  \
-   SendHttpResponseToCurrentClientConn(                     \
-      HTTP_RES_OK,                                          \
-      contentSize,                                          \
+SendHttpResponseToClientConn(ServeSession *session,  // IN
+                             const char *headFmt,    // IN
+                             int64 contentLen,       // IN
+                             Bool shutdown);         // IN
+
+#define SendHttpResponseOKToClientConn(session, contentSize)  \
+   SendHttpResponseToClientConn(                              \
+      session,                                                \
+      HTTP_RES_OK,                                            \
+      contentSize,                                            \
       (0 == contentSize ? TRUE : FALSE))
 
-#define SendHttpResponseForbiddenToCurrentClientConn()   \
-   SendHttpResponseToCurrentClientConn(                  \
-      HTTP_RES_FORBIDDEN,                                \
-      0,                                                 \
+#define SendHttpResponseForbiddenToClientConn(session)  \
+   SendHttpResponseToClientConn(                        \
+      session,                                          \
+      HTTP_RES_FORBIDDEN,                               \
+      0,                                                \
       TRUE)
 
-#define SendHttpResponseNotFoundToCurrentClientConn()    \
-   SendHttpResponseToCurrentClientConn(                  \
-      HTTP_RES_NOT_FOUND,                                \
-      0,                                                 \
+#define SendHttpResponseNotFoundToClientConn(session)   \
+   SendHttpResponseToClientConn(                        \
+      session,                                          \
+      HTTP_RES_NOT_FOUND,                               \
+      0,                                                \
       TRUE)
 
 static Bool
-SendConnectRequestToVmx(void);
+SendConnectRequestToVmx(ServeSession *session);  // IN
 
 static Bool
-SendDataMapToVmxConn(void);
+SendDataMapToVmxConn(ServeSession *session);  // IN
 
-#define CheckSendShutdownDataMapToVmxConn()            \
-   ASSERT(currentClientConn == NULL);                  \
-   if (theVmxConn != NULL && !theVmxConn->shutDown) {  \
-      SendDataMapToVmxConn();                          \
-   }
+static void
+CheckSendShutdownDataMapToVmxConn(ServeSession *session);  // IN
 
-#define CheckSendRequestDataMapToVmxConn()             \
-   ASSERT(currentClientConn != NULL);                  \
-   if (ReceivedHttpRequestFromCurrentClientConn() &&   \
-       theVmxConn != NULL && !theVmxConn->shutDown) {  \
-      SendDataMapToVmxConn();                          \
+#define CheckSendRequestDataMapToVmxConn(session)                     \
+   ASSERT((session)->clientConn != NULL);                             \
+   if (ReceivedHttpRequestFromClientConn((session)->clientConn) &&    \
+       (session)->vmxConn != NULL && !(session)->vmxConn->shutDown) { \
+      SendDataMapToVmxConn(session);                                  \
    }
 
 static Bool
-RecvDataMapFromVmxConn(void *buf,  // OUT
-                       int len);   // IN
+RecvDataMapFromVmxConn(ServeSession *session,  // IN
+                       void *buf,              // OUT
+                       int len);               // IN
 
 static inline void
-StopRecvFromVmxConn(void);
+StopRecvFromVmxConn(VmxConnInfo *vmxConn);  // IN
 
 static Bool
-ProcessVmxDataMap(const DataMap *map);  // IN
+ProcessVmxDataMap(ServeSession *session,     // IN
+                  const DataMapView *map);   // IN
 
 static Bool
-RecvContentFromVmxConn(void);
+RecvContentFromVmxConn(ServeSession *session);  // IN
 
 static void
-StartCurrentClientConnRecvTimeout(void);
+StartClientConnRecvTimeout(ClientConnInfo *clientConn);  // IN
 
 static inline void
 StopClientConnRecvTimeout(ClientConnInfo *clientConn);  // IN
 
-static inline void
-StopCurrentClientConnRecvTimeout(void);
-
 static Bool
-CurrentClientConnRecvTimeoutCb(gpointer clientData);  // IN
+ClientConnRecvTimeoutCb(gpointer clientData);  // IN
 
 static inline void
-StartVmxToGuestConnTimeout(void);
+StartVmxToGuestConnTimeout(ServeSession *session);  // IN
 
 static inline void
-StopVmxToGuestConnTimeout(void);
+StopVmxToGuestConnTimeout(ServeSession *session);  // IN
 
 static Bool
 VmxToGuestConnTimeoutCb(gpointer clientData);  // IN
 
 static inline void
-StartConnInactivityTimeout(void);
+StartConnInactivityTimeout(VmxConnInfo *vmxConn);  // IN
 
 static inline void
-StopConnInactivityTimeout(void);
+StopConnInactivityTimeout(VmxConnInfo *vmxConn);  // IN
 
 static Bool
 ConnInactivityTimeoutCb(gpointer clientData);  // IN
@@ -410,16 +471,16 @@ ClientConnErrorCb(int err,             // IN
                   void *clientData);   // IN
 
 static void
-CurrentClientConnSendCb(void *buf,           // IN
-                        int len,             // IN
-                        AsyncSocket *asock,  // IN
-                        void *clientData);   // IN
+ClientConnSendCb(void *buf,           // IN
+                 int len,             // IN
+                 AsyncSocket *asock,  // IN
+                 void *clientData);   // IN
 
 static void
-CurrentClientConnRecvHttpRequestCb(void *buf,           // IN
-                                   int len,             // IN
-                                   AsyncSocket *asock,  // IN
-                                   void *clientData);   // IN
+ClientConnRecvHttpRequestCb(void *buf,           // IN
+                            int len,             // IN
+                            AsyncSocket *asock,  // IN
+                            void *clientData);   // IN
 
 static void
 ClientConnectCb(AsyncSocket *asock,  // IN
@@ -453,14 +514,129 @@ VmxConnectCb(AsyncSocket *asock,  // IN
              void *clientData);   // IN
 
 
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * CreateSession --
+ *
+ *      Create a new serving session and add it to the active session list.
+ *
+ * Results:
+ *      Return the new session.
+ *
+ * Side effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static ServeSession *
+CreateSession(void)
+{
+   ServeSession *session = (ServeSession *)Util_SafeCalloc(1, sizeof *session);
+
+   pluginData.sessions = g_list_append(pluginData.sessions, session);
+   g_debug("%s: %u active serving sessions.\n", __FUNCTION__,
+           g_list_length(pluginData.sessions));
+
+   return session;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * ReleaseSessionIfIdle --
+ *
+ *      Free a serving session that has neither a client connection nor
+ *      a VMX connection, established or requested.
+ *
+ * Results:
+ *      TRUE if the session is freed, FALSE otherwise.
+ *
+ * Side effects:
+ *      The observed VMX connection limit is cleared after the last session
+ *      is freed, so that the next burst of client connections probes it
+ *      again.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+ReleaseSessionIfIdle(ServeSession *session)  // IN
+{
+   ASSERT(session != NULL);
+
+   if (session->clientConn != NULL ||
+       session->vmxConn != NULL ||
+       session->vmxConnectRequested) {
+      return FALSE;
+   }
+
+   ASSERT(session->timeoutSource == NULL);
+
+   pluginData.sessions = g_list_remove(pluginData.sessions, session);
+   free(session);
+
+   g_debug("%s: %u active serving sessions.\n", __FUNCTION__,
+           g_list_length(pluginData.sessions));
+
+   if (pluginData.sessions == NULL) {
+      pluginData.vmxConnLimit = 0;
+   }
+
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * CountOtherVmxSessions --
+ *
+ *      Count the serving sessions, other than the given one, that have
+ *      a VMX connection established or requested.
+ *
+ * Results:
+ *      Return the number of sessions.
+ *
+ * Side effects:
+ *      None
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static int
+CountOtherVmxSessions(const ServeSession *session)  // IN
+{
+   GList *l;
+   int count = 0;
+
+   for (l = pluginData.sessions; l != NULL; l = l->next) {
+      ServeSession *other = (ServeSession *)l->data;
+
+      if (other != session &&
+          (other->vmxConn != NULL || other->vmxConnectRequested)) {
+         count++;
+      }
+   }
+
+   return count;
+}
+
+
 /*
  *-----------------------------------------------------------------------------
  *
  * StartServeNextClientConn --
  *
  *      Remove the next client connection from the waiting list, make it
- *      the current client connection and start receiving HTTP request
- *      from it.
+ *      the client connection of the session and start receiving HTTP
+ *      request from it.
+ *
+ *      A client connection put back into the waiting list by another
+ *      session has already sent its HTTP request, its request is forwarded
+ *      to VMX directly.
  *
  *      If the waiting list is empty, initiate shutdown VMX connection.
  *
@@ -468,28 +644,38 @@ VmxConnectCb(AsyncSocket *asock,  // IN
  *      None
  *
  * Side effects:
- *      None
+ *      The session may be freed.
  *
  *-----------------------------------------------------------------------------
  */
 
 static void
-StartServeNextClientConn(void)
+StartServeNextClientConn(ServeSession *session)  // IN
 {
    g_debug("Entering %s.\n", __FUNCTION__);
 
-   ASSERT(currentClientConn == NULL);
+   ASSERT(session != NULL);
+   ASSERT(session->clientConn == NULL);
 
    if (pluginData.clientConnWaitList != NULL) {
-      currentClientConn = (ClientConnInfo *)
+      ClientConnInfo *clientConn = (ClientConnInfo *)
          (pluginData.clientConnWaitList->data);
-      pluginData.clientConnWaitList = g_list_remove(
-         pluginData.clientConnWaitList, currentClientConn);
-      currentClientConn->isCurrent = TRUE;
 
-      StartRecvHttpRequestFromCurrentClientConn();
+      pluginData.clientConnWaitList = g_list_remove(
+         pluginData.clientConnWaitList, clientConn);
+      clientConn->session = session;
+      session->clientConn = clientConn;
+
+      if (!ReceivedHttpRequestFromClientConn(clientConn)) {
+         StartRecvHttpRequestFromClientConn(session);
+      } else if (!session->vmxConnectRequested) {
+         ASSERT(session->vmxConn == NULL);
+         SendConnectRequestToVmx(session);
+      } else {
+         CheckSendRequestDataMapToVmxConn(session);
+      }
    } else {
-      CheckSendShutdownDataMapToVmxConn();
+      CheckSendShutdownDataMapToVmxConn(session);
    }
 }
 
@@ -541,13 +727,13 @@ CloseClientConn(ClientConnInfo *clientConn)  // IN
 
    StopClientConnRecvTimeout(clientConn);
 
-   if (clientConn->isCurrent) {
-      ASSERT(currentClientConn == clientConn);
+   if (clientConn->session != NULL) {
+      ASSERT(clientConn->session->clientConn == clientConn);
       /*
-       * AsyncSocketSendFn (CurrentClientConnSendCb) can be invoked inside
+       * AsyncSocketSendFn (ClientConnSendCb) can be invoked inside
        * AsyncSocket_Close().
        */
-      currentClientConn = NULL;
+      clientConn->session->clientConn = NULL;
    } else {
       /*
        * This client connection is in the waiting list.
@@ -565,7 +751,7 @@ CloseClientConn(ClientConnInfo *clientConn)  // IN
  *
  * CloseVmxConn --
  *
- *      Close the VMX connection.
+ *      Close the VMX connection of a session.
  *
  *      Note: AsyncSocket does not differentiate read/write errors yet and
  *      does not try to send any data to the other end on close, so pending
@@ -582,36 +768,38 @@ CloseClientConn(ClientConnInfo *clientConn)  // IN
  */
 
 static void
-CloseVmxConn(void)
+CloseVmxConn(ServeSession *session)  // IN
 {
+   VmxConnInfo *vmxConn = session->vmxConn;
+
    g_debug("Entering %s.\n", __FUNCTION__);
 
-   if (theVmxConn == NULL) {
+   if (vmxConn == NULL) {
       return;
    }
 
-   ASSERT(theVmxConn->asock != NULL);
+   ASSERT(vmxConn->asock != NULL);
 
    g_info("Closing VMX connection %d.\n",
-          AsyncSocket_GetFd(theVmxConn->asock));
+          AsyncSocket_GetFd(vmxConn->asock));
 
    /*
     * AsyncSocketSendFn (VmxConnSendDataMapCb) can be invoked inside
     * AsyncSocket_Close().
     */
-   AsyncSocket_Close(theVmxConn->asock);
-   theVmxConn->asock = NULL;
+   AsyncSocket_Close(vmxConn->asock);
+   vmxConn->asock = NULL;
 
-   if (theVmxConn->buf != NULL) {
-      free(theVmxConn->buf);
-      theVmxConn->buf = NULL;
+   if (vmxConn->buf != NULL) {
+      free(vmxConn->buf);
+      vmxConn->buf = NULL;
    }
 
-   StopConnInactivityTimeout();
+   StopConnInactivityTimeout(vmxConn);
 
-   free(theVmxConn);
-   theVmxConn = NULL;
-   pluginData.vmxConnectRequested = FALSE;
+   free(vmxConn);
+   session->vmxConn = NULL;
+   session->vmxConnectRequested = FALSE;
 }
 
 
@@ -620,37 +808,37 @@ CloseVmxConn(void)
  *
  * CloseActiveConnections --
  *
- *      Close the current client connection and the VMX connection, force to
- *      restart from the next client connection in the waiting list if it
- *      exists.
+ *      Close the client connection and the VMX connection of a session,
+ *      force to restart from the next client connection in the waiting list
+ *      if it exists.
  *
  * Results:
  *      None
  *
  * Side-effects:
- *      None
+ *      The session may be freed.
  *
  *-----------------------------------------------------------------------------
  */
 
 static void
-CloseActiveConnections(void)
+CloseActiveConnections(ServeSession *session)  // IN
 {
    g_debug("Entering %s.\n", __FUNCTION__);
 
-   CloseCurrentClientConn();
+   CloseSessionClientConn(session);
 
-   if (theVmxConn != NULL && !theVmxConn->shutDown) {
+   if (session->vmxConn != NULL && !session->vmxConn->shutDown) {
       /*
-       * After CloseCurrentClientConn(), send shutdown data map to VMX.
+       * After CloseSessionClientConn(), send shutdown data map to VMX.
        */
-      SendDataMapToVmxConn();
+      SendDataMapToVmxConn(session);
    } else {
       /*
        * Force to restart.
        */
-      CloseVmxConn();
-      StartServeNextClientConn();
+      CloseVmxConn(session);
+      StartServeNextClientConn(session);
    }
 }
 
@@ -658,45 +846,45 @@ CloseActiveConnections(void)
 /*
  *-----------------------------------------------------------------------------
  *
- * HandleCurrentClientConnError --
+ * HandleClientConnError --
  *
- *      Handle the current client connection error.
+ *      Handle the client connection error of a session.
  *
  * Results:
  *      None
  *
  * Side-effects:
- *      None
+ *      The session may be freed.
  *
  *-----------------------------------------------------------------------------
  */
 
 static void
-HandleCurrentClientConnError(void)
+HandleClientConnError(ServeSession *session)  // IN
 {
    Bool requestReceived;
 
    g_debug("Entering %s.\n", __FUNCTION__);
 
-   ASSERT(currentClientConn != NULL);
-   ASSERT(currentClientConn->asock != NULL);
+   ASSERT(session->clientConn != NULL);
+   ASSERT(session->clientConn->asock != NULL);
 
-   requestReceived = ReceivedHttpRequestFromCurrentClientConn();
+   requestReceived = ReceivedHttpRequestFromClientConn(session->clientConn);
 
-   CloseCurrentClientConn();
+   CloseClientConn(session->clientConn);
 
    if (requestReceived) {
       /*
-       * The VMX connection that serves the current client connection after
-       * it has received HTTP request has to be reset too.
+       * The VMX connection that serves the client connection after it has
+       * received HTTP request has to be reset too.
        */
-      CheckSendShutdownDataMapToVmxConn();
+      CheckSendShutdownDataMapToVmxConn(session);
    } else {
       /*
-       * HTTP request not received from the current client connection yet,
+       * HTTP request not received from the client connection yet,
        * the VMX connection is still clean.
        */
-      StartServeNextClientConn();
+      StartServeNextClientConn(session);
    }
 }
 
@@ -706,33 +894,38 @@ HandleCurrentClientConnError(void)
  *
  * HandleVmxConnError --
  *
- *      Handle the VMX connection error.
+ *      Handle the VMX connection error of a session.
  *
  * Results:
  *      None
  *
  * Side-effects:
- *      None
+ *      The session may be freed.
  *
  *-----------------------------------------------------------------------------
  */
 
 static void
-HandleVmxConnError(void)
+HandleVmxConnError(ServeSession *session)  // IN
 {
    g_debug("Entering %s.\n", __FUNCTION__);
 
-   CloseVmxConn();
+   CloseVmxConn(session);
 
    /*
-    * The current client connection being served after received HTTP request
+    * The client connection being served after received HTTP request
     * has to be reset too.
     */
-   CloseCurrentClientConnIfReceivedHttpRequest();
+   if (session->clientConn != NULL &&
+       ReceivedHttpRequestFromClientConn(session->clientConn)) {
+      CloseClientConn(session->clientConn);
+   }
 
    if (pluginData.guestStoreAccessEnabled &&
-       currentClientConn == NULL) {
-      StartServeNextClientConn();
+       session->clientConn == NULL) {
+      StartServeNextClientConn(session);
+   } else {
+      ReleaseSessionIfIdle(session);
    }
 }
 
@@ -740,9 +933,65 @@ HandleVmxConnError(void)
 /*
  *-----------------------------------------------------------------------------
  *
- * RecvHttpRequestFromCurrentClientConn --
+ * HandleVmxConnectFailure --
+ *
+ *      Handle failure to get a VMX connection for a session.
  *
- *      Receive HTTP request from the current client connection.
+ *      If other sessions still have VMX connections, VMX is taken to limit
+ *      the number of concurrent connections: no more sessions than those
+ *      are started and the client connection is put back at the head of the
+ *      waiting list for the other sessions to serve. Otherwise, all
+ *      outstanding client connections are closed.
+ *
+ * Results:
+ *      None
+ *
+ * Side-effects:
+ *      The session may be freed.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+HandleVmxConnectFailure(ServeSession *session)  // IN
+{
+   int otherSessions;
+
+   g_debug("Entering %s.\n", __FUNCTION__);
+
+   ASSERT(session->vmxConn == NULL);
+
+   StopVmxToGuestConnTimeout(session);
+   session->vmxConnectRequested = FALSE;
+
+   otherSessions = CountOtherVmxSessions(session);
+   if (otherSessions > 0) {
+      g_info("Limiting VMX connections to %d.\n", otherSessions);
+      pluginData.vmxConnLimit = otherSessions;
+
+      if (session->clientConn != NULL) {
+         ClientConnInfo *clientConn = session->clientConn;
+
+         clientConn->session = NULL;
+         session->clientConn = NULL;
+         pluginData.clientConnWaitList = g_list_prepend(
+            pluginData.clientConnWaitList, clientConn);
+      }
+   } else {
+      CloseSessionClientConn(session);
+      CloseClientConnsInWait();
+   }
+
+   ReleaseSessionIfIdle(session);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * RecvHttpRequestFromClientConn --
+ *
+ *      Receive HTTP request from the client connection of a session.
  *
  * Results:
  *      TURE on success, FALSE otherwise.
@@ -754,30 +1003,32 @@ HandleVmxConnError(void)
  */
 
 static Bool
-RecvHttpRequestFromCurrentClientConn(void *buf,  // OUT
-                                     int len)    // IN
+RecvHttpRequestFromClientConn(ServeSession *session,  // IN
+                              void *buf,              // OUT
+                              int len)                // IN
 {
+   ClientConnInfo *clientConn = session->clientConn;
    int res;
 
    g_debug("Entering %s: len=%d.\n", __FUNCTION__, len);
 
-   ASSERT(currentClientConn != NULL);
-   ASSERT(currentClientConn->asock != NULL);
+   ASSERT(clientConn != NULL);
+   ASSERT(clientConn->asock != NULL);
 
-   res = AsyncSocket_RecvPartial(currentClientConn->asock, buf, len,
-                                 CurrentClientConnRecvHttpRequestCb,
-                                 currentClientConn);
+   res = AsyncSocket_RecvPartial(clientConn->asock, buf, len,
+                                 ClientConnRecvHttpRequestCb,
+                                 clientConn);
    if (res != ASOCKERR_SUCCESS) {
       g_warning("AsyncSocket_RecvPartial failed "
-                "on current client connection %d: %s\n",
-                AsyncSocket_GetFd(currentClientConn->asock),
+                "on client connection %d: %s\n",
+                AsyncSocket_GetFd(clientConn->asock),
                 AsyncSocket_Err2String(res));
-      HandleCurrentClientConnError();
+      HandleClientConnError(session);
       return FALSE;
    }
 
-   if (currentClientConn->timeoutSource == NULL) {
-      StartCurrentClientConnRecvTimeout();
+   if (clientConn->timeoutSource == NULL) {
+      StartClientConnRecvTimeout(clientConn);
    }
 
    return TRUE;
@@ -787,10 +1038,10 @@ RecvHttpRequestFromCurrentClientConn(void *buf,  // OUT
 /*
  *-----------------------------------------------------------------------------
  *
- * StartRecvHttpRequestFromCurrentClientConn --
+ * StartRecvHttpRequestFromClientConn --
  *
- *      Start receiving HTTP request, with timeout, from
- *      the current client connection.
+ *      Start receiving HTTP request, with timeout, from the client
+ *      connection of a session.
  *
  * Results:
  *      TURE on success, FALSE otherwise.
@@ -802,29 +1053,31 @@ RecvHttpRequestFromCurrentClientConn(void *buf,  // OUT
  */
 
 static Bool
-StartRecvHttpRequestFromCurrentClientConn(void)
+StartRecvHttpRequestFromClientConn(ServeSession *session)  // IN
 {
+   ClientConnInfo *clientConn = session->clientConn;
+
    g_debug("Entering %s.\n", __FUNCTION__);
 
-   ASSERT(currentClientConn != NULL);
-   ASSERT(currentClientConn->asock != NULL);
-   ASSERT(currentClientConn->buf == NULL);
+   ASSERT(clientConn != NULL);
+   ASSERT(clientConn->asock != NULL);
+   ASSERT(clientConn->buf == NULL);
 
-   currentClientConn->bufLen = CLIENT_CONN_SEND_RECV_BUF_SIZE;
-   currentClientConn->buf = Util_SafeMalloc(currentClientConn->bufLen);
+   clientConn->bufLen = CLIENT_CONN_SEND_RECV_BUF_SIZE;
+   clientConn->buf = Util_SafeMalloc(clientConn->bufLen);
 
-   return RecvHttpRequestFromCurrentClientConn(currentClientConn->buf,
-                                               currentClientConn->bufLen);
+   return RecvHttpRequestFromClientConn(session, clientConn->buf,
+                                        clientConn->bufLen);
 }
 
 
 /*
  *-----------------------------------------------------------------------------
  *
- * StopRecvFromCurrentClientConn --
+ * StopRecvFromClientConn --
  *
- *      Stop receiving from the current client connection, safe to call in
- *      the same connection recv callback.
+ *      Stop receiving from a client connection, safe to call in the same
+ *      connection recv callback.
  *
  * Results:
  *      None
@@ -836,14 +1089,14 @@ StartRecvHttpRequestFromCurrentClientConn(void)
  */
 
 static inline void
-StopRecvFromCurrentClientConn(void)
+StopRecvFromClientConn(ClientConnInfo *clientConn)  // IN
 {
-   int res = AsyncSocket_CancelRecvEx(currentClientConn->asock,
+   int res = AsyncSocket_CancelRecvEx(clientConn->asock,
                                       NULL, NULL, NULL, TRUE);
    if (res != ASOCKERR_SUCCESS) {
       g_warning("AsyncSocket_CancelRecvEx failed "
-                "on current client connection %d: %s\n",
-                AsyncSocket_GetFd(currentClientConn->asock),
+                "on client connection %d: %s\n",
+                AsyncSocket_GetFd(clientConn->asock),
                 AsyncSocket_Err2String(res));
    }
 }
@@ -852,9 +1105,9 @@ StopRecvFromCurrentClientConn(void)
 /*
  *-----------------------------------------------------------------------------
  *
- * SendToCurrentClientConn --
+ * SendToClientConn --
  *
- *      Send to the current client connection.
+ *      Send to the client connection of a session.
  *
  * Results:
  *      TRUE on success, FALSE otherwise.
@@ -866,24 +1119,26 @@ StopRecvFromCurrentClientConn(void)
  */
 
 static Bool
-SendToCurrentClientConn(void *buf,  // IN
-                        int len)    // IN
+SendToClientConn(ServeSession *session,  // IN
+                 void *buf,              // IN
+                 int len)                // IN
 {
+   ClientConnInfo *clientConn = session->clientConn;
    int res;
 
    //g_debug("Entering %s: len=%d.\n", __FUNCTION__, len);
 
-   ASSERT(currentClientConn != NULL);
-   ASSERT(currentClientConn->asock != NULL);
+   ASSERT(clientConn != NULL);
+   ASSERT(clientConn->asock != NULL);
 
-   res = AsyncSocket_Send(currentClientConn->asock, buf, len,
-                          CurrentClientConnSendCb, currentClientConn);
+   res = AsyncSocket_Send(clientConn->asock, buf, len,
+                          ClientConnSendCb, clientConn);
    if (res != ASOCKERR_SUCCESS) {
       g_warning("AsyncSocket_Send failed "
-                "on current client connection %d: %s\n",
-                AsyncSocket_GetFd(currentClientConn->asock),
+                "on client connection %d: %s\n",
+                AsyncSocket_GetFd(clientConn->asock),
                 AsyncSocket_Err2String(res));
-      HandleCurrentClientConnError();
+      HandleClientConnError(session);
       return FALSE;
    }
 
@@ -894,9 +1149,9 @@ SendToCurrentClientConn(void *buf,  // IN
 /*
  *-----------------------------------------------------------------------------
  *
- * SendHttpResponseToCurrentClientConn --
+ * SendHttpResponseToClientConn --
  *
- *      Send HTTP response head to the current client connection.
+ *      Send HTTP response head to the client connection of a session.
  *
  * Results:
  *      TRUE on success, FALSE otherwise.
@@ -908,26 +1163,28 @@ SendToCurrentClientConn(void *buf,  // IN
  */
 
 static Bool
-SendHttpResponseToCurrentClientConn(const char *headFmt,  // IN
-                                    int64 contentLen,     // IN
-                                    Bool shutdown)        // IN
+SendHttpResponseToClientConn(ServeSession *session,  // IN
+                             const char *headFmt,    // IN
+                             int64 contentLen,       // IN
+                             Bool shutdown)          // IN
 {
+   ClientConnInfo *clientConn = session->clientConn;
    gchar *utcStr;
    int len;
 
    g_debug("Entering %s.\n", __FUNCTION__);
 
-   ASSERT(currentClientConn != NULL);
-   ASSERT(currentClientConn->asock != NULL);
+   ASSERT(clientConn != NULL);
+   ASSERT(clientConn->asock != NULL);
 
    utcStr = GetCurrentUtcStr();
-   len = Str_Sprintf(currentClientConn->buf, currentClientConn->bufLen,
+   len = Str_Sprintf(clientConn->buf, clientConn->bufLen,
                      headFmt,
                      utcStr != NULL ? utcStr : "", contentLen);
    g_free(utcStr);
 
-   currentClientConn->shutDown = shutdown;
-   return SendToCurrentClientConn(currentClientConn->buf, len);
+   clientConn->shutDown = shutdown;
+   return SendToClientConn(session, clientConn->buf, len);
 }
 
 
@@ -938,20 +1195,20 @@ SendHttpResponseToCurrentClientConn(const char *headFmt,  // IN
  *
  *      Request VMX to connect to our VSOCK listening port via RPC command.
  *
- *      This function should be called when pluginData.vmxConnectRequested
+ *      This function should be called when session->vmxConnectRequested
  *      is FALSE.
  *
  * Results:
  *      TRUE on success, FALSE otherwise
  *
  * Side-effects:
- *      All outstanding client connections are closed if failed.
+ *      See HandleVmxConnectFailure() if failed.
  *
  *-----------------------------------------------------------------------------
  */
 
 static Bool
-SendConnectRequestToVmx(void)
+SendConnectRequestToVmx(ServeSession *session)  // IN
 {
    Bool retVal;
    int fd;
@@ -969,8 +1226,8 @@ SendConnectRequestToVmx(void)
 
    g_debug("Entering %s.\n", __FUNCTION__);
 
-   ASSERT(!pluginData.vmxConnectRequested);
-   ASSERT(theVmxConn == NULL);
+   ASSERT(!session->vmxConnectRequested);
+   ASSERT(session->vmxConn == NULL);
    ASSERT(pluginData.vmxListenSock != NULL);
 
    fd = AsyncSocket_GetFd(pluginData.vmxListenSock);
@@ -1024,14 +1281,14 @@ SendConnectRequestToVmx(void)
    vm_free(result);
 
 exit:
+   session->vmxConnectRequested = retVal;
+
    if (!retVal) {
-      CloseCurrentClientConn();
-      CloseClientConnsInWait();
+      HandleVmxConnectFailure(session);
    } else {
-      StartVmxToGuestConnTimeout();
+      StartVmxToGuestConnTimeout(session);
    }
 
-   pluginData.vmxConnectRequested = retVal;
    return retVal;
 }
 
@@ -1041,11 +1298,11 @@ exit:
  *
  * SendDataMapToVmxConn --
  *
- *      Send a data map to the VMX connection.
+ *      Send a data map to the VMX connection of a session.
  *
- *      After received request path from the current client connection, data
- *      map field GUESTSTORE_REQ_FLD_PATH with the request path is sent to
- *      the VMX connection. VMX will send back a response data map with error
+ *      After received request path from the client connection, data map
+ *      field GUESTSTORE_REQ_FLD_PATH with the request path is sent to the
+ *      VMX connection. VMX will send back a response data map with error
  *      code.
  *
  *      When no more client to serve, initiate shutdown VMX connection by
@@ -1062,24 +1319,24 @@ exit:
  */
 
 static Bool
-SendDataMapToVmxConn(void)
+SendDataMapToVmxConn(ServeSession *session)  // IN
 {
+   VmxConnInfo *vmxConn = session->vmxConn;
    int fd;
    ErrorCode res;
    DataMap map;
    Bool mapCreated = FALSE;
    int cmdType;
-   char *serBuf = NULL;
    uint32 serBufLen;
    int resSock;
    Bool retVal = FALSE;
 
    g_debug("Entering %s.\n", __FUNCTION__);
 
-   ASSERT(theVmxConn != NULL);
-   ASSERT(theVmxConn->asock != NULL);
+   ASSERT(vmxConn != NULL);
+   ASSERT(vmxConn->asock != NULL);
 
-   fd = AsyncSocket_GetFd(theVmxConn->asock);
+   fd = AsyncSocket_GetFd(vmxConn->asock);
 
    res = DataMap_Create(&map);
    if (res != DMERR_SUCCESS) {
@@ -1090,23 +1347,23 @@ SendDataMapToVmxConn(void)
 
    mapCreated = TRUE;
 
-   if (currentClientConn == NULL) {
+   if (session->clientConn == NULL) {
       /*
        * No client to serve, inform VMX side to close its vsocket proactively,
        * rather than waiting for ASOCKERR_REMOTE_DISCONNECT (4) error callback
        * which may never happen.
        */
-      ASSERT(!theVmxConn->shutDown);
+      ASSERT(!vmxConn->shutDown);
 
-      theVmxConn->shutDown = TRUE;
-      StopRecvFromVmxConn();
+      vmxConn->shutDown = TRUE;
+      StopRecvFromVmxConn(vmxConn);
       cmdType = GUESTSTORE_REQ_CMD_CLOSE;
    } else {
       char *str;
 
-      ASSERT(ReceivedHttpRequestFromCurrentClientConn());
+      ASSERT(ReceivedHttpRequestFromClientConn(session->clientConn));
 
-      str = Util_SafeStrdup(currentClientConn->requestPath);
+      str = Util_SafeStrdup(session->clientConn->requestPath);
       res = DataMap_SetString(&map, GUESTSTORE_REQ_FLD_PATH, str, -1, TRUE);
       if (res != DMERR_SUCCESS) {
          g_warning("DataMap_SetString (field path) failed "
@@ -1125,23 +1382,21 @@ SendDataMapToVmxConn(void)
       goto exit;
    }
 
-   res = DataMap_Serialize(&map, &serBuf, &serBufLen);
-   if (res != DMERR_SUCCESS) {
-      g_warning("DataMap_Serialize failed "
-                "for VMX connection %d: error=%d.\n", fd, res);
-      goto exit;
-   }
-
-   if (serBufLen > theVmxConn->bufLen) {
+   res = DataMap_SerializeToBuffer(&map, vmxConn->buf, vmxConn->bufLen,
+                                   &serBufLen);
+   if (res == DMERR_BUFFER_TOO_SMALL) {
       g_warning("Data map to VMX connection %d is too large: length=%d.\n",
                 fd, serBufLen);
       goto exit;
+   } else if (res != DMERR_SUCCESS) {
+      g_warning("DataMap_SerializeToBuffer failed "
+                "for VMX connection %d: error=%d.\n", fd, res);
+      goto exit;
    }
 
-   memcpy(theVmxConn->buf, serBuf, serBufLen);
-   resSock = AsyncSocket_Send(theVmxConn->asock,
-                              theVmxConn->buf, serBufLen,
-                              VmxConnSendDataMapCb, theVmxConn);
+   resSock = AsyncSocket_Send(vmxConn->asock,
+                              vmxConn->buf, serBufLen,
+                              VmxConnSendDataMapCb, vmxConn);
    if (resSock != ASOCKERR_SUCCESS) {
       g_warning("AsyncSocket_Send failed on VMX connection %d: %s\n",
                 fd, AsyncSocket_Err2String(resSock));
@@ -1152,24 +1407,56 @@ SendDataMapToVmxConn(void)
 
 exit:
    if (mapCreated) {
-      free(serBuf);
       DataMap_Destroy(&map);
    }
 
    if (!retVal) {
-      HandleVmxConnError();
+      HandleVmxConnError(session);
    }
 
    return retVal;
 }
 
 
+/*
+ *-----------------------------------------------------------------------------
+ *
+ * CheckSendShutdownDataMapToVmxConn --
+ *
+ *      Initiate shutdown of the VMX connection of a session that has no
+ *      more client to serve, or free the session if it has no VMX
+ *      connection.
+ *
+ * Results:
+ *      None
+ *
+ * Side-effects:
+ *      The session may be freed.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+CheckSendShutdownDataMapToVmxConn(ServeSession *session)  // IN
+{
+   ASSERT(session->clientConn == NULL);
+
+   if (session->vmxConn != NULL) {
+      if (!session->vmxConn->shutDown) {
+         SendDataMapToVmxConn(session);
+      }
+   } else {
+      ReleaseSessionIfIdle(session);
+   }
+}
+
+
 /*
  *-----------------------------------------------------------------------------
  *
  * RecvDataMapFromVmxConn --
  *
- *      Start receiving data map from the VMX connection.
+ *      Start receiving data map from the VMX connection of a session.
  *
  * Results:
  *      TURE on success, FALSE otherwise.
@@ -1181,23 +1468,25 @@ exit:
  */
 
 static Bool
-RecvDataMapFromVmxConn(void *buf,  // OUT
-                       int len)    // IN
+RecvDataMapFromVmxConn(ServeSession *session,  // IN
+                       void *buf,              // OUT
+                       int len)                // IN
 {
+   VmxConnInfo *vmxConn = session->vmxConn;
    int res;
 
    g_debug("Entering %s: len=%d.\n", __FUNCTION__, len);
 
-   ASSERT(theVmxConn != NULL);
-   ASSERT(theVmxConn->asock != NULL);
+   ASSERT(vmxConn != NULL);
+   ASSERT(vmxConn->asock != NULL);
 
-   res = AsyncSocket_Recv(theVmxConn->asock, buf, len,
-                          VmxConnRecvDataMapCb, theVmxConn);
+   res = AsyncSocket_Recv(vmxConn->asock, buf, len,
+                          VmxConnRecvDataMapCb, vmxConn);
    if (res != ASOCKERR_SUCCESS) {
       g_warning("AsyncSocket_Recv failed on VMX connection %d: %s\n",
-                AsyncSocket_GetFd(theVmxConn->asock),
+                AsyncSocket_GetFd(vmxConn->asock),
                 AsyncSocket_Err2String(res));
-      HandleVmxConnError();
+      HandleVmxConnError(session);
       return FALSE;
    }
 
@@ -1210,7 +1499,7 @@ RecvDataMapFromVmxConn(void *buf,  // OUT
  *
  * StopRecvFromVmxConn --
  *
- *      Stop receiving from the VMX connection, safe to call in the same
+ *      Stop receiving from a VMX connection, safe to call in the same
  *      connection recv callback.
  *
  * Results:
@@ -1223,13 +1512,13 @@ RecvDataMapFromVmxConn(void *buf,  // OUT
  */
 
 static inline void
-StopRecvFromVmxConn(void)
+StopRecvFromVmxConn(VmxConnInfo *vmxConn)  // IN
 {
-   int res = AsyncSocket_CancelRecvEx(theVmxConn->asock,
+   int res = AsyncSocket_CancelRecvEx(vmxConn->asock,
                                       NULL, NULL, NULL, TRUE);
    if (res != ASOCKERR_SUCCESS) {
       g_warning("AsyncSocket_CancelRecvEx failed on VMX connection %d: %s\n",
-                AsyncSocket_GetFd(theVmxConn->asock),
+                AsyncSocket_GetFd(vmxConn->asock),
                 AsyncSocket_Err2String(res));
    }
 }
@@ -1240,7 +1529,7 @@ StopRecvFromVmxConn(void)
  *
  * ProcessVmxDataMap --
  *
- *      Process the data map received from the VMX connection.
+ *      Process the data map received from the VMX connection of a session.
  *
  *      The data map should contain field GUESTSTORE_RES_FLD_ERROR_CODE. In
  *      success case, field GUESTSTORE_RES_FLD_CONTENT_SIZE should also exist
@@ -1256,7 +1545,8 @@ StopRecvFromVmxConn(void)
  */
 
 static Bool
-ProcessVmxDataMap(const DataMap *map)  // IN
+ProcessVmxDataMap(ServeSession *session,     // IN
+                  const DataMapView *map)    // IN
 {
    int fd;
    ErrorCode res;
@@ -1264,29 +1554,29 @@ ProcessVmxDataMap(const DataMap *map)  // IN
 
    g_debug("Entering %s.\n", __FUNCTION__);
 
-   ASSERT(theVmxConn != NULL);
-   ASSERT(theVmxConn->asock != NULL);
+   ASSERT(session->vmxConn != NULL);
+   ASSERT(session->vmxConn->asock != NULL);
 
-   fd = AsyncSocket_GetFd(theVmxConn->asock);
+   fd = AsyncSocket_GetFd(session->vmxConn->asock);
 
-   res = DataMap_GetInt64(map, GUESTSTORE_RES_FLD_ERROR_CODE, &errorCode);
+   res = DataMap_ViewGetInt64(map, GUESTSTORE_RES_FLD_ERROR_CODE, &errorCode);
    if (res != DMERR_SUCCESS) {
-      g_warning("DataMap_GetInt64 (field error code) failed in data map "
+      g_warning("DataMap_ViewGetInt64 (field error code) failed in data map "
                 "from VMX connection %d: error=%d.\n", fd, res);
       goto error;
    }
 
-   ASSERT(currentClientConn != NULL);
-   ASSERT(currentClientConn->asock != NULL);
+   ASSERT(session->clientConn != NULL);
+   ASSERT(session->clientConn->asock != NULL);
 
    switch ((int32)errorCode) {
       case 0: // ERROR_SUCCESS
          {
             int64 contentSize;
-            res = DataMap_GetInt64(map, GUESTSTORE_RES_FLD_CONTENT_SIZE,
-                                   &contentSize);
+            res = DataMap_ViewGetInt64(map, GUESTSTORE_RES_FLD_CONTENT_SIZE,
+                                       &contentSize);
             if (res != DMERR_SUCCESS) {
-               g_warning("DataMap_GetInt64 (field content size) failed "
+               g_warning("DataMap_ViewGetInt64 (field content size) failed "
                          "in data map from VMX connection %d: error=%d.\n",
                          fd, res);
                goto error;
@@ -1299,16 +1589,16 @@ ProcessVmxDataMap(const DataMap *map)  // IN
                goto error;
             }
 
-            theVmxConn->bytesRemaining = contentSize;
-            return SendHttpResponseOKToCurrentClientConn(contentSize);
+            session->vmxConn->bytesRemaining = contentSize;
+            return SendHttpResponseOKToClientConn(session, contentSize);
          }
       case EPERM:
          {
-            return SendHttpResponseForbiddenToCurrentClientConn();
+            return SendHttpResponseForbiddenToClientConn(session);
          }
       case ENOENT:
          {
-            return SendHttpResponseNotFoundToCurrentClientConn();
+            return SendHttpResponseNotFoundToClientConn(session);
          }
       default:
          g_warning("Unexpected error code value %" FMT64 "d in data map "
@@ -1317,7 +1607,7 @@ ProcessVmxDataMap(const DataMap *map)  // IN
    }
 
 error:
-   HandleVmxConnError();
+   HandleVmxConnError(session);
    return FALSE;
 }
 
@@ -1327,7 +1617,7 @@ error:
  *
  * RecvContentFromVmxConn --
  *
- *      Start receiving content bytes from the VMX connection.
+ *      Start receiving content bytes from the VMX connection of a session.
  *
  * Results:
  *      TURE on success, FALSE otherwise.
@@ -1339,25 +1629,26 @@ error:
  */
 
 static Bool
-RecvContentFromVmxConn(void)
+RecvContentFromVmxConn(ServeSession *session)  // IN
 {
+   VmxConnInfo *vmxConn = session->vmxConn;
    int res;
 
    //g_debug("Entering %s.\n", __FUNCTION__);
 
-   ASSERT(theVmxConn != NULL);
-   ASSERT(theVmxConn->asock != NULL);
+   ASSERT(vmxConn != NULL);
+   ASSERT(vmxConn->asock != NULL);
 
-   res = AsyncSocket_RecvPartial(theVmxConn->asock,
-                                 theVmxConn->buf,
-                                 theVmxConn->bufLen,
+   res = AsyncSocket_RecvPartial(vmxConn->asock,
+                                 vmxConn->buf,
+                                 vmxConn->bufLen,
                                  VmxConnRecvContentCb,
-                                 theVmxConn);
+                                 vmxConn);
    if (res != ASOCKERR_SUCCESS) {
       g_warning("AsyncSocket_RecvPartial failed on VMX connection %d: %s\n",
-                AsyncSocket_GetFd(theVmxConn->asock),
+                AsyncSocket_GetFd(vmxConn->asock),
                 AsyncSocket_Err2String(res));
-      HandleVmxConnError();
+      HandleVmxConnError(session);
       return FALSE;
    }
 
@@ -1368,9 +1659,9 @@ RecvContentFromVmxConn(void)
 /*
  *-----------------------------------------------------------------------------
  *
- * StartCurrentClientConnRecvTimeout --
+ * StartClientConnRecvTimeout --
  *
- *      Start the current client connection recv timeout.
+ *      Start a client connection recv timeout.
  *
  * Results:
  *      None
@@ -1382,11 +1673,11 @@ RecvContentFromVmxConn(void)
  */
 
 static void
-StartCurrentClientConnRecvTimeout(void)
+StartClientConnRecvTimeout(ClientConnInfo *clientConn)  // IN
 {
    int clientRecvTimeout;
 
-   ASSERT(currentClientConn->timeoutSource == NULL);
+   ASSERT(clientConn->timeoutSource == NULL);
 
    clientRecvTimeout = GUESTSTORE_CONFIG_GET_INT("clientRecvTimeout",
       DEFAULT_CLIENT_RECV_TIMEOUT);
@@ -1396,12 +1687,11 @@ StartCurrentClientConnRecvTimeout(void)
       clientRecvTimeout = DEFAULT_CLIENT_RECV_TIMEOUT;
    }
 
-   currentClientConn->timeoutSource = g_timeout_source_new(
-      clientRecvTimeout * 1000);
+   clientConn->timeoutSource = g_timeout_source_new(clientRecvTimeout * 1000);
    VMTOOLSAPP_ATTACH_SOURCE(pluginData.ctx,
-                            currentClientConn->timeoutSource,
-                            CurrentClientConnRecvTimeoutCb,
-                            currentClientConn, NULL);
+                            clientConn->timeoutSource,
+                            ClientConnRecvTimeoutCb,
+                            clientConn, NULL);
 }
 
 
@@ -1437,35 +1727,12 @@ StopClientConnRecvTimeout(ClientConnInfo *clientConn)  // IN
 /*
  *-----------------------------------------------------------------------------
  *
- * StopCurrentClientConnRecvTimeout --
+ * ClientConnRecvTimeoutCb --
  *
- *      Stop the current client connection recv timeout.
+ *      Poll callback function for a client connection recv timeout.
  *
  * Results:
- *      None
- *
- * Side effects:
- *      None
- *
- *-----------------------------------------------------------------------------
- */
-
-static inline void
-StopCurrentClientConnRecvTimeout(void)
-{
-   StopClientConnRecvTimeout(currentClientConn);
-}
-
-
-/*
- *-----------------------------------------------------------------------------
- *
- * CurrentClientConnRecvTimeoutCb --
- *
- *      Poll callback function for the current client connection recv timeout.
- *
- * Results:
- *      The current client connection is closed.
+ *      The client connection is closed.
  *      The timeout source is removed from poll.
  *
  * Side-effects:
@@ -1475,23 +1742,26 @@ StopCurrentClientConnRecvTimeout(void)
  */
 
 static Bool
-CurrentClientConnRecvTimeoutCb(gpointer clientData)  // IN
+ClientConnRecvTimeoutCb(gpointer clientData)  // IN
 {
+   ClientConnInfo *clientConn = (ClientConnInfo *)clientData;
+
    g_debug("Entering %s.\n", __FUNCTION__);
 
-   ASSERT(currentClientConn == clientData);
-   ASSERT(currentClientConn != NULL);
-   ASSERT(currentClientConn->asock != NULL);
+   ASSERT(clientConn != NULL);
+   ASSERT(clientConn->asock != NULL);
+   ASSERT(clientConn->session != NULL);
+   ASSERT(clientConn->session->clientConn == clientConn);
 
-   g_warning("The current client connection %d recv timed out.\n",
-             AsyncSocket_GetFd(currentClientConn->asock));
+   g_warning("Client connection %d recv timed out.\n",
+             AsyncSocket_GetFd(clientConn->asock));
 
    /*
     * Follow the pattern in ConnInactivityTimeoutCb()
     */
-   StopCurrentClientConnRecvTimeout();
+   StopClientConnRecvTimeout(clientConn);
 
-   HandleCurrentClientConnError();
+   HandleClientConnError(clientConn->session);
 
    return G_SOURCE_REMOVE;
 }
@@ -1502,7 +1772,7 @@ CurrentClientConnRecvTimeoutCb(gpointer clientData)  // IN
  *
  * StartVmxToGuestConnTimeout --
  *
- *      Start VMX to guest connection timeout.
+ *      Start VMX to guest connection timeout of a session.
  *
  * Results:
  *      None
@@ -1514,16 +1784,16 @@ CurrentClientConnRecvTimeoutCb(gpointer clientData)  // IN
  */
 
 static inline void
-StartVmxToGuestConnTimeout(void)
+StartVmxToGuestConnTimeout(ServeSession *session)  // IN
 {
-   ASSERT(pluginData.timeoutSource == NULL);
+   ASSERT(session->timeoutSource == NULL);
 
-   pluginData.timeoutSource = g_timeout_source_new(
+   session->timeoutSource = g_timeout_source_new(
       GUESTSTORE_VMX_TO_GUEST_CONN_TIMEOUT * 1000);
    VMTOOLSAPP_ATTACH_SOURCE(pluginData.ctx,
-                            pluginData.timeoutSource,
+                            session->timeoutSource,
                             VmxToGuestConnTimeoutCb,
-                            NULL, NULL);
+                            session, NULL);
 }
 
 
@@ -1532,7 +1802,7 @@ StartVmxToGuestConnTimeout(void)
  *
  * StopVmxToGuestConnTimeout --
  *
- *      Stop VMX to guest connection timeout.
+ *      Stop VMX to guest connection timeout of a session.
  *
  * Results:
  *      None
@@ -1544,12 +1814,12 @@ StartVmxToGuestConnTimeout(void)
  */
 
 static inline void
-StopVmxToGuestConnTimeout(void)
+StopVmxToGuestConnTimeout(ServeSession *session)  // IN
 {
-   if (pluginData.timeoutSource != NULL) {
-      g_source_destroy(pluginData.timeoutSource);
-      g_source_unref(pluginData.timeoutSource);
-      pluginData.timeoutSource = NULL;
+   if (session->timeoutSource != NULL) {
+      g_source_destroy(session->timeoutSource);
+      g_source_unref(session->timeoutSource);
+      session->timeoutSource = NULL;
    }
 }
 
@@ -1562,7 +1832,7 @@ StopVmxToGuestConnTimeout(void)
  *      Poll callback function for VMX to guest connection timeout.
  *
  * Results:
- *      All outstanding client connections are closed.
+ *      See HandleVmxConnectFailure().
  *      The timeout source is removed from poll.
  *
  * Side-effects:
@@ -1574,18 +1844,16 @@ StopVmxToGuestConnTimeout(void)
 static Bool
 VmxToGuestConnTimeoutCb(gpointer clientData)  // IN
 {
+   ServeSession *session = (ServeSession *)clientData;
+
    g_debug("Entering %s.\n", __FUNCTION__);
 
-   ASSERT(theVmxConn == NULL);
+   ASSERT(session != NULL);
+   ASSERT(session->vmxConn == NULL);
 
    g_warning("VMX to guest connection timed out.\n");
 
-   StopVmxToGuestConnTimeout();
-
-   CloseCurrentClientConn();
-   CloseClientConnsInWait();
-
-   pluginData.vmxConnectRequested = FALSE;
+   HandleVmxConnectFailure(session);
 
    return G_SOURCE_REMOVE;
 }
@@ -1596,7 +1864,7 @@ VmxToGuestConnTimeoutCb(gpointer clientData)  // IN
  *
  * StartConnInactivityTimeout --
  *
- *      Start connection inactivity timeout.
+ *      Start connection inactivity timeout of a VMX connection.
  *
  * Results:
  *      None
@@ -1608,18 +1876,18 @@ VmxToGuestConnTimeoutCb(gpointer clientData)  // IN
  */
 
 static inline void
-StartConnInactivityTimeout(void)
+StartConnInactivityTimeout(VmxConnInfo *vmxConn)  // IN
 {
-   ASSERT(theVmxConn != NULL);
-   ASSERT(theVmxConn->timeoutSource == NULL);
-   ASSERT(theVmxConn->connTimeout != 0);
+   ASSERT(vmxConn != NULL);
+   ASSERT(vmxConn->timeoutSource == NULL);
+   ASSERT(vmxConn->connTimeout != 0);
 
-   theVmxConn->timeoutSource = g_timeout_source_new(
-      theVmxConn->connTimeout * 1000);
+   vmxConn->timeoutSource = g_timeout_source_new(
+      vmxConn->connTimeout * 1000);
    VMTOOLSAPP_ATTACH_SOURCE(pluginData.ctx,
-                            theVmxConn->timeoutSource,
+                            vmxConn->timeoutSource,
                             ConnInactivityTimeoutCb,
-                            theVmxConn, NULL);
+                            vmxConn, NULL);
 }
 
 
@@ -1628,7 +1896,7 @@ StartConnInactivityTimeout(void)
  *
  * StopConnInactivityTimeout --
  *
- *      Stop connection inactivity timeout.
+ *      Stop connection inactivity timeout of a VMX connection.
  *
  * Results:
  *      None
@@ -1640,14 +1908,14 @@ StartConnInactivityTimeout(void)
  */
 
 static inline void
-StopConnInactivityTimeout(void)
+StopConnInactivityTimeout(VmxConnInfo *vmxConn)  // IN
 {
-   ASSERT(theVmxConn != NULL);
+   ASSERT(vmxConn != NULL);
 
-   if (theVmxConn->timeoutSource != NULL) {
-      g_source_destroy(theVmxConn->timeoutSource);
-      g_source_unref(theVmxConn->timeoutSource);
-      theVmxConn->timeoutSource = NULL;
+   if (vmxConn->timeoutSource != NULL) {
+      g_source_destroy(vmxConn->timeoutSource);
+      g_source_unref(vmxConn->timeoutSource);
+      vmxConn->timeoutSource = NULL;
    }
 }
 
@@ -1660,7 +1928,8 @@ StopConnInactivityTimeout(void)
  *      Poll callback function for connection inactivity timeout.
  *
  * Results:
- *      The VMX connection and the current client connection are closed.
+ *      The VMX connection and the client connection of the session are
+ *      closed.
  *      The timeout source is removed from poll.
  *
  * Side-effects:
@@ -1672,11 +1941,14 @@ StopConnInactivityTimeout(void)
 static Bool
 ConnInactivityTimeoutCb(gpointer clientData)  // IN
 {
+   VmxConnInfo *vmxConn = (VmxConnInfo *)clientData;
+
    g_debug("Entering %s.\n", __FUNCTION__);
 
-   ASSERT(theVmxConn == clientData);
-   ASSERT(theVmxConn != NULL);
-   ASSERT(theVmxConn->asock != NULL);
+   ASSERT(vmxConn != NULL);
+   ASSERT(vmxConn->asock != NULL);
+   ASSERT(vmxConn->session != NULL);
+   ASSERT(vmxConn->session->vmxConn == vmxConn);
 
    g_warning("Connection inactivity timed out.\n");
 
@@ -1693,9 +1965,9 @@ ConnInactivityTimeoutCb(gpointer clientData)  // IN
     * After this callback returns G_SOURCE_REMOVE (FALSE), g_main_dispatch()
     * detects the inactivity timeout source destroyed and skips same action.
     */
-   StopConnInactivityTimeout();
+   StopConnInactivityTimeout(vmxConn);
 
-   CloseActiveConnections();
+   CloseActiveConnections(vmxConn->session);
 
    return G_SOURCE_REMOVE;
 }
@@ -1731,9 +2003,9 @@ ClientConnErrorCb(int err,             // IN
           AsyncSocket_GetFd(clientConn->asock),
           AsyncSocket_Err2String(err));
 
-   if (clientConn->isCurrent) {
-      ASSERT(currentClientConn == clientConn);
-      HandleCurrentClientConnError();
+   if (clientConn->session != NULL) {
+      ASSERT(clientConn->session->clientConn == clientConn);
+      HandleClientConnError(clientConn->session);
    } else {
       CloseClientConn(clientConn);
    }
@@ -1743,9 +2015,9 @@ ClientConnErrorCb(int err,             // IN
 /*
  *-----------------------------------------------------------------------------
  *
- * CurrentClientConnSendCb --
+ * ClientConnSendCb --
  *
- *      Callback function after sent to the current client connection.
+ *      Callback function after sent to a client connection.
  *
  * Results:
  *      None
@@ -1757,19 +2029,20 @@ ClientConnErrorCb(int err,             // IN
  */
 
 static void
-CurrentClientConnSendCb(void *buf,           // IN
-                        int len,             // IN
-                        AsyncSocket *asock,  // IN
-                        void *clientData)    // IN
+ClientConnSendCb(void *buf,           // IN
+                 int len,             // IN
+                 AsyncSocket *asock,  // IN
+                 void *clientData)    // IN
 {
+   ClientConnInfo *clientConn = (ClientConnInfo *)clientData;
+   ServeSession *session;
+
    //g_debug("Entering %s: len=%d.\n", __FUNCTION__, len);
 
-   ASSERT(currentClientConn == clientData);
-   ASSERT(currentClientConn != NULL);
-   ASSERT(currentClientConn->asock != NULL);
+   ASSERT(clientConn != NULL);
+   ASSERT(clientConn->asock != NULL);
 
-   if (AsyncSocket_GetState(currentClientConn->asock) != 
-       AsyncSocketConnected) {
+   if (AsyncSocket_GetState(clientConn->asock) != AsyncSocketConnected) {
       /*
        * This callback may be called after the connection is closed for
        * freeing the send buffer.
@@ -1777,25 +2050,28 @@ CurrentClientConnSendCb(void *buf,           // IN
       return;
    }
 
-   ASSERT(theVmxConn != NULL);
-   ASSERT(theVmxConn->timeoutSource != NULL);
+   session = clientConn->session;
+   ASSERT(session != NULL);
+   ASSERT(session->clientConn == clientConn);
+   ASSERT(session->vmxConn != NULL);
+   ASSERT(session->vmxConn->timeoutSource != NULL);
 
    /*
     * Restart connection inactivity timeout.
     */
-   StopConnInactivityTimeout();
-   StartConnInactivityTimeout();
+   StopConnInactivityTimeout(session->vmxConn);
+   StartConnInactivityTimeout(session->vmxConn);
 
-   if (currentClientConn->shutDown) {
-      g_info("Finished with current client connection %d.\n",
-             AsyncSocket_GetFd(currentClientConn->asock));
+   if (clientConn->shutDown) {
+      g_info("Finished with client connection %d.\n",
+             AsyncSocket_GetFd(clientConn->asock));
 
-      CloseCurrentClientConn();
-      StartServeNextClientConn();
+      CloseClientConn(clientConn);
+      StartServeNextClientConn(session);
    } else {
-      ASSERT(theVmxConn->bytesRemaining > 0);
+      ASSERT(session->vmxConn->bytesRemaining > 0);
 
-      RecvContentFromVmxConn();
+      RecvContentFromVmxConn(session);
    }
 }
 
@@ -1803,9 +2079,9 @@ CurrentClientConnSendCb(void *buf,           // IN
 /*
  *-----------------------------------------------------------------------------
  *
- * CurrentClientConnRecvHttpRequestCb --
+ * ClientConnRecvHttpRequestCb --
  *
- *      Callback function after received from the current client connection.
+ *      Callback function after received from a client connection.
  *
  * Results:
  *      None
@@ -1817,11 +2093,13 @@ CurrentClientConnSendCb(void *buf,           // IN
  */
 
 static void
-CurrentClientConnRecvHttpRequestCb(void *buf,           // IN
-                                   int len,             // IN
-                                   AsyncSocket *asock,  // IN
-                                   void *clientData)    // IN
+ClientConnRecvHttpRequestCb(void *buf,           // IN
+                            int len,             // IN
+                            AsyncSocket *asock,  // IN
+                            void *clientData)    // IN
 {
+   ClientConnInfo *clientConn = (ClientConnInfo *)clientData;
+   ServeSession *session;
    int fd;
    int recvLen;
    char *next_token;
@@ -1830,15 +2108,18 @@ CurrentClientConnRecvHttpRequestCb(void *buf,           // IN
 
    g_debug("Entering %s: len=%d.\n", __FUNCTION__, len);
 
-   ASSERT(currentClientConn == clientData);
-   ASSERT(currentClientConn != NULL);
-   ASSERT(currentClientConn->asock != NULL);
+   ASSERT(clientConn != NULL);
+   ASSERT(clientConn->asock != NULL);
 
-   fd = AsyncSocket_GetFd(currentClientConn->asock);
+   session = clientConn->session;
+   ASSERT(session != NULL);
+   ASSERT(session->clientConn == clientConn);
 
-   recvLen = (int)((char *)buf - currentClientConn->buf) + len;
-   if (recvLen >= currentClientConn->bufLen) {
-      g_warning("Recv from current client connection %d "
+   fd = AsyncSocket_GetFd(clientConn->asock);
+
+   recvLen = (int)((char *)buf - clientConn->buf) + len;
+   if (recvLen >= clientConn->bufLen) {
+      g_warning("Recv from client connection %d "
                 "reached buffer limit.\n", fd);
       goto error;
    }
@@ -1847,22 +2128,21 @@ CurrentClientConnRecvHttpRequestCb(void *buf,           // IN
     * Check for HTTP request end.
     */
    if (recvLen < HTTP_HEADER_END_LEN ||
-       strncmp(currentClientConn->buf + recvLen - HTTP_HEADER_END_LEN,
+       strncmp(clientConn->buf + recvLen - HTTP_HEADER_END_LEN,
                HTTP_HEADER_END, HTTP_HEADER_END_LEN) != 0) {
-      RecvHttpRequestFromCurrentClientConn(currentClientConn->buf +
-                                           recvLen,
-                                           currentClientConn->bufLen -
-                                           recvLen);
+      RecvHttpRequestFromClientConn(session,
+                                    clientConn->buf + recvLen,
+                                    clientConn->bufLen - recvLen);
       return;
    }
 
-   StopCurrentClientConnRecvTimeout();
+   StopClientConnRecvTimeout(clientConn);
 
-   *(currentClientConn->buf + recvLen) = '\0';
-   g_debug("HTTP request from current client connection %d:\n%s\n",
-           fd, currentClientConn->buf);
+   *(clientConn->buf + recvLen) = '\0';
+   g_debug("HTTP request from client connection %d:\n%s\n",
+           fd, clientConn->buf);
 
-   requestMethod = strtok_r(currentClientConn->buf, " ", &next_token);
+   requestMethod = strtok_r(clientConn->buf, " ", &next_token);
    if (NULL == requestMethod ||
        strcmp(requestMethod, HTTP_REQ_METHOD_GET) != 0) {
       g_warning("Invalid HTTP request method.\n");
@@ -1878,30 +2158,30 @@ CurrentClientConnRecvHttpRequestCb(void *buf,           // IN
       goto error;
    }
 
-   currentClientConn->requestPath = g_uri_unescape_string(requestPath, NULL);
-   if (NULL == currentClientConn->requestPath ||
-       '/' != *currentClientConn->requestPath ||
-       strlen(currentClientConn->requestPath) > GUESTSTORE_CONTENT_PATH_MAX) {
+   clientConn->requestPath = g_uri_unescape_string(requestPath, NULL);
+   if (NULL == clientConn->requestPath ||
+       '/' != *clientConn->requestPath ||
+       strlen(clientConn->requestPath) > GUESTSTORE_CONTENT_PATH_MAX) {
       g_warning("Invalid HTTP request path.\n");
       goto error;
    }
 
-   g_info("HTTP request path from current client connection %d: \"%s\"",
-          fd, currentClientConn->requestPath);
+   g_info("HTTP request path from client connection %d: \"%s\"",
+          fd, clientConn->requestPath);
 
-   StopRecvFromCurrentClientConn();
+   StopRecvFromClientConn(clientConn);
 
-   if (!pluginData.vmxConnectRequested) {
-      ASSERT(theVmxConn == NULL);
-      SendConnectRequestToVmx();
+   if (!session->vmxConnectRequested) {
+      ASSERT(session->vmxConn == NULL);
+      SendConnectRequestToVmx(session);
    } else {
-      CheckSendRequestDataMapToVmxConn();
+      CheckSendRequestDataMapToVmxConn(session);
    }
 
    return;
 
 error:
-   HandleCurrentClientConnError();
+   HandleClientConnError(session);
 }
 
 
@@ -1912,6 +2192,11 @@ error:
  *
  *      Poll callback function for a new client connection.
  *
+ *      The new client connection is queued in the waiting list. A new
+ *      serving session is started for it unless the maximum number of VMX
+ *      connections has been reached, in which case it is served by the
+ *      first session that finishes its current client connection.
+ *
  * Results:
  *      None
  *
@@ -1927,7 +2212,9 @@ ClientConnectCb(AsyncSocket *asock,  // IN
 {
    int fd = AsyncSocket_GetFd(asock);
    int maxConnections;
+   int numConnections;
    ClientConnInfo *clientConn = NULL;
+   GList *l;
    int res;
 
    g_debug("Entering %s.\n", __FUNCTION__);
@@ -1940,8 +2227,13 @@ ClientConnectCb(AsyncSocket *asock,  // IN
 
    maxConnections = GUESTSTORE_CONFIG_GET_INT("maxConnections",
       DEFAULT_MAX_CLIENT_CONNECTIONS);
-   if ((g_list_length(pluginData.clientConnWaitList) +
-        ((currentClientConn != NULL) ? 1 : 0)) >= maxConnections) {
+   numConnections = (int)g_list_length(pluginData.clientConnWaitList);
+   for (l = pluginData.sessions; l != NULL; l = l->next) {
+      if (((ServeSession *)l->data)->clientConn != NULL) {
+         numConnections++;
+      }
+   }
+   if (numConnections >= maxConnections) {
       g_info("Client connection %d has exceeded maximum limit "
              "of %d client connections.\n", fd, maxConnections);
       goto error;
@@ -1975,16 +2267,16 @@ ClientConnectCb(AsyncSocket *asock,  // IN
       goto error;
    }
 
-   if (currentClientConn == NULL) {
+   pluginData.clientConnWaitList = g_list_append(
+      pluginData.clientConnWaitList, clientConn);
+
+   if ((int)g_list_length(pluginData.sessions) < GetMaxVmxConnections()) {
       /*
-       * Make the first client connection be the current client connection.
+       * Serve the client connection at the head of the waiting list, which
+       * is this one unless other sessions have put back their client
+       * connections.
        */
-      currentClientConn = clientConn;
-      currentClientConn->isCurrent = TRUE;
-      StartRecvHttpRequestFromCurrentClientConn();
-   } else {
-      pluginData.clientConnWaitList = g_list_append(
-         pluginData.clientConnWaitList, clientConn);
+      StartServeNextClientConn(CreateSession());
    }
 
    return;
@@ -2017,16 +2309,19 @@ VmxConnErrorCb(int err,             // IN
                AsyncSocket *asock,  // IN
                void *clientData)    // IN
 {
+   VmxConnInfo *vmxConn = (VmxConnInfo *)clientData;
+
    g_debug("Entering %s.\n", __FUNCTION__);
 
-   ASSERT(theVmxConn == clientData);
-   ASSERT(theVmxConn != NULL);
-   ASSERT(theVmxConn->asock != NULL);
+   ASSERT(vmxConn != NULL);
+   ASSERT(vmxConn->asock != NULL);
+   ASSERT(vmxConn->session != NULL);
+   ASSERT(vmxConn->session->vmxConn == vmxConn);
    g_info("VMX connection %d error callback: %s\n",
-          AsyncSocket_GetFd(theVmxConn->asock),
+          AsyncSocket_GetFd(vmxConn->asock),
           AsyncSocket_Err2String(err));
 
-   HandleVmxConnError();
+   HandleVmxConnError(vmxConn->session);
 }
 
 
@@ -2035,7 +2330,7 @@ VmxConnErrorCb(int err,             // IN
  *
  * VmxConnSendDataMapCb --
  *
- *      Callback function after sent to the VMX connection.
+ *      Callback function after sent to a VMX connection.
  *
  * Results:
  *      None
@@ -2052,17 +2347,18 @@ VmxConnSendDataMapCb(void *buf,           // IN
                      AsyncSocket *asock,  // IN
                      void *clientData)    // IN
 {
+   VmxConnInfo *vmxConn = (VmxConnInfo *)clientData;
+   ServeSession *session;
    int fd;
 
    g_debug("Entering %s: len=%d.\n", __FUNCTION__, len);
 
-   ASSERT(theVmxConn == clientData);
-   ASSERT(theVmxConn != NULL);
-   ASSERT(theVmxConn->asock != NULL);
+   ASSERT(vmxConn != NULL);
+   ASSERT(vmxConn->asock != NULL);
 
-   fd = AsyncSocket_GetFd(theVmxConn->asock);
+   fd = AsyncSocket_GetFd(vmxConn->asock);
 
-   if (AsyncSocket_GetState(theVmxConn->asock) != AsyncSocketConnected) {
+   if (AsyncSocket_GetState(vmxConn->asock) != AsyncSocketConnected) {
       /*
        * This callback may be called after the connection is closed for
        * freeing the send buffer.
@@ -2070,20 +2366,24 @@ VmxConnSendDataMapCb(void *buf,           // IN
       return;
    }
 
-   if (theVmxConn->shutDown) {
-      g_info("Shut down VMX connection %d.\n", fd);
-      CloseVmxConn();
+   session = vmxConn->session;
+   ASSERT(session != NULL);
+   ASSERT(session->vmxConn == vmxConn);
 
-      if (pluginData.guestStoreAccessEnabled) {
-         if (currentClientConn == NULL) {
-            StartServeNextClientConn();
-         } else if (ReceivedHttpRequestFromCurrentClientConn()) {
-            SendConnectRequestToVmx();
-         }
+   if (vmxConn->shutDown) {
+      g_info("Shut down VMX connection %d.\n", fd);
+      CloseVmxConn(session);
+
+      if (!pluginData.guestStoreAccessEnabled) {
+         ReleaseSessionIfIdle(session);
+      } else if (session->clientConn == NULL) {
+         StartServeNextClientConn(session);
+      } else if (ReceivedHttpRequestFromClientConn(session->clientConn)) {
+         SendConnectRequestToVmx(session);
       }
    } else {
-      RecvDataMapFromVmxConn(&theVmxConn->dataMapLen,
-                             (int)sizeof(theVmxConn->dataMapLen));
+      RecvDataMapFromVmxConn(session, &vmxConn->dataMapLen,
+                             (int)sizeof(vmxConn->dataMapLen));
    }
 }
 
@@ -2093,7 +2393,7 @@ VmxConnSendDataMapCb(void *buf,           // IN
  *
  * VmxConnRecvDataMapCb --
  *
- *      Callback function after received data map from the VMX connection.
+ *      Callback function after received data map from a VMX connection.
  *
  *      VMX responds with a data map, followed by content bytes if no error.
  *
@@ -2112,55 +2412,65 @@ VmxConnRecvDataMapCb(void *buf,           // IN
                      AsyncSocket *asock,  // IN
                      void *clientData)    // IN
 {
+   VmxConnInfo *vmxConn = (VmxConnInfo *)clientData;
+   ServeSession *session;
    int fd;
 
    g_debug("Entering %s: len=%d.\n", __FUNCTION__, len);
 
-   ASSERT(theVmxConn == clientData);
-   ASSERT(theVmxConn != NULL);
-   ASSERT(theVmxConn->asock != NULL);
+   ASSERT(vmxConn != NULL);
+   ASSERT(vmxConn->asock != NULL);
 
-   fd = AsyncSocket_GetFd(theVmxConn->asock);
+   session = vmxConn->session;
+   ASSERT(session != NULL);
+   ASSERT(session->vmxConn == vmxConn);
 
-   if (buf == &theVmxConn->dataMapLen) {
-      int dataMapLen = ntohl(theVmxConn->dataMapLen);
+   fd = AsyncSocket_GetFd(vmxConn->asock);
 
-      ASSERT(len == sizeof theVmxConn->dataMapLen);
+   if (buf == &vmxConn->dataMapLen) {
+      int dataMapLen = ntohl(vmxConn->dataMapLen);
 
-      if (dataMapLen > (theVmxConn->bufLen - sizeof theVmxConn->dataMapLen)) {
+      ASSERT(len == sizeof vmxConn->dataMapLen);
+
+      if (dataMapLen > (vmxConn->bufLen - sizeof vmxConn->dataMapLen)) {
          g_warning("Data map from VMX connection %d "
                    "is too large: length=%d.\n", fd, dataMapLen);
          goto error;
       }
 
-      *((int32 *)(theVmxConn->buf)) = theVmxConn->dataMapLen;
-      RecvDataMapFromVmxConn(theVmxConn->buf + sizeof theVmxConn->dataMapLen,
+      *((int32 *)(vmxConn->buf)) = vmxConn->dataMapLen;
+      RecvDataMapFromVmxConn(session,
+                             vmxConn->buf + sizeof vmxConn->dataMapLen,
                              dataMapLen);
    } else {
       ErrorCode res;
-      DataMap map;
+      DataMapView map;
 
-      ASSERT(buf == (theVmxConn->buf + sizeof theVmxConn->dataMapLen));
-      ASSERT(len == ntohl(theVmxConn->dataMapLen));
+      ASSERT(buf == (vmxConn->buf + sizeof vmxConn->dataMapLen));
+      ASSERT(len == ntohl(vmxConn->dataMapLen));
 
-      res = DataMap_Deserialize(theVmxConn->buf,
-                                len + (int)sizeof(theVmxConn->dataMapLen),
-                                &map);
+      /*
+       * The data map only carries a couple of integers, read them in place
+       * rather than building a DataMap.
+       */
+      res = DataMap_ViewInit(vmxConn->buf,
+                             len + (int)sizeof(vmxConn->dataMapLen),
+                             &map);
       if (res != DMERR_SUCCESS) {
-         g_warning("DataMap_Deserialize failed for data map "
+         g_warning("DataMap_ViewInit failed for data map "
                    "from VMX connection %d: error=%d.\n", fd, res);
          goto error;
       }
 
-      StopRecvFromVmxConn();
-      ProcessVmxDataMap(&map);
-      DataMap_Destroy(&map);
+      StopRecvFromVmxConn(vmxConn);
+      ProcessVmxDataMap(session, &map);
+      DataMap_ViewDestroy(&map);
    }
 
    return;
 
 error:
-   HandleVmxConnError();
+   HandleVmxConnError(session);
 }
 
 
@@ -2169,7 +2479,7 @@ error:
  *
  * VmxConnRecvContentCb --
  *
- *      Callback function after received content bytes from the VMX connection.
+ *      Callback function after received content bytes from a VMX connection.
  *
  *      VMX responds with a data map, followed by content bytes if no error.
  *
@@ -2188,27 +2498,35 @@ VmxConnRecvContentCb(void *buf,           // IN
                      AsyncSocket *asock,  // IN
                      void *clientData)    // IN
 {
+   VmxConnInfo *vmxConn = (VmxConnInfo *)clientData;
+   ServeSession *session;
+
    //g_debug("Entering %s: len=%d.\n", __FUNCTION__, len);
 
-   ASSERT(theVmxConn == clientData);
-   ASSERT(theVmxConn != NULL);
-   ASSERT(theVmxConn->asock != NULL);
+   ASSERT(vmxConn != NULL);
+   ASSERT(vmxConn->asock != NULL);
 
-   theVmxConn->bytesRemaining -= len;
-   if (theVmxConn->bytesRemaining < 0) {
+   session = vmxConn->session;
+   ASSERT(session != NULL);
+   ASSERT(session->vmxConn == vmxConn);
+
+   vmxConn->bytesRemaining -= len;
+   if (vmxConn->bytesRemaining < 0) {
       g_warning("Recv from VMX connection %d exceeded content size.\n",
-                AsyncSocket_GetFd(theVmxConn->asock));
-      HandleVmxConnError();
+                AsyncSocket_GetFd(vmxConn->asock));
+      HandleVmxConnError(session);
       return;
    }
 
-   StopRecvFromVmxConn();
+   StopRecvFromVmxConn(vmxConn);
+
+   ASSERT(session->clientConn != NULL);
 
-   if (theVmxConn->bytesRemaining == 0) {
-      currentClientConn->shutDown = TRUE;
+   if (vmxConn->bytesRemaining == 0) {
+      session->clientConn->shutDown = TRUE;
    }
 
-   SendToCurrentClientConn(buf, len);
+   SendToClientConn(session, buf, len);
 }
 
 
@@ -2219,6 +2537,9 @@ VmxConnRecvContentCb(void *buf,           // IN
  *
  *      Poll callback function for a new VMX connection.
  *
+ *      VMX connections are interchangeable, the new connection is given to
+ *      the first session waiting for one.
+ *
  * Results:
  *      None
  *
@@ -2232,26 +2553,31 @@ VmxConnectCb(AsyncSocket *asock,  // IN
              void *clientData)    // IN
 {
    int fd = AsyncSocket_GetFd(asock);
+   ServeSession *session = NULL;
+   VmxConnInfo *vmxConn = NULL;
+   GList *l;
    int res;
 
    g_debug("Entering %s.\n", __FUNCTION__);
    g_info("Got new VMX connection %d.\n", fd);
 
-   StopVmxToGuestConnTimeout();
+   for (l = pluginData.sessions; l != NULL; l = l->next) {
+      ServeSession *candidate = (ServeSession *)l->data;
 
-   if (!pluginData.vmxConnectRequested) {
-      g_warning("Closing the unexpected VMX connection %d.\n", fd);
-      AsyncSocket_Close(asock);
-      return;
+      if (candidate->vmxConnectRequested && candidate->vmxConn == NULL) {
+         session = candidate;
+         break;
+      }
    }
 
-   if (theVmxConn != NULL) {
-      g_warning("The VMX connection already exists, closing the extra "
-                "VMX connection %d.\n", fd);
+   if (session == NULL) {
+      g_warning("Closing the unexpected VMX connection %d.\n", fd);
       AsyncSocket_Close(asock);
       return;
    }
 
+   StopVmxToGuestConnTimeout(session);
+
    if (AsyncSocket_GetState(asock) != AsyncSocketConnected) {
       g_info("VMX connection %d is not in connected state.\n", fd);
       goto error;
@@ -2265,11 +2591,12 @@ VmxConnectCb(AsyncSocket *asock,  // IN
       goto error;
    }
 
-   theVmxConn = (VmxConnInfo *)Util_SafeCalloc(1, sizeof *theVmxConn);
+   vmxConn = (VmxConnInfo *)Util_SafeCalloc(1, sizeof *vmxConn);
 
-   theVmxConn->asock = asock;
+   vmxConn->asock = asock;
+   vmxConn->session = session;
 
-   res = AsyncSocket_SetErrorFn(asock, VmxConnErrorCb, theVmxConn);
+   res = AsyncSocket_SetErrorFn(asock, VmxConnErrorCb, vmxConn);
    if (res != ASOCKERR_SUCCESS) {
       g_warning("AsyncSocket_SetErrorFn failed "
                 "on VMX connection %d: %s\n",
@@ -2277,24 +2604,25 @@ VmxConnectCb(AsyncSocket *asock,  // IN
       goto error;
    }
 
-   theVmxConn->bufLen = VMX_CONN_SEND_RECV_BUF_SIZE;
-   theVmxConn->buf = Util_SafeMalloc(theVmxConn->bufLen);
+   vmxConn->bufLen = VMX_CONN_SEND_RECV_BUF_SIZE;
+   vmxConn->buf = Util_SafeMalloc(vmxConn->bufLen);
 
-   theVmxConn->connTimeout = GUESTSTORE_CONFIG_GET_INT("connTimeout",
+   vmxConn->connTimeout = GUESTSTORE_CONFIG_GET_INT("connTimeout",
       GUESTSTORE_DEFAULT_CONN_TIMEOUT);
-   if (theVmxConn->connTimeout <= 0 ||
-       theVmxConn->connTimeout > (G_MAXINT / 1000)) {
+   if (vmxConn->connTimeout <= 0 ||
+       vmxConn->connTimeout > (G_MAXINT / 1000)) {
       g_warning("Invalid connTimeout (%d); Using default (%d).\n",
-                theVmxConn->connTimeout, GUESTSTORE_DEFAULT_CONN_TIMEOUT);
-      theVmxConn->connTimeout = GUESTSTORE_DEFAULT_CONN_TIMEOUT;
+                vmxConn->connTimeout, GUESTSTORE_DEFAULT_CONN_TIMEOUT);
+      vmxConn->connTimeout = GUESTSTORE_DEFAULT_CONN_TIMEOUT;
    }
 
-   StartConnInactivityTimeout();
+   session->vmxConn = vmxConn;
+   StartConnInactivityTimeout(vmxConn);
 
-   if (currentClientConn == NULL) {
-      StartServeNextClientConn();
+   if (session->clientConn == NULL) {
+      StartServeNextClientConn(session);
    } else {
-      CheckSendRequestDataMapToVmxConn();
+      CheckSendRequestDataMapToVmxConn(session);
    }
 
    return;
@@ -2302,14 +2630,9 @@ VmxConnectCb(AsyncSocket *asock,  // IN
 error:
    g_info("Closing VMX connection %d.\n", fd);
    AsyncSocket_Close(asock);
-   if (theVmxConn != NULL) {
-      free(theVmxConn);
-      theVmxConn = NULL;
-   }
+   free(vmxConn);
 
-   CloseCurrentClientConn();
-   CloseClientConnsInWait();
-   pluginData.vmxConnectRequested = FALSE;
+   HandleVmxConnectFailure(session);
 }
 
 
@@ -2694,6 +3017,9 @@ InitPluginSignals(ToolsAppCtx* ctx)  // IN
 static void
 GuestStoreAccessDisable(void)
 {
+   GList *sessions;
+   GList *l;
+
    g_debug("Entering %s.\n", __FUNCTION__);
 
    if (!pluginData.shutdown) {
@@ -2714,22 +3040,33 @@ GuestStoreAccessDisable(void)
       pluginData.clientListenSock = NULL;
    }
 
-   CloseCurrentClientConn();
    CloseClientConnsInWait();
 
-   if (theVmxConn != NULL && !theVmxConn->shutDown) {
-      /*
-       * After CloseCurrentClientConn(), send shutdown data map to VMX.
-       */
-      SendDataMapToVmxConn();
-   } else {
-      /*
-       * Force to stop.
-       */
-      CloseVmxConn();
-      StopVmxToGuestConnTimeout();
-      pluginData.vmxConnectRequested = FALSE;  // To make sure
+   /*
+    * Walk a copy, sessions are freed as they are stopped.
+    */
+   sessions = g_list_copy(pluginData.sessions);
+   for (l = sessions; l != NULL; l = l->next) {
+      ServeSession *session = (ServeSession *)l->data;
+
+      CloseSessionClientConn(session);
+
+      if (session->vmxConn != NULL && !session->vmxConn->shutDown) {
+         /*
+          * After CloseSessionClientConn(), send shutdown data map to VMX.
+          */
+         SendDataMapToVmxConn(session);
+      } else {
+         /*
+          * Force to stop.
+          */
+         CloseVmxConn(session);
+         StopVmxToGuestConnTimeout(session);
+         session->vmxConnectRequested = FALSE;  // To make sure
+         ReleaseSessionIfIdle(session);
+      }
    }
+   g_list_free(sessions);
 }
 
 
@@ -2861,7 +3198,13 @@ GuestStoreConfReload(gpointer src,      // IN
                      ToolsAppCtx *ctx,  // IN
                      gpointer data)     // IN
 {
-   Bool featureDisabled = IsFeatureDisabled();
+   Bool featureDisabled;
+
+   if (!ToolsCore_ConfigGroupChanged(ctx, "guestStore")) {
+      return;
+   }
+
+   featureDisabled = IsFeatureDisabled();
 
    if (pluginData.featureDisabled != featureDisabled) {
       pluginData.featureDisabled = featureDisabled;
@@ -2918,8 +3261,28 @@ GuestStoreReset(gpointer src,      // IN
                 ToolsAppCtx *ctx,  // IN
                 gpointer data)     // IN
 {
-   if (theVmxConn != NULL) {
+   GList *l;
+
+   for (l = pluginData.sessions; l != NULL; l = l->next) {
+      ServeSession *session = (ServeSession *)l->data;
+
+      if (session->vmxConn == NULL && session->vmxConnectRequested) {
+         /*
+          * GuestStoreAccessDisable() closes pluginData.vmxListensock, which
+          * cancels any pending VmxConnectCb() call.
+          * GuestStoreAccessDisable() also calls StopVmxToGuestConnTimeout().
+          */
+         g_info("Perform tools reset without VMX connection "
+                "but VMX connect request was made.\n");
+         GuestStoreAccessDisable();
+         return;
+      }
+   }
+
 #ifdef _WIN32
+   if (pluginData.sessions != NULL) {
+      GList *sessions = g_list_copy(pluginData.sessions);
+
       /*
        * After suspend/resume, VMX side vsocket is closed, VMX connection is
        * broken, but VmxConnErrorCb() is not called on Windows guests.
@@ -2930,18 +3293,16 @@ GuestStoreReset(gpointer src,      // IN
        * we want VMX to close its side vsocket proactively.
        */
       g_info("Perform tools reset by closing active connections.\n");
-      CloseActiveConnections();
-#endif
-   } else if (pluginData.vmxConnectRequested) {
-      /*
-       * GuestStoreAccessDisable() closes pluginData.vmxListensock, which
-       * cancels any pending VmxConnectCb() call.
-       * GuestStoreAccessDisable() also calls StopVmxToGuestConnTimeout().
-       */
-      g_info("Perform tools reset without VMX connection "
-             "but VMX connect request was made.\n");
-      GuestStoreAccessDisable();
+      for (l = sessions; l != NULL; l = l->next) {
+         ServeSession *session = (ServeSession *)l->data;
+
+         if (session->vmxConn != NULL) {
+            CloseActiveConnections(session);
+         }
+      }
+      g_list_free(sessions);
    }
+#endif
 }
 
 
@@ -3058,7 +3419,11 @@ ToolsOnLoad(ToolsAppCtx *ctx)  // IN
 
    InitPluginData(ctx);
    InitPluginSignals(ctx);
+#if defined(__linux__)
+   Poll_InitEpoll();  // Must match the implementation RpcIn picks
+#else
    Poll_InitGtk();
+#endif
 
    ctx->registerServiceProperty(ctx->serviceObj, &propGuestStore);
    g_object_set(ctx->serviceObj, TOOLS_PLUGIN_SVC_PROP_GUESTSTORE,
@@ -116,6 +116,12 @@ static gchar* scriptInstallDir = NULL;
  */
 #define SERVICE_DISCOVERY_RPC_WAIT_TIME 100
 
+/*
+ * Time to wait in milliseconds before retrying a gdp publish that was
+ * rejected because the gdp submission queue is full
+ */
+#define SERVICE_DISCOVERY_GDP_QUEUE_WAIT_TIME 100
+
 /*
  * Defines the configuration to cache data in gdp plugin
  */
@@ -190,6 +196,15 @@ typedef struct {
    gchar *val;
 } KeyNameValue;
 
+/*
+ * Script output last written to Namespace DB: the number of chunks it was
+ * written in, and the cycle it was written in.
+ */
+typedef struct {
+   int numChunks;
+   size_t cycle;
+} NDBKeyChunks;
+
 static KeyNameValue gKeyScripts[] = {
    { SERVICE_DISCOVERY_KEY_PROCESSES, SERVICE_DISCOVERY_SCRIPT_PROCESSES },
    { SERVICE_DISCOVERY_KEY_CONNECTIONS,
@@ -219,7 +234,27 @@ static size_t cycle = 0;
 static Bool isGDPWriteReady = TRUE;
 static Bool isNDBWriteReady = TRUE;
 
-static Bool gSkipThisTask = FALSE; // Skip this task on some gdp errors.
+/*
+ * Publishes to the gdp daemon are queued without waiting for their results.
+ * The results arrive in the gdp task thread, so the state they update is
+ * protected by a lock.
+ */
+static struct {
+   GMutex lock;
+   GCond cond;
+   guint pending;           // Publishes queued but not completed
+   gboolean skipThisTask;   // Skip this task on some gdp errors
+} gGdpPublish;
+
+/*
+ * NDBKeyChunks of the script outputs written to Namespace DB, keyed by
+ * script key name. A key is absent when what Namespace DB holds for it is
+ * not known. Only accessed from the service discovery task.
+ */
+static GHashTable *gNDBChunks = NULL;
+
+static void CleanupNamespaceDBKey(ToolsAppCtx *ctx, const char *keyName);
+static void DeleteDataAndFree(ToolsAppCtx *ctx, GPtrArray *keys);
 
 /*
  *****************************************************************************
@@ -326,11 +361,70 @@ SendRpcMessage(ToolsAppCtx *ctx,
    return status;
 }
 
+/*
+ *****************************************************************************
+ * SendDataCheckError --
+ *
+ * Logs a gdp publish error, and marks the task to be skipped for errors
+ * that will fail the following publishes too. Must be called with the
+ * gGdpPublish lock held.
+ *
+ * @param[in] gdpErr      The publish error
+ *
+ *****************************************************************************
+ */
+
+static void
+SendDataCheckError(GdpError gdpErr)
+{
+   g_info("%s: ToolsPluginSvcGdp_PublishAsync error: %s\n",
+          __FUNCTION__, gdpErrMsgs[gdpErr]);
+   /*
+    *  NOTE to SD maintainer:
+    *  GDP_ERROR_NO_SUBSCRIBERS to be handled here when ready
+    */
+   if (gdpErr == GDP_ERROR_STOP ||
+       gdpErr == GDP_ERROR_GENERAL ||
+       gdpErr == GDP_ERROR_UNREACH ||
+       gdpErr == GDP_ERROR_TIMEOUT) {
+      gGdpPublish.skipThisTask = TRUE;
+   }
+}
+
+
+/*
+ *****************************************************************************
+ * SendDataDone --
+ *
+ * Completion callback of the publishes queued by SendData. Called in the gdp
+ * task thread.
+ *
+ * @param[in] gdpErr      The publish result
+ * @param[in] clientData  Unused
+ *
+ *****************************************************************************
+ */
+
+static void
+SendDataDone(GdpError gdpErr,
+             gpointer clientData)
+{
+   g_mutex_lock(&gGdpPublish.lock);
+   if (gdpErr != GDP_ERROR_SUCCESS) {
+      SendDataCheckError(gdpErr);
+   }
+   gGdpPublish.pending--;
+   g_cond_broadcast(&gGdpPublish.cond);
+   g_mutex_unlock(&gGdpPublish.lock);
+}
+
+
 /*
  *****************************************************************************
  * SendData --
  *
- * Sends guest data to host-side gdp daemon.
+ * Queues guest data for sending to host-side gdp daemon. The result is
+ * collected by SendDataWait.
  *
  * @param[in] ctx         The application context
  * @param[in] createTime  Data create time
@@ -339,7 +433,7 @@ SendRpcMessage(ToolsAppCtx *ctx,
  * @param[in] len         Service data length
  *
  * @retval TRUE  On success.
- * @retval FALSE Failed.
+ * @retval FALSE Failed, or a previous publish of this task failed.
  *
  *****************************************************************************
  */
@@ -352,7 +446,7 @@ SendData(ToolsAppCtx *ctx,
          const int len)
 {
    GdpError gdpErr;
-   Bool status = FALSE;
+   Bool status;
    Bool cacheData = VMTools_ConfigGetBoolean(
                        ctx->config,
                        CONFGROUPNAME_SERVICEDISCOVERY,
@@ -364,35 +458,103 @@ SendData(ToolsAppCtx *ctx,
                          CONFNAME_SERVICEDISCOVERY_REQUIRESUBS,
                          SERVICE_DISCOVERY_CONF_DEFAULT_REQUIRESUBS);
 
-   gdpErr = ToolsPluginSvcGdp_Publish(ctx,
-                                      createTime,
-                                      topic,
-                                      NULL, /* token (optional) */
-                                      NULL, /* category (optional) */
-                                      data,
-                                      len,
-                                      cacheData,
-                                      requireSubs);
-   if (gdpErr != GDP_ERROR_SUCCESS) {
-      g_info("%s: ToolsPluginSvcGdp_Publish error: %s\n",
-             __FUNCTION__, gdpErrMsgs[gdpErr]);
+   g_mutex_lock(&gGdpPublish.lock);
+   gGdpPublish.pending++;
+
+   for (;;) {
+      g_mutex_unlock(&gGdpPublish.lock);
+      gdpErr = ToolsPluginSvcGdp_PublishAsync(ctx,
+                                              createTime,
+                                              topic,
+                                              NULL, /* token (optional) */
+                                              NULL, /* category (optional) */
+                                              data,
+                                              len,
+                                              cacheData,
+                                              requireSubs,
+                                              SendDataDone,
+                                              NULL);
+      g_mutex_lock(&gGdpPublish.lock);
+
+      if (gdpErr != GDP_ERROR_QUEUE_FULL) {
+         break;
+      }
+
       /*
-       *  NOTE to SD maintainer:
-       *  GDP_ERROR_NO_SUBSCRIBERS to be handled here when ready
+       * Wait for a queued publish to complete, ours or another plugin's.
        */
-      if (gdpErr == GDP_ERROR_STOP ||
-          gdpErr == GDP_ERROR_GENERAL ||
-          gdpErr == GDP_ERROR_UNREACH ||
-          gdpErr == GDP_ERROR_TIMEOUT) {
-         gSkipThisTask = TRUE;
-      }
+      g_cond_wait_until(&gGdpPublish.cond, &gGdpPublish.lock,
+                        g_get_monotonic_time() +
+                        SERVICE_DISCOVERY_GDP_QUEUE_WAIT_TIME *
+                        G_TIME_SPAN_MILLISECOND);
+   }
+
+   if (gdpErr != GDP_ERROR_SUCCESS) {
+      /* SendDataDone will not be called. */
+      gGdpPublish.pending--;
+      SendDataCheckError(gdpErr);
+      status = FALSE;
    } else {
-      status = TRUE;
+      status = !gGdpPublish.skipThisTask;
    }
+   g_mutex_unlock(&gGdpPublish.lock);
 
    return status;
 }
 
+
+/*
+ *****************************************************************************
+ * SendDataWait --
+ *
+ * Waits for all the publishes queued by SendData to complete.
+ *
+ * @retval TRUE  All the publishes of this task so far succeeded, or failed
+ *               with an error that does not skip the task.
+ * @retval FALSE The task is to be skipped.
+ *
+ *****************************************************************************
+ */
+
+static Bool
+SendDataWait(void)
+{
+   Bool status;
+
+   g_mutex_lock(&gGdpPublish.lock);
+   while (gGdpPublish.pending > 0) {
+      g_cond_wait(&gGdpPublish.cond, &gGdpPublish.lock);
+   }
+   status = !gGdpPublish.skipThisTask;
+   g_mutex_unlock(&gGdpPublish.lock);
+
+   return status;
+}
+
+
+/*
+ *****************************************************************************
+ * SendDataSkipThisTask --
+ *
+ * @retval TRUE if a publish of this task failed with an error that skips
+ *         the task. Publishes still queued may set it later.
+ *
+ *****************************************************************************
+ */
+
+static Bool
+SendDataSkipThisTask(void)
+{
+   Bool skip;
+
+   g_mutex_lock(&gGdpPublish.lock);
+   skip = gGdpPublish.skipThisTask;
+   g_mutex_unlock(&gGdpPublish.lock);
+
+   return skip;
+}
+
+
 /*
  *****************************************************************************
  * fread_safe --
@@ -717,6 +879,109 @@ out:
    return status;
 }
 
+/*
+ *****************************************************************************
+ * PrepareNamespaceDBKey --
+ *
+ * Gets the number of chunks the given key was last written in. If that is
+ * not known, the chunks the key holds in Namespace DB are deleted instead.
+ *
+ * Chunks the new output is written to are simply overwritten, so only the
+ * chunks beyond its end need to be deleted once it is written.
+ *
+ * @param[in] ctx       Application context.
+ * @param[in] key       Script key name.
+ *
+ * @retval The number of chunks left in Namespace DB for the key.
+ *
+ *****************************************************************************
+ */
+
+static int
+PrepareNamespaceDBKey(ToolsAppCtx *ctx,
+                      const char *key)
+{
+   NDBKeyChunks *keyChunks = NULL;
+
+   if (gNDBChunks != NULL) {
+      keyChunks = g_hash_table_lookup(gNDBChunks, key);
+   }
+
+   if (keyChunks == NULL) {
+      CleanupNamespaceDBKey(ctx, key);
+      return 0;
+   }
+
+   return keyChunks->numChunks;
+}
+
+
+/*
+ *****************************************************************************
+ * FinishNamespaceDBKey --
+ *
+ * Writes the chunk count of the given key, and deletes the chunks left from
+ * a longer output written in a previous cycle.
+ *
+ * @param[in] ctx          Application context.
+ * @param[in] key          Script key name.
+ * @param[in] numChunks    Number of chunks written in this cycle.
+ * @param[in] prevChunks   Number of chunks in Namespace DB before this cycle.
+ *
+ * @retval TRUE  Successfully written the chunk count.
+ * @retval FALSE Otherwise.
+ *
+ *****************************************************************************
+ */
+
+static Bool
+FinishNamespaceDBKey(ToolsAppCtx *ctx,
+                     const char *key,
+                     int numChunks,
+                     int prevChunks)
+{
+   Bool status;
+   gchar *chunkCount = g_strdup_printf("%d", numChunks);
+   NDBKeyChunks *keyChunks;
+
+   status = WriteData(ctx, key, chunkCount, strlen(chunkCount));
+   if (!status) {
+      g_free(chunkCount);
+      return FALSE;
+   }
+
+   g_debug("%s: Written key %s chunks %s\n", __FUNCTION__, key, chunkCount);
+   g_free(chunkCount);
+
+   if (prevChunks > numChunks) {
+      GPtrArray *keys = g_ptr_array_new();
+      int j;
+
+      for (j = numChunks; j < prevChunks; j++) {
+         g_ptr_array_add(keys, g_strdup_printf("%s-%d", key, j + 1));
+         if (keys->len >= SERVICE_DISCOVERY_DELETE_CHUNK_SIZE) {
+            DeleteDataAndFree(ctx, keys);
+         }
+      }
+      if (keys->len >= 1) {
+         DeleteDataAndFree(ctx, keys);
+      }
+      g_ptr_array_free(keys, TRUE);
+   }
+
+   if (gNDBChunks == NULL) {
+      gNDBChunks = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                         g_free, g_free);
+   }
+   keyChunks = g_new(NDBKeyChunks, 1);
+   keyChunks->numChunks = numChunks;
+   keyChunks->cycle = cycle;
+   g_hash_table_insert(gNDBChunks, g_strdup(key), keyChunks);
+
+   return TRUE;
+}
+
+
 /*
  *****************************************************************************
  * SendScriptOutput --
@@ -729,6 +994,9 @@ out:
  * is sent to gdp daemon/namespace db separately with its chunk number in the
  * topic.
  *
+ * Namespace DB chunks from a previous cycle are overwritten rather than
+ * deleted first, when their number is known.
+ *
  * @param[in] ctx             The application context
  * @param[in] key             Script name
  * @param[in] childStdout     Stream to read child process stdout
@@ -747,9 +1015,15 @@ SendScriptOutput(ToolsAppCtx *ctx,
    Bool status = TRUE;
    Bool gdp_status = TRUE;
    int i = 0;
+   int prevChunks = 0;
    size_t totalReadBytes = 0;
    gint64 createTime = g_get_real_time();
    size_t ndbBufSize = SERVICE_DISCOVERY_VALUE_MAX_SIZE * sizeof(char);
+
+   if (isNDBWriteReady) {
+      prevChunks = PrepareNamespaceDBKey(ctx, key);
+   }
+
    for (;;) {
       size_t readBytes;
       char buf[GDP_USER_DATA_LEN];
@@ -811,12 +1085,7 @@ SendScriptOutput(ToolsAppCtx *ctx,
    }
 
    if (isNDBWriteReady && status) {
-      gchar *chunkCount = g_strdup_printf("%d", i);
-      status = WriteData(ctx, key, chunkCount, strlen(chunkCount));
-      if (status) {
-         g_debug("%s: Written key %s chunks %s\n", __FUNCTION__, key, chunkCount);
-      }
-      g_free(chunkCount);
+      status = FinishNamespaceDBKey(ctx, key, i, prevChunks);
    }
 
    return status && gdp_status;
@@ -852,79 +1121,70 @@ DeleteDataAndFree(ToolsAppCtx *ctx,
 
 /*
  *****************************************************************************
- * CleanupNamespaceDB --
+ * CleanupNamespaceDBKey --
  *
- * Deletes all the chunks written to the Namespace DB in previous cycle.
+ * Deletes the chunks of the given key written to the Namespace DB in a
+ * previous cycle.
  *
  * @param[in] ctx       Application context.
+ * @param[in] keyName   Script key name.
  *
  *****************************************************************************
  */
 
 static void
-CleanupNamespaceDB(ToolsAppCtx *ctx) {
-   int i;
+CleanupNamespaceDBKey(ToolsAppCtx *ctx,
+                      const char *keyName)
+{
+   char *value = NULL;
+   size_t len = 0;
    GPtrArray *keys = g_ptr_array_new();
 
-   g_debug("%s: Performing cleanup of previous data\n", __FUNCTION__);
-
-   ASSERT(gFullPaths);
+   g_debug("%s: Performing cleanup of previous data for %s\n",
+           __FUNCTION__, keyName);
 
-   for (i = 0; i < gFullPaths->len; i++) {
-      char *value = NULL;
-      size_t len = 0;
-      KeyNameValue tmp = g_array_index(gFullPaths, KeyNameValue, i);
-      /*
-       * Read count of chunks, ignore timestamp, iterate over chunks
-       * and remove them.
-       */
-      if (ReadData(ctx, tmp.keyName, &value, &len) && len > 1) {
-         char *token = NULL;
-         g_debug("%s: Read %s from Namespace DB\n", __FUNCTION__, value);
+   /*
+    * Read count of chunks, ignore timestamp, iterate over chunks
+    * and remove them.
+    */
+   if (ReadData(ctx, keyName, &value, &len) && len > 1) {
+      char *token = NULL;
+      g_debug("%s: Read %s from Namespace DB\n", __FUNCTION__, value);
 
-         g_ptr_array_add(keys, g_strdup(tmp.keyName));
-         if (keys->len >= SERVICE_DISCOVERY_DELETE_CHUNK_SIZE) {
-            DeleteDataAndFree(ctx, keys);
-         }
+      g_ptr_array_add(keys, g_strdup(keyName));
 
-         if (NULL == strtok(value, ",")) {
-            g_warning("%s: Malformed data for %s in Namespace DB",
-                      __FUNCTION__, tmp.keyName);
-            if (value) {
-               free(value);
-               value = NULL;
-            }
-            continue;
-         }
-         token = strtok(NULL, ",");
-         if (token != NULL) {
-            int count = (int) g_ascii_strtoll(token, NULL, 10);
-            int j;
-
-            for (j = 0; j < count; j++) {
-               gchar *msg = g_strdup_printf("%s-%d", tmp.keyName, j + 1);
-               g_ptr_array_add(keys, msg);
-               if (keys->len >= SERVICE_DISCOVERY_DELETE_CHUNK_SIZE) {
-                  DeleteDataAndFree(ctx, keys);
-               }
+      if (NULL == strtok(value, ",")) {
+         g_warning("%s: Malformed data for %s in Namespace DB",
+                   __FUNCTION__, keyName);
+         goto out;
+      }
+      token = strtok(NULL, ",");
+      if (token != NULL) {
+         int count = (int) g_ascii_strtoll(token, NULL, 10);
+         int j;
+
+         for (j = 0; j < count; j++) {
+            gchar *msg = g_strdup_printf("%s-%d", keyName, j + 1);
+            g_ptr_array_add(keys, msg);
+            if (keys->len >= SERVICE_DISCOVERY_DELETE_CHUNK_SIZE) {
+               DeleteDataAndFree(ctx, keys);
             }
-         } else {
-            g_warning("%s: Chunk count has invalid value %s", __FUNCTION__,
-                      value);
          }
       } else {
-         g_warning("%s: Key %s not found in Namespace DB\n", __FUNCTION__,
-                   tmp.keyName);
-      }
-      if (value) {
-         free(value);
-         value = NULL;
+         g_warning("%s: Chunk count has invalid value %s", __FUNCTION__,
+                   value);
       }
+   } else {
+      g_warning("%s: Key %s not found in Namespace DB\n", __FUNCTION__,
+                keyName);
    }
+
+out:
    if (keys->len >= 1) {
       DeleteDataAndFree(ctx, keys);
    }
    g_ptr_array_free(keys, TRUE);
+   free(value);
 }
 
 
@@ -948,7 +1208,9 @@ ServiceDiscoveryTask(ToolsAppCtx *ctx,
    Bool status = FALSE;
    Atomic_WriteBool(&gTaskSubmitted, TRUE);
    if (isGDPWriteReady) {
-      gSkipThisTask = FALSE;
+      g_mutex_lock(&gGdpPublish.lock);
+      gGdpPublish.skipThisTask = FALSE;
+      g_mutex_unlock(&gGdpPublish.lock);
    }
    if (isNDBWriteReady) {
       gint64 previousWriteTime = gLastWriteTime;
@@ -973,9 +1235,12 @@ ServiceDiscoveryTask(ToolsAppCtx *ctx,
       }
 
       /*
-       * Remove chunks written to DB in the previous iteration
+       * Namespace DB may have been changed behind our back when the last
+       * write time got reset: look up what it holds again.
        */
-      CleanupNamespaceDB(ctx);
+      if (gNDBChunks != NULL && previousWriteTime == 0) {
+         g_hash_table_remove_all(gNDBChunks);
+      }
    }
 
    readBytesPerCycle = 0;
@@ -985,13 +1250,34 @@ ServiceDiscoveryTask(ToolsAppCtx *ctx,
       if (!ExecuteScript(ctx, tmp.keyName, tmp.val, scriptInstallDir)) {
          g_debug("%s: ExecuteScript failed for script %s\n",
                 __FUNCTION__, tmp.val);
-         if (isGDPWriteReady && gSkipThisTask && !isNDBWriteReady) {
+         if (isNDBWriteReady) {
+            NDBKeyChunks *keyChunks = NULL;
+
+            if (gNDBChunks != NULL) {
+               keyChunks = g_hash_table_lookup(gNDBChunks, tmp.keyName);
+            }
+
+            /*
+             * Unless this cycle's output was completely written, drop the
+             * key, so that no output of a previous cycle passes as current.
+             */
+            if (keyChunks == NULL || keyChunks->cycle != cycle) {
+               if (keyChunks != NULL) {
+                  g_hash_table_remove(gNDBChunks, tmp.keyName);
+               }
+               CleanupNamespaceDBKey(ctx, tmp.keyName);
+            }
+         }
+         if (isGDPWriteReady && SendDataSkipThisTask() && !isNDBWriteReady) {
             break;
          }
       }
    }
 
-   if (isGDPWriteReady && !gSkipThisTask) {
+   /*
+    * The ready flag is only sent once all the script output was published.
+    */
+   if (isGDPWriteReady && SendDataWait()) {
       gchar* readyData = g_strdup_printf("%"FMTSZ"u", readBytesPerCycle);
       g_debug("%s: Sending ready flag with number of read bytes :%s\n",
              __FUNCTION__, readyData);
@@ -1000,6 +1286,7 @@ ServiceDiscoveryTask(ToolsAppCtx *ctx,
       SendData(ctx, g_get_real_time(), topic, readyData, strlen(readyData));
       g_free(topic);
       g_free(readyData);
+      SendDataWait();
    }
 
    if (isNDBWriteReady) {
@@ -1211,7 +1498,13 @@ ServiceDiscoveryServerConfReload(gpointer src,
                                  ToolsAppCtx *ctx,
                                  gpointer data)
 {
-   gboolean disabled =
+   gboolean disabled;
+
+   if (!ToolsCore_ConfigGroupChanged(ctx, CONFGROUPNAME_SERVICEDISCOVERY)) {
+      return;
+   }
+
+   disabled =
       VMTools_ConfigGetBoolean(ctx->config,
                                CONFGROUPNAME_SERVICEDISCOVERY,
                                CONFNAME_SERVICEDISCOVERY_DISABLED,
@@ -1254,6 +1547,11 @@ ServiceDiscoveryServerShutdown(gpointer src,
    g_free(scriptInstallDir);
    scriptInstallDir = NULL;
 
+   if (gNDBChunks != NULL) {
+      g_hash_table_destroy(gNDBChunks);
+      gNDBChunks = NULL;
+   }
+
    if (gFullPaths != NULL) {
       int i = 0;
       guint len = gFullPaths->len;
@@ -1406,6 +1704,9 @@ ToolsOnLoad(ToolsAppCtx *ctx)
                                   CONFGROUPNAME_SERVICEDISCOVERY,
                                   CONFNAME_SERVICEDISCOVERY_DISABLED,
                                   SERVICE_DISCOVERY_CONF_DEFAULT_DISABLED_VALUE);
+      g_mutex_init(&gGdpPublish.lock);
+      g_cond_init(&gGdpPublish.cond);
+
       if (!disabled) {
          TweakDiscoveryLoop(ctx);
       }
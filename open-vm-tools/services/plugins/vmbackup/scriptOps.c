@@ -58,6 +58,9 @@
 typedef struct VmBackupScript {
    char *path;
    ProcMgr_AsyncProc *proc;
+   int group;           // scripts of a group run concurrently
+   Bool failed;         // freeze failed, so skip it when running freezeFail
+   gint64 startTime;
 } VmBackupScript;
 
 
@@ -65,8 +68,14 @@ typedef struct VmBackupScriptOp {
    VmBackupOp callbacks;
    Bool canceled;
    Bool thawFailed;
+   Bool freezeFailed;
    VmBackupScriptType type;
    VmBackupState *state;
+   ssize_t groupFirst;  // the scripts of the group being run
+   ssize_t groupLast;
+   int numRunning;
+   gint64 groupStartTime;
+   GString *failures;   // names of the scripts that failed
 } VmBackupScriptOp;
 
 
@@ -103,16 +112,139 @@ VmBackupGetScriptPath(void)
 }
 
 
+/*
+ *-----------------------------------------------------------------------------
+ *
+ *  VmBackupScriptFailed --
+ *
+ *    Records a script failure, for the error reported to the host.
+ *
+ * Result
+ *    None.
+ *
+ * Side effects:
+ *    None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+VmBackupScriptFailed(VmBackupScriptOp *op,      // IN/OUT
+                     VmBackupScript *script,    // IN/OUT
+                     const char *reason)        // IN
+{
+   char *name;
+
+   if (op->type == VMBACKUP_SCRIPT_FREEZE) {
+      op->freezeFailed = TRUE;
+      script->failed = TRUE;
+   } else {
+      op->thawFailed = TRUE;
+   }
+
+   name = g_path_get_basename(script->path);
+   g_string_append_printf(op->failures, "%s%s (%s)",
+                          op->failures->len > 0 ? ", " : "", name, reason);
+   g_free(name);
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ *  VmBackupStartScript --
+ *
+ *    Starts a single script.
+ *
+ * Result
+ *    TRUE if the script was started.
+ *
+ * Side effects:
+ *    None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+VmBackupStartScript(VmBackupScriptOp *op,       // IN/OUT
+                    VmBackupScript *script,     // IN/OUT
+                    const char *scriptOp)       // IN
+{
+   char *cmd;
+
+   if (op->state->scriptArg != NULL && op->state->scriptArg[0] != '\0') {
+      cmd = Str_Asprintf(NULL, "\"%s\" %s \"%s\"", script->path,
+                         scriptOp, op->state->scriptArg);
+   } else {
+      cmd = Str_Asprintf(NULL, "\"%s\" %s", script->path,
+                         scriptOp);
+   }
+   if (cmd != NULL) {
+      host_debug("Running script: %s\n", script->path);
+      guest_debug("Running script: %s\n", cmd);
+      script->proc = ProcMgr_ExecAsync(cmd, NULL);
+   } else {
+      g_debug("Failed to allocate memory to run script: %s\n",
+              script->path);
+      script->proc = NULL;
+   }
+   vm_free(cmd);
+
+   if (script->proc == NULL) {
+      VmBackupScriptFailed(op, script, "failed to start");
+      return FALSE;
+   }
+
+   script->startTime = g_get_monotonic_time();
+   op->numRunning++;
+   return TRUE;
+}
+
+
+/*
+ *-----------------------------------------------------------------------------
+ *
+ *  VmBackupFreezeGroupFailed --
+ *
+ *    Called when a freeze script of the current group failed. Every script
+ *    of the group that did not freeze successfully is skipped when the
+ *    freezeFail scripts are run, and the others are run first.
+ *
+ * Result
+ *    None.
+ *
+ * Side effects:
+ *    Sets the "current script" index past the end of the group.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+VmBackupFreezeGroupFailed(VmBackupScriptOp *op)  // IN/OUT
+{
+   VmBackupScript *scripts = op->state->scripts;
+   ssize_t i;
+
+   for (i = op->groupFirst; i <= op->groupLast; i++) {
+      if (scripts[i].proc == NULL && scripts[i].startTime == 0) {
+         scripts[i].failed = TRUE;
+      }
+   }
+   op->state->currentScript = op->groupLast + 1;
+}
+
+
 /*
  *-----------------------------------------------------------------------------
  *
  * VmBackupRunNextScript --
  *
- *    Runs the next script for the given operation. If thawing (or running
+ *    Runs the next group of scripts for the given operation. Unless parallel
+ *    scripts are enabled, a group is a single script. If thawing (or running
  *    scripts after a failure), this function will try as much as possible
- *    to start a script, meaning that if it fails to start a script it will
- *    try to start the preceding one until one script is run, or it runs out
- *    of scripts to try.
+ *    to start a script, meaning that if it fails to start any script of a
+ *    group it will try to start the preceding group until one script is
+ *    run, or it runs out of scripts to try.
  *
  * Results:
  *    -1: an error occurred.
@@ -131,6 +263,7 @@ VmBackupRunNextScript(VmBackupScriptOp *op)  // IN/OUT
    const char *scriptOp;
    int ret = 0;
    ssize_t index;
+   Bool startFailed = FALSE;
    VmBackupScript *scripts = op->state->scripts;
 
    switch (op->type) {
@@ -153,39 +286,56 @@ VmBackupRunNextScript(VmBackupScriptOp *op)  // IN/OUT
       NOT_REACHED();
    }
 
-   while (index >= 0 && scripts[index].path != NULL) {
-      if (File_IsFile(scripts[index].path)) {
-         char *cmd;
+   op->numRunning = 0;
+   op->groupStartTime = g_get_monotonic_time();
 
-         if (op->state->scriptArg != NULL && op->state->scriptArg[0] != '\0') {
-            cmd = Str_Asprintf(NULL, "\"%s\" %s \"%s\"", scripts[index].path,
-                               scriptOp, op->state->scriptArg);
-         } else {
-            cmd = Str_Asprintf(NULL, "\"%s\" %s", scripts[index].path,
-                               scriptOp);
-         }
-         if (cmd != NULL) {
-            host_debug("Running script: %s\n", scripts[index].path);
-            guest_debug("Running script: %s\n", cmd);
-            scripts[index].proc = ProcMgr_ExecAsync(cmd, NULL);
-         } else {
-            g_debug("Failed to allocate memory to run script: %s\n",
-                    scripts[index].path);
-            scripts[index].proc = NULL;
-         }
-         vm_free(cmd);
+   while (index >= 0 && scripts[index].path != NULL) {
+      int group = scripts[index].group;
+      ssize_t next;
 
-         if (scripts[index].proc == NULL) {
+      /*
+       * Start all scripts of the group. Freeze walks the list forwards,
+       * freezeFail and thaw backwards.
+       */
+      op->groupFirst = op->groupLast = index;
+      for (;;) {
+         if (!(op->type == VMBACKUP_SCRIPT_FREEZE_FAIL && scripts[index].failed) &&
+             File_IsFile(scripts[index].path) &&
+             !VmBackupStartScript(op, &scripts[index], scriptOp)) {
+            startFailed = TRUE;
             if (op->type == VMBACKUP_SCRIPT_FREEZE) {
-               ret = -1;
                break;
-            } else {
-               op->thawFailed = TRUE;
             }
-         } else {
-            ret = 1;
+         }
+
+         next = (op->type == VMBACKUP_SCRIPT_FREEZE) ? index + 1 : index - 1;
+         if (next < 0 || scripts[next].path == NULL ||
+             scripts[next].group != group) {
             break;
          }
+         index = next;
+         op->state->currentScript = index;
+         op->groupFirst = MIN(op->groupFirst, index);
+         op->groupLast = MAX(op->groupLast, index);
+      }
+
+      if (op->type == VMBACKUP_SCRIPT_FREEZE && startFailed) {
+         /*
+          * Let any scripts of the group that did start finish before
+          * reporting the error.
+          */
+         while (scripts[op->groupLast + 1].path != NULL &&
+                scripts[op->groupLast + 1].group == group) {
+            op->groupLast++;
+         }
+         VmBackupFreezeGroupFailed(op);
+         ret = op->numRunning > 0 ? 1 : -1;
+         break;
+      }
+
+      if (op->numRunning > 0) {
+         ret = 1;
+         break;
       }
 
       if (op->type == VMBACKUP_SCRIPT_FREEZE) {
@@ -195,19 +345,10 @@ VmBackupRunNextScript(VmBackupScriptOp *op)  // IN/OUT
       }
 
       /*
-       * This happens if all thaw/fail scripts failed to start. Since the first
-       * entry may be a legacy script (which may not exist), need to check
-       * whether the interesting failure is the first or the second entry in
-       * the script list.
+       * This happens if all thaw/fail scripts failed to start.
        */
-      if (index == -1) {
-         size_t failIdx = 0;
-         if (!File_IsFile(scripts[0].path)) {
-            failIdx = 1;
-         }
-         if (scripts[failIdx].proc == NULL && scripts[failIdx].path != NULL) {
-            ret = -1;
-         }
+      if (index == -1 && startFailed) {
+         ret = -1;
       }
    }
 
@@ -239,20 +380,52 @@ VmBackupStringCompare(const void *str1,   // IN
 }
 
 
+/*
+ *-----------------------------------------------------------------------------
+ *
+ *  VmBackupSameScriptGroup --
+ *
+ *    Checks whether two script names start with the same group prefix:
+ *    a number followed by '-' or '_', as in "50-mysql" and "50-postgres".
+ *
+ * Result
+ *    TRUE if the scripts belong to the same group.
+ *
+ * Side effects:
+ *    None.
+ *
+ *-----------------------------------------------------------------------------
+ */
+
+static Bool
+VmBackupSameScriptGroup(const char *name1,   // IN
+                        const char *name2)   // IN
+{
+   size_t len = strspn(name1, "0123456789");
+
+   return len > 0 &&
+          (name1[len] == '-' || name1[len] == '_') &&
+          strspn(name2, "0123456789") == len &&
+          (name2[len] == '-' || name2[len] == '_') &&
+          strncmp(name1, name2, len) == 0;
+}
+
+
 /*
  *-----------------------------------------------------------------------------
  *
  *  VmBackupScriptOpQuery --
  *
- *    Checks the status of the current running script. If the script is
- *    finished, run the next script in the queue or, if no scripts are left,
- *    return a "finished" status.
+ *    Checks the status of the current running scripts. If they are all
+ *    finished, run the next group of scripts in the queue or, if no scripts
+ *    are left, return a "finished" status. With parallel scripts, the
+ *    scripts of a group still running after the group's timeout are killed.
  *
  * Result
  *    The status of the operation.
  *
  * Side effects:
- *    Might start a new process.
+ *    Might start new processes.
  *
  *-----------------------------------------------------------------------------
  */
@@ -263,62 +436,107 @@ VmBackupScriptOpQuery(VmBackupOp *_op) // IN
    VmBackupOpStatus ret = VMBACKUP_STATUS_PENDING;
    VmBackupScriptOp *op = (VmBackupScriptOp *) _op;
    VmBackupScript *scripts = op->state->scripts;
-   VmBackupScript *currScript = NULL;
-
-   if (scripts != NULL && op->state->currentScript >= 0) {
-      currScript = &scripts[op->state->currentScript];
-   }
+   Bool timedOut = FALSE;
+   gint64 now;
+   ssize_t i;
 
    if (op->canceled) {
       ret = VMBACKUP_STATUS_CANCELED;
       goto exit;
-   } else if (scripts == NULL || currScript == NULL || currScript->proc == NULL) {
+   } else if (scripts == NULL || op->numRunning == 0) {
       ret = VMBACKUP_STATUS_FINISHED;
       goto exit;
    }
 
-   if (!ProcMgr_IsAsyncProcRunning(currScript->proc)) {
-      int exitCode;
+   now = g_get_monotonic_time();
+   if (op->state->parallelScripts && op->state->parallelScriptsTimeout != 0) {
+      timedOut = (now - op->groupStartTime) >=
+                 (gint64) op->state->parallelScriptsTimeout * G_USEC_PER_SEC;
+   }
+
+   for (i = op->groupFirst; i <= op->groupLast; i++) {
+      VmBackupScript *currScript = &scripts[i];
+      int exitCode = -1;
       Bool succeeded;
 
-      succeeded = (ProcMgr_GetExitCode(currScript->proc, &exitCode) == 0 &&
-                   exitCode == 0);
+      if (currScript->proc == NULL) {
+         continue;
+      }
+
+      if (ProcMgr_IsAsyncProcRunning(currScript->proc)) {
+         if (!timedOut) {
+            continue;
+         }
+         g_warning("Script %s did not finish within %u seconds, killing it.\n",
+                   currScript->path, op->state->parallelScriptsTimeout);
+         if (ProcMgr_KillByPid(ProcMgr_GetPid(currScript->proc))) {
+            ProcMgr_GetExitCode(currScript->proc, &exitCode);
+         }
+         VmBackupScriptFailed(op, currScript, "timed out");
+      } else {
+         succeeded = (ProcMgr_GetExitCode(currScript->proc, &exitCode) == 0 &&
+                      exitCode == 0);
+         g_debug("Script %s exited with code %d after %"G_GINT64_FORMAT" ms.\n",
+                 currScript->path, exitCode,
+                 (now - currScript->startTime) / 1000);
+
+         /*
+          * If thaw scripts fail, keep running and only notify the failure
+          * after all others have run. If a freeze script fails, the rest of
+          * its group is still waited for.
+          */
+         if (!succeeded) {
+            char *reason = g_strdup_printf("exit code %d", exitCode);
+
+            VmBackupScriptFailed(op, currScript, reason);
+            g_free(reason);
+         }
+      }
+
       ProcMgr_Free(currScript->proc);
       currScript->proc = NULL;
+      op->numRunning--;
+   }
 
-      /*
-       * If thaw scripts fail, keep running and only notify the failure after
-       * all others have run.
-       */
-      if (!succeeded) {
-          if (op->type == VMBACKUP_SCRIPT_FREEZE) {
-             ret = VMBACKUP_STATUS_ERROR;
-             goto exit;
-          } else if (op->type == VMBACKUP_SCRIPT_THAW) {
-             op->thawFailed = TRUE;
-          }
-      }
+   if (op->numRunning > 0) {
+      goto exit;
+   }
 
-      switch (VmBackupRunNextScript(op)) {
-      case -1:
-         ret = VMBACKUP_STATUS_ERROR;
-         break;
+   if (op->freezeFailed) {
+      VmBackupFreezeGroupFailed(op);
+      ret = VMBACKUP_STATUS_ERROR;
+      goto exit;
+   }
 
-      case 0:
-         ret = op->thawFailed ? VMBACKUP_STATUS_ERROR : VMBACKUP_STATUS_FINISHED;
-         break;
+   switch (VmBackupRunNextScript(op)) {
+   case -1:
+      ret = VMBACKUP_STATUS_ERROR;
+      break;
 
-      default:
-         break;
-      }
+   case 0:
+      ret = op->thawFailed ? VMBACKUP_STATUS_ERROR : VMBACKUP_STATUS_FINISHED;
+      break;
+
+   default:
+      break;
    }
 
 exit:
    if (ret == VMBACKUP_STATUS_ERROR) {
       /* Report the script error to the host */
-      VmBackup_SendEvent(VMBACKUP_EVENT_REQUESTOR_ERROR,
-                         VMBACKUP_SCRIPT_ERROR,
-                         "Custom quiesce script failed.");
+      if (op->state->parallelScripts && op->failures->len > 0) {
+         char *desc = g_strdup_printf("Custom quiesce script failed: %s.",
+                                      op->failures->str);
+
+         VmBackup_SendEvent(VMBACKUP_EVENT_REQUESTOR_ERROR,
+                            VMBACKUP_SCRIPT_ERROR,
+                            desc);
+         g_free(desc);
+      } else {
+         VmBackup_SendEvent(VMBACKUP_EVENT_REQUESTOR_ERROR,
+                            VMBACKUP_SCRIPT_ERROR,
+                            "Custom quiesce script failed.");
+      }
    }
    return ret;
 }
@@ -362,6 +580,7 @@ VmBackupScriptOpRelease(VmBackupOp *_op)  // IN
       op->state->currentScript = 0;
    }
 
+   g_string_free(op->failures, TRUE);
    free(op);
 }
 
@@ -371,7 +590,7 @@ VmBackupScriptOpRelease(VmBackupOp *_op)  // IN
  *
  *  VmBackupScriptOpCancel --
  *
- *    Cancels the current operation.  Forces any currently running script
+ *    Cancels the current operation.  Forces any currently running scripts
  *    to quit and flags the operation as canceled.
  *
  * Result
@@ -388,19 +607,22 @@ VmBackupScriptOpCancel(VmBackupOp *_op)   // IN
 {
    VmBackupScriptOp *op = (VmBackupScriptOp *) _op;
    VmBackupScript *scripts = op->state->scripts;
-   VmBackupScript *currScript = NULL;
    ProcMgr_Pid pid;
+   ssize_t i;
 
-   if (scripts != NULL) {
-      currScript = &scripts[op->state->currentScript];
-      ASSERT(currScript->proc != NULL);
+   if (scripts != NULL && op->numRunning > 0) {
+      for (i = op->groupFirst; i <= op->groupLast; i++) {
+         if (scripts[i].proc == NULL) {
+            continue;
+         }
 
-      pid = ProcMgr_GetPid(currScript->proc);
-      if (!ProcMgr_KillByPid(pid)) {
-         // XXX: what to do in this situation? other than log and cry?
-      } else {
-         int exitCode;
-         ProcMgr_GetExitCode(currScript->proc, &exitCode);
+         pid = ProcMgr_GetPid(scripts[i].proc);
+         if (!ProcMgr_KillByPid(pid)) {
+            // XXX: what to do in this situation? other than log and cry?
+         } else {
+            int exitCode;
+            ProcMgr_GetExitCode(scripts[i].proc, &exitCode);
+         }
       }
    }
 
@@ -454,6 +676,7 @@ VmBackup_NewScriptOp(VmBackupScriptType type, // IN
 
    op->state = state;
    op->type = type;
+   op->failures = g_string_new(NULL);
    op->callbacks.queryFn = VmBackupScriptOpQuery;
    op->callbacks.cancelFn = VmBackupScriptOpCancel;
    op->callbacks.releaseFn = VmBackupScriptOpRelease;
@@ -477,6 +700,8 @@ VmBackup_NewScriptOp(VmBackupScriptType type, // IN
       VmBackupScript *scripts = NULL;
       int legacy = 0;
       size_t idx = 0;
+      int group = -1;
+      const char *prevName = NULL;
 
       state->scripts = NULL;
       state->currentScript = 0;
@@ -506,6 +731,7 @@ VmBackup_NewScriptOp(VmBackupScriptType type, // IN
       }
 
       if (legacy > 0) {
+         scripts[idx].group = ++group;
          scripts[idx++].path = Util_SafeStrdup(LEGACY_FREEZE_SCRIPT);
       }
 
@@ -524,6 +750,16 @@ VmBackup_NewScriptOp(VmBackupScriptType type, // IN
                fail = TRUE;
                goto exit;
             } else if (File_IsFile(script)) {
+               /*
+                * The list is sorted, so the scripts of a parallel group
+                * are next to each other.
+                */
+               if (!state->parallelScripts || prevName == NULL ||
+                   !VmBackupSameScriptGroup(prevName, fileList[i])) {
+                  group++;
+               }
+               prevName = fileList[i];
+               scripts[idx].group = group;
                scripts[idx++].path = script;
             } else {
                free(script);
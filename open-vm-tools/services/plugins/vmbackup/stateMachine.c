@@ -139,6 +139,28 @@ VmBackupGetTimeout(GKeyFile *config,
 }
 
 
+/**
+ * Returns the configured timeout for a group of parallel scripts.
+ *
+ * @param[in]  config   Config file to read from.
+ *
+ * @return value of the parallelScriptsTimeout key if valid, 0 otherwise.
+ */
+
+static guint
+VmBackupGetParallelScriptsTimeout(GKeyFile *config)
+{
+   gint timeout = VMBACKUP_CONFIG_GET_INT(config, "parallelScriptsTimeout", 0);
+   if (timeout < 0) {
+      g_warning("Invalid parallelScriptsTimeout %d. Using default 0s.",
+                timeout);
+      timeout = 0;
+   }
+
+   return (guint) timeout;
+}
+
+
 /**
  * Returns a string representation of the given state machine state.
  *
@@ -1062,6 +1084,11 @@ VmBackupStartCommon(RpcInData *data,
                                                              "enableNullDriver",
                                                              TRUE);
    gBackupState->rpcState = VMBACKUP_RPC_STATE_NORMAL;
+   gBackupState->parallelScripts = VMBACKUP_CONFIG_GET_BOOL(ctx->config,
+                                                            "parallelScripts",
+                                                            FALSE);
+   gBackupState->parallelScriptsTimeout =
+      VmBackupGetParallelScriptsTimeout(ctx->config);
 
    g_debug("Using quiesceApps = %d, quiesceFS = %d, allowHWProvider = %d,"
            " execScripts = %d, scriptArg = %s, timeout = %u,"
@@ -1070,6 +1097,9 @@ VmBackupStartCommon(RpcInData *data,
            gBackupState->allowHWProvider, gBackupState->execScripts,
            (gBackupState->scriptArg != NULL) ? gBackupState->scriptArg : "",
            gBackupState->timeout, gBackupState->enableNullDriver, forceQuiesce);
+   g_debug("Using parallelScripts = %d, parallelScriptsTimeout = %u\n",
+           gBackupState->parallelScripts,
+           gBackupState->parallelScriptsTimeout);
 #if defined(__linux__)
    gBackupState->excludedFileSystems =
          VMBACKUP_CONFIG_GET_STR(ctx->config, "excludedFileSystems", NULL);
@@ -131,6 +131,8 @@ typedef struct VmBackupState {
    char          *excludedFileSystems;
    Bool           allowHWProvider;
    Bool           execScripts;
+   Bool           parallelScripts;
+   guint          parallelScriptsTimeout;
    Bool           enableNullDriver;
    Bool           ignoreFrozenFS;   // See note 2 above
    Bool           needsPriv;
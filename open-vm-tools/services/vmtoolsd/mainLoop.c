@@ -37,6 +37,7 @@
 #include "toolsHangDetector.h"
 #include "str.h"
 #include "system.h"
+#include "userlock.h"
 #include "util.h"
 #include "vmcheck.h"
 #include "vm_tools_version.h"
@@ -70,6 +71,13 @@
 #  include "posix.h"
 #endif
 
+#if defined(__linux__)
+#  include <errno.h>
+#  include <string.h>
+#  include <unistd.h>
+#  include <sys/inotify.h>
+#endif
+
 
 /*
  * Establish the default and maximum vmusr RPC channel error limits
@@ -84,6 +92,314 @@
 static gboolean gGlobalConfStarted = FALSE;
 #endif
 
+/*
+ * Default and maximum number of locks logged by the lock statistics.
+ */
+#define LOCKSTATS_DEFAULT_TOP   10
+#define LOCKSTATS_MAX_TOP       100
+
+#if defined(__linux__)
+/*
+ * Config directory events that may indicate a change to a config file, and
+ * how long to wait for a burst of them to settle before reloading.
+ */
+#define CONF_WATCH_EVENTS  (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | \
+                            IN_CREATE | IN_DELETE)
+#define CONF_RELOAD_DELAY  250
+#endif
+
+
+/**
+ * Timer callback that just calls ToolsCore_ReloadConfig().
+ *
+ * @param[in]  clientData  Service state.
+ *
+ * @return TRUE.
+ */
+
+static gboolean
+ToolsCoreConfFileCb(gpointer clientData)
+{
+   ToolsCore_ReloadConfig(clientData, FALSE);
+   return TRUE;
+}
+
+
+#if defined(__linux__)
+
+/**
+ * One-shot timer callback that reloads the config after a change notification.
+ * The mtimes are cleared so that the files are re-read even if they changed
+ * within the granularity of the file system timestamps; if the contents are
+ * the same, plugins see an empty set of changes.
+ *
+ * @param[in]  clientData  Service state.
+ *
+ * @return FALSE.
+ */
+
+static gboolean
+ToolsCoreConfReloadCb(gpointer clientData)
+{
+   ToolsServiceState *state = clientData;
+
+   state->configReloadTask = 0;
+   state->configMtime = 0;
+#if defined(GLOBALCONFIG_SUPPORTED)
+   state->globalConfigMtime = 0;
+#endif
+   ToolsCore_ReloadConfig(state, FALSE);
+   return FALSE;
+}
+
+
+/**
+ * Callback for the inotify descriptor watching the config directories. Drains
+ * the pending events and schedules a config reload if any of them refers to
+ * one of the config files. If the events can't be read, or a watched
+ * directory goes away, falls back to polling.
+ *
+ * @param[in]  source      The inotify channel.
+ * @param[in]  cond        Unused.
+ * @param[in]  clientData  Service state.
+ *
+ * @return FALSE if the watch was replaced with polling, TRUE otherwise.
+ */
+
+static gboolean
+ToolsCoreConfWatchCb(GIOChannel *source,
+                     GIOCondition cond,
+                     gpointer clientData)
+{
+   ToolsServiceState *state = clientData;
+   int fd = g_io_channel_unix_get_fd(source);
+   char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+   gboolean changed = FALSE;
+   gboolean lost = FALSE;
+
+   for (;;) {
+      ssize_t len = read(fd, buf, sizeof buf);
+      char *p;
+
+      if (len < 0 && errno == EINTR) {
+         continue;
+      }
+      if (len < 0 && errno == EAGAIN) {
+         break;
+      }
+      if (len <= 0) {
+         g_warning("%s: Failed to read config change events: %s\n",
+                   __FUNCTION__, len < 0 ? strerror(errno) : "EOF");
+         lost = TRUE;
+         break;
+      }
+
+      for (p = buf; p < buf + len; ) {
+         const struct inotify_event *ev = (const struct inotify_event *) p;
+
+         if ((ev->mask & IN_IGNORED) != 0) {
+            lost = TRUE;
+         } else if ((ev->mask & IN_Q_OVERFLOW) != 0) {
+            changed = TRUE;
+         } else if (ev->len > 0 &&
+                    (strcmp(ev->name, state->configWatchName) == 0 ||
+                     (state->configWatchTarget != NULL &&
+                      strcmp(ev->name, state->configWatchTarget) == 0)
+#if defined(GLOBALCONFIG_SUPPORTED)
+                     || strcmp(ev->name, GLOBALCONF_LOCAL_FILENAME) == 0
+#endif
+                    )) {
+            changed = TRUE;
+         }
+         p += sizeof *ev + ev->len;
+      }
+   }
+
+   if (lost) {
+      g_info("%s: Config directory watch lost, polling for changes.\n",
+             __FUNCTION__);
+      if (state->configPollTask != 0) {
+         g_source_remove(state->configPollTask);
+         state->configPollTask = 0;
+      }
+      state->configCheckTask = g_timeout_add(CONF_POLL_TIME * 1000,
+                                             ToolsCoreConfFileCb,
+                                             state);
+      changed = TRUE;
+   }
+
+   if (changed && state->configReloadTask == 0) {
+      state->configReloadTask = g_timeout_add(CONF_RELOAD_DELAY,
+                                              ToolsCoreConfReloadCb,
+                                              state);
+   }
+
+   return !lost;
+}
+
+
+/**
+ * Sets up an inotify watch on the directories holding tools.conf and the
+ * global config file. The watch source is stored in configCheckTask, in place
+ * of the polling timer.
+ *
+ * If tools.conf is a symlink, the directory of the file it resolves to is
+ * watched too. Changes further along the chain of links (a link being
+ * retargeted, say) aren't seen by either watch, so such configs are also
+ * polled every CONF_POLL_TIME seconds.
+ *
+ * @param[in]  state    Service state.
+ *
+ * @return Whether the watch was set up.
+ */
+
+static gboolean
+ToolsCoreConfWatchStart(ToolsServiceState *state)
+{
+   char *confPath = GuestApp_GetConfPath();
+   gchar *confDir;
+   gchar *confFile = NULL;
+   char *target = NULL;
+   GIOChannel *chan;
+   int fd = -1;
+   gboolean ret = FALSE;
+
+   if (state->configFile != NULL) {
+      confDir = g_path_get_dirname(state->configFile);
+   } else {
+      confDir = g_strdup(confPath);
+   }
+   if (state->configWatchName == NULL) {
+      state->configWatchName = state->configFile != NULL ?
+                                  g_path_get_basename(state->configFile) :
+                                  g_strdup(CONF_FILE);
+   }
+
+   if (confDir == NULL) {
+      goto exit;
+   }
+
+   fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+   if (fd < 0) {
+      g_info("%s: inotify not available: %s\n", __FUNCTION__, strerror(errno));
+      goto exit;
+   }
+
+   if (inotify_add_watch(fd, confDir, CONF_WATCH_EVENTS) < 0) {
+      g_info("%s: Cannot watch %s: %s\n", __FUNCTION__, confDir,
+             strerror(errno));
+      goto exit;
+   }
+
+#if defined(GLOBALCONFIG_SUPPORTED)
+   /* Adding the same directory twice just returns the existing watch. */
+   if (confPath != NULL &&
+       inotify_add_watch(fd, confPath, CONF_WATCH_EVENTS) < 0) {
+      g_info("%s: Cannot watch %s: %s\n", __FUNCTION__, confPath,
+             strerror(errno));
+      goto exit;
+   }
+#endif
+
+   g_free(state->configWatchTarget);
+   state->configWatchTarget = NULL;
+
+   confFile = g_build_filename(confDir, state->configWatchName, NULL);
+   if (g_file_test(confFile, G_FILE_TEST_IS_SYMLINK)) {
+      target = realpath(confFile, NULL);
+      if (target != NULL) {
+         gchar *targetDir = g_path_get_dirname(target);
+
+         if (inotify_add_watch(fd, targetDir, CONF_WATCH_EVENTS) >= 0) {
+            state->configWatchTarget = g_path_get_basename(target);
+         } else {
+            g_info("%s: Cannot watch %s: %s\n", __FUNCTION__, targetDir,
+                   strerror(errno));
+         }
+         g_free(targetDir);
+      }
+
+      g_debug("%s: %s is a symlink, also polling for changes.\n",
+              __FUNCTION__, confFile);
+      state->configPollTask = g_timeout_add(CONF_POLL_TIME * 1000,
+                                            ToolsCoreConfFileCb,
+                                            state);
+   }
+
+   chan = g_io_channel_unix_new(fd);
+   g_io_channel_set_close_on_unref(chan, TRUE);
+   state->configCheckTask = g_io_add_watch(chan, G_IO_IN,
+                                           ToolsCoreConfWatchCb, state);
+   g_io_channel_unref(chan);
+   fd = -1;
+   ret = TRUE;
+
+exit:
+   if (fd >= 0) {
+      close(fd);
+   }
+   free(target);
+   g_free(confFile);
+   g_free(confDir);
+   free(confPath);
+   return ret;
+}
+
+#endif
+
+
+/**
+ * Starts monitoring the config files for changes. On Linux the config
+ * directories are watched with inotify; elsewhere, or if that fails, the
+ * files are polled every CONF_POLL_TIME seconds.
+ *
+ * @param[in]  state    Service state.
+ */
+
+static void
+ToolsCoreConfCheckStart(ToolsServiceState *state)
+{
+   ASSERT(state->configCheckTask == 0);
+
+#if defined(__linux__)
+   if (ToolsCoreConfWatchStart(state)) {
+      g_debug("%s: Watching the config files for changes.\n", __FUNCTION__);
+      return;
+   }
+#endif
+
+   state->configCheckTask = g_timeout_add(CONF_POLL_TIME * 1000,
+                                          ToolsCoreConfFileCb,
+                                          state);
+}
+
+
+/**
+ * Stops monitoring the config files for changes, and cancels any pending
+ * reload.
+ *
+ * @param[in]  state    Service state.
+ */
+
+static void
+ToolsCoreConfCheckStop(ToolsServiceState *state)
+{
+   if (state->configCheckTask != 0) {
+      g_source_remove(state->configCheckTask);
+      state->configCheckTask = 0;
+   }
+#if defined(__linux__)
+   if (state->configPollTask != 0) {
+      g_source_remove(state->configPollTask);
+      state->configPollTask = 0;
+   }
+   if (state->configReloadTask != 0) {
+      g_source_remove(state->configReloadTask);
+      state->configReloadTask = 0;
+   }
+#endif
+}
+
 
 /*
  ******************************************************************************
@@ -101,6 +417,20 @@ static void
 ToolsCoreCleanup(ToolsServiceState *state)
 {
    g_info("%s: Entering\n", __FUNCTION__);
+
+   if (state->lockStatsTask != 0) {
+      g_source_remove(state->lockStatsTask);
+      state->lockStatsTask = 0;
+   }
+
+   ToolsCoreConfCheckStop(state);
+#if defined(__linux__)
+   g_free(state->configWatchName);
+   state->configWatchName = NULL;
+   g_free(state->configWatchTarget);
+   state->configWatchTarget = NULL;
+#endif
+
    /*
     * Emit the early shutdown signal.
     */
@@ -208,25 +538,10 @@ ToolsCoreInitializeDebug(ToolsServiceState *state)
 }
 
 
-/**
- * Timer callback that just calls ToolsCore_ReloadConfig().
- *
- * @param[in]  clientData  Service state.
- *
- * @return TRUE.
- */
-
-static gboolean
-ToolsCoreConfFileCb(gpointer clientData)
-{
-   ToolsCore_ReloadConfig(clientData, FALSE);
-   return TRUE;
-}
-
-
 /**
  * IO freeze signal handler. Disables the conf file check task if I/O is
- * frozen, re-enable it otherwise. See bug 529653.
+ * frozen, re-enable it otherwise. Changes made while frozen are picked up
+ * by an explicit reload when I/O is thawed. See bug 529653.
  *
  * @param[in]  src      The source object.
  * @param[in]  ctx      Unused.
@@ -241,14 +556,12 @@ ToolsCoreIOFreezeCb(gpointer src,
                     ToolsServiceState *state)
 {
    if (state->configCheckTask > 0 && freeze) {
-      g_source_remove(state->configCheckTask);
-      state->configCheckTask = 0;
+      ToolsCoreConfCheckStop(state);
       VMTools_SuspendLogIO();
    } else if (state->configCheckTask == 0 && !freeze) {
       VMTools_ResumeLogIO();
-      state->configCheckTask = g_timeout_add(CONF_POLL_TIME * 1000,
-                                             ToolsCoreConfFileCb,
-                                             state);
+      ToolsCoreConfCheckStart(state);
+      ToolsCore_ReloadConfig(state, FALSE);
    }
 }
 
@@ -464,11 +777,234 @@ ToolsCoreConfReloadSignalCb(gpointer src,          // IN
                             ToolsAppCtx *ctx,      // IN
                             gpointer data)         // IN
 {
+   if (!ToolsCore_ConfigKeyChanged(ctx, CONFGROUPNAME_VMTOOLS,
+                                   CONFNAME_USELEGACYVERSION)) {
+      return;
+   }
+
    g_debug("Reinitialize the guest vars for version data.\n");
    ToolsCoreReportVersionData(ctx); /* Update version guest vars */
 }
 
 
+/*
+ ******************************************************************************
+ * ToolsCoreFormatLockStats --                                          */ /**
+ *
+ * Formats the statistics of one lock as a single line. All times are in
+ * microseconds.
+ *
+ * @param[in]  s           Lock statistics.
+ *
+ * @return The line, to be freed with g_free().
+ *
+ ******************************************************************************
+ */
+
+static gchar *
+ToolsCoreFormatLockStats(const MXUserLockStats *s)
+{
+   gchar *line;
+
+   line = g_strdup_printf("%s: acquired %"FMT64"u contended %"FMT64"u "
+                          "waited %"FMT64"u wait p50 %"FMT64"u "
+                          "p99 %"FMT64"u max %"FMT64"u",
+                          s->name, s->numAttempts, s->numContended,
+                          s->contentionTime / 1000, s->waitP50 / 1000,
+                          s->waitP99 / 1000, s->waitMax / 1000);
+
+   if (s->numHeld > 0) {
+      gchar *held = g_strdup_printf("%s held p50 %"FMT64"u "
+                                    "p99 %"FMT64"u max %"FMT64"u",
+                                    line, s->heldP50 / 1000,
+                                    s->heldP99 / 1000, s->heldMax / 1000);
+      g_free(line);
+      line = held;
+   }
+
+   return line;
+}
+
+
+/*
+ ******************************************************************************
+ * ToolsCoreLogLockStats --                                             */ /**
+ *
+ * Logs wait and hold times of the most contended locks in the process.
+ *
+ * @param[in]  state       Service state.
+ * @param[in]  dumpState   Whether to log as part of the state dump.
+ *
+ ******************************************************************************
+ */
+
+static void
+ToolsCoreLogLockStats(ToolsServiceState *state,
+                      gboolean dumpState)
+{
+   MXUserLockStats *stats;
+   guint count;
+   guint i;
+
+   if (!state->lockStatsEnabled) {
+      return;
+   }
+
+   stats = g_new(MXUserLockStats, state->lockStatsTop);
+   count = MXUser_GetTopContendedLocks(stats, state->lockStatsTop);
+
+   if (dumpState) {
+      ToolsCore_LogState(TOOLS_STATE_LOG_CONTAINER,
+                         "Most contended locks: %u\n", count);
+   } else {
+      g_info("Most contended locks: %u\n", count);
+   }
+
+   for (i = 0; i < count; i++) {
+      gchar *line = ToolsCoreFormatLockStats(&stats[i]);
+
+      if (dumpState) {
+         ToolsCore_LogState(TOOLS_STATE_LOG_PLUGIN, "%s\n", line);
+      } else {
+         g_info("  %s\n", line);
+      }
+      g_free(line);
+   }
+
+   g_free(stats);
+}
+
+
+/*
+ ******************************************************************************
+ * ToolsCore_GetLockStats --                                            */ /**
+ *
+ * Returns wait and hold times of the most contended locks in the process,
+ * one lock per line, in the format used for the log.
+ *
+ * @param[in]  state       Service state.
+ *
+ * @return The statistics, to be freed with g_free(), or NULL if lock
+ *         statistics are not enabled.
+ *
+ ******************************************************************************
+ */
+
+gchar *
+ToolsCore_GetLockStats(ToolsServiceState *state)
+{
+   MXUserLockStats *stats;
+   GString *text;
+   guint count;
+   guint i;
+
+   if (!state->lockStatsEnabled) {
+      return NULL;
+   }
+
+   stats = g_new(MXUserLockStats, state->lockStatsTop);
+   count = MXUser_GetTopContendedLocks(stats, state->lockStatsTop);
+
+   text = g_string_new(NULL);
+   for (i = 0; i < count; i++) {
+      gchar *line = ToolsCoreFormatLockStats(&stats[i]);
+
+      g_string_append_printf(text, "%s\n", line);
+      g_free(line);
+   }
+
+   g_free(stats);
+   return g_string_free(text, FALSE);
+}
+
+
+/**
+ * Timer callback that logs the lock statistics.
+ *
+ * @param[in]  clientData  Service state.
+ *
+ * @return TRUE.
+ */
+
+static gboolean
+ToolsCoreLockStatsCb(gpointer clientData)
+{
+   ToolsCoreLogLockStats(clientData, FALSE);
+   return TRUE;
+}
+
+
+/*
+ ******************************************************************************
+ * ToolsCoreConfigLockStats --                                          */ /**
+ *
+ * Applies the lock statistics settings from the config file. Statistics
+ * collection can be switched on and off without restarting the service.
+ *
+ * @param[in]  state       Service state.
+ *
+ ******************************************************************************
+ */
+
+static void
+ToolsCoreConfigLockStats(ToolsServiceState *state)
+{
+   GKeyFile *config = state->ctx.config;
+   gboolean enabled;
+   gboolean heldTimes;
+   gint top;
+   gint interval;
+
+   enabled = VMTools_ConfigGetBoolean(config, CONFGROUPNAME_LOCKSTATS,
+                                      CONFNAME_LOCKSTATS_ENABLED, FALSE);
+   heldTimes = VMTools_ConfigGetBoolean(config, CONFGROUPNAME_LOCKSTATS,
+                                        CONFNAME_LOCKSTATS_HELD_TIMES, TRUE);
+   top = VMTools_ConfigGetInteger(config, CONFGROUPNAME_LOCKSTATS,
+                                  CONFNAME_LOCKSTATS_TOP,
+                                  LOCKSTATS_DEFAULT_TOP);
+   interval = VMTools_ConfigGetInteger(config, CONFGROUPNAME_LOCKSTATS,
+                                       CONFNAME_LOCKSTATS_INTERVAL, 0);
+
+   if (top <= 0 || top > LOCKSTATS_MAX_TOP) {
+      g_warning("Invalid %s.%s value %d, using %d.\n",
+                CONFGROUPNAME_LOCKSTATS, CONFNAME_LOCKSTATS_TOP, top,
+                LOCKSTATS_DEFAULT_TOP);
+      top = LOCKSTATS_DEFAULT_TOP;
+   }
+
+   if (interval < 0) {
+      g_warning("Invalid %s.%s value %d, using 0.\n",
+                CONFGROUPNAME_LOCKSTATS, CONFNAME_LOCKSTATS_INTERVAL,
+                interval);
+      interval = 0;
+   }
+
+   if (!enabled) {
+      interval = 0;
+   }
+
+   if (enabled != state->lockStatsEnabled) {
+      g_info("%s lock statistics.\n", enabled ? "Enabling" : "Disabling");
+      MXUser_SetStatsExport(enabled, heldTimes);
+      state->lockStatsEnabled = enabled;
+   }
+   state->lockStatsTop = top;
+
+   if (interval != state->lockStatsInterval) {
+      if (state->lockStatsTask != 0) {
+         g_source_remove(state->lockStatsTask);
+         state->lockStatsTask = 0;
+      }
+      if (interval > 0) {
+         state->lockStatsTask = g_timeout_add_seconds(interval,
+                                                      ToolsCoreLockStatsCb,
+                                                      state);
+      }
+      state->lockStatsInterval = interval;
+   }
+}
+
+
 /*
  ******************************************************************************
  * ToolsCoreRunLoop --                                                  */ /**
@@ -599,9 +1135,7 @@ ToolsCoreRunLoop(ToolsServiceState *state)
                           NULL);
       }
 
-      state->configCheckTask = g_timeout_add(CONF_POLL_TIME * 1000,
-                                             ToolsCoreConfFileCb,
-                                             state);
+      ToolsCoreConfCheckStart(state);
 
 #if defined(__APPLE__)
       ToolsCore_CFRunLoop(state);
@@ -682,6 +1216,8 @@ ToolsCore_DumpState(ToolsServiceState *state)
 
    ToolsCore_DumpPluginInfo(state);
 
+   ToolsCoreLogLockStats(state, TRUE);
+
    g_signal_emit_by_name(state->ctx.serviceObj,
                          TOOLS_CORE_SIG_DUMP_STATE,
                          &state->ctx);
@@ -715,6 +1251,11 @@ ToolsCore_GetTcloName(ToolsServiceState *state)
  * time, try to upgrade it to the new version if an old version is
  * detected.
  *
+ * On reloads, the new config is compared with the current one, and the set
+ * of changed groups and keys is available to plugins in
+ * ToolsAppCtx::configChanges while they are notified. The notification is
+ * sent even if nothing changed (the set is then empty), as it always was.
+ *
  * @param[in]  state       Service state.
  * @param[in]  reset       Whether to reset the logging subsystem.
  */
@@ -725,6 +1266,8 @@ ToolsCore_ReloadConfig(ToolsServiceState *state,
 {
    gboolean first = state->ctx.config == NULL;
    gboolean loaded;
+   GKeyFile *newConfig = NULL;
+   GKeyFile *oldConfig = NULL;
 
 #if defined(GLOBALCONFIG_SUPPORTED)
    gboolean globalConfLoaded = FALSE;
@@ -744,21 +1287,44 @@ ToolsCore_ReloadConfig(ToolsServiceState *state,
    }
 #endif
 
+   /*
+    * Load into a new dictionary so that the current one can be compared
+    * with it before it's replaced.
+    */
    loaded = VMTools_LoadConfig(state->configFile,
                                G_KEY_FILE_NONE,
-                               &state->ctx.config,
+                               &newConfig,
                                &state->configMtime);
 
 #if defined(GLOBALCONFIG_SUPPORTED)
    if (loaded || globalConfLoaded) {
+      /*
+       * If tools.conf couldn't be re-read, the global settings are merged
+       * into the current config and the set of changes is not known.
+       */
       gboolean configUpdated = VMTools_AddConfig(state->globalConfig,
-                                                 state->ctx.config);
+                                                 loaded ? newConfig :
+                                                          state->ctx.config);
       loaded = loaded || configUpdated;
    }
 #endif
 
+   if (newConfig != NULL) {
+      oldConfig = state->ctx.config;
+      state->ctx.config = newConfig;
+   }
+
    if (!first && loaded) {
-      g_info("Config file reloaded.\n");
+      if (newConfig != NULL) {
+         state->ctx.configChanges = VMTools_DiffConfig(oldConfig, newConfig);
+      }
+
+      if (state->ctx.configChanges != NULL &&
+          g_hash_table_size(state->ctx.configChanges) == 0) {
+         g_debug("%s: Config file reloaded, no changes.\n", __FUNCTION__);
+      } else {
+         g_info("Config file reloaded.\n");
+      }
 
       /*
        * Inform plugins of config file update.
@@ -767,6 +1333,15 @@ ToolsCore_ReloadConfig(ToolsServiceState *state,
       g_signal_emit_by_name(state->ctx.serviceObj,
                             TOOLS_CORE_SIG_CONF_RELOAD,
                             &state->ctx);
+
+      if (state->ctx.configChanges != NULL) {
+         g_hash_table_unref(state->ctx.configChanges);
+         state->ctx.configChanges = NULL;
+      }
+   }
+
+   if (oldConfig != NULL) {
+      g_key_file_free(oldConfig);
    }
 
    if (state->ctx.config == NULL) {
@@ -788,6 +1363,10 @@ ToolsCore_ReloadConfig(ToolsServiceState *state,
        */
       VMTools_SetupVmxGuestLog(FALSE, state->ctx.config, NULL);
    }
+
+   if (first || loaded) {
+      ToolsCoreConfigLockStats(state);
+   }
 }
 
 
@@ -901,7 +1480,7 @@ ToolsCore_Setup(ToolsServiceState *state)
 
    /* Initializes the app context. */
    gctx = g_main_context_default();
-   state->ctx.version = TOOLS_CORE_API_V1;
+   state->ctx.version = TOOLS_CORE_API_V1 | TOOLS_CORE_API_V2;
    state->ctx.name = state->name;
    state->ctx.errorCode = EXIT_SUCCESS;
 #if defined(__APPLE__)
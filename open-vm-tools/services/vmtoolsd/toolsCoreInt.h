@@ -83,6 +83,16 @@ typedef struct ToolsServiceState {
    time_t         globalConfigMtime;
 #endif
    guint          configCheckTask;
+#if defined(__linux__)
+   gchar         *configWatchName;
+   gchar         *configWatchTarget;
+   guint          configReloadTask;
+   guint          configPollTask;
+#endif
+   gboolean       lockStatsEnabled;
+   guint          lockStatsTop;
+   guint          lockStatsInterval;
+   guint          lockStatsTask;
    gboolean       mainService;
    gboolean       capsRegistered;
    gchar         *commonPath;
@@ -130,6 +140,9 @@ ToolsCore_GetVmusrLimit(ToolsServiceState *state);
 const char *
 ToolsCore_GetTcloName(ToolsServiceState *state);
 
+gchar *
+ToolsCore_GetLockStats(ToolsServiceState *state);
+
 int
 ToolsCore_Run(ToolsServiceState *state);
 
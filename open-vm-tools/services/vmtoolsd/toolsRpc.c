@@ -37,6 +37,7 @@
 #include "guestApp.h"
 #include "str.h"
 #include "strutil.h"
+#include "util.h"
 #include "toolsCoreInt.h"
 #include "vmtoolsd_version.h"
 #include "vmware/tools/utils.h"
@@ -371,6 +372,35 @@ ToolsCoreRpcSetOption(RpcInData *data)
 }
 
 
+/**
+ * Handles a "lockstats.get" RPC. Returns wait and hold times of the most
+ * contended locks in the service, one lock per line. Lock statistics have
+ * to be enabled in the [lockstats] section of the config file.
+ *
+ * @param[in]  data     The RPC data.
+ *
+ * @return Whether lock statistics are enabled.
+ */
+
+static gboolean
+ToolsCoreRpcLockStats(RpcInData *data)
+{
+   ToolsServiceState *state = data->clientData;
+   gchar *stats = ToolsCore_GetLockStats(state);
+   gboolean ret;
+
+   if (stats == NULL) {
+      return RPCIN_SETRETVALS(data, "Lock statistics are not enabled", FALSE);
+   }
+
+   /* The RPC layer frees the result with free(). */
+   ret = RPCIN_SETRETVALSF(data, Util_SafeStrdup(stats), TRUE);
+   g_free(stats);
+
+   return ret;
+}
+
+
 /**
  * Initializes the RPC channel. Currently this instantiates an RpcIn loop.
  * This function should only be called once.
@@ -386,6 +416,7 @@ ToolsCore_InitRpc(ToolsServiceState *state)
    static RpcChannelCallback rpcs[] = {
       { "Capabilities_Register", ToolsCoreRpcCapReg, NULL, NULL, NULL, 0 },
       { "Set_Option", ToolsCoreRpcSetOption, NULL, NULL, NULL, 0 },
+      { "lockstats.get", ToolsCoreRpcLockStats, NULL, NULL, NULL, 0 },
    };
 
    const gchar *app;
@@ -40,6 +40,7 @@
 #include "vm_basic_defs.h"
 #include "toolboxCmdInt.h"
 #include "vmware/tools/i18n.h"
+#include "vmware/tools/utils.h"
 #include "guestStoreClient.h"
 
 
@@ -60,6 +61,8 @@ GUESTSTORE_LIB_ERR_LIST
 };
 #undef GUESTSTORE_LIB_ERR_ITEM
 
+#define CONFGROUPNAME_GUESTSTORECLIENT "gueststoreclient"
+
 /*
  * Passed in from main(), command line --quiet (q) option.
  */
@@ -197,6 +200,9 @@ GuestStore_Command(char **argv,      // IN: Command line arguments
    int exitCode;
    char *contentPath;
    char *outputPath;
+   GKeyFile *conf = NULL;
+   gchar *cacheDir = NULL;
+   GuestStoreCacheOptions cacheOptions;
 
    if (toolbox_strcmp(argv[optind], "getcontent") != 0) {
       ToolsCmd_UnknownEntityError(argv[0],
@@ -220,8 +226,34 @@ GuestStore_Command(char **argv,      // IN: Command line arguments
    contentPath = GuestStoreRemovePathEnclosingQuotes(argv[argc - 2]);
    outputPath = GuestStoreRemovePathEnclosingQuotes(argv[argc - 1]);
 
-   exitCode = GuestStoreClient_GetContent(contentPath, outputPath,
-                                          GuestStoreReportProgress, NULL);
+   /*
+    * The local content cache is only used when a cache directory is
+    * configured in tools.conf.
+    */
+   VMTools_LoadConfig(NULL, G_KEY_FILE_NONE, &conf, NULL);
+   if (conf != NULL) {
+      cacheDir = VMTools_ConfigGetString(conf, CONFGROUPNAME_GUESTSTORECLIENT,
+                                         "cacheDir", NULL);
+      cacheOptions.maxCacheSize =
+         (int64)MAX(VMTools_ConfigGetInteger(conf,
+                                             CONFGROUPNAME_GUESTSTORECLIENT,
+                                             "cacheMaxSize", 0), 0) * 1024 * 1024;
+      cacheOptions.maxAge =
+         MAX(VMTools_ConfigGetInteger(conf, CONFGROUPNAME_GUESTSTORECLIENT,
+                                      "cacheMaxAge", 0), 0);
+      g_key_file_free(conf);
+   }
+
+   if (cacheDir != NULL && *cacheDir != '\0') {
+      cacheOptions.cacheDir = cacheDir;
+      exitCode = GuestStoreClient_GetContentEx(contentPath, outputPath,
+                                               &cacheOptions,
+                                               GuestStoreReportProgress, NULL);
+   } else {
+      exitCode = GuestStoreClient_GetContent(contentPath, outputPath,
+                                             GuestStoreReportProgress, NULL);
+   }
+   g_free(cacheDir);
    if (exitCode != GSLIBERR_SUCCESS) {
       g_critical("GuestStoreClient_GetContent failed: error=%d.\n", exitCode);
    }
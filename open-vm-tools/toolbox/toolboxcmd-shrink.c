@@ -28,6 +28,7 @@
 
 #ifndef _WIN32
 #   include <signal.h>
+#   include <unistd.h>
 #endif
 
 #include "vm_assert.h"
@@ -37,6 +38,7 @@
 #include "vmware/guestrpc/tclodefs.h"
 #include "vmware/tools/i18n.h"
 #include "vmware/tools/log.h"
+#include "vmware/tools/utils.h"
 
 #ifndef _WIN32
 static void ShrinkWiperDestroy(int signal);
@@ -66,8 +68,20 @@ static void ShrinkWiperDestroy(int signal);
 
 static Wiper_State *wiper = NULL;
 
+#ifndef _WIN32
+/*
+ * Set while Wiper_Next() is being called in a loop, and when SIGINT asks
+ * that loop to cancel the wipe. The wiper can't be canceled from the signal
+ * handler itself: that joins its writer threads and takes its lock.
+ */
+static volatile sig_atomic_t shrinkWiping = 0;
+static volatile sig_atomic_t shrinkCanceled = 0;
+#endif
+
 #define WIPER_STATE_CMD "disk.wiper.enable"
 
+#define CONFGROUPNAME_DISKWIPER "diskwiper"
+
 typedef enum {
    WIPER_UNAVAILABLE,
    WIPER_DISABLED,
@@ -355,6 +369,8 @@ ShrinkDoWipeAndShrink(char *mountPoint,         // IN: mount point
 #if defined(_WIN32)
    DWORD currPriority = GetPriorityClass(GetCurrentProcess());
 #else
+   WiperStats stats;
+
    signal(SIGINT, ShrinkWiperDestroy);
 #endif
 
@@ -422,7 +438,26 @@ ShrinkDoWipeAndShrink(char *mountPoint,         // IN: mount point
                                "for the duration of wipe process.\n"));
    }
 
+#if defined(_WIN32)
    wiper = Wiper_Start(part, MAX_WIPER_FILE_SIZE);
+#else
+   wiper = Wiper_StartWithStats(part, MAX_WIPER_FILE_SIZE, &stats);
+   if (wiper != NULL) {
+      GKeyFile *conf = NULL;
+
+      VMTools_LoadConfig(NULL, G_KEY_FILE_NONE, &conf, NULL);
+      if (conf != NULL) {
+         gint streams = VMTools_ConfigGetInteger(conf, CONFGROUPNAME_DISKWIPER,
+                                                 "zeroFillStreams", 0);
+         gint maxMBps = VMTools_ConfigGetInteger(conf, CONFGROUPNAME_DISKWIPER,
+                                                 "zeroFillMaxMBps", 0);
+
+         Wiper_SetZeroFill(wiper, MAX(streams, 0), MAX(maxMBps, 0));
+         g_key_file_free(conf);
+      }
+      shrinkWiping = 1;
+   }
+#endif
 
 #if defined(_WIN32)
    /*
@@ -435,6 +470,16 @@ ShrinkDoWipeAndShrink(char *mountPoint,         // IN: mount point
 #endif
 
    while (progress < 100 && wiper != NULL) {
+#if !defined(_WIN32)
+      if (shrinkCanceled) {
+         Wiper_Cancel(&wiper);
+         g_print("\n");
+         ToolsCmd_Print("%s", SU_(disk.shrink.canceled,
+                                  "Disk shrink canceled.\n"));
+         exit(VM_EX_INTERRUPT);
+      }
+#endif
+
       err = Wiper_Next(&wiper, &progress);
       if (strlen(err) > 0) {
          if (strcmp(err, "error.create") == 0) {
@@ -467,6 +512,34 @@ ShrinkDoWipeAndShrink(char *mountPoint,         // IN: mount point
 #endif
 
    g_print("\n");
+
+#if !defined(_WIN32)
+   shrinkWiping = 0;
+
+   /*
+    * SIGINT may have arrived during the last Wiper_Next() or after the loop
+    * ended; it still cancels the shrink.
+    */
+   if (shrinkCanceled) {
+      Wiper_Cancel(&wiper);
+      ToolsCmd_Print("%s", SU_(disk.shrink.canceled,
+                               "Disk shrink canceled.\n"));
+      exit(VM_EX_INTERRUPT);
+   }
+
+   if (progress == 100 && !quiet) {
+      uint64 usecs = MAX(stats.usecs, 1);
+
+      ToolsCmd_Print(SU_(disk.wiper.stats,
+                         "Free space reclaimed using %s: %u MB in %u seconds "
+                         "(%u MB/s).\n"),
+                     Wiper_MethodName(stats.method),
+                     (unsigned int) (stats.bytes >> 20),
+                     (unsigned int) (usecs / 1000000),
+                     (unsigned int) ((stats.bytes >> 20) * 1000000 / usecs));
+   }
+#endif
+
    if (progress < 100) {
       rc = EX_TEMPFAIL;
    } else if (performShrink) {
@@ -501,8 +574,9 @@ out:
  *      None.
  *
  * Side effects:
- *      The wipe operation will be canceled, and "zero" files removed.
- *      We will also exit the vmware-toolbox-cmd program.
+ *      During a wipe, asks the wipe loop to cancel it, which removes the
+ *      "zero" files and exits the vmware-toolbox-cmd program. Otherwise
+ *      exits right away, as there is nothing to clean up.
  *
  *-----------------------------------------------------------------------------
  */
@@ -510,12 +584,10 @@ out:
 void
 ShrinkWiperDestroy(int signal)	// IN: Signal caught
 {
-   if (wiper != NULL) {
-      Wiper_Cancel(&wiper);
-      wiper = NULL;
+   if (!shrinkWiping) {
+      _exit(VM_EX_INTERRUPT);
    }
-   ToolsCmd_Print("%s", SU_(disk.shrink.canceled, "Disk shrink canceled.\n"));
-   exit(VM_EX_INTERRUPT);
+   shrinkCanceled = 1;
 }
 #endif
 
@@ -28,6 +28,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <openssl/ssl.h>
 #include <openssl/bio.h>
 #include <openssl/evp.h>
@@ -610,7 +611,62 @@ done:
 
 /*
  ******************************************************************************
- * CertVerify_CertChain --                                               */ /**
+ * CertVerifyChainNotAfter --                                            */ /**
+ *
+ * Finds when the first cert of a verified chain expires.
+ *
+ * @param[in]  verifyCtx   The context of a successful X509_verify_cert().
+ *
+ * @return The earliest notAfter time in the chain, or 0 if it can't be
+ *         determined.
+ *
+ ******************************************************************************
+ */
+
+static time_t
+CertVerifyChainNotAfter(X509_STORE_CTX *verifyCtx)
+{
+   time_t notAfter = 0;
+#if OPENSSL_VERSION_NUMBER >= 0x10002000L
+   STACK_OF(X509) *chain;
+   time_t now = time(NULL);
+   int i;
+
+   chain = X509_STORE_CTX_get1_chain(verifyCtx);
+   if (NULL == chain) {
+      return 0;
+   }
+
+   for (i = 0; i < sk_X509_num(chain); i++) {
+      X509 *x = sk_X509_value(chain, i);
+      int days;
+      int secs;
+      time_t t;
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+      if (!ASN1_TIME_diff(&days, &secs, NULL, X509_get0_notAfter(x))) {
+#else
+      if (!ASN1_TIME_diff(&days, &secs, NULL, X509_get_notAfter(x))) {
+#endif
+         notAfter = 0;
+         break;
+      }
+      t = now + (time_t) days * 24 * 60 * 60 + secs;
+      if (0 == notAfter || t < notAfter) {
+         notAfter = t;
+      }
+   }
+
+   sk_X509_pop_free(chain, X509_free);
+#endif
+
+   return notAfter;
+}
+
+
+/*
+ ******************************************************************************
+ * CertVerify_CertChainEx --                                             */ /**
  *
  * @brief Verifies a complete certificate chain.
  *
@@ -625,6 +681,9 @@ done:
  * @param[in]  pemUntrustedCertChain    The chain of untrusted certificates.
  * @param[in]  numTrustedCerts          The size of the trusted chain.
  * @param[in]  pemTrustedCertChain      The chain of trusted certificates.
+ * @param[out] validUntil               Optional; on success, the earliest
+ *                                      expiration time of the certs in the
+ *                                      verified chain, or 0 if unknown.
  *
  * @return VGAUTH_E_OK on success, VGAuthError on failure
  *
@@ -632,11 +691,12 @@ done:
  */
 
 VGAuthError
-CertVerify_CertChain(const char *pemLeafCert,
-                     int numUntrustedCerts,
-                     const char **pemUntrustedCertChain,
-                     int numTrustedCerts,
-                     const char **pemTrustedCertChain)
+CertVerify_CertChainEx(const char *pemLeafCert,
+                       int numUntrustedCerts,
+                       const char **pemUntrustedCertChain,
+                       int numTrustedCerts,
+                       const char **pemTrustedCertChain,
+                       time_t *validUntil)
 {
    VGAuthError err = VGAUTH_E_OK;
    int ret;
@@ -646,6 +706,9 @@ CertVerify_CertChain(const char *pemLeafCert,
    X509_STORE_CTX *verifyCtx = NULL;
    X509 *leafCert;
 
+   if (NULL != validUntil) {
+      *validUntil = 0;
+   }
 
    /*
     * Turn the leaf cert into an x509 object.
@@ -739,6 +802,10 @@ CertVerify_CertChain(const char *pemLeafCert,
       goto done;
    }
 
+   if (NULL != validUntil) {
+      *validUntil = CertVerifyChainNotAfter(verifyCtx);
+   }
+
 done:
    sk_X509_pop_free(trustedChain, X509_free);
    sk_X509_pop_free(untrustedChain, X509_free);
@@ -758,6 +825,37 @@ done:
 }
 
 
+/*
+ ******************************************************************************
+ * CertVerify_CertChain --                                               */ /**
+ *
+ * Verifies a complete certificate chain.  See CertVerify_CertChainEx().
+ *
+ * @param[in]  pemLeafCert              The leaf cert in PEM format.
+ * @param[in]  numUntrustedCerts        The size of the untrusted chain.
+ * @param[in]  pemUntrustedCertChain    The chain of untrusted certificates.
+ * @param[in]  numTrustedCerts          The size of the trusted chain.
+ * @param[in]  pemTrustedCertChain      The chain of trusted certificates.
+ *
+ * @return VGAUTH_E_OK on success, VGAuthError on failure
+ *
+ ******************************************************************************
+ */
+
+VGAuthError
+CertVerify_CertChain(const char *pemLeafCert,
+                     int numUntrustedCerts,
+                     const char **pemUntrustedCertChain,
+                     int numTrustedCerts,
+                     const char **pemTrustedCertChain)
+{
+   return CertVerify_CertChainEx(pemLeafCert,
+                                 numUntrustedCerts, pemUntrustedCertChain,
+                                 numTrustedCerts, pemTrustedCertChain,
+                                 NULL);
+}
+
+
 /*
  ******************************************************************************
  * CertVerify_CheckSignatureUsingCert --                                 */ /**
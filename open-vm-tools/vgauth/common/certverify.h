@@ -25,6 +25,7 @@
  * Certificate verification support.
  */
 
+#include <time.h>
 #include <glib.h>
 #include "VGAuthAuthentication.h"
 #include "openssl/opensslv.h"  // For OPENSSL_VERSION_NUMBER.
@@ -60,6 +61,13 @@ VGAuthError CertVerify_CertChain(const char *pemLeafCert,
                                   int numTrustedCerts,
                                   const char **pemTrustedCertChain);
 
+VGAuthError CertVerify_CertChainEx(const char *pemLeafCert,
+                                   int numUntrustedCerts,
+                                   const char **pemUntrustedCertChain,
+                                   int numTrustedCerts,
+                                   const char **pemTrustedCertChain,
+                                   time_t *validUntil);
+
 VGAuthError CertVerify_CheckSignatureUsingCert(VGAuthHashAlg hash,
                                                const char *pemCert,
                                                size_t dataLen,
@@ -97,6 +97,8 @@ loglevel=normal
 enableLogging=true
 enableCoreDumps=true
 clockSkewAdjustment = 300
+samlTokenCacheSize = 256
+requestWorkerThreads = 4
 
 [ticket]
 ticketTTL=3600
@@ -142,6 +144,10 @@ msgCatalog = /etc/vmware-tools/vgauth/messages
 #define VGAUTH_PREF_CLOCK_SKEW_SECS        "clockSkewAdjustment"
 /** If unrelated certificates are allowed in a SAML token */
 #define VGAUTH_PREF_ALLOW_UNRELATED_CERTS  "allowUnrelatedCerts"
+/** The number of verified SAML tokens and cert chains remembered; 0 disables. */
+#define VGAUTH_PREF_SAML_TOKEN_CACHE_SIZE  "samlTokenCacheSize"
+/** The number of threads verifying requests off the main loop; 0 disables. */
+#define VGAUTH_PREF_REQUEST_WORKER_THREADS "requestWorkerThreads"
 
 /** Ticket group name. */
 #define VGAUTH_PREF_GROUP_NAME_TICKET      "ticket"
@@ -208,5 +214,9 @@ msgCatalog = /etc/vmware-tools/vgauth/messages
 
 #define VGAUTH_PREF_DEFAULT_CLOCK_SKEW_SECS (300)
 
+#define VGAUTH_PREF_DEFAULT_SAML_TOKEN_CACHE_SIZE (256)
+
+#define VGAUTH_PREF_DEFAULT_REQUEST_WORKER_THREADS (4)
+
 #endif // _PREFS_H_
 
@@ -209,7 +209,8 @@ ServiceSigtermHandler(gpointer data)
 
    /*
     * It's safe to just exit here, since we've been called by the glib
-    * mainloop so cannot be in the middle of processing a request.
+    * mainloop so cannot be in the middle of processing a request, and
+    * Service_Shutdown() waited for any worker threads.
     */
    exit(0);
 
@@ -289,6 +290,16 @@ ServiceIOHandleIOGSource(gpointer userData)
       return FALSE;
    }
 
+   /*
+    * The request was handed to a worker thread.  Stop watching the
+    * connection until its reply has been sent; ServiceIOResumeIO()
+    * sets up a new watch.
+    */
+   if (conn->busy) {
+      conn->gioId = 0;
+      return FALSE;
+   }
+
    /*
     * Windows needs to initiate a new async read IO before polling again.
     * Do it here instead of immediately after the read() since we like to
@@ -312,6 +323,67 @@ ServiceIOHandleIO(GIOChannel *chan,
 }
 
 
+/*
+ ******************************************************************************
+ * ServiceIOWatchConnection --                                           */ /**
+ *
+ * Starts watching for input on a data connection.
+ *
+ * @param[in]   conn              The ServiceConnection.
+ *
+ ******************************************************************************
+ */
+
+static void
+ServiceIOWatchConnection(ServiceConnection *conn)
+{
+#ifdef _WIN32
+   GSource *gSourceData;
+
+   gSourceData = ServiceIONewHandleGSource(conn->ol.hEvent,
+                                           ServiceIOHandleIOGSource,
+                                           (gpointer) conn);
+   conn->gioId = g_source_attach(gSourceData, NULL);
+   g_source_unref(gSourceData);
+#else
+   GIOChannel *echan;
+
+   echan = g_io_channel_unix_new(conn->sock);
+   conn->gioId = g_io_add_watch(echan, G_IO_IN, ServiceIOHandleIO,
+                                (gpointer) conn);
+   g_io_channel_unref(echan);
+#endif
+}
+
+
+/*
+ ******************************************************************************
+ * ServiceIOResumeIO --                                                  */ /**
+ *
+ * Starts watching a data connection again after a worker thread
+ * finished its request.
+ *
+ * @param[in]   conn              The ServiceConnection.
+ *
+ * @return VGAuthError
+ *
+ ******************************************************************************
+ */
+
+VGAuthError
+ServiceIOResumeIO(ServiceConnection *conn)
+{
+   ASSERT(conn->gioId == 0);
+
+#ifdef _WIN32
+   ServiceNetworkStartRead(conn);
+#endif
+   ServiceIOWatchConnection(conn);
+
+   return VGAUTH_E_OK;
+}
+
+
 /*
  ******************************************************************************
  * ServiceIOAccept --                                                    */ /**
@@ -348,26 +420,9 @@ ServiceIOAcceptGSource(gpointer userData)
 
    err = ServiceAcceptConnection(lConn, newConn);
    if (VGAUTH_E_OK == err) {
-#ifdef _WIN32
-      GSource *gSourceData;
-#else
-      GIOChannel *echan;
-#endif
-
       VGAUTH_LOG_DEBUG("Established a new pipe connection %d on %s", newConn->connId,
                        newConn->pipeName);
-#ifdef _WIN32
-      gSourceData = ServiceIONewHandleGSource(newConn->ol.hEvent,
-                                              ServiceIOHandleIOGSource,
-                                              (gpointer) newConn);
-      newConn->gioId = g_source_attach(gSourceData, NULL);
-      g_source_unref(gSourceData);
-#else
-      echan = g_io_channel_unix_new(newConn->sock);
-      newConn->gioId = g_io_add_watch(echan, G_IO_IN, ServiceIOHandleIO,
-                            (gpointer) newConn);
-      g_io_channel_unref(echan);
-#endif
+      ServiceIOWatchConnection(newConn);
    } else if (VGAUTH_E_TOO_MANY_CONNECTIONS == err) {
       ServiceConnectionShutdown(newConn);
    } else {
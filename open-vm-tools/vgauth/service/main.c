@@ -175,12 +175,15 @@ ServiceStartAndRun(void)
       exit(-1);
    }
 
-   err = ServiceRegisterIOFunctions(ServiceIOStartListen, ServiceStopIO);
+   err = ServiceRegisterIOFunctions(ServiceIOStartListen, ServiceStopIO,
+                                    ServiceIOResumeIO);
    if (VGAUTH_E_OK != err) {
       Warning("%s: failed to register IO functions; exiting\n", __FUNCTION__);
       exit(-1);
    }
 
+   ServiceProtoInitWorkers();
+
 
    err = ServiceCreatePublicConnection(&publicConn);
    if (VGAUTH_E_OK != err) {
@@ -54,6 +54,8 @@ VGAuthError ServiceIOMainLoop(void);
 
 VGAuthError ServiceStopIO(ServiceConnection *conn);
 
+VGAuthError ServiceIOResumeIO(ServiceConnection *conn);
+
 #ifdef _WIN32
 VGAuthError ServiceIORegisterQuitEvent(HANDLE hQuitEvent);
 
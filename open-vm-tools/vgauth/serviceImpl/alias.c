@@ -34,6 +34,8 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <string.h>
+#include <time.h>
 #ifdef _WIN32
 #include <io.h>
 #include <windows.h>
@@ -93,6 +95,37 @@ static gchar *aliasStoreRootDir = DEFAULT_ALIASSTORE_ROOT_DIR;
  */
 #define ALIASSTORE_FILE_MAX_SIZE       (10 * 1024 * 1024)
 
+/*
+ * Parsed alias and mapping files are kept in memory, so that token
+ * validation doesn't re-read and re-parse the XML on every request.
+ * A cached parse is reused as long as the file's identity (inode, size,
+ * mtime and ctime) is unchanged; updates made by the service itself drop
+ * the affected entries explicitly.
+ */
+#define ALIASSTORE_CACHE_MAX_ENTRIES   64
+
+/*
+ * A file modified this recently may be modified again without its
+ * timestamps changing, so a parse of it isn't trusted for reuse.
+ */
+#define ALIASSTORE_CACHE_RACY_SECS     2
+
+typedef struct _AliasStoreCacheEntry {
+   gchar *fileName;
+   gboolean present;             // file existed when parsed
+   gboolean stable;              // safe to reuse while identity is unchanged
+   struct stat fileStat;         // identity of the parsed file
+   int num;
+   ServiceAlias *aList;          // per-user alias file contents
+   ServiceMappedAlias *maList;   // mapping file contents
+   GHashTable *certIndex;        // cert fingerprint -> GSList of indices
+   guint64 lastUse;
+} AliasStoreCacheEntry;
+
+static GHashTable *aliasStoreCache = NULL;
+static guint64 aliasStoreCacheClock = 0;
+G_LOCK_DEFINE_STATIC(aliasStoreCache);
+
 /*
  * Alias store XML details.
  */
@@ -1509,10 +1542,11 @@ AliasCheckMapFilePerms(const gchar *fileName)
 
 /*
  ******************************************************************************
- * AliasLoadAliases --                                                   */ /**
+ * AliasParseAliasFile --                                                */ /**
  *
  * Reads and parses the Alias file for userName.
  *
+ * @param[in]   aliasFilename   The alias file of userName.
  * @param[in]   userName        The user whose store is to be loaded.
  * @param[out]  num             The number of certs read.
  * @param[out]  aList           The Aliases read.  The caller should
@@ -1524,9 +1558,10 @@ AliasCheckMapFilePerms(const gchar *fileName)
  */
 
 static VGAuthError
-AliasLoadAliases(const gchar *userName,
-                 int *num,
-                 ServiceAlias **aList)
+AliasParseAliasFile(const gchar *aliasFilename,
+                    const gchar *userName,
+                    int *num,
+                    ServiceAlias **aList)
 {
    static const GMarkupParser aliasParser = {
       AliasStartElement,
@@ -1539,7 +1574,6 @@ AliasLoadAliases(const gchar *userName,
    gboolean bRet;
    gchar *fileContents = NULL;
    gsize fileSize;
-   gchar *aliasFilename;
    AliasParseList list;
    VGAuthError err;
    GError *gErr = NULL;
@@ -1556,8 +1590,6 @@ AliasLoadAliases(const gchar *userName,
 
    context = g_markup_parse_context_new(&aliasParser, 0, &list, NULL);
 
-   aliasFilename = ServiceUserNameToAliasStoreFileName(userName);
-
    /*
     * If it's not there, then we have nothing to read.
     */
@@ -1597,7 +1629,6 @@ cleanup:
       ServiceAliasFreeAliasList(list.num, list.aList);
    }
    g_markup_parse_context_free(context);
-   g_free(aliasFilename);
    g_free(fileContents);
    return err;
 }
@@ -1846,10 +1877,11 @@ MappedEndElement(GMarkupParseContext *parseContext,
 
 /*
  ******************************************************************************
- * AliasLoadMapped --                                                    */ /**
+ * AliasParseMapFile --                                                  */ /**
  *
  * Reads and parses the mapping file.
  *
+ * @param[in]   mapFilename     The mapping file.
  * @param[out]  num             The number of entries read.
  * @param[out]  maList          The ServiceMappedAliases read.  The caller
  *                              should call ServiceAliasFreeMappedAliasList()
@@ -1861,8 +1893,9 @@ MappedEndElement(GMarkupParseContext *parseContext,
  */
 
 static VGAuthError
-AliasLoadMapped(int *num,
-                ServiceMappedAlias **maList)
+AliasParseMapFile(const gchar *mapFilename,
+                  int *num,
+                  ServiceMappedAlias **maList)
 {
    static const GMarkupParser mappedIdParser = {
       MappedStartElement,
@@ -1875,7 +1908,6 @@ AliasLoadMapped(int *num,
    gboolean bRet;
    gchar *fileContents = NULL;
    gsize fileSize;
-   gchar *mapFilename;
    MappedAliasParseList list;
    VGAuthError err;
    GError *gErr = NULL;
@@ -1892,10 +1924,6 @@ AliasLoadMapped(int *num,
 
    context = g_markup_parse_context_new(&mappedIdParser, 0, &list, NULL);
 
-   mapFilename = g_strdup_printf("%s"DIRSEP"%s",
-                                 aliasStoreRootDir,
-                                 ALIASSTORE_MAPFILE_NAME);
-
    /*
     * If its not there, then we have nothing to read.
     */
@@ -1935,13 +1963,509 @@ cleanup:
       ServiceAliasFreeMappedAliasList(list.num, list.maList);
    }
    g_markup_parse_context_free(context);
-   g_free(mapFilename);
    g_free(fileContents);
    return err;
+}
+
+/*
+ ******************************************************************************
+ * AliasCertFingerprint --                                               */ /**
+ *
+ * Computes the key used to index certificates in the alias store cache:
+ * the SHA-256 of the DER encoding, so that it is independent of the PEM
+ * headers and whitespace, just like ServiceComparePEMCerts().
+ *
+ * @param[in]   pemCert         The cert.
+ *
+ * @return The hex fingerprint, or NULL if the cert can't be decoded.
+ *         The caller should g_free() it.
+ *
+ ******************************************************************************
+ */
+
+static gchar *
+AliasCertFingerprint(const gchar *pemCert)
+{
+   gchar *cleanCert;
+   guchar *binCert;
+   gsize len = 0;
+   gchar *fingerprint = NULL;
+
+   if (NULL == pemCert) {
+      return NULL;
+   }
+
+   cleanCert = CertVerify_StripPEMCert(pemCert);
+   binCert = g_base64_decode(cleanCert, &len);
+   if (len > 0) {
+      fingerprint = g_compute_checksum_for_data(G_CHECKSUM_SHA256,
+                                                binCert, len);
+   }
+
+   g_free(cleanCert);
+   g_free(binCert);
+
+   return fingerprint;
+}
+
+
+/*
+ ******************************************************************************
+ * AliasStoreCacheIndexFree --                                           */ /**
+ *
+ * Frees a list of indices in the cert index.  Used as the GHashTable value
+ * destroy function.
+ *
+ * @param[in]   data            The GSList.
+ *
+ ******************************************************************************
+ */
+
+static void
+AliasStoreCacheIndexFree(gpointer data)
+{
+   g_slist_free((GSList *) data);
+}
+
+
+/*
+ ******************************************************************************
+ * AliasStoreCacheEntryFree --                                           */ /**
+ *
+ * Frees an alias store cache entry.  Used as the GHashTable value destroy
+ * function.
+ *
+ * @param[in]   data            The AliasStoreCacheEntry.
+ *
+ ******************************************************************************
+ */
+
+static void
+AliasStoreCacheEntryFree(gpointer data)
+{
+   AliasStoreCacheEntry *entry = (AliasStoreCacheEntry *) data;
+
+   ServiceAliasFreeAliasList(entry->aList ? entry->num : 0, entry->aList);
+   ServiceAliasFreeMappedAliasList(entry->maList ? entry->num : 0,
+                                   entry->maList);
+   if (NULL != entry->certIndex) {
+      g_hash_table_destroy(entry->certIndex);
+   }
+   g_free(entry->fileName);
+   g_free(entry);
+}
+
+
+/*
+ ******************************************************************************
+ * AliasStoreCacheBuildIndex --                                          */ /**
+ *
+ * Indexes the certificates of a freshly parsed cache entry by fingerprint.
+ *
+ * @param[in]   entry           The cache entry.
+ *
+ ******************************************************************************
+ */
+
+static void
+AliasStoreCacheBuildIndex(AliasStoreCacheEntry *entry)
+{
+   int i;
+
+   entry->certIndex = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                            g_free,
+                                            AliasStoreCacheIndexFree);
+
+   for (i = 0; i < entry->num; i++) {
+      const gchar *pemCert = (NULL != entry->aList) ?
+                             entry->aList[i].pemCert :
+                             entry->maList[i].pemCert;
+      gchar *fingerprint = AliasCertFingerprint(pemCert);
+      GSList *idxList;
+
+      if (NULL == fingerprint) {
+         Debug("%s: unable to decode cert #%d in '%s'\n", __FUNCTION__,
+               i, entry->fileName);
+         continue;
+      }
+
+      /*
+       * Appending to a non-empty list keeps its head, so only a new
+       * fingerprint needs inserting.  Lists stay in file order.
+       */
+      idxList = g_hash_table_lookup(entry->certIndex, fingerprint);
+      if (NULL != idxList) {
+         g_slist_append(idxList, GINT_TO_POINTER(i));
+         g_free(fingerprint);
+      } else {
+         g_hash_table_insert(entry->certIndex, fingerprint,
+                             g_slist_append(NULL, GINT_TO_POINTER(i)));
+      }
+   }
+}
+
+
+/*
+ ******************************************************************************
+ * AliasStoreCacheEvict --                                               */ /**
+ *
+ * Drops the least recently used entry from the alias store cache.
+ * Must be called with the cache lock held.
+ *
+ ******************************************************************************
+ */
+
+static void
+AliasStoreCacheEvict(void)
+{
+   GHashTableIter iter;
+   gpointer value;
+   AliasStoreCacheEntry *oldest = NULL;
+
+   g_hash_table_iter_init(&iter, aliasStoreCache);
+   while (g_hash_table_iter_next(&iter, NULL, &value)) {
+      AliasStoreCacheEntry *entry = (AliasStoreCacheEntry *) value;
+
+      if (NULL == oldest || entry->lastUse < oldest->lastUse) {
+         oldest = entry;
+      }
+   }
+
+   if (NULL != oldest) {
+      g_hash_table_remove(aliasStoreCache, oldest->fileName);
+   }
+}
+
+
+/*
+ ******************************************************************************
+ * AliasStoreCacheGet --                                                 */ /**
+ *
+ * Returns the parsed contents of an alias or mapping file, re-parsing
+ * the file only if it changed since it was last read.
+ * Must be called with the cache lock held; the entry is only valid
+ * until the lock is dropped.
+ *
+ * @param[in]   fileName        The file to load.
+ * @param[in]   userName        The owner of an alias file, or NULL for
+ *                              the mapping file.
+ * @param[out]  entryOut        The cache entry.
+ *
+ * @return VGAUTH_E_OK on success, VGAuthError on failure
+ *
+ ******************************************************************************
+ */
+
+static VGAuthError
+AliasStoreCacheGet(const gchar *fileName,
+                   const gchar *userName,
+                   AliasStoreCacheEntry **entryOut)
+{
+   AliasStoreCacheEntry *entry;
+   struct stat st;
+   gboolean present;
+   time_t now;
+   VGAuthError err;
+
+   *entryOut = NULL;
+
+   if (NULL == aliasStoreCache) {
+      aliasStoreCache = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                              NULL,
+                                              AliasStoreCacheEntryFree);
+   }
+
+   present = (g_lstat(fileName, &st) == 0);
+   if (!present) {
+      memset(&st, 0, sizeof st);
+   }
+
+   entry = g_hash_table_lookup(aliasStoreCache, fileName);
+   if (NULL != entry && entry->stable && entry->present == present &&
+       entry->fileStat.st_dev == st.st_dev &&
+       entry->fileStat.st_ino == st.st_ino &&
+       entry->fileStat.st_size == st.st_size &&
+       entry->fileStat.st_mtime == st.st_mtime &&
+       entry->fileStat.st_ctime == st.st_ctime) {
+      goto done;
+   }
+
+   if (NULL != entry) {
+      g_hash_table_remove(aliasStoreCache, fileName);
+   } else if (g_hash_table_size(aliasStoreCache) >=
+              ALIASSTORE_CACHE_MAX_ENTRIES) {
+      AliasStoreCacheEvict();
+   }
+
+   entry = g_malloc0(sizeof *entry);
+   entry->fileName = g_strdup(fileName);
+   entry->present = present;
+   entry->fileStat = st;
+
+   now = time(NULL);
+   entry->stable = !present ||
+                   (now - st.st_mtime >= ALIASSTORE_CACHE_RACY_SECS &&
+                    now - st.st_ctime >= ALIASSTORE_CACHE_RACY_SECS);
+
+   if (NULL == userName) {
+      err = AliasParseMapFile(fileName, &entry->num, &entry->maList);
+   } else {
+      err = AliasParseAliasFile(fileName, userName,
+                                &entry->num, &entry->aList);
+   }
+   if (VGAUTH_E_OK != err) {
+      AliasStoreCacheEntryFree(entry);
+      return err;
+   }
+
+   AliasStoreCacheBuildIndex(entry);
+   g_hash_table_insert(aliasStoreCache, entry->fileName, entry);
+
+done:
+   entry->lastUse = ++aliasStoreCacheClock;
+   *entryOut = entry;
 
    return VGAUTH_E_OK;
 }
 
+
+/*
+ ******************************************************************************
+ * AliasStoreCacheLookupCert --                                          */ /**
+ *
+ * Finds the entries of a cached file that contain a certificate.
+ * Must be called with the cache lock held.
+ *
+ * @param[in]   entry           The cache entry.
+ * @param[in]   pemCert         The cert to look for.
+ *
+ * @return A list of indices into the entry's aList or maList, owned by
+ *         the cache.
+ *
+ ******************************************************************************
+ */
+
+static GSList *
+AliasStoreCacheLookupCert(AliasStoreCacheEntry *entry,
+                          const gchar *pemCert)
+{
+   gchar *fingerprint;
+   GSList *idxList;
+
+   if (0 == entry->num) {
+      return NULL;
+   }
+
+   fingerprint = AliasCertFingerprint(pemCert);
+   if (NULL == fingerprint) {
+      return NULL;
+   }
+
+   idxList = g_hash_table_lookup(entry->certIndex, fingerprint);
+   g_free(fingerprint);
+
+   return idxList;
+}
+
+
+/*
+ ******************************************************************************
+ * AliasStoreCacheInvalidate --                                          */ /**
+ *
+ * Drops any cached contents of a file.  Called whenever the service
+ * rewrites an alias or mapping file.
+ *
+ * @param[in]   fileName        The file.
+ *
+ ******************************************************************************
+ */
+
+static void
+AliasStoreCacheInvalidate(const gchar *fileName)
+{
+   G_LOCK(aliasStoreCache);
+   if (NULL != aliasStoreCache) {
+      g_hash_table_remove(aliasStoreCache, fileName);
+   }
+   G_UNLOCK(aliasStoreCache);
+}
+
+
+/*
+ ******************************************************************************
+ * AliasCopyAlias --                                                     */ /**
+ *
+ * Copies the contents of a ServiceAlias.
+ *
+ * @param[in]   src             The source ServiceAlias.
+ * @param[out]  dst             The dest ServiceAlias.
+ *
+ ******************************************************************************
+ */
+
+static void
+AliasCopyAlias(const ServiceAlias *src,
+               ServiceAlias *dst)
+{
+   int i;
+
+   dst->pemCert = g_strdup(src->pemCert);
+   dst->num = src->num;
+   dst->infos = g_new0(ServiceAliasInfo, src->num);
+   for (i = 0; i < src->num; i++) {
+      ServiceAliasCopyAliasInfoContents(&src->infos[i], &dst->infos[i]);
+   }
+}
+
+
+/*
+ ******************************************************************************
+ * AliasCopyMappedAlias --                                               */ /**
+ *
+ * Copies the contents of a ServiceMappedAlias.
+ *
+ * @param[in]   src             The source ServiceMappedAlias.
+ * @param[out]  dst             The dest ServiceMappedAlias.
+ *
+ ******************************************************************************
+ */
+
+static void
+AliasCopyMappedAlias(const ServiceMappedAlias *src,
+                     ServiceMappedAlias *dst)
+{
+   int i;
+
+   dst->pemCert = g_strdup(src->pemCert);
+   dst->userName = g_strdup(src->userName);
+   dst->num = src->num;
+   dst->subjects = g_new0(ServiceSubject, src->num);
+   for (i = 0; i < src->num; i++) {
+      dst->subjects[i].type = src->subjects[i].type;
+      dst->subjects[i].name = g_strdup(src->subjects[i].name);
+   }
+}
+
+
+/*
+ ******************************************************************************
+ * AliasMapFileName --                                                   */ /**
+ *
+ * @return The path of the mapping file.  The caller should g_free() it.
+ *
+ ******************************************************************************
+ */
+
+static gchar *
+AliasMapFileName(void)
+{
+   return g_strdup_printf("%s"DIRSEP"%s",
+                          aliasStoreRootDir,
+                          ALIASSTORE_MAPFILE_NAME);
+}
+
+
+/*
+ ******************************************************************************
+ * AliasLoadAliases --                                                   */ /**
+ *
+ * Returns the Aliases of userName, parsing the Alias file only if it
+ * changed since it was last read.
+ *
+ * @param[in]   userName        The user whose store is to be loaded.
+ * @param[out]  num             The number of certs read.
+ * @param[out]  aList           The Aliases read.  The caller should
+ *                              call ServiceAliasFreeAliasList() when done.
+ *
+ * @return VGAUTH_E_OK on success, VGAuthError on failure
+ *
+ ******************************************************************************
+ */
+
+static VGAuthError
+AliasLoadAliases(const gchar *userName,
+                 int *num,
+                 ServiceAlias **aList)
+{
+   AliasStoreCacheEntry *entry;
+   gchar *aliasFilename;
+   VGAuthError err;
+   int i;
+
+   ASSERT(num);
+   ASSERT(aList);
+
+   *num = 0;
+   *aList = NULL;
+
+   aliasFilename = ServiceUserNameToAliasStoreFileName(userName);
+
+   G_LOCK(aliasStoreCache);
+   err = AliasStoreCacheGet(aliasFilename, userName, &entry);
+   if (VGAUTH_E_OK == err && entry->num > 0) {
+      *aList = g_new0(ServiceAlias, entry->num);
+      for (i = 0; i < entry->num; i++) {
+         AliasCopyAlias(&entry->aList[i], &(*aList)[i]);
+      }
+      *num = entry->num;
+   }
+   G_UNLOCK(aliasStoreCache);
+
+   g_free(aliasFilename);
+   return err;
+}
+
+
+/*
+ ******************************************************************************
+ * AliasLoadMapped --                                                    */ /**
+ *
+ * Returns the contents of the mapping file, parsing it only if it changed
+ * since it was last read.
+ *
+ * @param[out]  num             The number of entries read.
+ * @param[out]  maList          The ServiceMappedAliases read.  The caller
+ *                              should call ServiceAliasFreeMappedAliasList()
+ *                              when done.
+ *
+ * @return VGAUTH_E_OK on success, VGAuthError on failure
+ *
+ ******************************************************************************
+ */
+
+static VGAuthError
+AliasLoadMapped(int *num,
+                ServiceMappedAlias **maList)
+{
+   AliasStoreCacheEntry *entry;
+   gchar *mapFilename;
+   VGAuthError err;
+   int i;
+
+   ASSERT(num);
+   ASSERT(maList);
+
+   *num = 0;
+   *maList = NULL;
+
+   mapFilename = AliasMapFileName();
+
+   G_LOCK(aliasStoreCache);
+   err = AliasStoreCacheGet(mapFilename, NULL, &entry);
+   if (VGAUTH_E_OK == err && entry->num > 0) {
+      *maList = g_new0(ServiceMappedAlias, entry->num);
+      for (i = 0; i < entry->num; i++) {
+         AliasCopyMappedAlias(&entry->maList[i], &(*maList)[i]);
+      }
+      *num = entry->num;
+   }
+   G_UNLOCK(aliasStoreCache);
+
+   g_free(mapFilename);
+   return err;
+}
+
+
 /*
  ******************************************************************************
  * AliasSafeRenameFiles --                                               */ /**
@@ -1971,6 +2495,7 @@ AliasSafeRenameFiles(const gchar *srcAliasFilename,
    gchar *aliasBackupFilename = NULL;
    gchar *mapFilename = NULL;
    gchar *mapBackupFilename = NULL;
+   gboolean locked = FALSE;
 
 
    aliasFilename = ServiceUserNameToAliasStoreFileName(userName);
@@ -2016,6 +2541,14 @@ AliasSafeRenameFiles(const gchar *srcAliasFilename,
    }
 
 
+   /*
+    * Queries may be running on worker threads.  Hold the cache lock
+    * while the files are swapped, so none of them finds a store
+    * missing between the renames.
+    */
+   G_LOCK(aliasStoreCache);
+   locked = TRUE;
+
    /*
     * Back up the real files so we can recover on an error.
     */
@@ -2092,6 +2625,9 @@ restore:
    }
 
 done:
+   if (locked) {
+      G_UNLOCK(aliasStoreCache);
+   }
    g_free(aliasFilename);
    g_free(mapFilename);
    g_free(aliasBackupFilename);
@@ -2463,6 +2999,23 @@ cleanup:
    }
 
 done:
+   /*
+    * Whatever happened, the files may no longer match what's cached,
+    * and nothing verified against the old contents can be trusted.
+    */
+   {
+      gchar *fileName = ServiceUserNameToAliasStoreFileName(userName);
+
+      AliasStoreCacheInvalidate(fileName);
+      g_free(fileName);
+      if (updateMap) {
+         fileName = AliasMapFileName();
+         AliasStoreCacheInvalidate(fileName);
+         g_free(fileName);
+      }
+   }
+   ServiceVerifyFlushCaches();
+
    g_free(tmpAliasFilename);
    g_free(tmpMapFilename);
    return err;
@@ -3196,6 +3749,136 @@ ServiceAliasQueryMappedAliases(int *num,
 }
 
 
+/*
+ ******************************************************************************
+ * ServiceAliasQueryAliasByCert --                                       */ /**
+ *
+ * Looks up the alias for a certificate in userName's store.  Unlike
+ * ServiceAliasQueryAliases(), only the matching entry is copied out,
+ * and the store is searched through its cert index.
+ *
+ * @param[in]   userName        The user whose store is to be used.
+ * @param[in]   pemCert         The cert to look for.
+ * @param[out]  alias           The matching alias, or NULL if there is
+ *                              none.  The caller should call
+ *                              ServiceAliasFreeAliasList(1, alias) when done.
+ *
+ * @return VGAUTH_E_OK on success, VGAuthError on failure
+ *
+ ******************************************************************************
+ */
+
+VGAuthError
+ServiceAliasQueryAliasByCert(const gchar *userName,
+                             const gchar *pemCert,
+                             ServiceAlias **alias)
+{
+   AliasStoreCacheEntry *entry;
+   gchar *aliasFilename;
+   GSList *idxList;
+   VGAuthError err;
+
+   *alias = NULL;
+
+   if (!Usercheck_UsernameIsLegal(userName)) {
+      Warning("%s: Illegal user name '%s'\n", __FUNCTION__, userName);
+      return VGAUTH_E_FAIL;
+   }
+
+   aliasFilename = ServiceUserNameToAliasStoreFileName(userName);
+
+   G_LOCK(aliasStoreCache);
+   err = AliasStoreCacheGet(aliasFilename, userName, &entry);
+   if (VGAUTH_E_OK == err) {
+      /*
+       * Adding an existing cert merges into its alias, so there's
+       * at most one.
+       */
+      idxList = AliasStoreCacheLookupCert(entry, pemCert);
+      if (NULL != idxList) {
+         *alias = g_new0(ServiceAlias, 1);
+         AliasCopyAlias(&entry->aList[GPOINTER_TO_INT(idxList->data)],
+                        *alias);
+      }
+   }
+   G_UNLOCK(aliasStoreCache);
+
+   if (VGAUTH_E_OK != err) {
+      Warning("%s: failed to load Aliases for '%s'\n", __FUNCTION__, userName);
+   }
+
+   g_free(aliasFilename);
+   return err;
+}
+
+
+/*
+ ******************************************************************************
+ * ServiceAliasQueryMappedAliasesByCert --                               */ /**
+ *
+ * Looks up the mapping file entries for a certificate through the
+ * mapping file's cert index.
+ *
+ * @param[in]   pemCert         The cert to look for.
+ * @param[out]  numStore        If non-NULL, the total number of entries in
+ *                              the mapping file.
+ * @param[out]  num             The number of entries being returned.
+ * @param[out]  maList          The matching entries.  The caller should call
+ *                              ServiceAliasFreeMappedAliasList() when done.
+ *
+ * @return VGAUTH_E_OK on success, VGAuthError on failure
+ *
+ ******************************************************************************
+ */
+
+VGAuthError
+ServiceAliasQueryMappedAliasesByCert(const gchar *pemCert,
+                                     int *numStore,
+                                     int *num,
+                                     ServiceMappedAlias **maList)
+{
+   AliasStoreCacheEntry *entry;
+   gchar *mapFilename;
+   GSList *idxList;
+   GSList *l;
+   VGAuthError err;
+   int i;
+
+   if (NULL != numStore) {
+      *numStore = 0;
+   }
+   *num = 0;
+   *maList = NULL;
+
+   mapFilename = AliasMapFileName();
+
+   G_LOCK(aliasStoreCache);
+   err = AliasStoreCacheGet(mapFilename, NULL, &entry);
+   if (VGAUTH_E_OK == err) {
+      if (NULL != numStore) {
+         *numStore = entry->num;
+      }
+      idxList = AliasStoreCacheLookupCert(entry, pemCert);
+      if (NULL != idxList) {
+         *num = g_slist_length(idxList);
+         *maList = g_new0(ServiceMappedAlias, *num);
+         for (l = idxList, i = 0; l != NULL; l = l->next, i++) {
+            AliasCopyMappedAlias(&entry->maList[GPOINTER_TO_INT(l->data)],
+                                 &(*maList)[i]);
+         }
+      }
+   }
+   G_UNLOCK(aliasStoreCache);
+
+   if (VGAUTH_E_OK != err) {
+      Warning("%s: failed to load mapped aliases\n", __FUNCTION__);
+   }
+
+   g_free(mapFilename);
+   return err;
+}
+
+
 /*
  ******************************************************************************
  * ServiceIDVerifyStoreContents --                                       */ /**
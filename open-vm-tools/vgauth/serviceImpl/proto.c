@@ -161,6 +161,20 @@ struct ProtoRequest {
 static VGAuthError ServiceProtoValidateSamlBearerToken(ServiceConnection *conn,
                                                        ProtoRequest *req);
 
+/*
+ * Worker threads for the requests that can hold up the main loop:
+ * SAML token verification and alias store queries.  Everything else
+ * is cheap, or touches state owned by the main loop (tickets, the
+ * alias store writers, Windows pid checks), and is handled inline.
+ */
+static GThreadPool *gRequestPool = NULL;
+static int gRequestWorkerThreads = 0;
+
+typedef struct ProtoWork {
+   ServiceConnection *conn;
+   VGAuthError err;
+} ProtoWork;
+
 
 /*
  ******************************************************************************
@@ -1089,12 +1103,207 @@ Proto_ConfidenceCheckRequest(ProtoRequest *request)
 }
 
 
+/*
+ ******************************************************************************
+ * ServiceProtoWorkDone --                                               */ /**
+ *
+ * Main loop callback for a request finished by a worker thread.  Resets
+ * the parser and starts watching the connection again, or shuts it down
+ * on an error.
+ *
+ * @param[in]  data     The ProtoWork.
+ *
+ * @return FALSE, so the idle source is removed.
+ *
+ ******************************************************************************
+ */
+
+static gboolean
+ServiceProtoWorkDone(gpointer data)
+{
+   ProtoWork *work = (ProtoWork *) data;
+   ServiceConnection *conn = work->conn;
+   VGAuthError err = work->err;
+
+   g_free(work);
+   conn->busy = FALSE;
+
+   if (err == VGAUTH_E_OK) {
+      ServiceProtoCleanupParseState(conn);
+      err = ServiceConnectionResumeIO(conn);
+   }
+
+   if (err != VGAUTH_E_OK) {
+      ServiceConnectionShutdown(conn);
+   }
+
+   return FALSE;
+}
+
+
+/*
+ ******************************************************************************
+ * ServiceProtoWorkerRun --                                              */ /**
+ *
+ * Worker thread function.  Processes the connection's current request,
+ * which sends the reply, and hands the connection back to the main loop.
+ *
+ * @param[in]  data      The ProtoWork.
+ * @param[in]  userData  Unused.
+ *
+ ******************************************************************************
+ */
+
+static void
+ServiceProtoWorkerRun(gpointer data,
+                      gpointer userData)
+{
+   ProtoWork *work = (ProtoWork *) data;
+
+   work->err = ServiceProtoDispatchRequest(work->conn,
+                                           work->conn->curRequest);
+
+   g_idle_add(ServiceProtoWorkDone, work);
+}
+
+
+/*
+ ******************************************************************************
+ * ServiceProtoQueueRequest --                                           */ /**
+ *
+ * Hands a complete request to a worker thread if the pool is enabled
+ * and the request type is one worth moving off the main loop.
+ *
+ * The connection is marked busy, and its IO watch is dropped until
+ * the worker is done, so a connection never has more than one request
+ * in flight.
+ *
+ * @param[in]  conn     The ServiceConnection.
+ * @param[in]  req      Its current, complete, request.
+ *
+ * @return TRUE if the request was queued.
+ *
+ ******************************************************************************
+ */
+
+static gboolean
+ServiceProtoQueueRequest(ServiceConnection *conn,
+                         ProtoRequest *req)
+{
+   ProtoWork *work;
+   GError *gErr = NULL;
+
+   if (NULL == gRequestPool || 0 == gRequestWorkerThreads) {
+      return FALSE;
+   }
+
+   switch (req->reqType) {
+   case PROTO_REQUEST_QUERYALIASES:
+   case PROTO_REQUEST_QUERYMAPPEDALIASES:
+   case PROTO_REQUEST_VALIDATE_SAML_BEARER_TOKEN:
+      break;
+   default:
+      return FALSE;
+   }
+
+   work = g_new0(ProtoWork, 1);
+   work->conn = conn;
+
+   conn->busy = TRUE;
+   if (!g_thread_pool_push(gRequestPool, work, &gErr)) {
+      Warning("%s: g_thread_pool_push() failed: %s\n",
+              __FUNCTION__, gErr->message);
+      g_error_free(gErr);
+      conn->busy = FALSE;
+      g_free(work);
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/*
+ ******************************************************************************
+ * ServiceProtoInitWorkers --                                            */ /**
+ *
+ * Creates the request worker pool, or resizes it on a pref reload.
+ * A size of 0 processes every request on the main loop.
+ *
+ * Windows requests always stay on the main loop.
+ *
+ ******************************************************************************
+ */
+
+void
+ServiceProtoInitWorkers(void)
+{
+#ifndef _WIN32
+   GError *gErr = NULL;
+   int numThreads;
+
+   numThreads = Pref_GetInt(gPrefs,
+                            VGAUTH_PREF_REQUEST_WORKER_THREADS,
+                            VGAUTH_PREF_GROUP_NAME_SERVICE,
+                            VGAUTH_PREF_DEFAULT_REQUEST_WORKER_THREADS);
+   if (numThreads < 0) {
+      Warning("%s: invalid worker thread count %d; using %d\n",
+              __FUNCTION__, numThreads,
+              VGAUTH_PREF_DEFAULT_REQUEST_WORKER_THREADS);
+      numThreads = VGAUTH_PREF_DEFAULT_REQUEST_WORKER_THREADS;
+   }
+
+   if (numThreads > 0) {
+      if (NULL == gRequestPool) {
+         gRequestPool = g_thread_pool_new(ServiceProtoWorkerRun, NULL,
+                                          numThreads, FALSE, &gErr);
+         if (NULL == gRequestPool) {
+            Warning("%s: g_thread_pool_new() failed: %s\n",
+                    __FUNCTION__, gErr->message);
+            g_error_free(gErr);
+            numThreads = 0;
+         }
+      } else if (!g_thread_pool_set_max_threads(gRequestPool, numThreads,
+                                                &gErr)) {
+         Warning("%s: g_thread_pool_set_max_threads() failed: %s\n",
+                 __FUNCTION__, gErr->message);
+         g_error_free(gErr);
+      }
+   }
+
+   gRequestWorkerThreads = numThreads;
+   Log("%s: using %d request worker threads\n", __FUNCTION__, numThreads);
+#endif
+}
+
+
+/*
+ ******************************************************************************
+ * ServiceProtoShutdownWorkers --                                        */ /**
+ *
+ * Waits for any queued or running requests and frees the worker pool.
+ *
+ ******************************************************************************
+ */
+
+void
+ServiceProtoShutdownWorkers(void)
+{
+   if (NULL != gRequestPool) {
+      g_thread_pool_free(gRequestPool, FALSE, TRUE);
+      gRequestPool = NULL;
+   }
+   gRequestWorkerThreads = 0;
+}
+
+
 /*
  ******************************************************************************
  * ServiceProtoReadAndProcessRequest --                                  */ /**
  *
  * Called when data is ready to be read from a client.  Reads that data,
  * parses it, and if it completes a request, process that request.
+ * Some requests are handed to a worker thread; conn->busy is set then.
  *
  * @param[in]  conn                 The ServiceConnection.
  *
@@ -1172,6 +1381,14 @@ ServiceProtoReadAndProcessRequest(ServiceConnection *conn)
          Warning("%s: request confidence check failed\n", __FUNCTION__);
       }
 
+      /*
+       * Expensive requests go to a worker thread, which sends the
+       * reply; parser cleanup waits for it in ServiceProtoWorkDone().
+       */
+      if (err == VGAUTH_E_OK && ServiceProtoQueueRequest(conn, req)) {
+         goto quit;
+      }
+
       // only try to handle it if the confidence check passed
       if (err == VGAUTH_E_OK) {
          err = ServiceProtoDispatchRequest(conn, req);
@@ -48,11 +48,13 @@
 #include "vmxlog.h"
 
 /*
- * XXX
+ * Token cache.
  *
- * Optimization idea: stash a hash (SHA512) of a valid token, and bypass
- * the full assertion process when we see that token again. The expiration
- * date of the token must also be saved off (and beware the time skew issue).
+ * A SHA512 hash of each valid token is stashed, and the full assertion
+ * process (parse, schema validation, signature check) is bypassed when
+ * the same token is seen again.  The entry expires at the earliest
+ * NotOnOrAfter the token was checked against, including the clock skew
+ * allowance, and never lives longer than SAML_TOKEN_CACHE_MAX_LIFETIME_SECS.
  *
  * Note that there's some extra complexity here:
  *
@@ -61,23 +63,37 @@
  * 3 - RemoveAlias removes the combo
  * 4 - the cached token still works
  *
- * So the cache should only bypass the token validation, not the certificate
- * check in ServiceVerifyAndCheckTrustCertChainForSubject()
+ * So the cache only bypasses the token validation, not the certificate
+ * check in ServiceVerifyAndCheckTrustCertChainForSubject(), and any
+ * alias store change flushes it anyway.
  *
- * Also TBD is how much this buys us in the real world.  With short
- * token lifetimes, its less interesting.  Its also possible that
- * it will have no measureable affect because the token verification
- * will be lost in the noise of the API plumbing from VC->hostd->VMX->tools.
+ * Tokens with a OneTimeUse condition are never cached.
  *
  * The security folks have signed off on this, so long as we store only
  * in memory.
- *
  */
+#define SAML_TOKEN_CACHE_MAX_LIFETIME_SECS   (10 * 60)
+
+typedef struct SAMLTokenCacheEntry {
+   gboolean hostVerified;     // signature check was skipped
+   gint64 expireTime;         // seconds since the epoch
+   gchar *subject;
+   int numCerts;
+   gchar **certChain;
+} SAMLTokenCacheEntry;
 
 static int gClockSkewAdjustment = VGAUTH_PREF_DEFAULT_CLOCK_SKEW_SECS;
 static gboolean gAllowUnrelatedCerts = FALSE;
 static xmlSchemaPtr gParsedSchemas = NULL;
-static xmlSchemaValidCtxtPtr gSchemaValidateCtx = NULL;
+/*
+ * Tokens are verified by request worker threads.  The parsed schema is
+ * read-only during validation, so each token gets its own validation
+ * context, and reloading the schema and catalog takes the write lock.
+ */
+static GRWLock gSchemaLock;
+static GHashTable *gTokenCache = NULL;     // token digest -> entry
+static int gTokenCacheSize = VGAUTH_PREF_DEFAULT_SAML_TOKEN_CACHE_SIZE;
+G_LOCK_DEFINE_STATIC(gTokenCache);
 
 #define CATALOG_FILENAME            "catalog.xml"
 #define SAML_SCHEMA_FILENAME        "saml-schema-assertion-2.0.xsd"
@@ -276,20 +292,6 @@ LoadCatalogAndSchema(void)
       goto done;
    }
 
-   /*
-    * Set up the validaton context for later use.
-    */
-   gSchemaValidateCtx = xmlSchemaNewValidCtxt(gParsedSchemas);
-   if (NULL == gSchemaValidateCtx) {
-      g_warning("Failed to create schema validation context\n");
-      retVal = FALSE;
-      goto done;
-   }
-   xmlSchemaSetValidErrors(gSchemaValidateCtx,
-                           XmlErrorHandler,
-                           XmlErrorHandler,
-                           NULL);
-
    retVal = TRUE;
 done:
    if (NULL != ctx) {
@@ -315,10 +317,6 @@ done:
 static void
 FreeSchemas(void)
 {
-   if (NULL != gSchemaValidateCtx) {
-      xmlSchemaFreeValidCtxt(gSchemaValidateCtx);
-      gSchemaValidateCtx = NULL;
-   }
    if (NULL != gParsedSchemas) {
       xmlSchemaFree(gParsedSchemas);
       gParsedSchemas = NULL;
@@ -347,6 +345,19 @@ LoadPrefs(void)
                                         VGAUTH_PREF_ALLOW_UNRELATED_CERTS,
                                         VGAUTH_PREF_GROUP_NAME_SERVICE,
                                         FALSE);
+
+   /*
+    * Anything cached was verified under the old settings.
+    */
+   G_LOCK(gTokenCache);
+   gTokenCacheSize = Pref_GetInt(gPrefs, VGAUTH_PREF_SAML_TOKEN_CACHE_SIZE,
+                                 VGAUTH_PREF_GROUP_NAME_SERVICE,
+                                 VGAUTH_PREF_DEFAULT_SAML_TOKEN_CACHE_SIZE);
+   gTokenCacheSize = MAX(gTokenCacheSize, 0);
+   if (NULL != gTokenCache) {
+      g_hash_table_remove_all(gTokenCache);
+   }
+   G_UNLOCK(gTokenCache);
 }
 
 
@@ -365,6 +376,7 @@ VGAuthError
 SAML_Init(void)
 {
    int ret;
+   gboolean bRet;
 
    /*
     * Init the xml parser
@@ -383,7 +395,10 @@ SAML_Init(void)
    /*
     * Load schemas
     */
-   if (!LoadCatalogAndSchema()) {
+   g_rw_lock_writer_lock(&gSchemaLock);
+   bRet = LoadCatalogAndSchema();
+   g_rw_lock_writer_unlock(&gSchemaLock);
+   if (!bRet) {
       g_warning("Failed to load schemas\n");
       return VGAUTH_E_FAIL;
    }
@@ -474,7 +489,17 @@ SAML_Init(void)
 void
 SAML_Shutdown()
 {
+   g_rw_lock_writer_lock(&gSchemaLock);
    FreeSchemas();
+   g_rw_lock_writer_unlock(&gSchemaLock);
+
+   G_LOCK(gTokenCache);
+   if (NULL != gTokenCache) {
+      g_hash_table_destroy(gTokenCache);
+      gTokenCache = NULL;
+   }
+   G_UNLOCK(gTokenCache);
+
    xmlSecCryptoShutdown();
    xmlSecCryptoAppShutdown();
    xmlSecShutdown();
@@ -503,9 +528,12 @@ SAML_Shutdown()
 void
 SAML_Reload()
 {
-   FreeSchemas();
    LoadPrefs();
+
+   g_rw_lock_writer_lock(&gSchemaLock);
+   FreeSchemas();
    LoadCatalogAndSchema();
+   g_rw_lock_writer_unlock(&gSchemaLock);
 }
 
 
@@ -545,6 +573,214 @@ SAML_FreeCertArray(int num,
 }
 
 
+/*
+ ******************************************************************************
+ * CopyCertArray --                                                      */ /**
+ *
+ * Copies a simple array of pemCert.
+ *
+ * @param[in]  num      Number of certs in array.
+ * @param[in]  certs    Array of certs to copy.
+ *
+ * @return The copy.  Free with FreeCertArray().
+ *
+ ******************************************************************************
+ */
+
+static gchar **
+CopyCertArray(int num,
+              gchar **certs)
+{
+   gchar **copy = g_new0(gchar *, num);
+   int i;
+
+   for (i = 0; i < num; i++) {
+      copy[i] = g_strdup(certs[i]);
+   }
+   return copy;
+}
+
+
+/*
+ ******************************************************************************
+ * TokenCacheEntryFree --                                                */ /**
+ *
+ * Frees a token cache entry.  Used as the GHashTable value destroy function.
+ *
+ * @param[in]  data     The SAMLTokenCacheEntry.
+ *
+ ******************************************************************************
+ */
+
+static void
+TokenCacheEntryFree(gpointer data)
+{
+   SAMLTokenCacheEntry *entry = (SAMLTokenCacheEntry *) data;
+
+   g_free(entry->subject);
+   FreeCertArray(entry->numCerts, entry->certChain);
+   g_free(entry);
+}
+
+
+/*
+ ******************************************************************************
+ * TokenCacheLookup --                                                   */ /**
+ *
+ * Looks for a previously verified token.  A token verified with the
+ * signature check skipped only satisfies requests that skip it too.
+ *
+ * @param[in]  digest        The token digest.
+ * @param[in]  hostVerified  If the signature check is being skipped.
+ * @param[out] subject       Subject of SAML token,  Caller must g_free().
+ * @param[out] numCerts      Number of certs in the token.
+ * @param[out] certChain     Certs in the token. Caller should g_free()
+ *                           array and contents.
+ *
+ * @return TRUE if the token was found.
+ *
+ ******************************************************************************
+ */
+
+static gboolean
+TokenCacheLookup(const gchar *digest,
+                 gboolean hostVerified,
+                 gchar **subject,
+                 int *numCerts,
+                 gchar ***certChain)
+{
+   SAMLTokenCacheEntry *entry;
+   gboolean found = FALSE;
+
+   G_LOCK(gTokenCache);
+   if (NULL == gTokenCache) {
+      goto done;
+   }
+
+   entry = g_hash_table_lookup(gTokenCache, digest);
+   if (NULL == entry) {
+      goto done;
+   }
+   if (g_get_real_time() / G_USEC_PER_SEC >= entry->expireTime) {
+      g_hash_table_remove(gTokenCache, digest);
+      goto done;
+   }
+   if (entry->hostVerified && !hostVerified) {
+      goto done;
+   }
+
+   if (NULL != subject) {
+      *subject = g_strdup(entry->subject);
+   }
+   *numCerts = entry->numCerts;
+   *certChain = CopyCertArray(entry->numCerts, entry->certChain);
+   found = TRUE;
+
+done:
+   G_UNLOCK(gTokenCache);
+   return found;
+}
+
+
+/*
+ ******************************************************************************
+ * TokenCacheAdd --                                                      */ /**
+ *
+ * Remembers a verified token.  If the cache is full, expired entries are
+ * dropped first, then the one closest to expiring.
+ *
+ * @param[in]  digest        The token digest.
+ * @param[in]  hostVerified  If the signature check was skipped.
+ * @param[in]  expireTime    When the token stops being valid.
+ * @param[in]  subject       Subject of SAML token.
+ * @param[in]  numCerts      Number of certs in the token.
+ * @param[in]  certChain     Certs in the token.
+ *
+ ******************************************************************************
+ */
+
+static void
+TokenCacheAdd(const gchar *digest,
+              gboolean hostVerified,
+              gint64 expireTime,
+              const gchar *subject,
+              int numCerts,
+              gchar **certChain)
+{
+   gint64 now = g_get_real_time() / G_USEC_PER_SEC;
+   SAMLTokenCacheEntry *entry;
+   GHashTableIter iter;
+   gpointer key;
+   gpointer value;
+   gpointer oldestKey;
+   gint64 oldest;
+
+   expireTime = MIN(expireTime, now + SAML_TOKEN_CACHE_MAX_LIFETIME_SECS);
+   if (expireTime <= now) {
+      return;
+   }
+
+   G_LOCK(gTokenCache);
+   if (0 == gTokenCacheSize) {
+      goto done;
+   }
+   if (NULL == gTokenCache) {
+      gTokenCache = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                          g_free, TokenCacheEntryFree);
+   }
+
+   if (g_hash_table_size(gTokenCache) >= (guint) gTokenCacheSize) {
+      oldestKey = NULL;
+      oldest = 0;
+      g_hash_table_iter_init(&iter, gTokenCache);
+      while (g_hash_table_iter_next(&iter, &key, &value)) {
+         gint64 t = ((SAMLTokenCacheEntry *) value)->expireTime;
+
+         if (t <= now) {
+            g_hash_table_iter_remove(&iter);
+         } else if (NULL == oldestKey || t < oldest) {
+            oldestKey = key;
+            oldest = t;
+         }
+      }
+      if (g_hash_table_size(gTokenCache) >= (guint) gTokenCacheSize) {
+         g_hash_table_remove(gTokenCache, oldestKey);
+      }
+   }
+
+   entry = g_new0(SAMLTokenCacheEntry, 1);
+   entry->hostVerified = hostVerified;
+   entry->expireTime = expireTime;
+   entry->subject = g_strdup(subject);
+   entry->numCerts = numCerts;
+   entry->certChain = CopyCertArray(numCerts, certChain);
+   g_hash_table_replace(gTokenCache, g_strdup(digest), entry);
+
+done:
+   G_UNLOCK(gTokenCache);
+}
+
+
+/*
+ ******************************************************************************
+ * SAML_FlushTokenCache --                                               */ /**
+ *
+ * Forgets all previously verified tokens.
+ *
+ ******************************************************************************
+ */
+
+void
+SAML_FlushTokenCache(void)
+{
+   G_LOCK(gTokenCache);
+   if (NULL != gTokenCache) {
+      g_hash_table_remove_all(gTokenCache);
+   }
+   G_UNLOCK(gTokenCache);
+}
+
+
 /*
  ******************************************************************************
  * FindAttrValue --                                                      */ /**
@@ -734,6 +970,7 @@ FindAllNodesByName(xmlNodePtr root,
  * ValidateDoc --                                                        */ /**
  *
  * Validates the XML document against the schema.
+ * Must be called with gSchemaLock held for reading.
  *
  * @param[in]  doc         Parsed XML document.
  *
@@ -743,13 +980,31 @@ FindAllNodesByName(xmlNodePtr root,
 static gboolean
 ValidateDoc(xmlDocPtr doc)
 {
+   xmlSchemaValidCtxtPtr validateCtx;
    int ret;
 
-   ret = xmlSchemaValidateDoc(gSchemaValidateCtx, doc);
+   if (NULL == gParsedSchemas) {
+      g_warning("No schemas loaded\n");
+      return FALSE;
+   }
+
+   validateCtx = xmlSchemaNewValidCtxt(gParsedSchemas);
+   if (NULL == validateCtx) {
+      g_warning("Failed to create schema validation context\n");
+      return FALSE;
+   }
+   xmlSchemaSetValidErrors(validateCtx,
+                           XmlErrorHandler,
+                           XmlErrorHandler,
+                           NULL);
+
+   ret = xmlSchemaValidateDoc(validateCtx, doc);
    if (ret < 0) {
       g_warning("Failed to validate doc against schema\n");
    }
 
+   xmlSchemaFreeValidCtxt(validateCtx);
+
    return (ret == 0) ? TRUE : FALSE;
 }
 
@@ -765,6 +1020,8 @@ ValidateDoc(xmlDocPtr doc)
  * @param[in]  attrName     The name of the attribute.
  * @param[in]  notBefore    Whether the condition given by the attribute
  *                          should be in the past or 'now' (TRUE).
+ * @param[in,out] expireTime  Optional; for an expiration attribute, lowered
+ *                            to the last second the attribute allows.
  *
  ******************************************************************************
  */
@@ -772,7 +1029,8 @@ ValidateDoc(xmlDocPtr doc)
 static gboolean
 CheckTimeAttr(const xmlNodePtr node,
               const gchar *attrName,
-              gboolean notBefore)
+              gboolean notBefore,
+              gint64 *expireTime)
 {
    xmlChar *timeAttr;
    GTimeVal attrTime;
@@ -829,6 +1087,11 @@ CheckTimeAttr(const xmlNodePtr node,
       goto done;
    }
 
+   if (!notBefore && NULL != expireTime) {
+      *expireTime = MIN(*expireTime,
+                        (gint64) attrTime.tv_sec + gClockSkewAdjustment);
+   }
+
    retVal = TRUE;
 
 done:
@@ -895,6 +1158,8 @@ CheckAudience(const xmlChar *audience)
  * @param[in]     doc         The parsed SAML token.
  * @param[out]    subjectRet  The Subject NameId.  Should be g_free()d by
  *                            caller.
+ * @param[in,out] expireTime  Lowered to when the accepted
+ *                            SubjectConfirmation expires.
  *
  * @return TRUE if the conditions in at least one SubjectConfirmation is met,
  *         FALSE otherwise.
@@ -904,7 +1169,8 @@ CheckAudience(const xmlChar *audience)
 
 static gboolean
 VerifySubject(xmlDocPtr doc,
-              gchar **subjectRet)
+              gchar **subjectRet,
+              gint64 *expireTime)
 {
    xmlNodePtr subjNode;
    xmlNodePtr nameIDNode;
@@ -942,6 +1208,7 @@ VerifySubject(xmlDocPtr doc,
    for (child = subjNode->children; child != NULL; child = child->next) {
       xmlChar *method;
       xmlNodePtr subjConfirmData;
+      gint64 confirmExpireTime = *expireTime;
 
       if (child->type == XML_ELEMENT_NODE) {
          if (!xmlStrEqual(child->name, "SubjectConfirmation")) {
@@ -965,8 +1232,9 @@ VerifySubject(xmlDocPtr doc,
          if (NULL != subjConfirmData) {
             xmlChar *recipient;
 
-            if (!CheckTimeAttr(subjConfirmData, "NotBefore", TRUE) ||
-                !CheckTimeAttr(subjConfirmData, "NotOnOrAfter", FALSE)) {
+            if (!CheckTimeAttr(subjConfirmData, "NotBefore", TRUE, NULL) ||
+                !CheckTimeAttr(subjConfirmData, "NotOnOrAfter", FALSE,
+                               &confirmExpireTime)) {
                g_warning("%s: subjConfirmData time check failed\n",
                          __FUNCTION__);
                continue;
@@ -988,6 +1256,7 @@ VerifySubject(xmlDocPtr doc,
          /*
           * passed all the checks, we have a match so kick out
           */
+         *expireTime = confirmExpireTime;
          validSubjectFound = TRUE;
          break;
       }
@@ -1019,7 +1288,9 @@ done:
  *       </saml:AudienceRestriction>
  *    </saml:Conditions>
  *
- * @param[in]  doc  The parsed SAML token.
+ * @param[in]     doc         The parsed SAML token.
+ * @param[in,out] expireTime  Lowered to when the conditions expire, or set
+ *                            to 0 if the token must not be cached.
  *
  * @return TRUE if the conditions are met; FALSE otherwise.
  *
@@ -1027,7 +1298,8 @@ done:
  */
 
 static gboolean
-VerifyConditions(xmlDocPtr doc)
+VerifyConditions(xmlDocPtr doc,
+                 gint64 *expireTime)
 {
    xmlNodePtr condNode;
 
@@ -1042,8 +1314,8 @@ VerifyConditions(xmlDocPtr doc)
       return TRUE;
    }
 
-   if (!CheckTimeAttr(condNode, "NotBefore", TRUE) ||
-       !CheckTimeAttr(condNode, "NotOnOrAfter", FALSE)) {
+   if (!CheckTimeAttr(condNode, "NotBefore", TRUE, NULL) ||
+       !CheckTimeAttr(condNode, "NotOnOrAfter", FALSE, expireTime)) {
       g_warning("%s: Time Conditions failed!\n", __FUNCTION__);
       return FALSE;
    }
@@ -1072,16 +1344,14 @@ VerifyConditions(xmlDocPtr doc)
     * Our SSO server doesn't set it, so no point in checking it.
     */
 
-#if 0
-   // TODO nothing looks at this
    /*
-    * <OneTimeUse> element is specified to disallow caching. We don't
-    * cache, so it doesn't affect our validation.
-    * However, we need to communicate it to clients so they do not cache.
+    * <OneTimeUse> element is specified to disallow caching, so keep such
+    * a token out of the token cache.
+    * XXX We should also communicate it to clients so they do not cache.
     */
-   oneTimeUse = (FindChildByName(condNode, "OneTimeUse")
-                       != NULL);
-#endif
+   if (FindNodeByName(condNode, "OneTimeUse") != NULL) {
+      *expireTime = 0;
+   }
 
    /*
     * <ProxyRestriction> only applies if a service wants to make their own
@@ -1412,6 +1682,7 @@ SAML_VerifySignature(xmlDocPtr doc,
  *
  * Verifies a XML text as a SAML token.
  * Parses the XML, then verifies Subject, Conditions and Signature.
+ * The result is remembered in the token cache until the token expires.
  *
  * @param[in]  token         Text of SAML token.
  * @param[in]  hostVerfied   If true, the signature check can be skipped.
@@ -1435,6 +1706,27 @@ VerifySAMLToken(const gchar *token,
    xmlDocPtr doc = NULL;
    int retCode = FALSE;
    gboolean bRet;
+   gchar *digest;
+   gchar *subjectVal = NULL;
+   gint64 expireTime = G_MAXINT64;
+
+   if (NULL != subject) {
+      *subject = NULL;
+   }
+
+   digest = g_compute_checksum_for_string(G_CHECKSUM_SHA512, token, -1);
+   if (TokenCacheLookup(digest, hostVerified, subject, numCerts, certChain)) {
+      g_debug("%s: token previously verified\n", __FUNCTION__);
+      g_free(digest);
+      return TRUE;
+   }
+
+   /*
+    * Parsing can pull in the DTD through the catalog, so hold the
+    * schema lock until the doc is validated.
+    */
+   g_rw_lock_reader_lock(&gSchemaLock);
+
    /*
     * If we want to set extra options, use this path.
     */
@@ -1464,17 +1756,19 @@ VerifySAMLToken(const gchar *token,
                        XML_PARSE_NOENT | XML_PARSE_DTDATTR | XML_PARSE_DTDLOAD);
 #endif
    if ((NULL == doc) || (xmlDocGetRootElement(doc) == NULL)) {
+      g_rw_lock_reader_unlock(&gSchemaLock);
       g_warning("Failed to parse document\n");
       goto done;
    }
 
    bRet = ValidateDoc(doc);
+   g_rw_lock_reader_unlock(&gSchemaLock);
    if (FALSE == bRet) {
       g_warning("Failed to validate token against schema\n");
       goto done;
    }
 
-   bRet = VerifySubject(doc, subject);
+   bRet = VerifySubject(doc, &subjectVal, &expireTime);
 #ifndef TEST_VERIFY_SIGN_ONLY
    if (FALSE == bRet) {
       g_warning("Failed to verify Subject node\n");
@@ -1482,7 +1776,7 @@ VerifySAMLToken(const gchar *token,
    }
 #endif
 
-   bRet = VerifyConditions(doc);
+   bRet = VerifyConditions(doc, &expireTime);
 #ifndef TEST_VERIFY_SIGN_ONLY
    if (FALSE == bRet) {
       g_warning("Failed to verify Conditions\n");
@@ -1499,17 +1793,24 @@ VerifySAMLToken(const gchar *token,
       goto done;
    }
 
+#ifndef TEST_VERIFY_SIGN_ONLY
+   TokenCacheAdd(digest, hostVerified, expireTime,
+                 subjectVal, *numCerts, *certChain);
+#endif
+
    retCode = TRUE;
+   if (NULL != subject) {
+      *subject = subjectVal;
+      subjectVal = NULL;
+   }
 done:
 #if PARSE_WITH_OPTIONS
    if (NULL != parseCtx) {
       xmlFreeParserCtxt(parseCtx);
    }
 #endif
-   if (!retCode && (NULL != subject)) {
-      g_free(*subject);
-      *subject = NULL;
-   }
+   g_free(subjectVal);
+   g_free(digest);
    if (doc) {
       xmlFreeDoc(doc);
    }
@@ -34,6 +34,7 @@
 
 static ServiceStartListeningForIOFunc startListeningIOFunc = NULL;
 static ServiceStopListeningForIOFunc stopListeningIOFunc = NULL;
+static ServiceResumeIOFunc resumeIOFunc = NULL;
 
 static GHashTable *listenConnectionMap = NULL;
 
@@ -114,6 +115,9 @@ ServiceConnectionGetNextConnectionId(void)
  *                              listening for IO on a connection.
  * @param[in]   stopFunc        The function called when we no longer
  *                              care about IO on a connection.
+ * @param[in]   resumeFunc      The function called to start watching a
+ *                              data connection again after a request
+ *                              finished off the main loop.
  *
  * @return VGAUTH_E_OK on success, VGAuthError on failure
  *
@@ -122,10 +126,12 @@ ServiceConnectionGetNextConnectionId(void)
 
 VGAuthError
 ServiceRegisterIOFunctions(ServiceStartListeningForIOFunc startFunc,
-                           ServiceStopListeningForIOFunc stopFunc)
+                           ServiceStopListeningForIOFunc stopFunc,
+                           ServiceResumeIOFunc resumeFunc)
 {
    startListeningIOFunc = startFunc;
    stopListeningIOFunc = stopFunc;
+   resumeIOFunc = resumeFunc;
 
    return VGAUTH_E_OK;
 }
@@ -445,6 +451,29 @@ ServiceConnectionShutdown(ServiceConnection *conn)
 }
 
 
+/*
+ ******************************************************************************
+ * ServiceConnectionResumeIO --                                          */ /**
+ *
+ * Starts watching for input on a data connection again, once the
+ * request that was handed to a worker thread has been answered.
+ *
+ * @param[in]   conn          The ServiceConnection.
+ *
+ * @return VGAUTH_E_OK on success, VGAuthError on failure
+ *
+ ******************************************************************************
+ */
+
+VGAuthError
+ServiceConnectionResumeIO(ServiceConnection *conn)
+{
+   ASSERT(resumeIOFunc);
+
+   return (* resumeIOFunc) (conn);
+}
+
+
 /*
  ******************************************************************************
  * ServiceHashConnectionShutdown --                                      */ /**
@@ -793,6 +822,8 @@ Service_ReloadPrefs(void)
 {
    ServiceInitTicketPrefs();
    ServiceInitListenConnectionPrefs();
+   ServiceInitVerifyPrefs();
+   ServiceProtoInitWorkers();
    SAML_Reload();
 }
 
@@ -809,6 +840,7 @@ Service_ReloadPrefs(void)
 void
 Service_Shutdown(void)
 {
+   ServiceProtoShutdownWorkers();
    SAML_Shutdown();
 }
 
@@ -149,6 +149,13 @@ typedef struct _ServiceConnection {
     */
    GTimeVal lastUse;
    gboolean dataConnectionIncremented;
+
+   /*
+    * Set while a worker thread owns the current request.  No input is
+    * watched for until the reply is sent, which keeps requests on a
+    * connection in order.
+    */
+   gboolean busy;
 } ServiceConnection;
 
 
@@ -261,9 +268,11 @@ gboolean ServiceNetworkIsConnectionPrivateSuperUser(ServiceConnection *conn);
  */
 typedef VGAuthError (* ServiceStartListeningForIOFunc)(ServiceConnection *conn);
 typedef VGAuthError (* ServiceStopListeningForIOFunc)(ServiceConnection *conn);
+typedef VGAuthError (* ServiceResumeIOFunc)(ServiceConnection *conn);
 
 VGAuthError ServiceRegisterIOFunctions(ServiceStartListeningForIOFunc startFunc,
-                                       ServiceStopListeningForIOFunc stopFunc);
+                                       ServiceStopListeningForIOFunc stopFunc,
+                                       ServiceResumeIOFunc resumeFunc);
 
 
 /*
@@ -325,6 +334,15 @@ VGAuthError ServiceAliasQueryAliases(const gchar *userName,
 VGAuthError ServiceAliasQueryMappedAliases(int *num,
                                            ServiceMappedAlias **maList);
 
+VGAuthError ServiceAliasQueryAliasByCert(const gchar *userName,
+                                         const gchar *pemCert,
+                                         ServiceAlias **alias);
+
+VGAuthError ServiceAliasQueryMappedAliasesByCert(const gchar *pemCert,
+                                                 int *numStore,
+                                                 int *num,
+                                                 ServiceMappedAlias **maList);
+
 void ServiceAliasFreeAliasList(int num, ServiceAlias *aList);
 
 void ServiceAliasFreeAliasInfo(ServiceAliasInfo *ai);
@@ -350,6 +368,8 @@ gboolean ServiceComparePEMCerts(const gchar *pemCert1,
  */
 void ServiceConnectionShutdown(ServiceConnection *conn);
 
+VGAuthError ServiceConnectionResumeIO(ServiceConnection *conn);
+
 VGAuthError ServiceConnectionClone(ServiceConnection *parent,
                                    ServiceConnection **clone);       // OUT
 
@@ -369,6 +389,10 @@ VGAuthError ServiceProtoDispatchRequest(ServiceConnection *conn,
 
 void ServiceProtoCleanupParseState(ServiceConnection *conn);
 
+void ServiceProtoInitWorkers(void);
+
+void ServiceProtoShutdownWorkers(void);
+
 VGAuthError ServiceStartUserConnection(const char *userName,
                                        char **pipeName);       // OUT
 
@@ -473,6 +497,8 @@ VGAuthError ServiceVerifyAndCheckTrustCertChainForSubject(int numCerts,
 
 
 VGAuthError ServiceInitVerify(void);
+void ServiceInitVerifyPrefs(void);
+void ServiceVerifyFlushCaches(void);
 
 
 void Service_ReloadPrefs(void);
@@ -505,6 +531,7 @@ VGAuthError SAML_VerifyBearerTokenAndChain(const char *xmlText,
 
 void SAML_Shutdown(void);
 void SAML_Reload(void);
+void SAML_FlushTokenCache(void);
 
 void ServiceFreeValidationResultsData(ServiceValidationResultsData *samlData);
 
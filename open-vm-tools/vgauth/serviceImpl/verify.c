@@ -29,6 +29,19 @@
 #include "certverify.h"
 #include "vmxlog.h"
 
+/*
+ * Successfully verified cert chains are remembered, keyed by a digest of
+ * the leaf, untrusted and trusted certs, so repeated requests with the
+ * same token don't redo the X509 verification.  An entry lives until the
+ * first cert of the chain expires, but no longer than this.
+ */
+#define VERIFY_CHAIN_CACHE_MAX_LIFETIME_SECS   (10 * 60)
+
+static GHashTable *gChainCache = NULL;     // digest -> gint64 expire time
+static int gChainCacheSize = VGAUTH_PREF_DEFAULT_SAML_TOKEN_CACHE_SIZE;
+G_LOCK_DEFINE_STATIC(gChainCache);
+
+
 /*
  ******************************************************************************
  * ServiceInitVerify --                                                 */ /**
@@ -45,10 +58,213 @@ ServiceInitVerify(void)
 {
 
    CertVerify_Init();
+   ServiceInitVerifyPrefs();
    return SAML_Init();
 }
 
 
+/*
+ ******************************************************************************
+ * ServiceInitVerifyPrefs --                                             */ /**
+ *
+ * Loads the preferences used by the verification code, dropping anything
+ * cached under the old settings.
+ *
+ ******************************************************************************
+ */
+
+void
+ServiceInitVerifyPrefs(void)
+{
+   int size = Pref_GetInt(gPrefs, VGAUTH_PREF_SAML_TOKEN_CACHE_SIZE,
+                          VGAUTH_PREF_GROUP_NAME_SERVICE,
+                          VGAUTH_PREF_DEFAULT_SAML_TOKEN_CACHE_SIZE);
+
+   G_LOCK(gChainCache);
+   gChainCacheSize = MAX(size, 0);
+   if (NULL != gChainCache) {
+      g_hash_table_remove_all(gChainCache);
+   }
+   G_UNLOCK(gChainCache);
+}
+
+
+/*
+ ******************************************************************************
+ * ServiceVerifyFlushCaches --                                           */ /**
+ *
+ * Forgets all verified tokens and cert chains.  Called whenever the
+ * alias store changes, so that a removed alias can't keep authenticating.
+ *
+ ******************************************************************************
+ */
+
+void
+ServiceVerifyFlushCaches(void)
+{
+   G_LOCK(gChainCache);
+   if (NULL != gChainCache) {
+      g_hash_table_remove_all(gChainCache);
+   }
+   G_UNLOCK(gChainCache);
+
+   SAML_FlushTokenCache();
+}
+
+
+/*
+ ******************************************************************************
+ * VerifyChainDigest --                                                  */ /**
+ *
+ * Computes the chain cache key for a cert chain.
+ *
+ * @param[in]  leafCert      The leaf cert.
+ * @param[in]  numUntrusted  The number of untrusted certs.
+ * @param[in]  untrusted     The untrusted certs.
+ * @param[in]  numTrusted    The number of trusted certs.
+ * @param[in]  trusted       The trusted certs.
+ *
+ * @return The hex digest.  The caller should g_free() it.
+ *
+ ******************************************************************************
+ */
+
+static gchar *
+VerifyChainDigest(const char *leafCert,
+                  int numUntrusted,
+                  const char **untrusted,
+                  int numTrusted,
+                  const char **trusted)
+{
+   GChecksum *sum = g_checksum_new(G_CHECKSUM_SHA256);
+   gchar *digest;
+   int i;
+
+   /*
+    * Include the NULs, so the boundaries between certs and the trusted
+    * and untrusted lists are part of the digest.
+    */
+   g_checksum_update(sum, (const guchar *) leafCert, strlen(leafCert) + 1);
+   for (i = 0; i < numUntrusted; i++) {
+      g_checksum_update(sum, (const guchar *) untrusted[i],
+                        strlen(untrusted[i]) + 1);
+   }
+   g_checksum_update(sum, (const guchar *) "", 1);
+   for (i = 0; i < numTrusted; i++) {
+      g_checksum_update(sum, (const guchar *) trusted[i],
+                        strlen(trusted[i]) + 1);
+   }
+
+   digest = g_strdup(g_checksum_get_string(sum));
+   g_checksum_free(sum);
+
+   return digest;
+}
+
+
+/*
+ ******************************************************************************
+ * VerifyChainCacheLookup --                                             */ /**
+ *
+ * Checks whether a chain was verified recently.
+ *
+ * @param[in]  digest     The chain digest.
+ *
+ * @return TRUE if the chain is known to be good.
+ *
+ ******************************************************************************
+ */
+
+static gboolean
+VerifyChainCacheLookup(const gchar *digest)
+{
+   gint64 *expireTime;
+   gboolean found = FALSE;
+
+   G_LOCK(gChainCache);
+   if (NULL != gChainCache) {
+      expireTime = g_hash_table_lookup(gChainCache, digest);
+      if (NULL != expireTime) {
+         if (g_get_real_time() / G_USEC_PER_SEC < *expireTime) {
+            found = TRUE;
+         } else {
+            g_hash_table_remove(gChainCache, digest);
+         }
+      }
+   }
+   G_UNLOCK(gChainCache);
+
+   return found;
+}
+
+
+/*
+ ******************************************************************************
+ * VerifyChainCacheAdd --                                                */ /**
+ *
+ * Remembers a verified chain.  If the cache is full, expired entries are
+ * dropped first, then the one closest to expiring.
+ *
+ * @param[in]  digest       The chain digest.
+ * @param[in]  validUntil   When the first cert in the chain expires.
+ *
+ ******************************************************************************
+ */
+
+static void
+VerifyChainCacheAdd(const gchar *digest,
+                    time_t validUntil)
+{
+   gint64 now = g_get_real_time() / G_USEC_PER_SEC;
+   gint64 *expireTime;
+   GHashTableIter iter;
+   gpointer key;
+   gpointer value;
+   gpointer oldestKey;
+   gint64 oldest;
+
+   if (validUntil <= now) {
+      return;
+   }
+
+   G_LOCK(gChainCache);
+   if (0 == gChainCacheSize) {
+      goto done;
+   }
+   if (NULL == gChainCache) {
+      gChainCache = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                          g_free, g_free);
+   }
+
+   if (g_hash_table_size(gChainCache) >= (guint) gChainCacheSize) {
+      oldestKey = NULL;
+      oldest = 0;
+      g_hash_table_iter_init(&iter, gChainCache);
+      while (g_hash_table_iter_next(&iter, &key, &value)) {
+         gint64 t = *(gint64 *) value;
+
+         if (t <= now) {
+            g_hash_table_iter_remove(&iter);
+         } else if (NULL == oldestKey || t < oldest) {
+            oldestKey = key;
+            oldest = t;
+         }
+      }
+      if (g_hash_table_size(gChainCache) >= (guint) gChainCacheSize) {
+         g_hash_table_remove(gChainCache, oldestKey);
+      }
+   }
+
+   expireTime = g_new(gint64, 1);
+   *expireTime = MIN((gint64) validUntil,
+                     now + VERIFY_CHAIN_CACHE_MAX_LIFETIME_SECS);
+   g_hash_table_replace(gChainCache, g_strdup(digest), expireTime);
+
+done:
+   G_UNLOCK(gChainCache);
+}
+
+
 /*
  ******************************************************************************
  * ServiceVerifyAndCheckTrustCertChainForSubject --                      */ /**
@@ -90,19 +306,20 @@ ServiceVerifyAndCheckTrustCertChainForSubject(int numCerts,
                                               ServiceAliasInfo **verifyAi)
 {
    VGAuthError err;
+   int numStoreMapped = 0;
    int numMapped = 0;
    ServiceMappedAlias *maList = NULL;
    int numStoreCerts = 0;
    ServiceAlias *aList = NULL;
-   int matchIdIdx = -1;
-   int matchSiIdx = -1;
-   ServiceAliasInfo *ai;
+   ServiceAlias *alias = NULL;
+   ServiceAliasInfo *matchAi = NULL;
    char **trustedCerts = NULL;
    int numTrusted = 0;
    char **untrustedCerts = NULL;
    int numUntrusted = 0;
    char *queryUserName = NULL;
    char *leafCert = NULL;
+   gchar *chainDigest = NULL;
    gboolean foundTrusted;
    int i;
    int j;
@@ -130,61 +347,65 @@ ServiceVerifyAndCheckTrustCertChainForSubject(int numCerts,
     * from the cert chain.
     */
    if (NULL == userName || *userName == '\0') {
-      err = ServiceAliasQueryMappedAliases(&numMapped, &maList);
-
-      if (VGAUTH_E_OK != err) {
-         goto done;
-      }
-      if (0 == numMapped) {
-         /*
-          * No username, no mapped certs, no chance.
-          */
-         Warning("%s: no mapping entries or specified userName\n",
-                 __FUNCTION__);
-         VMXLog_Log(VMXLOG_LEVEL_WARNING,
-                    "%s: no mapping entries or specified userName\n",
-                    __FUNCTION__);
-         err = VGAUTH_E_AUTHENTICATION_DENIED;
-         goto done;
-      }
-
       /*
-       * Search for a match in the mapped store.
+       * Search for a match in the mapped store.  The lookup goes through
+       * the store's cert index, so only the entries for each chain cert
+       * need to be examined.
        */
       for (i = 0; i < numCerts; i++) {
+         err = ServiceAliasQueryMappedAliasesByCert(pemCertChain[i],
+                                                    &numStoreMapped,
+                                                    &numMapped, &maList);
+         if (VGAUTH_E_OK != err) {
+            goto done;
+         }
+         if (0 == numStoreMapped) {
+            /*
+             * No username, no mapped certs, no chance.
+             */
+            Warning("%s: no mapping entries or specified userName\n",
+                    __FUNCTION__);
+            VMXLog_Log(VMXLOG_LEVEL_WARNING,
+                       "%s: no mapping entries or specified userName\n",
+                       __FUNCTION__);
+            err = VGAUTH_E_AUTHENTICATION_DENIED;
+            goto done;
+         }
+
          for (j = 0; j < numMapped; j++) {
-            if (ServiceComparePEMCerts(pemCertChain[i], maList[j].pemCert)) {
-               /*
-                * Make sure we don't have multiple matches with different users.
-                * Two possible scenarios that can trigger this:
-                * - the mapping file could be inconsistent
-                * - the chain coming in could have more than one cert that
-                *   exists in the mapping file, belonging to different users
-                */
-               if ((NULL != queryUserName) &&
-                   g_strcmp0(queryUserName, maList[j].userName) != 0) {
-                  Warning("%s: found more than one user in map file chain\n",
-                          __FUNCTION__);
-                  VMXLog_Log(VMXLOG_LEVEL_WARNING,
-                             "%s: found more than one user in map file chain\n",
-                          __FUNCTION__);
-                  err = VGAUTH_E_MULTIPLE_MAPPINGS;
-                  goto done;
-               }
+            /*
+             * Make sure we don't have multiple matches with different users.
+             * Two possible scenarios that can trigger this:
+             * - the mapping file could be inconsistent
+             * - the chain coming in could have more than one cert that
+             *   exists in the mapping file, belonging to different users
+             */
+            if ((NULL != queryUserName) &&
+                g_strcmp0(queryUserName, maList[j].userName) != 0) {
+               Warning("%s: found more than one user in map file chain\n",
+                       __FUNCTION__);
+               VMXLog_Log(VMXLOG_LEVEL_WARNING,
+                          "%s: found more than one user in map file chain\n",
+                       __FUNCTION__);
+               err = VGAUTH_E_MULTIPLE_MAPPINGS;
+               goto done;
+            }
 
-               for (k = 0; k < maList[j].num; k++) {
-                  if ((maList[j].subjects[k].type == SUBJECT_TYPE_ANY) ||
-                      ServiceAliasIsSubjectEqual(subj->type,
-                                                 maList[j].subjects[k].type,
-                                                 subj->name,
-                                                 maList[j].subjects[k].name)) {
-                     queryUserName = g_strdup(maList[j].userName);
-                     break;
-                  }
+            for (k = 0; k < maList[j].num; k++) {
+               if ((maList[j].subjects[k].type == SUBJECT_TYPE_ANY) ||
+                   ServiceAliasIsSubjectEqual(subj->type,
+                                              maList[j].subjects[k].type,
+                                              subj->name,
+                                              maList[j].subjects[k].name)) {
+                  queryUserName = g_strdup(maList[j].userName);
+                  break;
                }
-
             }
+
          }
+         ServiceAliasFreeMappedAliasList(numMapped, maList);
+         numMapped = 0;
+         maList = NULL;
       }
       /*
        * Subject went unmatched, so fail.
@@ -214,15 +435,15 @@ ServiceVerifyAndCheckTrustCertChainForSubject(int numCerts,
       goto done;
    }
 
-   err = ServiceAliasQueryAliases(queryUserName, &numStoreCerts, &aList);
-   if (VGAUTH_E_OK != err) {
-      goto done;
-   }
-
    /*
     * Dump the store cert chain for debugging purposes.
     */
    if (gVerboseLogging) {
+      err = ServiceAliasQueryAliases(queryUserName, &numStoreCerts, &aList);
+      if (VGAUTH_E_OK != err) {
+         goto done;
+      }
+
       Debug("%s: %d certs in store for user %s\n",  __FUNCTION__,
             numStoreCerts, queryUserName);
       for (i = 0; i < numStoreCerts; i++) {
@@ -242,41 +463,45 @@ ServiceVerifyAndCheckTrustCertChainForSubject(int numCerts,
       int foundSubjectIdx;
 
       foundTrusted = FALSE;
-      for (j = 0; j < numStoreCerts; j++) {
-         if (ServiceComparePEMCerts(pemCertChain[i], aList[j].pemCert)) {
+      err = ServiceAliasQueryAliasByCert(queryUserName, pemCertChain[i],
+                                         &alias);
+      if (VGAUTH_E_OK != err) {
+         goto done;
+      }
+      if (NULL != alias) {
+         foundAnyIdx = -1;
+         foundSubjectIdx = -1;
+
+         for (k = 0; k < alias->num; k++) {
+            if (alias->infos[k].type == SUBJECT_TYPE_ANY) {
+               foundAnyIdx = k;
+            } else if (ServiceAliasIsSubjectEqual(subj->type,
+                                                  alias->infos[k].type,
+                                                  subj->name,
+                                                  alias->infos[k].name)) {
+               foundSubjectIdx = k;
+            }
+         }
+         if ((foundSubjectIdx >= 0) || (foundAnyIdx >= 0)) {
+            numTrusted++;
+            trustedCerts = g_realloc_n(trustedCerts,
+                                       numTrusted, sizeof(*trustedCerts));
+            trustedCerts[numTrusted - 1] = g_strdup(pemCertChain[i]);
+            foundTrusted = TRUE;
             /*
-             * Remember the root cert, so we can return its AliasInfo
-             * if all checks out.
+             * Remember the matching ai, so we can return its comment
+             * if all checks out.  Note that a specific subject match takes
+             * precendence over an ANY match.
              */
-            matchIdIdx = j;
-            foundAnyIdx = -1;
-            foundSubjectIdx = -1;
-
-            for (k = 0; k < aList[j].num; k++) {
-               if (aList[j].infos[k].type == SUBJECT_TYPE_ANY) {
-                  foundAnyIdx = k;
-               } else if (ServiceAliasIsSubjectEqual(subj->type,
-                                                     aList[j].infos[k].type,
-                                                     subj->name,
-                                                     aList[j].infos[k].name)) {
-                  foundSubjectIdx = k;
-               }
-            }
-            if ((foundSubjectIdx >= 0) || (foundAnyIdx >= 0)) {
-               numTrusted++;
-               trustedCerts = g_realloc_n(trustedCerts,
-                                          numTrusted, sizeof(*trustedCerts));
-               trustedCerts[numTrusted - 1] = g_strdup(pemCertChain[i]);
-               foundTrusted = TRUE;
-               /*
-                * Remember the matching ai, so we can return its comment
-                * if all checks out.  Note that a specific subject match takes
-                * precendence over an ANY match.
-                */
-               matchSiIdx = (foundSubjectIdx >= 0) ?
-                  foundSubjectIdx : foundAnyIdx;
-            }
+            ServiceAliasFreeAliasInfo(matchAi);
+            matchAi = g_malloc0(sizeof(ServiceAliasInfo));
+            ServiceAliasCopyAliasInfoContents(
+               &alias->infos[(foundSubjectIdx >= 0) ?
+                             foundSubjectIdx : foundAnyIdx],
+               matchAi);
          }
+         ServiceAliasFreeAliasList(1, alias);
+         alias = NULL;
       }
       if (!foundTrusted) {
          numUntrusted++;
@@ -314,18 +539,35 @@ ServiceVerifyAndCheckTrustCertChainForSubject(int numCerts,
       ASSERT(0);
    }
 
-   err = CertVerify_CertChain(leafCert,
-                              numUntrusted,
-                              (const char **) untrustedCerts,
-                              numTrusted,
-                              (const char **) trustedCerts);
-   if (VGAUTH_E_OK != err) {
-      VMXLog_Log(VMXLOG_LEVEL_WARNING,
-                 "%s: cert chain validation failed\n", __FUNCTION__);
-      goto done;
-   }
+   /*
+    * The trusted certs come from the alias store, so a chain that was
+    * good under a since-removed alias hashes differently.
+    */
+   chainDigest = VerifyChainDigest(leafCert,
+                                   numUntrusted,
+                                   (const char **) untrustedCerts,
+                                   numTrusted,
+                                   (const char **) trustedCerts);
+   if (VerifyChainCacheLookup(chainDigest)) {
+      Debug("%s: cert chain previously validated", __FUNCTION__);
+   } else {
+      time_t validUntil;
+
+      err = CertVerify_CertChainEx(leafCert,
+                                   numUntrusted,
+                                   (const char **) untrustedCerts,
+                                   numTrusted,
+                                   (const char **) trustedCerts,
+                                   &validUntil);
+      if (VGAUTH_E_OK != err) {
+         VMXLog_Log(VMXLOG_LEVEL_WARNING,
+                    "%s: cert chain validation failed\n", __FUNCTION__);
+         goto done;
+      }
 
-   Debug("%s: cert chain successfully validated", __FUNCTION__);
+      Debug("%s: cert chain successfully validated", __FUNCTION__);
+      VerifyChainCacheAdd(chainDigest, validUntil);
+   }
 
    /*
     * Save off AliasInfo.
@@ -334,12 +576,9 @@ ServiceVerifyAndCheckTrustCertChainForSubject(int numCerts,
     * trusted certs in the alias store.  For now, use the root-most
     * (last found).
     */
-   ai = g_malloc0(sizeof(ServiceAliasInfo));
-   ASSERT(matchIdIdx >= 0 && matchSiIdx >= 0);
-   ai->type = aList[matchIdIdx].infos[matchSiIdx].type;
-   ai->name = g_strdup(aList[matchIdIdx].infos[matchSiIdx].name);
-   ai->comment = g_strdup(aList[matchIdIdx].infos[matchSiIdx].comment);
-   *verifyAi = ai;
+   ASSERT(matchAi != NULL);
+   *verifyAi = matchAi;
+   matchAi = NULL;
    *userNameOut = queryUserName;
    queryUserName = NULL;
 
@@ -347,6 +586,7 @@ done:
    ServiceAliasFreeMappedAliasList(numMapped, maList);
 
    ServiceAliasFreeAliasList(numStoreCerts, aList);
+   ServiceAliasFreeAliasInfo(matchAi);
 
    for (i = 0; i < numTrusted; i++) {
       g_free(trustedCerts[i]);
@@ -359,6 +599,7 @@ done:
    g_free(untrustedCerts);
 
    g_free(leafCert);
+   g_free(chainDigest);
    g_free(queryUserName);
 
    return err;
@@ -36,6 +36,8 @@
  *    - clear out any existing aliases
  *    - add an alias using the built-in cert
  *    - validate the SAML token
+ *    - with -l, validate the token from several threads at once and
+ *      report the throughput
  *
  *    Possible reasons for failure:
  *    - VGAuthService wasn't started
@@ -71,6 +73,13 @@
 
 static gchar *appName;
 
+/*
+ * Load test settings.
+ */
+static int loadThreads = 0;
+static int loadRequests = 0;
+static volatile gint loadFailures = 0;
+
 #define ALIAS_USER_NAME    "root"
 #define SUBJECT_NAME       "SmokeSubject"
 #define COMMENT            "Smoke comment"
@@ -198,7 +207,7 @@ static const gchar *token =
 static void
 Usage(void)
 {
-   fprintf(stderr, "Usage: %s\n", appName);
+   fprintf(stderr, "Usage: %s [-l numThreads numRequests]\n", appName);
    exit(-1);
 }
 
@@ -419,6 +428,109 @@ done:
 }
 
 
+/*
+ ******************************************************************************
+ * LoadTestThread --                                                     */ /**
+ *
+ * Validates the token loadRequests times on its own connection.
+ *
+ * @param[in]  data        Unused.
+ *
+ * @return NULL
+ *
+ ******************************************************************************
+ */
+
+static gpointer
+LoadTestThread(gpointer data)
+{
+   VGAuthError err;
+   VGAuthContext *ctx;
+   VGAuthExtraParams extraParams[1];
+   VGAuthUserHandle *userHandle;
+   int i;
+
+   /*
+    * Contexts aren't thread safe, and each one is its own connection
+    * to the service.
+    */
+   err = VGAuth_Init(appName, 0, NULL, &ctx);
+   if (VGAUTH_E_OK != err) {
+      g_printerr("Failed to init VGAuth");
+      g_atomic_int_add(&loadFailures, loadRequests);
+      return NULL;
+   }
+
+   extraParams[0].name = VGAUTH_PARAM_VALIDATE_INFO_ONLY;
+   extraParams[0].value = VGAUTH_PARAM_VALUE_TRUE;
+   for (i = 0; i < loadRequests; i++) {
+      userHandle = NULL;
+      err = VGAuth_ValidateSamlBearerToken(ctx,
+                                           token,
+                                           ALIAS_USER_NAME,
+                                           1,
+                                           extraParams,
+                                           &userHandle);
+      if (VGAUTH_E_OK != err) {
+         g_atomic_int_inc(&loadFailures);
+      }
+      VGAuth_UserHandleFree(userHandle);
+   }
+
+   VGAuth_Shutdown(ctx);
+   return NULL;
+}
+
+
+/*
+ ******************************************************************************
+ * LoadTest --                                                           */ /**
+ *
+ * Validates the token from loadThreads threads at once, and reports
+ * the request rate the service managed.  Compare runs with different
+ * requestWorkerThreads settings in the service.
+ *
+ * Note that after the first request, the service answers from its
+ * token cache unless that's disabled with samlTokenCacheSize=0.
+ *
+ * @return VGAUTH_E_OK if every request succeeded.
+ *
+ ******************************************************************************
+ */
+
+static VGAuthError
+LoadTest(void)
+{
+   GThread **threads;
+   gint64 start;
+   gint64 elapsed;
+   int total = loadThreads * loadRequests;
+   int i;
+
+   threads = g_new0(GThread *, loadThreads);
+
+   start = g_get_monotonic_time();
+   for (i = 0; i < loadThreads; i++) {
+      threads[i] = g_thread_new("loadtest", LoadTestThread, NULL);
+   }
+   for (i = 0; i < loadThreads; i++) {
+      g_thread_join(threads[i]);
+   }
+   elapsed = MAX(g_get_monotonic_time() - start, 1);
+
+   g_free(threads);
+
+   printf("Load test: %d threads, %d requests, %d failed, "
+          "%.3f seconds, %.1f requests/sec\n",
+          loadThreads, total, g_atomic_int_get(&loadFailures),
+          elapsed / (double) G_USEC_PER_SEC,
+          total * (double) G_USEC_PER_SEC / elapsed);
+
+   return (g_atomic_int_get(&loadFailures) == 0) ?
+      VGAUTH_E_OK : VGAUTH_E_FAIL;
+}
+
+
 /*
  ******************************************************************************
  * main --                                                               */ /**
@@ -442,7 +554,13 @@ main(int argc,
    VGAuthContext *ctx;
 
    appName = g_path_get_basename(argv[0]);
-   if (argc != 1) {
+   if (argc == 4 && strcmp(argv[1], "-l") == 0) {
+      loadThreads = atoi(argv[2]);
+      loadRequests = atoi(argv[3]);
+      if (loadThreads <= 0 || loadRequests <= 0) {
+         Usage();
+      }
+   } else if (argc != 1) {
       Usage();
    }
 
@@ -474,6 +592,14 @@ main(int argc,
       return -1;
    }
 
+   if (loadThreads > 0) {
+      err = LoadTest();
+      if (VGAUTH_E_OK != err) {
+         g_printerr("Load test failed");
+         return -1;
+      }
+   }
+
    printf("PASSED!\n");
 
    // make sure we end with a clean slate
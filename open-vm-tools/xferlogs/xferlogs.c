@@ -35,6 +35,9 @@
  *      Aug 24 18:48:10: vcpu-0| Guest: >Mi4K
  *      Aug 24 18:48:10: vcpu-0| Guest: >Logfile Ends
  *
+ *      With --compress, the file is sent in the framed format instead, see
+ *      xmitFileFramed.
+ *
  */
 
 #include <stdio.h>
@@ -44,6 +47,9 @@
 #include <errno.h>
 #include <time.h>
 #include <glib.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 #include "vmware.h"
 #include "vmsupport.h"
@@ -77,6 +83,17 @@ VM_EMBED_VERSION(XFERLOGS_VERSION_STRING);
 #define LOG_GUEST_MARK         "Guest: >"
 #define LOG_START_MARK         ">Logfile Begins "
 #define LOG_END_MARK           ">Logfile Ends "
+#define LOG_METHOD_RAW         "raw"
+#define LOG_METHOD_ZLIB        "zlib"
+
+/*
+ * Framed transfers send XFER_FRAME_SIZE bytes per line, which base64 encode
+ * to 1024 characters and leave room for the prefix within a vmx log line.
+ */
+#define XFER_FRAME_SIZE        768
+#define XFER_READ_SIZE         (64 * 1024)
+#define XFER_INFLATE_SIZE      (16 * 1024)
+#define BUF_LINE_SIZE          2048
 
 typedef enum {
    NOT_IN_GUEST_LOGGING,
@@ -84,6 +101,26 @@ typedef enum {
 } extractMode;
 
 #define LOG_VERSION            1
+#define LOG_VERSION_FRAMED     2
+
+/*
+ * Decoding state of a framed transfer in extractFile.
+ */
+typedef struct {
+   Bool framed;
+   Bool compressed;
+   Bool failed;           // a frame was lost or damaged
+   Bool streamEnd;        // the compressed stream is complete
+   FILE *outfp;
+   const char *fname;
+   uint32 nextSeq;
+   uint32 crc;            // of the data written so far
+   uint64 size;
+#ifdef HAVE_ZLIB
+   z_stream zs;
+   Bool zsInit;
+#endif
+} FramedXfer;
 
 
 /*
@@ -139,6 +176,537 @@ exit:
 }
 
 
+/*
+ *--------------------------------------------------------------------------
+ *
+ * XferCrc32 --
+ *
+ *       Computes the CRC-32 (as used by zlib and gzip) of a buffer,
+ *       continuing from a previous value. Start with 0.
+ *
+ * Results:
+ *       The updated CRC.
+ *
+ * Side effects:
+ *       Builds the lookup table on first use.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static uint32
+XferCrc32(uint32 crc,         // IN: CRC of the preceding data
+          const uint8 *buf,   // IN:
+          size_t len)         // IN:
+{
+   static uint32 table[256];
+   static Bool tableInit = FALSE;
+
+   if (!tableInit) {
+      uint32 i;
+
+      for (i = 0; i < ARRAYSIZE(table); i++) {
+         uint32 c = i;
+         int k;
+
+         for (k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+         }
+         table[i] = c;
+      }
+      tableInit = TRUE;
+   }
+
+   crc = ~crc;
+   while (len-- > 0) {
+      crc = table[(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+   }
+   return ~crc;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * xmitFrame --
+ *
+ *       Sends one frame of a framed transfer as a single vmx log line:
+ *       sequence number, CRC-32 of the frame and the base64 encoded frame.
+ *
+ * Results:
+ *       TRUE on success, FALSE if the frame could not be encoded.
+ *
+ * Side effects:
+ *       Output is added to the vmx log file. *seq is incremented.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static Bool
+xmitFrame(const uint8 *frame,  // IN:
+          size_t len,          // IN:
+          uint32 *seq)         // IN/OUT: frame sequence number
+{
+   char base64Buf[XFER_FRAME_SIZE / 3 * 4 + 1];
+
+   if (!Base64_Encode(frame, len, base64Buf, sizeof base64Buf, NULL)) {
+      Warning("Error in Base64_Encode\n");
+      return FALSE;
+   }
+
+   //XXX the format below is hardcoded and used by extractFrame
+   RpcVMX_Log(">%u %08x %s", *seq, XferCrc32(0, frame, len), base64Buf);
+   (*seq)++;
+   return TRUE;
+}
+
+
+#ifdef HAVE_ZLIB
+/*
+ *--------------------------------------------------------------------------
+ *
+ * xmitDeflate --
+ *
+ *       Runs the pending input of a deflate stream through the compressor
+ *       and sends every frame it fills. With Z_FINISH, also flushes the
+ *       stream and sends the last, partial, frame.
+ *
+ * Results:
+ *       TRUE on success, FALSE on error.
+ *
+ * Side effects:
+ *       Output is added to the vmx log file.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static Bool
+xmitDeflate(z_stream *zs,     // IN/OUT: stream with next_out set to frame
+            int flush,        // IN: Z_NO_FLUSH or Z_FINISH
+            uint8 *frame,     // IN: XFER_FRAME_SIZE output buffer
+            uint32 *seq)      // IN/OUT: frame sequence number
+{
+   int ret;
+
+   do {
+      ret = deflate(zs, flush);
+      if (ret == Z_STREAM_ERROR) {
+         Warning("Error in deflate\n");
+         return FALSE;
+      }
+
+      if (zs->avail_out == 0 || ret == Z_STREAM_END) {
+         size_t len = XFER_FRAME_SIZE - zs->avail_out;
+
+         if (len > 0 && !xmitFrame(frame, len, seq)) {
+            return FALSE;
+         }
+         zs->next_out = frame;
+         zs->avail_out = XFER_FRAME_SIZE;
+      }
+   } while (flush == Z_FINISH ? ret != Z_STREAM_END : zs->avail_in > 0);
+
+   return TRUE;
+}
+#endif
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * xmitFileFramed --
+ *
+ *       This function transfers a file to the vmx logs using the framed
+ *       format (LOG_VERSION_FRAMED). The file is optionally compressed
+ *       with zlib, then sent XFER_FRAME_SIZE bytes per log line instead of
+ *       BUF_BASE64_SIZE, which cuts the number of backdoor calls and log
+ *       lines by more than an order of magnitude. Every frame carries a
+ *       sequence number and a CRC-32, and the end mark carries the size and
+ *       CRC-32 of the original file, so that extractFile can tell whether
+ *       it got the file back intact.
+ *
+ *       A transfer looks like:
+ *       Guest: >Logfile Begins : /tmp/vm-support.tar.gz: ver - 2 : zlib
+ *       Guest: >0 8a9f3c21 eJzt3Qd4FFW/x/HNbEt2k0..
+ *       ....
+ *       Guest: >Logfile Ends : 1048576 5d2e8c0f
+ *
+ * Results:
+ *       None.
+ *
+ * Side effects:
+ *       The program would exit if the file cannot be opened.
+ *       Output is added to the vmx log file.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static void
+xmitFileFramed(char *filename,   // IN: file to be transmitted.
+               gboolean zip)     // IN: compress the file
+{
+   FILE *fp;
+   uint8 *inBuf;
+   uint8 frame[XFER_FRAME_SIZE];
+   size_t readLen;
+   uint32 seq = 0;
+   uint32 fileCrc = 0;
+   uint64 fileSize = 0;
+   Bool ok = FALSE;
+#ifdef HAVE_ZLIB
+   z_stream zs;
+#endif
+
+#ifndef HAVE_ZLIB
+   if (zip) {
+      Warning("Compression is not available, sending %s uncompressed\n",
+              filename);
+      zip = FALSE;
+   }
+#endif
+
+   if (!(fp = fopen(filename, "rb"))) {
+      Warning("Unable to open file %s with errno %d\n", filename, errno);
+      exit(-1);
+   }
+
+   inBuf = g_malloc(XFER_READ_SIZE);
+
+#ifdef HAVE_ZLIB
+   if (zip) {
+      memset(&zs, 0, sizeof zs);
+      if (deflateInit(&zs, Z_DEFAULT_COMPRESSION) != Z_OK) {
+         Warning("Error in deflateInit\n");
+         g_free(inBuf);
+         fclose(fp);
+         return;
+      }
+      zs.next_out = frame;
+      zs.avail_out = sizeof frame;
+   }
+#endif
+
+   //XXX the format below is hardcoded and used by extractFile
+   RpcVMX_Log("%s: %s: ver - %d : %s", LOG_START_MARK, filename,
+              LOG_VERSION_FRAMED, zip ? LOG_METHOD_ZLIB : LOG_METHOD_RAW);
+
+   while ((readLen = fread(inBuf, 1, XFER_READ_SIZE, fp)) > 0) {
+      fileCrc = XferCrc32(fileCrc, inBuf, readLen);
+      fileSize += readLen;
+
+#ifdef HAVE_ZLIB
+      if (zip) {
+         zs.next_in = inBuf;
+         zs.avail_in = readLen;
+         if (!xmitDeflate(&zs, Z_NO_FLUSH, frame, &seq)) {
+            goto exit;
+         }
+         continue;
+      }
+#endif
+
+      {
+         size_t off;
+
+         for (off = 0; off < readLen; off += XFER_FRAME_SIZE) {
+            if (!xmitFrame(inBuf + off, MIN(readLen - off, XFER_FRAME_SIZE),
+                           &seq)) {
+               goto exit;
+            }
+         }
+      }
+   }
+
+   if (ferror(fp)) {
+      Warning("Error reading file %s\n", filename);
+      goto exit;
+   }
+
+#ifdef HAVE_ZLIB
+   if (zip && !xmitDeflate(&zs, Z_FINISH, frame, &seq)) {
+      goto exit;
+   }
+#endif
+
+   ok = TRUE;
+
+exit:
+   /*
+    * A transfer that failed part way ends without the size and checksum,
+    * so extractFile reports it as incomplete.
+    */
+   if (ok) {
+      RpcVMX_Log("%s: %"FMT64"u %08x", LOG_END_MARK, fileSize, fileCrc);
+   } else {
+      RpcVMX_Log(LOG_END_MARK);
+   }
+#ifdef HAVE_ZLIB
+   if (zip) {
+      deflateEnd(&zs);
+   }
+#endif
+   g_free(inBuf);
+   fclose(fp);
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * extractStart --
+ *
+ *       Sets up the decoding of a framed transfer from the method named in
+ *       its start mark.
+ *
+ * Results:
+ *       TRUE if the transfer can be decoded, FALSE otherwise.
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static Bool
+extractStart(FramedXfer *xfer,    // OUT
+             const char *ver,     // IN: start mark from the version on
+             const char *fname)   // IN: output file name
+{
+   const char *method = strstr(ver, ": ");
+
+   memset(xfer, 0, sizeof *xfer);
+   xfer->framed = TRUE;
+   xfer->fname = fname;
+
+   if (method == NULL) {
+      Warning("No transfer method detected\n");
+      return FALSE;
+   }
+   method += 2;
+
+   if (strncmp(method, LOG_METHOD_RAW, sizeof LOG_METHOD_RAW - 1) == 0) {
+      return TRUE;
+   }
+
+   if (strncmp(method, LOG_METHOD_ZLIB, sizeof LOG_METHOD_ZLIB - 1) == 0) {
+#ifdef HAVE_ZLIB
+      if (inflateInit(&xfer->zs) != Z_OK) {
+         Warning("Error in inflateInit\n");
+         return FALSE;
+      }
+      xfer->zsInit = TRUE;
+      xfer->compressed = TRUE;
+      return TRUE;
+#else
+      Warning("This binary was built without zlib and cannot decompress "
+              "the input\n");
+      return FALSE;
+#endif
+   }
+
+   Warning("Unknown transfer method %s\n", method);
+   return FALSE;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * extractWrite --
+ *
+ *       Writes decoded data of a framed transfer to the output file and
+ *       accounts for it in the running size and CRC.
+ *
+ * Results:
+ *       TRUE on success, FALSE on a write error.
+ *
+ * Side effects:
+ *       Output is written to the file.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static Bool
+extractWrite(FramedXfer *xfer,    // IN/OUT
+             const uint8 *data,   // IN:
+             size_t len)          // IN:
+{
+   if (fwrite(data, 1, len, xfer->outfp) != len) {
+      Warning("Error writing output\n");
+      return FALSE;
+   }
+   xfer->crc = XferCrc32(xfer->crc, data, len);
+   xfer->size += len;
+   return TRUE;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * extractFrame --
+ *
+ *       Decodes one line of a framed transfer (see xmitFileFramed), checks
+ *       its sequence number and CRC, decompresses it if needed and writes
+ *       the result to the output file. Once a frame is lost or damaged the
+ *       rest of the transfer is skipped, as the output could not be trusted.
+ *
+ * Results:
+ *       None.
+ *
+ * Side effects:
+ *       Output is written to the file. xfer->failed is set on error.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static void
+extractFrame(FramedXfer *xfer,   // IN/OUT
+             const char *line)   // IN: log line after LOG_GUEST_MARK
+{
+   uint8 frame[XFER_FRAME_SIZE];
+   size_t frameLen;
+   unsigned long seq;
+   unsigned long crc;
+   char *end;
+
+   if (xfer->failed) {
+      return;
+   }
+
+   seq = strtoul(line, &end, 10);
+   if (end == line || *end != ' ') {
+      Warning("Invalid frame %s\n", line);
+      goto error;
+   }
+   line = end + 1;
+   crc = strtoul(line, &end, 16);
+   if (end == line || *end != ' ') {
+      Warning("Invalid frame %s\n", line);
+      goto error;
+   }
+
+   if (seq != xfer->nextSeq) {
+      Warning("Frame %u is missing, skipping the rest of the file\n",
+              xfer->nextSeq);
+      goto error;
+   }
+   xfer->nextSeq++;
+
+   if (!Base64_Decode(end + 1, frame, sizeof frame, &frameLen)) {
+      Warning("Error decoding frame %lu\n", seq);
+      goto error;
+   }
+
+   if (XferCrc32(0, frame, frameLen) != crc) {
+      Warning("Frame %lu is damaged, skipping the rest of the file\n", seq);
+      goto error;
+   }
+
+#ifdef HAVE_ZLIB
+   if (xfer->compressed) {
+      uint8 out[XFER_INFLATE_SIZE];
+      int ret;
+
+      xfer->zs.next_in = frame;
+      xfer->zs.avail_in = frameLen;
+      do {
+         xfer->zs.next_out = out;
+         xfer->zs.avail_out = sizeof out;
+         ret = inflate(&xfer->zs, Z_NO_FLUSH);
+         if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+            Warning("Error decompressing frame %lu: %d\n", seq, ret);
+            goto error;
+         }
+         if (!extractWrite(xfer, out, sizeof out - xfer->zs.avail_out)) {
+            goto error;
+         }
+      } while (xfer->zs.avail_out == 0 ||
+               (xfer->zs.avail_in > 0 && ret != Z_STREAM_END));
+      if (ret == Z_STREAM_END) {
+         xfer->streamEnd = TRUE;
+      }
+      return;
+   }
+#endif
+
+   if (extractWrite(xfer, frame, frameLen)) {
+      return;
+   }
+
+error:
+   xfer->failed = TRUE;
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * extractEnd --
+ *
+ *       Checks the end mark of a framed transfer against what was written:
+ *       the guest sends the size and CRC-32 of the original file.
+ *
+ * Results:
+ *       None.
+ *
+ * Side effects:
+ *       Reports the outcome of the transfer.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static void
+extractEnd(FramedXfer *xfer,   // IN
+           const char *line)   // IN: log line from LOG_END_MARK on
+{
+   uint64 size;
+   unsigned int crc;
+
+   if (xfer->failed) {
+      Warning("%s is incomplete or damaged\n", xfer->fname);
+   } else if (sscanf(line + sizeof LOG_END_MARK - 1, ": %"FMT64"u %x",
+                     &size, &crc) != 2) {
+      Warning("%s is incomplete, the guest did not finish sending it\n",
+              xfer->fname);
+   } else if (size != xfer->size || crc != xfer->crc ||
+              (xfer->compressed && !xfer->streamEnd)) {
+      Warning("%s does not match the original file: size %"FMT64"u, "
+              "expected %"FMT64"u\n", xfer->fname, xfer->size, size);
+   } else {
+      printf("Verified %s, %"FMT64"u bytes\n", xfer->fname, size);
+   }
+}
+
+
+/*
+ *--------------------------------------------------------------------------
+ *
+ * extractReset --
+ *
+ *       Releases the decoding state of a framed transfer. The output file
+ *       is owned, and closed, by extractFile.
+ *
+ * Results:
+ *       None.
+ *
+ * Side effects:
+ *       None.
+ *
+ *--------------------------------------------------------------------------
+ */
+
+static void
+extractReset(FramedXfer *xfer)   // IN/OUT
+{
+#ifdef HAVE_ZLIB
+   if (xfer->zsInit) {
+      inflateEnd(&xfer->zs);
+   }
+#endif
+   memset(xfer, 0, sizeof *xfer);
+}
+
+
 /*
  *--------------------------------------------------------------------------
  *
@@ -162,7 +730,8 @@ extractFile(char *filename) //IN: vmx log filename e.g. vmware.log
 {
    FILE *fp;
    FILE *outfp = NULL;
-   char buf[BUF_OUT_SIZE];
+   FramedXfer xfer;
+   char buf[BUF_LINE_SIZE];
    uint8 base64Out[BUF_OUT_SIZE];
    size_t lenOut;
    char fname[256];
@@ -171,6 +740,7 @@ extractFile(char *filename) //IN: vmx log filename e.g. vmware.log
    int filenu = 0; // output file enumerator
    DEBUG_ONLY(extractMode state = NOT_IN_GUEST_LOGGING);
 
+   memset(&xfer, 0, sizeof xfer);
 
    if (!(fp = fopen(filename, "rt"))) {
       Warning("Error opening file %s, errno %d - %s \n",
@@ -202,6 +772,7 @@ extractFile(char *filename) //IN: vmx log filename e.g. vmware.log
             } else {
                ASSERT(state == NOT_IN_GUEST_LOGGING);
             }
+            extractReset(&xfer);
             DEBUG_ONLY(state = IN_GUEST_LOGGING);
 
             /*
@@ -249,14 +820,18 @@ extractFile(char *filename) //IN: vmx log filename e.g. vmware.log
             } else {
                ver = ver + sizeof "ver - " - 1;
                version = strtol(ver, NULL, 0);
-               if (version != LOG_VERSION) {
+               if (version != LOG_VERSION && version != LOG_VERSION_FRAMED) {
                   Warning("Input version %d doesn't match the\
                           version of this binary %d", version, LOG_VERSION);
+               } else if (version == LOG_VERSION_FRAMED &&
+                          !extractStart(&xfer, ver, fname)) {
+                  Warning("Skipping %s\n", logInpFilename);
                } else {
                   printf("Reading file %s to %s \n", logInpFilename, fname);
                   if (!(outfp = fopen(fname, "wb"))) {
                      Warning("Error opening file %s\n", fname);
                   }
+                  xfer.outfp = outfp;
                }
             }
          } else if (strstr(buf, LOG_END_MARK)) { // close the output file.
@@ -266,19 +841,25 @@ extractFile(char *filename) //IN: vmx log filename e.g. vmware.log
              */
             if (outfp) {
                ASSERT(state == IN_GUEST_LOGGING);
+               if (xfer.framed) {
+                  extractEnd(&xfer, strstr(buf, LOG_END_MARK));
+               }
                fclose(outfp);
                outfp = NULL;
             } else {
                ASSERT(state == NOT_IN_GUEST_LOGGING);
                Warning("Reached file end mark without start mark\n");
             }
+            extractReset(&xfer);
             DEBUG_ONLY(state = NOT_IN_GUEST_LOGGING);
          } else { // write to the output file
             if (outfp) {
                ASSERT(state == IN_GUEST_LOGGING);
                ptrStr = strstr(buf, LOG_GUEST_MARK);
                ptrStr += sizeof LOG_GUEST_MARK - 1;
-               if (Base64_Decode(ptrStr, base64Out, BUF_OUT_SIZE, &lenOut)) {
+               if (xfer.framed) {
+                  extractFrame(&xfer, ptrStr);
+               } else if (Base64_Decode(ptrStr, base64Out, BUF_OUT_SIZE, &lenOut)) {
                   if (fwrite(base64Out, 1, lenOut, outfp) != lenOut) {
                      Warning("Error writing output\n");
                   }
@@ -298,8 +879,12 @@ extractFile(char *filename) //IN: vmx log filename e.g. vmware.log
     */
    if (outfp) {
       ASSERT(state == IN_GUEST_LOGGING);
+      if (xfer.framed) {
+         Warning("%s is incomplete, the end mark is missing\n", fname);
+      }
       fclose(outfp);
    }
+   extractReset(&xfer);
    fclose(fp);
 }
 
@@ -321,6 +906,7 @@ main(int argc,
    gchar *encBuffer = NULL; // storage for filename for 'enc' option
    gchar *decBuffer = NULL; // storage for filename for 'dec' option
    gchar *vmsupportStatus = NULL; // storage for vmsupport status for 'upd' opt
+   gboolean compress = FALSE;     // use the framed format for 'put'
    int success = -1;
    int status;
    /*
@@ -333,6 +919,9 @@ main(int argc,
    GOptionEntry options[] = {
       {"put", 'p', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_FILENAME, &encBuffer,
        "encodes and transfers <filename> to the VMX log.", "<filename>"},
+      {"compress", 'z', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_NONE, &compress,
+       "with --put, compresses <filename> and sends it in large, checksummed "
+       "frames. Needs a matching --get to extract.", NULL},
       {"get", 'g', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_FILENAME, &decBuffer,
        "extracts encoded data to <filename> from the VMX log.", "<filename>"},
       {"update", 'u', G_OPTION_FLAG_IN_MAIN, G_OPTION_ARG_STRING,
@@ -402,7 +991,11 @@ main(int argc,
    }
 
    if (encBuffer != NULL) {
-      xmitFile(encBuffer);
+      if (compress) {
+         xmitFileFramed(encBuffer, TRUE);
+      } else {
+         xmitFile(encBuffer);
+      }
    } else if (decBuffer != NULL) {
       extractFile(decBuffer);
    } else if (vmsupportStatus != NULL) {